@@ -20,26 +20,46 @@
 #endif
 
 #include <QAbstractItemModel>
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QDataStream>
 #include <QDir>
+#include <QElapsedTimer>
 #include <QIODevice>
 #include <QLabel>
 #include <QModelIndex>
+#include <QSemaphore>
 #include <QSettings>
 #include <QTextEdit>
+#include <QThread>
 #include <QtPlugin>
 #include <QVBoxLayout>
 
+#ifdef HAS_SODIUM
+#   include <sodium.h>
+#endif
+
+#include <atomic>
+#include <memory>
+
 namespace {
 
 const QLatin1String mimeEncryptedData("application/x-copyq-encrypted");
 
 const QLatin1String dataFileHeader("CopyQ_encrypted_tab");
 const QLatin1String dataFileHeaderV2("CopyQ_encrypted_tab v2");
+// Items encrypted separately (libsodium) with a data key which is encrypted with GnuPG.
+const QLatin1String dataFileHeaderV3("CopyQ_encrypted_tab v3");
 
 const QLatin1String configEncryptTabs("encrypt_tabs");
 
 const int maxItemCount = 10000;
 
+const int loadBatchSize = 100;
+const int loadBatchIntervalMs = 100;
+const int waitForDecryptedDataMs = 100;
+const int decryptChunkSize = 64 * 1024;
+
 bool waitOrTerminate(QProcess *p, int timeoutMs)
 {
     p->waitForStarted();
@@ -200,6 +220,145 @@ QByteArray readGpgOutput(const QStringList &args, const QByteArray &input = QByt
     return p.readAllStandardOutput();
 }
 
+QByteArray decryptWithGpg(const QByteArray &encryptedBytes, const std::atomic_bool &canceled)
+{
+    QProcess p;
+    startGpgProcess( &p, QStringList("--decrypt"), QIODevice::ReadWrite );
+    p.write(encryptedBytes);
+    p.closeWriteChannel();
+
+    // Wait for password entry dialog.
+    while ( p.state() != QProcess::NotRunning && !p.waitForFinished(waitForDecryptedDataMs) ) {
+        if (canceled) {
+            p.kill();
+            p.waitForFinished();
+            return QByteArray();
+        }
+    }
+
+    if ( !verifyProcess(&p) )
+        return QByteArray();
+
+    return p.readAllStandardOutput();
+}
+
+#ifdef HAS_SODIUM
+bool initSodium()
+{
+    static const bool initialized = sodium_init() >= 0;
+    return initialized;
+}
+
+QByteArray randomKey(size_t size)
+{
+    QByteArray key(static_cast<int>(size), Qt::Uninitialized);
+    randombytes_buf(key.data(), size);
+    return key;
+}
+
+QByteArray newDataKey()
+{
+    return initSodium() ? randomKey(crypto_secretbox_KEYBYTES) : QByteArray();
+}
+
+const unsigned char *bytesData(const QByteArray &bytes)
+{
+    return reinterpret_cast<const unsigned char*>(bytes.constData());
+}
+
+/// Returns nonce and authenticated encrypted bytes (or empty array on error).
+QByteArray encryptItem(const QByteArray &bytes, const QByteArray &dataKey)
+{
+    QByteArray encryptedItem(
+        static_cast<int>(crypto_secretbox_NONCEBYTES + crypto_secretbox_MACBYTES) + bytes.size(),
+        Qt::Uninitialized);
+    auto nonce = reinterpret_cast<unsigned char*>(encryptedItem.data());
+    randombytes_buf(nonce, crypto_secretbox_NONCEBYTES);
+
+    const int result = crypto_secretbox_easy(
+        nonce + crypto_secretbox_NONCEBYTES,
+        bytesData(bytes), static_cast<unsigned long long>(bytes.size()),
+        nonce, bytesData(dataKey) );
+    return result == 0 ? encryptedItem : QByteArray();
+}
+
+bool decryptItem(const QByteArray &encryptedItem, const QByteArray &dataKey, QByteArray *bytes)
+{
+    const int headerSize = static_cast<int>(crypto_secretbox_NONCEBYTES + crypto_secretbox_MACBYTES);
+    if ( encryptedItem.size() < headerSize || dataKey.size() != static_cast<int>(crypto_secretbox_KEYBYTES) )
+        return false;
+
+    bytes->resize(encryptedItem.size() - headerSize);
+    const auto nonce = bytesData(encryptedItem);
+    return crypto_secretbox_open_easy(
+        reinterpret_cast<unsigned char*>(bytes->data()),
+        nonce + crypto_secretbox_NONCEBYTES,
+        static_cast<unsigned long long>(encryptedItem.size()) - crypto_secretbox_NONCEBYTES,
+        nonce, bytesData(dataKey) ) == 0;
+}
+
+/**
+ * Returns keyed hash of serialized item to find already encrypted items.
+ *
+ * The key is random and hashes are kept only in memory.
+ */
+QByteArray itemHash(const QByteArray &bytes, const QByteArray &hashKey)
+{
+    QByteArray hash(static_cast<int>(crypto_generichash_BYTES), Qt::Uninitialized);
+    crypto_generichash(
+        reinterpret_cast<unsigned char*>(hash.data()), crypto_generichash_BYTES,
+        bytesData(bytes), static_cast<unsigned long long>(bytes.size()),
+        bytesData(hashKey), static_cast<size_t>(hashKey.size()) );
+    return hash;
+}
+
+QByteArray newItemHashKey()
+{
+    return initSodium() ? randomKey(crypto_generichash_KEYBYTES) : QByteArray();
+}
+
+/**
+ * Returns the last record in tab which contains number of items and hash of
+ * all encrypted items so items cannot be removed or reordered.
+ */
+QByteArray tabSummary(quint32 itemCount, const QByteArray &encryptedItemsHash)
+{
+    QByteArray bytes;
+    QDataStream stream(&bytes, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_4_7);
+    stream << itemCount << encryptedItemsHash;
+    return bytes;
+}
+#endif
+
+QByteArray serializeItem(const QVariantMap &dataMap)
+{
+    QByteArray bytes;
+    QDataStream stream(&bytes, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_4_7);
+    stream << dataMap;
+    return bytes;
+}
+
+bool deserializeItem(const QByteArray &bytes, QVariantMap *dataMap)
+{
+    QDataStream stream(bytes);
+    stream.setVersion(QDataStream::Qt_4_7);
+    stream >> *dataMap;
+    return stream.status() == QDataStream::Ok;
+}
+
+bool readHeader(QIODevice *file, QString *header)
+{
+    QDataStream stream(file);
+    stream.setVersion(QDataStream::Qt_4_7);
+    stream >> *header;
+
+    return stream.status() == QDataStream::Ok
+            && (*header == dataFileHeader || *header == dataFileHeaderV2
+                || *header == dataFileHeaderV3);
+}
+
 bool keysExist()
 {
     return !readGpgOutput( QStringList("--list-keys") ).isEmpty();
@@ -281,6 +440,280 @@ bool isGpgInstalled()
 
 } // namespace
 
+/// Decrypts items in background.
+class ItemEncryptedTabLoader final : public QThread
+{
+    Q_OBJECT
+
+public:
+    ItemEncryptedTabLoader(
+            const QByteArray &encryptedData, bool itemsEncryptedSeparately,
+            const QByteArray &itemHashKey, int maxItems)
+        : m_encryptedData(encryptedData)
+        , m_itemsEncryptedSeparately(itemsEncryptedSeparately)
+        , m_itemHashKey(itemHashKey)
+        , m_maxItems( qMin(maxItems, maxItemCount) )
+    {
+    }
+
+    void cancel() { m_canceled = true; }
+
+    bool failed() const { return m_failed; }
+
+    /**
+     * Blocks until the first item is decrypted (after password prompt) or
+     * loading ends.
+     *
+     * Returns false if decryption failed or was canceled.
+     */
+    bool waitForDecrypting()
+    {
+        m_decryptingSemaphore.acquire();
+        return m_decrypting;
+    }
+
+    const QByteArray &dataKey() const { return m_dataKey; }
+    const QByteArray &wrappedDataKey() const { return m_wrappedDataKey; }
+
+signals:
+    /// Decrypted items, for separately encrypted items also their hashes and encrypted data.
+    void itemsLoaded(
+        const QVector<QVariantMap> &items, const QVector<QByteArray> &hashes,
+        const QVector<QByteArray> &encryptedItems);
+
+protected:
+    void run() override
+    {
+        m_batchTimer.start();
+        const bool ok = m_itemsEncryptedSeparately ? loadEncryptedItems() : loadEncryptedTab();
+        m_failed = !ok && !m_canceled;
+        if (ok)
+            flushItems();
+        setDecrypting(ok);
+    }
+
+private:
+    bool loadEncryptedItems()
+    {
+#ifdef HAS_SODIUM
+        if ( !initSodium() ) {
+            COPYQ_LOG("ItemEncrypt ERROR: Failed to initialize libsodium");
+            return false;
+        }
+
+        QDataStream stream(m_encryptedData);
+        stream.setVersion(QDataStream::Qt_4_7);
+
+        QByteArray wrappedDataKey;
+        stream >> wrappedDataKey;
+        if ( stream.status() != QDataStream::Ok ) {
+            COPYQ_LOG("ItemEncrypt ERROR: Failed to read encrypted tab header");
+            return false;
+        }
+
+        const QByteArray dataKey = decryptWithGpg(wrappedDataKey, m_canceled);
+        if ( dataKey.size() != static_cast<int>(crypto_secretbox_KEYBYTES) ) {
+            COPYQ_LOG("ItemEncrypt ERROR: Failed to decrypt data key");
+            return false;
+        }
+        m_dataKey = dataKey;
+        m_wrappedDataKey = wrappedDataKey;
+
+        // Items are followed by tab summary (see tabSummary()).
+        QCryptographicHash encryptedItemsHash(QCryptographicHash::Sha256);
+        quint32 itemCount = 0;
+        for (;;) {
+            if (m_canceled)
+                return false;
+
+            QByteArray encryptedItem;
+            stream >> encryptedItem;
+            if ( stream.status() != QDataStream::Ok ) {
+                COPYQ_LOG("ItemEncrypt ERROR: Failed to read encrypted item");
+                return false;
+            }
+
+            QByteArray bytes;
+            if ( stream.atEnd() ) {
+                if ( !decryptItem(encryptedItem, dataKey, &bytes)
+                     || bytes != tabSummary(itemCount, encryptedItemsHash.result()) )
+                {
+                    COPYQ_LOG("ItemEncrypt ERROR: Failed to verify encrypted tab");
+                    return false;
+                }
+                return true;
+            }
+
+            encryptedItemsHash.addData(encryptedItem);
+            ++itemCount;
+
+            // Items over the limit are only verified.
+            if ( static_cast<int>(itemCount) > m_maxItems )
+                continue;
+
+            QVariantMap dataMap;
+            if ( !decryptItem(encryptedItem, dataKey, &bytes)
+                 || !deserializeItem(bytes, &dataMap) )
+            {
+                COPYQ_LOG("ItemEncrypt ERROR: Failed to decrypt item!");
+                return false;
+            }
+
+            setDecrypting(true);
+            addItem(dataMap, itemHash(bytes, m_itemHashKey), encryptedItem);
+        }
+#else
+        COPYQ_LOG("ItemEncrypt ERROR: The tab can be loaded only if plugin is built with libsodium");
+        return false;
+#endif
+    }
+
+    /// Parses items from GnuPG output while it's being decrypted.
+    bool loadEncryptedTab()
+    {
+        QProcess p;
+        startGpgProcess( &p, QStringList("--decrypt"), QIODevice::ReadWrite );
+
+        QDataStream stream(&p);
+        stream.setVersion(QDataStream::Qt_4_7);
+
+        int written = 0;
+        int count = -1;
+        int loaded = 0;
+
+        for (;;) {
+            if (m_canceled) {
+                p.kill();
+                p.waitForFinished();
+                return false;
+            }
+
+            // Pass more data to GnuPG after it consumed previous chunk.
+            if ( written < m_encryptedData.size() && p.bytesToWrite() == 0 ) {
+                const int size = qMin(decryptChunkSize, m_encryptedData.size() - written);
+                p.write(m_encryptedData.constData() + written, size);
+                written += size;
+                if ( written == m_encryptedData.size() ) {
+                    p.closeWriteChannel();
+                    m_encryptedData.clear();
+                    written = 0;
+                }
+            }
+
+            while (loaded != count) {
+                stream.startTransaction();
+                if (count == -1) {
+                    quint64 length;
+                    stream >> length;
+                    if ( stream.commitTransaction() ) {
+                        if (length == 0) {
+                            COPYQ_LOG("ItemEncrypt ERROR: Failed to parse item count!");
+                            p.kill();
+                            p.waitForFinished();
+                            return false;
+                        }
+                        count = static_cast<int>( qMin(length, static_cast<quint64>(m_maxItems)) );
+                        continue;
+                    }
+                } else {
+                    QVariantMap dataMap;
+                    stream >> dataMap;
+                    if ( stream.commitTransaction() ) {
+                        setDecrypting(true);
+                        addItem(dataMap, QByteArray(), QByteArray());
+                        ++loaded;
+                        continue;
+                    }
+                }
+
+                if ( stream.status() != QDataStream::ReadPastEnd ) {
+                    COPYQ_LOG("ItemEncrypt ERROR: Failed to decrypt item!");
+                    p.kill();
+                    p.waitForFinished();
+                    return false;
+                }
+                break;
+            }
+
+            if (loaded == count)
+                break;
+
+            if ( m_batchTimer.hasExpired(loadBatchIntervalMs) )
+                flushItems();
+
+            if ( p.state() == QProcess::NotRunning && p.bytesAvailable() == 0 ) {
+                verifyProcess(&p);
+                COPYQ_LOG("ItemEncrypt ERROR: Failed to read encrypted data.");
+                return false;
+            }
+
+            p.waitForReadyRead(waitForDecryptedDataMs);
+        }
+
+        p.closeReadChannel(QProcess::StandardOutput);
+        while ( p.state() != QProcess::NotRunning && !p.waitForFinished(waitForDecryptedDataMs) ) {
+            if (m_canceled) {
+                p.kill();
+                p.waitForFinished();
+                return false;
+            }
+        }
+        return verifyProcess(&p);
+    }
+
+    void setDecrypting(bool decrypting)
+    {
+        if (m_decryptingSet)
+            return;
+
+        m_decryptingSet = true;
+        m_decrypting = decrypting;
+        m_decryptingSemaphore.release();
+    }
+
+    void addItem(const QVariantMap &dataMap, const QByteArray &hash, const QByteArray &encryptedItem)
+    {
+        m_items.append(dataMap);
+        if ( !hash.isEmpty() ) {
+            m_hashes.append(hash);
+            m_encryptedItems.append(encryptedItem);
+        }
+
+        if ( m_items.size() >= loadBatchSize || m_batchTimer.hasExpired(loadBatchIntervalMs) )
+            flushItems();
+    }
+
+    void flushItems()
+    {
+        if ( !m_items.isEmpty() )
+            emit itemsLoaded(m_items, m_hashes, m_encryptedItems);
+        m_items.clear();
+        m_hashes.clear();
+        m_encryptedItems.clear();
+        m_batchTimer.restart();
+    }
+
+    QByteArray m_encryptedData;
+    bool m_itemsEncryptedSeparately;
+    QByteArray m_itemHashKey;
+    int m_maxItems;
+
+    QByteArray m_dataKey;
+    QByteArray m_wrappedDataKey;
+
+    QVector<QVariantMap> m_items;
+    QVector<QByteArray> m_hashes;
+    QVector<QByteArray> m_encryptedItems;
+    QElapsedTimer m_batchTimer;
+
+    std::atomic_bool m_canceled{false};
+    bool m_failed = false;
+
+    QSemaphore m_decryptingSemaphore;
+    bool m_decryptingSet = false;
+    bool m_decrypting = false;
+};
+
 ItemEncrypted::ItemEncrypted(QWidget *parent)
     : QWidget(parent)
     , ItemWidget(this)
@@ -293,12 +726,135 @@ ItemEncrypted::ItemEncrypted(QWidget *parent)
     layout->addWidget(iconWidget);
 }
 
+ItemEncryptedSaver::~ItemEncryptedSaver()
+{
+    cancelLoading();
+}
+
+bool ItemEncryptedSaver::loadItems(
+        const QByteArray &encryptedData, bool itemsEncryptedSeparately,
+        QAbstractItemModel *model, int maxItems)
+{
+    cancelLoading();
+
+    m_model = model;
+    m_maxItems = maxItems;
+    m_loadFailed = false;
+
+#ifdef HAS_SODIUM
+    if ( m_itemHashKey.isEmpty() )
+        m_itemHashKey = newItemHashKey();
+#endif
+
+    m_loader = new ItemEncryptedTabLoader(
+        encryptedData, itemsEncryptedSeparately, m_itemHashKey, maxItems);
+    connect( m_loader, &ItemEncryptedTabLoader::itemsLoaded,
+             this, &ItemEncryptedSaver::onItemsLoaded );
+    connect( m_loader, &QThread::finished, this, [this]() {
+        if (m_loader)
+            finishLoading();
+    });
+    m_loader->start();
+
+    // Tab fails to load if the password prompt is canceled or the data
+    // cannot be decrypted; only the rest is loaded in background.
+    if ( !m_loader->waitForDecrypting() ) {
+        finishLoading();
+        return false;
+    }
+
+    return true;
+}
+
 bool ItemEncryptedSaver::saveItems(const QString &, const QAbstractItemModel &model, QIODevice *file)
 {
-    const auto length = model.rowCount();
-    if (length == 0)
+    waitForLoaded();
+
+    // Avoid overwriting items which failed to decrypt.
+    if (m_loadFailed) {
+        COPYQ_LOG("ItemEncrypt ERROR: Refusing to save tab which failed to load");
+        return false;
+    }
+
+    if (model.rowCount() == 0)
         return false; // No need to encode empty tab.
 
+#ifdef HAS_SODIUM
+    return saveItemsEncryptedSeparately(model, file);
+#else
+    return saveItemsEncryptedWithGpg(model, file);
+#endif
+}
+
+#ifdef HAS_SODIUM
+bool ItemEncryptedSaver::saveItemsEncryptedSeparately(const QAbstractItemModel &model, QIODevice *file)
+{
+    if ( m_dataKey.isEmpty() ) {
+        const QByteArray dataKey = newDataKey();
+        const QByteArray wrappedDataKey = dataKey.isEmpty()
+            ? QByteArray() : readGpgOutput(QStringList("--encrypt"), dataKey);
+        if ( wrappedDataKey.isEmpty() ) {
+            emitEncryptFailed();
+            COPYQ_LOG("ItemEncrypt ERROR: Failed to encrypt data key");
+            return false;
+        }
+        m_dataKey = dataKey;
+        m_wrappedDataKey = wrappedDataKey;
+    }
+
+    if ( m_itemHashKey.isEmpty() )
+        m_itemHashKey = newItemHashKey();
+
+    const auto length = model.rowCount();
+    QHash<QByteArray, QByteArray> encryptedItems;
+    encryptedItems.reserve(length);
+    QCryptographicHash encryptedItemsHash(QCryptographicHash::Sha256);
+
+    QDataStream stream(file);
+    stream.setVersion(QDataStream::Qt_4_7);
+    stream << QString(dataFileHeaderV3);
+    stream << m_wrappedDataKey;
+
+    for (int i = 0; i < length && stream.status() == QDataStream::Ok; ++i) {
+        const QModelIndex index = model.index(i, 0);
+        const QByteArray bytes = serializeItem( index.data(contentType::data).toMap() );
+        const QByteArray hash = itemHash(bytes, m_itemHashKey);
+
+        QByteArray encryptedItem = m_encryptedItems.value(hash);
+        if ( encryptedItem.isEmpty() ) {
+            encryptedItem = encryptItem(bytes, m_dataKey);
+            if ( encryptedItem.isEmpty() ) {
+                emitEncryptFailed();
+                COPYQ_LOG("ItemEncrypt ERROR: Failed to encrypt item");
+                return false;
+            }
+        }
+
+        encryptedItems.insert(hash, encryptedItem);
+        encryptedItemsHash.addData(encryptedItem);
+        stream << encryptedItem;
+    }
+
+    const QByteArray summary = encryptItem(
+        tabSummary(static_cast<quint32>(length), encryptedItemsHash.result()), m_dataKey );
+    stream << summary;
+
+    if ( summary.isEmpty() || stream.status() != QDataStream::Ok ) {
+        emitEncryptFailed();
+        COPYQ_LOG("ItemEncrypt ERROR: Failed to write encrypted data");
+        return false;
+    }
+
+    m_encryptedItems = encryptedItems;
+
+    return true;
+}
+#endif
+
+bool ItemEncryptedSaver::saveItemsEncryptedWithGpg(const QAbstractItemModel &model, QIODevice *file)
+{
+    const auto length = model.rowCount();
+
     QByteArray bytes;
 
     {
@@ -335,6 +891,84 @@ bool ItemEncryptedSaver::saveItems(const QString &, const QAbstractItemModel &mo
     return true;
 }
 
+bool ItemEncryptedSaver::isLoading() const
+{
+    return m_loader != nullptr;
+}
+
+void ItemEncryptedSaver::waitForLoaded()
+{
+    if (!m_loader)
+        return;
+
+    // Deliver pending items in order; finished() is delivered after them.
+    m_loader->wait();
+    QCoreApplication::sendPostedEvents(this, QEvent::MetaCall);
+
+    if (m_loader)
+        finishLoading();
+}
+
+void ItemEncryptedSaver::onItemsLoaded(
+        const QVector<QVariantMap> &items, const QVector<QByteArray> &hashes,
+        const QVector<QByteArray> &encryptedItems)
+{
+    for (int i = 0; i < hashes.size(); ++i) {
+        if ( !hashes[i].isEmpty() )
+            m_encryptedItems.insert(hashes[i], encryptedItems[i]);
+    }
+
+    if (!m_model)
+        return;
+
+    // Items added while loading count towards the maximum.
+    const int row = m_model->rowCount();
+    const int count = qBound(0, m_maxItems - row, items.size());
+    if (count == 0)
+        return;
+
+    if ( !m_model->insertRows(row, count) ) {
+        COPYQ_LOG("ItemEncrypt ERROR: Failed to insert item!");
+        return;
+    }
+
+    for (int i = 0; i < count; ++i)
+        m_model->setData( m_model->index(row + i, 0), items[i], contentType::data );
+}
+
+void ItemEncryptedSaver::finishLoading()
+{
+    std::unique_ptr<ItemEncryptedTabLoader> loader(m_loader);
+    m_loader = nullptr;
+    loader->wait();
+
+    if ( loader->failed() ) {
+        m_loadFailed = true;
+        m_encryptedItems.clear();
+        // Same as when the tab fails to load: no partially loaded items.
+        if (m_model)
+            m_model->removeRows( 0, m_model->rowCount() );
+        emit error( ItemEncryptedLoader::tr("Decryption failed!") );
+        return;
+    }
+
+    if ( !loader->dataKey().isEmpty() ) {
+        m_dataKey = loader->dataKey();
+        m_wrappedDataKey = loader->wrappedDataKey();
+    }
+}
+
+void ItemEncryptedSaver::cancelLoading()
+{
+    if (!m_loader)
+        return;
+
+    m_loader->cancel();
+    m_loader->wait();
+    delete m_loader;
+    m_loader = nullptr;
+}
+
 void ItemEncryptedSaver::emitEncryptFailed()
 {
     emit error( ItemEncryptedLoader::tr("Encryption failed!") );
@@ -634,14 +1268,8 @@ QWidget *ItemEncryptedLoader::createSettingsWidget(QWidget *parent)
 
 bool ItemEncryptedLoader::canLoadItems(QIODevice *file) const
 {
-    QDataStream stream(file);
-    stream.setVersion(QDataStream::Qt_4_7);
-
     QString header;
-    stream >> header;
-
-    return stream.status() == QDataStream::Ok
-            && (header == dataFileHeader || header == dataFileHeaderV2);
+    return readHeader(file, &header);
 }
 
 bool ItemEncryptedLoader::canSaveItems(const QString &tabName) const
@@ -672,7 +1300,8 @@ bool ItemEncryptedLoader::canSaveItems(const QString &tabName) const
 ItemSaverPtr ItemEncryptedLoader::loadItems(const QString &, QAbstractItemModel *model, QIODevice *file, int maxItems)
 {
     // This is needed to skip header.
-    if ( !canLoadItems(file) )
+    QString header;
+    if ( !readHeader(file, &header) )
         return nullptr;
 
     if (status() == GpgNotInstalled) {
@@ -682,70 +1311,18 @@ ItemSaverPtr ItemEncryptedLoader::loadItems(const QString &, QAbstractItemModel
 
     importGpgKey();
 
-    QProcess p;
-    startGpgProcess( &p, QStringList("--decrypt"), QIODevice::ReadWrite );
-
-    char encryptedBytes[4096];
-
-    QDataStream stream(file);
-    while ( !stream.atEnd() ) {
-        const int bytesRead = stream.readRawData(encryptedBytes, 4096);
-        if (bytesRead == -1) {
-            emitDecryptFailed();
-            COPYQ_LOG("ItemEncrypted ERROR: Failed to read encrypted data");
-            return nullptr;
-        }
-        p.write(encryptedBytes, bytesRead);
-    }
-
-    p.closeWriteChannel();
-
-    // Wait for password entry dialog.
-    p.waitForFinished(-1);
-
-    if ( !verifyProcess(&p) ) {
+    const QByteArray encryptedData = file->readAll();
+    if ( encryptedData.isEmpty() ) {
         emitDecryptFailed();
+        COPYQ_LOG("ItemEncrypted ERROR: Failed to read encrypted data");
         return nullptr;
     }
 
-    const QByteArray bytes = p.readAllStandardOutput();
-    if ( bytes.isEmpty() ) {
-        emitDecryptFailed();
-        COPYQ_LOG("ItemEncrypt ERROR: Failed to read encrypted data.");
-        verifyProcess(&p);
+    auto saver = createSaver();
+    if ( !saver->loadItems(encryptedData, header == dataFileHeaderV3, model, maxItems) )
         return nullptr;
-    }
 
-    QDataStream stream2(bytes);
-
-    quint64 length;
-    stream2 >> length;
-    if ( length <= 0 || stream2.status() != QDataStream::Ok ) {
-        emitDecryptFailed();
-        COPYQ_LOG("ItemEncrypt ERROR: Failed to parse item count!");
-        return nullptr;
-    }
-    length = qMin(length, static_cast<quint64>(maxItems)) - static_cast<quint64>(model->rowCount());
-
-    const auto count = length < maxItemCount ? static_cast<int>(length) : maxItemCount;
-    for ( int i = 0; i < count && stream2.status() == QDataStream::Ok; ++i ) {
-        if ( !model->insertRow(i) ) {
-            emitDecryptFailed();
-            COPYQ_LOG("ItemEncrypt ERROR: Failed to insert item!");
-            return nullptr;
-        }
-        QVariantMap dataMap;
-        stream2 >> dataMap;
-        model->setData( model->index(i, 0), dataMap, contentType::data );
-    }
-
-    if ( stream2.status() != QDataStream::Ok ) {
-        emitDecryptFailed();
-        COPYQ_LOG("ItemEncrypt ERROR: Failed to decrypt item!");
-        return nullptr;
-    }
-
-    return createSaver();
+    return saver;
 }
 
 ItemSaverPtr ItemEncryptedLoader::initializeTab(const QString &, QAbstractItemModel *, int)
@@ -759,7 +1336,11 @@ ItemSaverPtr ItemEncryptedLoader::initializeTab(const QString &, QAbstractItemMo
 QObject *ItemEncryptedLoader::tests(const TestInterfacePtr &test) const
 {
 #ifdef HAS_TESTS
+    QVariantMap settings;
+    settings[configEncryptTabs] = QStringList{ItemEncryptedTests::encryptedTab()};
+
     QObject *tests = new ItemEncryptedTests(test);
+    tests->setProperty("CopyQ_test_settings", settings);
     return tests;
 #else
     Q_UNUSED(test)
@@ -928,7 +1509,7 @@ void ItemEncryptedLoader::emitDecryptFailed()
     emit error( ItemEncryptedLoader::tr("Decryption failed!") );
 }
 
-ItemSaverPtr ItemEncryptedLoader::createSaver()
+std::shared_ptr<ItemEncryptedSaver> ItemEncryptedLoader::createSaver()
 {
     auto saver = std::make_shared<ItemEncryptedSaver>();
     connect( saver.get(), &ItemEncryptedSaver::error,
@@ -960,3 +1541,5 @@ bool ItemEncryptedLoader::setData(const QVariantMap &data, const QModelIndex &in
 
     return encryptMimeData(data, index, model);
 }
+
+#include "itemencrypted.moc"
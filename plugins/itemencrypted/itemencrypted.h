@@ -6,7 +6,10 @@
 #include "item/itemwidget.h"
 #include "gui/icons.h"
 
+#include <QHash>
+#include <QPointer>
 #include <QProcess>
+#include <QVector>
 #include <QWidget>
 
 #include <memory>
@@ -16,6 +19,7 @@ class ItemEncryptedSettings;
 }
 
 class QIODevice;
+class ItemEncryptedTabLoader;
 
 class ItemEncrypted final : public QWidget, public ItemWidget
 {
@@ -25,18 +29,76 @@ public:
     explicit ItemEncrypted(QWidget *parent);
 };
 
+/**
+ * Saves items encrypted with a tab data key.
+ *
+ * The data key is encrypted (wrapped) with GnuPG only once and kept in
+ * memory so saving tab doesn't need to run GnuPG. Each item is encrypted
+ * separately with libsodium (XSalsa20-Poly1305) and only new or changed
+ * items are encrypted again.
+ *
+ * If the plugin is built without libsodium, whole tab is encrypted with
+ * GnuPG on each save (old format).
+ *
+ * Items are decrypted and added to the model in background.
+ */
 class ItemEncryptedSaver final : public QObject, public ItemSaverInterface
 {
     Q_OBJECT
 
 public:
+    ItemEncryptedSaver() = default;
+
+    ~ItemEncryptedSaver();
+
+    /**
+     * Starts decrypting items from tab data (without header).
+     *
+     * If @a itemsEncryptedSeparately is false, whole tab data are encrypted
+     * with GnuPG (old format).
+     *
+     * Blocks until the data can be decrypted (user may need to enter
+     * password) and returns false if the decryption fails.
+     */
+    bool loadItems(const QByteArray &encryptedData, bool itemsEncryptedSeparately,
+                   QAbstractItemModel *model, int maxItems);
+
     bool saveItems(const QString &tabName, const QAbstractItemModel &model, QIODevice *file) override;
 
+    bool isLoading() const override;
+
+    void waitForLoaded() override;
+
 signals:
     void error(const QString &);
 
 private:
+    void onItemsLoaded(
+        const QVector<QVariantMap> &items, const QVector<QByteArray> &hashes,
+        const QVector<QByteArray> &encryptedItems);
+
+    void finishLoading();
+
+    void cancelLoading();
+
+#ifdef HAS_SODIUM
+    bool saveItemsEncryptedSeparately(const QAbstractItemModel &model, QIODevice *file);
+#endif
+    bool saveItemsEncryptedWithGpg(const QAbstractItemModel &model, QIODevice *file);
+
     void emitEncryptFailed();
+
+    ItemEncryptedTabLoader *m_loader = nullptr;
+    QPointer<QAbstractItemModel> m_model;
+    int m_maxItems = 0;
+    bool m_loadFailed = false;
+
+    QByteArray m_dataKey;
+    QByteArray m_wrappedDataKey;
+    /// Random key for hashes in m_encryptedItems.
+    QByteArray m_itemHashKey;
+    /// Encrypted items by keyed hash of serialized item data.
+    QHash<QByteArray, QByteArray> m_encryptedItems;
 };
 
 class ItemEncryptedScriptable final : public ItemScriptable
@@ -131,7 +193,7 @@ private:
 
     void emitDecryptFailed();
 
-    ItemSaverPtr createSaver();
+    std::shared_ptr<ItemEncryptedSaver> createSaver();
 
     GpgProcessStatus status() const;
 
@@ -2,14 +2,100 @@
 
 #include "itemencryptedtests.h"
 
+#include "common/config.h"
 #include "tests/test_utils.h"
 
+#include <QDataStream>
+#include <QFile>
+
+namespace {
+
+const auto clipboardBrowserId = "focus:ClipboardBrowser";
+const auto editorId = "focus::ItemEditorWidget";
+
+QString tabFileName(const QString &tabName)
+{
+    QString part( tabName.toUtf8().toBase64() );
+    part.replace( QChar('/'), QString('-') );
+    return getConfigurationFilePath("_tab_") + part + QLatin1String(".dat");
+}
+
+QByteArray readFile(const QString &fileName)
+{
+    QFile file(fileName);
+    return file.open(QIODevice::ReadOnly) ? file.readAll() : QByteArray();
+}
+
+QStringList manyItems()
+{
+    QStringList items;
+    for (int i = 0; i < 1000; ++i)
+        items.append( QString("ITEM %1").arg(i) );
+    return items;
+}
+
+bool writeFile(const QString &fileName, const QByteArray &bytes)
+{
+    QFile file(fileName);
+    return file.open(QIODevice::WriteOnly) && file.write(bytes) == bytes.size();
+}
+
+enum class TabPart {
+    DataKey,
+    FirstItem,
+};
+
+/// Returns offset of given part in encrypted tab file (v3) or -1 on error.
+qint64 tabPartOffset(const QByteArray &bytes, TabPart part)
+{
+    QDataStream stream(bytes);
+    stream.setVersion(QDataStream::Qt_4_7);
+
+    QString header;
+    stream >> header;
+    if ( stream.status() != QDataStream::Ok || header != "CopyQ_encrypted_tab v3" )
+        return -1;
+
+    // Skip size of the data.
+    const qint64 dataKeyOffset = stream.device()->pos() + 4;
+    if (part == TabPart::DataKey)
+        return dataKeyOffset;
+
+    QByteArray wrappedDataKey;
+    stream >> wrappedDataKey;
+    if ( stream.status() != QDataStream::Ok )
+        return -1;
+    return stream.device()->pos() + 4;
+}
+
+QByteArray tamperTabFile(const QString &fileName, TabPart part)
+{
+    QByteArray bytes = readFile(fileName);
+    const qint64 offset = tabPartOffset(bytes, part);
+    if ( offset == -1 || offset + 32 >= bytes.size() )
+        return "Unexpected encrypted tab file format";
+
+    const int i = static_cast<int>(offset + 16);
+    bytes[i] = static_cast<char>(bytes[i] ^ 0x01);
+    if ( !writeFile(fileName, bytes) )
+        return "Failed to write tab file";
+
+    return QByteArray();
+}
+
+} // namespace
+
 ItemEncryptedTests::ItemEncryptedTests(const TestInterfacePtr &test, QObject *parent)
     : QObject(parent)
     , m_test(test)
 {
 }
 
+QString ItemEncryptedTests::encryptedTab()
+{
+    return testTab(2);
+}
+
 void ItemEncryptedTests::initTestCase()
 {
     SKIP_ON_ENV("COPYQ_TESTS_SKIP_ITEMENCRYPT");
@@ -95,6 +181,142 @@ void ItemEncryptedTests::encryptDecryptItems()
     RUN("tab" << tab << "read" << "application/x-copyq-item-notes" << "0", "NOTE");
 }
 
+void ItemEncryptedTests::encryptedTabRoundTrip()
+{
+    if ( !isGpgInstalled() )
+        SKIP("gpg2 is required to run the test");
+
+    TEST( addItemsToEncryptedTab({"SECRET_ITEM_1", "SECRET_ITEM_2", "SECRET_ITEM_3"}) );
+
+    const QByteArray bytes = readFile( tabFileName(encryptedTab()) );
+    QVERIFY( !bytes.isEmpty() );
+    QVERIFY( !bytes.contains("SECRET_ITEM") );
+
+    const Args args = Args("separator") << "," << "tab" << encryptedTab();
+    WAIT_ON_OUTPUT(args << "read" << "0" << "1" << "2", "SECRET_ITEM_3,SECRET_ITEM_2,SECRET_ITEM_1");
+
+    // Change only one item and keep the others.
+    RUN(args << "write" << "1" << "text/plain" << "SECRET_ITEM_X", "");
+    TEST( m_test->stopServer() );
+    TEST( m_test->startServer() );
+    WAIT_ON_OUTPUT(args << "read" << "0" << "1" << "2" << "3",
+                   "SECRET_ITEM_3,SECRET_ITEM_X,SECRET_ITEM_2,SECRET_ITEM_1");
+}
+
+void ItemEncryptedTests::encryptedTabTampered()
+{
+#ifndef HAS_SODIUM
+    SKIP("libsodium is required to run the test");
+#endif
+
+    if ( !isGpgInstalled() )
+        SKIP("gpg2 is required to run the test");
+
+    TEST( addItemsToEncryptedTab({"SECRET_ITEM_1", "SECRET_ITEM_2"}) );
+    TEST( m_test->stopServer() );
+
+    const QString fileName = tabFileName(encryptedTab());
+    TEST( tamperTabFile(fileName, TabPart::FirstItem) );
+    const QByteArray tamperedBytes = readFile(fileName);
+
+    TEST( m_test->startServer() );
+
+    // Tampered tab is not loaded or overwritten.
+    m_test->setIgnoreError("Failed to load tab file");
+    RUN("tab" << encryptedTab() << "size", "0\n");
+    TEST( m_test->stopServer() );
+    QCOMPARE( readFile(fileName), tamperedBytes );
+}
+
+void ItemEncryptedTests::encryptedTabWrongKey()
+{
+#ifndef HAS_SODIUM
+    SKIP("libsodium is required to run the test");
+#endif
+
+    if ( !isGpgInstalled() )
+        SKIP("gpg2 is required to run the test");
+
+    TEST( addItemsToEncryptedTab({"SECRET_ITEM_1", "SECRET_ITEM_2"}) );
+    TEST( m_test->stopServer() );
+
+    // Password cannot be entered in tests, so the data key which can be
+    // decrypted only with the password is corrupted instead.
+    const QString fileName = tabFileName(encryptedTab());
+    TEST( tamperTabFile(fileName, TabPart::DataKey) );
+    const QByteArray tamperedBytes = readFile(fileName);
+
+    TEST( m_test->startServer() );
+
+    m_test->setIgnoreError("Failed to load tab file");
+    RUN("tab" << encryptedTab() << "size", "0\n");
+    TEST( m_test->stopServer() );
+    QCOMPARE( readFile(fileName), tamperedBytes );
+}
+
+void ItemEncryptedTests::encryptedTabEditDuringLoad()
+{
+    if ( !isGpgInstalled() )
+        SKIP("gpg2 is required to run the test");
+
+    RUN("config" << "maxitems" << "2000", "2000\n");
+    TEST( addItemsToEncryptedTab(manyItems()) );
+
+    // Opening the tab in GUI loads the items in background.
+    RUN("setCurrentTab" << encryptedTab(), "");
+    RUN("keys" << clipboardBrowserId << "CTRL+N" << editorId << ":NEW" << "F2", "");
+
+    const Args args = Args("separator") << "," << "tab" << encryptedTab();
+    RUN(args << "size", "1001\n");
+    RUN(args << "read" << "0" << "1" << "1000", "NEW,ITEM 999,ITEM 0");
+
+    TEST( m_test->stopServer() );
+    TEST( m_test->startServer() );
+    RUN(args << "size", "1001\n");
+    RUN(args << "read" << "0" << "1" << "1000", "NEW,ITEM 999,ITEM 0");
+}
+
+void ItemEncryptedTests::encryptedTabQuitDuringLoad()
+{
+    if ( !isGpgInstalled() )
+        SKIP("gpg2 is required to run the test");
+
+    RUN("config" << "maxitems" << "2000", "2000\n");
+    TEST( addItemsToEncryptedTab(manyItems()) );
+    const QByteArray bytes = readFile( tabFileName(encryptedTab()) );
+
+    // Exit while items are loaded in background.
+    RUN("setCurrentTab" << encryptedTab(), "");
+    TEST( m_test->stopServer() );
+    QCOMPARE( readFile(tabFileName(encryptedTab())), bytes );
+
+    TEST( m_test->startServer() );
+    const Args args = Args("separator") << "," << "tab" << encryptedTab();
+    RUN(args << "size", "1000\n");
+    RUN(args << "read" << "0" << "999", "ITEM 999,ITEM 0");
+}
+
+QByteArray ItemEncryptedTests::addItemsToEncryptedTab(const QStringList &items)
+{
+    QByteArray out;
+    if ( m_test->run(Args("-e") << "plugins.itemencrypted.generateTestKeys()", &out) != 0 || out != "\n" )
+        return "Failed to generate keys: " + out;
+
+    const auto errors = m_test->runClient(Args("tab") << encryptedTab() << "add" << items, "");
+    if ( !errors.isEmpty() )
+        return errors;
+
+    // Save tab.
+    const auto stopErrors = m_test->stopServer();
+    if ( !stopErrors.isEmpty() )
+        return stopErrors;
+
+    if ( !QFile::exists(tabFileName(encryptedTab())) )
+        return "Encrypted tab was not saved";
+
+    return m_test->startServer();
+}
+
 bool ItemEncryptedTests::isGpgInstalled() const
 {
     QByteArray actualStdout;
@@ -13,6 +13,9 @@ class ItemEncryptedTests final : public QObject
 public:
     explicit ItemEncryptedTests(const TestInterfacePtr &test, QObject *parent = nullptr);
 
+    /// Tab which is saved encrypted in tests.
+    static QString encryptedTab();
+
 private slots:
     void initTestCase();
     void cleanupTestCase();
@@ -23,9 +26,18 @@ private slots:
 
     void encryptDecryptItems();
 
+    void encryptedTabRoundTrip();
+    void encryptedTabTampered();
+    void encryptedTabWrongKey();
+    void encryptedTabEditDuringLoad();
+    void encryptedTabQuitDuringLoad();
+
 private:
     bool isGpgInstalled() const;
 
+    /// Adds items to encrypted tab and saves it by restarting server.
+    QByteArray addItemsToEncryptedTab(const QStringList &items);
+
     TestInterfacePtr m_test;
 };
 
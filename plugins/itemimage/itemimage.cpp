@@ -9,9 +9,16 @@
 #include "gui/pixelratio.h"
 
 #include <QBuffer>
+#include <QCache>
+#include <QCoreApplication>
+#include <QCryptographicHash>
+#include <QEvent>
 #include <QHBoxLayout>
+#include <QImageReader>
 #include <QModelIndex>
 #include <QMovie>
+#include <QMutex>
+#include <QMutexLocker>
 #include <QPainter>
 #include <QPixmap>
 #include <QSettings>
@@ -25,6 +32,29 @@ const QLatin1String configMaxImageHeight("max_image_height");
 const QLatin1String configImageEditor("image_editor");
 const QLatin1String configSvgEditor("svg_editor");
 
+/// Maximum total size of cached thumbnails in KiB.
+const int maxThumbnailCacheCost = 64 * 1024;
+
+class ImageDecodedEvent final : public QEvent
+{
+public:
+    ImageDecodedEvent(const QPointer<ItemImage> &item, const QImage &image)
+        : QEvent(eventType())
+        , item(item)
+        , image(image)
+    {
+    }
+
+    static QEvent::Type eventType()
+    {
+        static const auto type = static_cast<QEvent::Type>( QEvent::registerEventType() );
+        return type;
+    }
+
+    QPointer<ItemImage> item;
+    QImage image;
+};
+
 QString findImageFormat(const QList<QString> &formats)
 {
     // Check formats in this order.
@@ -78,6 +108,48 @@ bool getAnimatedImageData(const QVariantMap &dataMap, QByteArray *data, QByteArr
     return false;
 }
 
+/// Returns size of image scaled to fit maximum width and height (zero for unlimited).
+QSize scaledImageSize(QSize size, int maxWidth, int maxHeight)
+{
+    const int w = size.width();
+    const int h = size.height();
+    if ( maxWidth > 0 && w > maxWidth && (maxHeight <= 0 || 1.0 * w / maxWidth > 1.0 * h / maxHeight) )
+        return QSize( maxWidth, qMax(1, qRound(1.0 * h * maxWidth / w)) );
+
+    if ( maxHeight > 0 && h > maxHeight )
+        return QSize( qMax(1, qRound(1.0 * w * maxHeight / h)), maxHeight );
+
+    return size;
+}
+
+QMutex thumbnailCacheMutex;
+
+QCache<QByteArray, QImage> &thumbnailCache()
+{
+    static QCache<QByteArray, QImage> cache(maxThumbnailCacheCost);
+    return cache;
+}
+
+QByteArray thumbnailKey(const QByteArray &data, QSize size)
+{
+    return QCryptographicHash::hash(data, QCryptographicHash::Sha1)
+            + QByteArray::number(size.width()) + 'x' + QByteArray::number(size.height());
+}
+
+QImage cachedThumbnail(const QByteArray &key)
+{
+    QMutexLocker lock(&thumbnailCacheMutex);
+    const QImage *image = thumbnailCache().object(key);
+    return image ? *image : QImage();
+}
+
+void cacheThumbnail(const QByteArray &key, const QImage &image)
+{
+    const int cost = qMax(1, image.bytesPerLine() * image.height() / 1024);
+    QMutexLocker lock(&thumbnailCacheMutex);
+    thumbnailCache().insert(key, new QImage(image), cost);
+}
+
 bool getPixmapFromData(const QVariantMap &dataMap, QPixmap *pix)
 {
     QString mime;
@@ -92,6 +164,52 @@ bool getPixmapFromData(const QVariantMap &dataMap, QPixmap *pix)
 
 } // namespace
 
+ItemImageDecoder::ItemImageDecoder(
+        const QByteArray &data, QSize size, bool cache,
+        ItemImage *image, QObject *eventTarget)
+    : m_data(data)
+    , m_size(size)
+    , m_cache(cache)
+    , m_image(image)
+    , m_eventTarget(eventTarget)
+{
+}
+
+void ItemImageDecoder::run()
+{
+    const QByteArray cacheKey = m_cache ? thumbnailKey(m_data, m_size) : QByteArray();
+
+    QImage image;
+    if ( !cacheKey.isEmpty() )
+        image = cachedThumbnail(cacheKey);
+
+    if ( image.size() != m_size ) {
+        QBuffer buffer(&m_data);
+        buffer.open(QIODevice::ReadOnly);
+        QImageReader reader(&buffer);
+        reader.setScaledSize(m_size);
+        image = reader.read();
+
+        if ( !image.isNull() && !cacheKey.isEmpty() )
+            cacheThumbnail(cacheKey, image);
+    }
+
+    // The item widget can be deleted anytime in GUI thread,
+    // so it is only accessed when handling the event there.
+    QCoreApplication::postEvent( m_eventTarget, new ImageDecodedEvent(m_image, image) );
+}
+
+bool ItemImageDecoder::handleDecodedEvent(QEvent *event)
+{
+    if ( event->type() != ImageDecodedEvent::eventType() )
+        return false;
+
+    const auto decodedEvent = static_cast<ImageDecodedEvent*>(event);
+    if (decodedEvent->item)
+        decodedEvent->item->setImage(decodedEvent->image);
+    return true;
+}
+
 ItemImage::ItemImage(
         const QPixmap &pix,
         const QByteArray &animationData, const QByteArray &animationFormat,
@@ -138,6 +256,17 @@ void ItemImage::setCurrent(bool current)
     }
 }
 
+void ItemImage::setImage(const QImage &image)
+{
+    if ( image.isNull() )
+        return;
+
+    m_pixmap = QPixmap::fromImage(image);
+    m_pixmap.setDevicePixelRatio( pixelRatio(this) );
+    if ( !movie() )
+        setPixmap(m_pixmap);
+}
+
 void ItemImage::showEvent(QShowEvent *event)
 {
     startAnimation();
@@ -180,32 +309,55 @@ ItemImageLoader::ItemImageLoader()
 {
 }
 
-ItemImageLoader::~ItemImageLoader() = default;
+ItemImageLoader::~ItemImageLoader()
+{
+    m_decoderPool.waitForDone();
+}
 
 ItemWidget *ItemImageLoader::create(const QVariantMap &data, QWidget *parent, bool preview) const
 {
     if ( data.value(mimeHidden).toBool() )
         return nullptr;
 
-    // TODO: Just check if image provided and load it in different thread.
-    QPixmap pix;
-    if ( !getPixmapFromData(data, &pix) )
+    QString mime;
+    QByteArray imageData;
+    if ( !getImageData(data, &imageData, &mime) && !getSvgData(data, &imageData, &mime) )
         return nullptr;
 
-    pix.setDevicePixelRatio( pixelRatio(parent) );
+    QByteArray animationData;
+    QByteArray animationFormat;
+    getAnimatedImageData(data, &animationData, &animationFormat);
 
-    // scale pixmap
     const int w = preview ? 0 : m_maxImageWidth;
     const int h = preview ? 0 : m_maxImageHeight;
-    if ( w > 0 && pix.width() > w && (h <= 0 || 1.0 * pix.width()/w > 1.0 * pix.height()/h) ) {
-        pix = pix.scaledToWidth(w, Qt::SmoothTransformation);
-    } else if (h > 0 && pix.height() > h) {
-        pix = pix.scaledToHeight(h, Qt::SmoothTransformation);
+
+    // Only image header is read here, the image is decoded in background.
+    QBuffer buffer(&imageData);
+    buffer.open(QIODevice::ReadOnly);
+    const QSize imageSize = QImageReader(&buffer).size();
+    if ( imageSize.isValid() ) {
+        const QSize size = scaledImageSize(imageSize, w, h);
+        QPixmap placeholder(size);
+        placeholder.fill(Qt::transparent);
+        placeholder.setDevicePixelRatio( pixelRatio(parent) );
+
+        auto image = new ItemImage(placeholder, animationData, animationFormat, parent);
+        auto eventTarget = const_cast<ItemImageLoader*>(this);
+        m_decoderPool.start(
+            new ItemImageDecoder(imageData, size, size != imageSize, image, eventTarget) );
+        return image;
     }
 
-    QByteArray animationData;
-    QByteArray animationFormat;
-    getAnimatedImageData(data, &animationData, &animationFormat);
+    QPixmap pix;
+    if ( !getPixmapFromData(data, &pix) )
+        return nullptr;
+
+    pix.setDevicePixelRatio( pixelRatio(parent) );
+
+    // scale pixmap
+    const QSize size = scaledImageSize(pix.size(), w, h);
+    if ( size != pix.size() )
+        pix = pix.scaled(size, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
 
     return new ItemImage(pix, animationData, animationFormat, parent);
 }
@@ -247,6 +399,12 @@ QWidget *ItemImageLoader::createSettingsWidget(QWidget *parent)
     return w;
 }
 
+void ItemImageLoader::customEvent(QEvent *event)
+{
+    if ( !ItemImageDecoder::handleDecodedEvent(event) )
+        QObject::customEvent(event);
+}
+
 QObject *ItemImageLoader::createExternalEditor(const QModelIndex &, const QVariantMap &data, QWidget *parent) const
 {
     QString mime;
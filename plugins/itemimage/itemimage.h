@@ -8,6 +8,10 @@
 
 #include <QLabel>
 #include <QPixmap>
+#include <QPointer>
+#include <QRunnable>
+#include <QSize>
+#include <QThreadPool>
 
 #include <memory>
 
@@ -31,6 +35,9 @@ public:
 
     void setCurrent(bool current) override;
 
+    /// Replaces placeholder pixmap with decoded image.
+    void setImage(const QImage &image);
+
 protected:
     void showEvent(QShowEvent *event) override;
     void hideEvent(QHideEvent *event) override;
@@ -46,6 +53,35 @@ private:
     QMovie *m_animation;
 };
 
+/**
+ * Decodes image, scaled to given size, in a thread pool.
+ *
+ * The decoded image is posted as an event to the event target in the GUI
+ * thread which passes it to the item widget unless it was already deleted.
+ *
+ * Scaled images (thumbnails) are cached in memory only so that images from
+ * encrypted tabs are never written to disk.
+ */
+class ItemImageDecoder final : public QRunnable
+{
+public:
+    ItemImageDecoder(
+            const QByteArray &data, QSize size, bool cache,
+            ItemImage *image, QObject *eventTarget);
+
+    void run() override;
+
+    /// Passes image from an event posted by run() to the item widget.
+    static bool handleDecodedEvent(QEvent *event);
+
+private:
+    QByteArray m_data;
+    QSize m_size;
+    bool m_cache;
+    QPointer<ItemImage> m_image;
+    QObject *m_eventTarget;
+};
+
 class ItemImageLoader final : public QObject, public ItemLoaderInterface
 {
     Q_OBJECT
@@ -76,12 +112,18 @@ public:
 
     QObject *createExternalEditor(const QModelIndex &index, const QVariantMap &data, QWidget *parent) const override;
 
+protected:
+    void customEvent(QEvent *event) override;
+
 private:
     int m_maxImageWidth = 320;
     int m_maxImageHeight = 240;
     QString m_imageEditor;
     QString m_svgEditor;
     std::unique_ptr<Ui::ItemImageSettings> ui;
+
+    /// Waits for pending decoders on destruction before events can no longer be received.
+    mutable QThreadPool m_decoderPool;
 };
 
 #endif // ITEMIMAGE_H
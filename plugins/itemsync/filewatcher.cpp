@@ -14,9 +14,17 @@
 #include <QElapsedTimer>
 #include <QMimeData>
 #include <QRegularExpression>
+#include <QRunnable>
+#include <QThreadPool>
 #include <QUrl>
 
+#ifdef Q_OS_UNIX
+#   include <sys/stat.h>
+#endif
+
+#include <algorithm>
 #include <array>
+#include <numeric>
 #include <vector>
 
 const QLatin1String mimeExtensionMap(COPYQ_MIME_PREFIX_ITEMSYNC "mime-to-extension-map");
@@ -53,13 +61,24 @@ struct BaseNameExtensions {
     Exts exts;
 };
 
+/// Item data read from files.
+struct ItemFiles {
+    QString baseName;
+    QVariantMap dataMap;
+    QVariantMap mimeToExtension;
+    FileStats fileStats;
+};
+
 namespace {
 
 const QLatin1String dataFileSuffix("_copyq.dat");
 const QLatin1String noteFileSuffix("_note.txt");
 
 const int defaultUpdateFocusItemsIntervalMs = 10000;
+// Full updates only check consistency if directory changes are watched.
+const int defaultFullUpdateIntervalMs = 60000;
 const int batchItemUpdateIntervalMs = 100;
+const int changedFilesUpdateDelayMs = 50;
 
 const qint64 sizeLimit = 10 << 20;
 
@@ -273,6 +292,170 @@ QStringList listFiles(const QDir &dir)
     return files;
 }
 
+FileStat fileStat(const QString &filePath)
+{
+    FileStat result;
+    const QFileInfo info(filePath);
+    if ( !info.exists() )
+        return result;
+
+    result.size = info.size();
+    result.modified = info.lastModified().toMSecsSinceEpoch();
+
+#ifdef Q_OS_UNIX
+    // Inode changes if file is replaced (e.g. renamed over the original).
+    struct stat buf;
+    if ( ::stat(QFile::encodeName(filePath).constData(), &buf) == 0 )
+        result.inode = static_cast<quint64>(buf.st_ino);
+#endif
+
+    return result;
+}
+
+bool isSameFile(const FileStat &lhs, const FileStat &rhs)
+{
+    return lhs.size != -1
+        && lhs.size == rhs.size
+        && lhs.modified == rhs.modified
+        && lhs.inode == rhs.inode;
+}
+
+bool hasSameFileStats(const QDir &dir, const FileStats &fileStats)
+{
+    for (auto it = fileStats.constBegin(); it != fileStats.constEnd(); ++it) {
+        if ( !isSameFile(it.value(), fileStat(dir.absoluteFilePath(it.key()))) )
+            return false;
+    }
+    return true;
+}
+
+/**
+ * Reads item data from files.
+ *
+ * Content hashes are calculated only for files which changed since they were
+ * added to @a cachedFileStats.
+ */
+void readItemFiles(
+        const QDir &dir, const BaseNameExtensions &baseNameWithExts,
+        QVariantMap *dataMap, QVariantMap *mimeToExtension,
+        FileStats *fileStats, const FileStats &cachedFileStats)
+{
+    for (const auto &ext : baseNameWithExts.exts) {
+        if ( ext.format.isEmpty() )
+            continue;
+
+        const QString fileName = baseNameWithExts.baseName + ext.extension;
+        const QString filePath = dir.absoluteFilePath(fileName);
+
+        QFile f(filePath);
+        if ( !f.open(QIODevice::ReadOnly) )
+            continue;
+
+        FileStat stat = fileStat(filePath);
+
+        if ( ext.extension == dataFileSuffix ) {
+            QDataStream stream(&f);
+            if ( deserializeData(&stream, dataMap) )
+                mimeToExtension->insert(mimeUnknownFormats, dataFileSuffix);
+        } else if ( f.size() > sizeLimit || ext.format.startsWith(mimeNoFormat)
+                    || dataMap->contains(ext.format) )
+        {
+            mimeToExtension->insert(mimeNoFormat + ext.extension, ext.extension);
+        } else {
+            const QByteArray bytes = f.readAll();
+            dataMap->insert(ext.format, bytes);
+            mimeToExtension->insert(ext.format, ext.extension);
+
+            const auto cached = cachedFileStats.constFind(fileName);
+            if ( cached != cachedFileStats.constEnd() && !cached->hash.isEmpty()
+                 && isSameFile(*cached, stat) )
+            {
+                stat.hash = cached->hash;
+            } else {
+                stat.hash = FileWatcher::calculateHash(bytes);
+            }
+        }
+
+        if (fileStats)
+            fileStats->insert(fileName, stat);
+    }
+}
+
+QVariantList fileStatToData(const FileStat &stat)
+{
+    return {stat.size, stat.modified, stat.inode, stat.hash};
+}
+
+FileStat fileStatFromData(const QVariant &data)
+{
+    const QVariantList values = data.toList();
+    FileStat stat;
+    if ( values.size() == 4 ) {
+        stat.size = values[0].toLongLong();
+        stat.modified = values[1].toLongLong();
+        stat.inode = values[2].toULongLong();
+        stat.hash = values[3].toByteArray();
+    }
+    return stat;
+}
+
+/// Reads item files in a thread pool.
+class ItemFilesReader final : public QObject, public QRunnable
+{
+    Q_OBJECT
+
+public:
+    ItemFilesReader(const QString &path, const BaseNameExtensionsList &fileList,
+                    const FileStats &cachedFileStats)
+        : m_path(path)
+        , m_fileList(fileList)
+        , m_cachedFileStats(cachedFileStats)
+    {
+        setAutoDelete(false);
+    }
+
+    void run() override
+    {
+        const QDir dir(m_path);
+        m_itemFilesList.reserve(m_fileList.size());
+        for (const auto &baseNameWithExts : m_fileList) {
+            ItemFiles itemFiles;
+            itemFiles.baseName = baseNameWithExts.baseName;
+            readItemFiles(
+                dir, baseNameWithExts, &itemFiles.dataMap, &itemFiles.mimeToExtension,
+                &itemFiles.fileStats, m_cachedFileStats);
+            m_itemFilesList.append(itemFiles);
+        }
+
+        emit finished();
+    }
+
+    const QVector<ItemFiles> &itemFilesList() const { return m_itemFilesList; }
+
+signals:
+    void finished();
+
+private:
+    QString m_path;
+    BaseNameExtensionsList m_fileList;
+    FileStats m_cachedFileStats;
+    QVector<ItemFiles> m_itemFilesList;
+};
+
+/// Lists item file names quickly (unsorted and without full paths).
+QStringList listFileNames(const QDir &dir)
+{
+    QStringList fileNames;
+
+    const QDir::Filters itemFileFilter = QDir::Files | QDir::Readable | QDir::Writable;
+    for ( const auto &fileName : dir.entryList(itemFileFilter, QDir::Unsorted) ) {
+        if ( !fileName.startsWith(QLatin1Char('.')) )
+            fileNames.append(fileName);
+    }
+
+    return fileNames;
+}
+
 /// Return true only if no file name in @a fileNames starts with @a baseName.
 bool isUniqueBaseName(const QString &baseName, const QStringList &fileNames,
                       const QStringList &baseNames = QStringList())
@@ -421,6 +604,7 @@ FileWatcher::FileWatcher(
         QAbstractItemModel *model,
         int maxItems,
         const QList<FileFormat> &formatSettings,
+        const QVariantMap &fileStats,
         QObject *parent)
     : QObject(parent)
     , m_model(model)
@@ -429,14 +613,27 @@ FileWatcher::FileWatcher(
     , m_valid(true)
     , m_maxItems(maxItems)
 {
+    for (auto it = fileStats.constBegin(); it != fileStats.constEnd(); ++it)
+        m_fileStats.insert( it.key(), fileStatFromData(it.value()) );
+
     m_updateTimer.setSingleShot(true);
+    m_changeTimer.setSingleShot(true);
+    m_changeTimer.setInterval(changedFilesUpdateDelayMs);
 
     bool ok;
     const int interval = qEnvironmentVariableIntValue("COPYQ_SYNC_UPDATE_INTERVAL_MS", &ok);
-    m_interval = ok && interval > 0 ? interval : defaultUpdateFocusItemsIntervalMs;
+    m_intervalOverridden = ok && interval > 0;
+    m_interval = m_intervalOverridden ? interval : defaultUpdateFocusItemsIntervalMs;
 
     connect( &m_updateTimer, &QTimer::timeout,
              this, &FileWatcher::updateItems );
+    connect( &m_changeTimer, &QTimer::timeout,
+             this, &FileWatcher::updateChangedItems );
+    connect( &m_watcher, &QFileSystemWatcher::directoryChanged,
+             this, [this]() {
+                 if (m_updatesEnabled)
+                     m_changeTimer.start();
+             } );
 
     connect( m_model, &QAbstractItemModel::rowsInserted,
              this, &FileWatcher::onRowsInserted );
@@ -451,6 +648,8 @@ FileWatcher::FileWatcher(
         saveItems(0, model->rowCount() - 1);
 
     prependItemsFromFiles( QDir(path), listFiles(paths, m_formatSettings, m_maxItems) );
+
+    watchDirectory();
 }
 
 bool FileWatcher::lock()
@@ -467,12 +666,21 @@ void FileWatcher::unlock()
     m_valid = true;
 }
 
-QVariantMap FileWatcher::itemDataFromFiles(const QDir &dir, const BaseNameExtensions &baseNameWithExts)
+QVariantMap FileWatcher::fileStatsData() const
+{
+    QVariantMap data;
+    for (auto it = m_fileStats.constBegin(); it != m_fileStats.constEnd(); ++it)
+        data.insert( it.key(), fileStatToData(it.value()) );
+    return data;
+}
+
+QVariantMap FileWatcher::itemDataFromFiles(
+        const QDir &dir, const BaseNameExtensions &baseNameWithExts, FileStats *fileStats)
 {
     QVariantMap dataMap;
     QVariantMap mimeToExtension;
 
-    updateDataAndWatchFile(dir, baseNameWithExts, &dataMap, &mimeToExtension);
+    readItemFiles(dir, baseNameWithExts, &dataMap, &mimeToExtension, fileStats, m_fileStats);
 
     if ( !mimeToExtension.isEmpty() ) {
         const QString baseName = QFileInfo(baseNameWithExts.baseName).fileName();
@@ -487,15 +695,20 @@ QVariantMap FileWatcher::itemDataFromFiles(const QDir &dir, const BaseNameExtens
 void FileWatcher::prependItemsFromFiles(const QDir &dir, const BaseNameExtensionsList &fileList)
 {
     QVector<QVariantMap> items;
+    QVector<FileStats> itemFileStats;
     items.reserve(fileList.size());
+    itemFileStats.reserve(fileList.size());
 
     for (auto it = fileList.rbegin(); it != fileList.rend(); ++it) {
-        const QVariantMap item = itemDataFromFiles(dir, *it);
-        if ( !item.isEmpty() )
+        FileStats fileStats;
+        const QVariantMap item = itemDataFromFiles(dir, *it, &fileStats);
+        if ( !item.isEmpty() ) {
             items.append(item);
+            itemFileStats.append(fileStats);
+        }
     }
 
-    createItems(items, 0);
+    createItems(items, 0, itemFileStats);
 }
 
 void FileWatcher::insertItemsFromFiles(const QDir &dir, const BaseNameExtensionsList &fileList)
@@ -504,14 +717,24 @@ void FileWatcher::insertItemsFromFiles(const QDir &dir, const BaseNameExtensions
         return;
 
     QVector<QVariantMap> items;
+    QVector<FileStats> itemFileStats;
     items.reserve(fileList.size());
+    itemFileStats.reserve(fileList.size());
     for (const auto &baseNameWithExts : fileList) {
-        const QVariantMap item = itemDataFromFiles(dir, baseNameWithExts);
+        FileStats fileStats;
+        const QVariantMap item = itemDataFromFiles(dir, baseNameWithExts, &fileStats);
         // Skip if the associated file was just removed.
-        if ( !item.isEmpty() )
+        if ( !item.isEmpty() ) {
             items.append(item);
+            itemFileStats.append(fileStats);
+        }
     }
 
+    insertItems(items, itemFileStats);
+}
+
+void FileWatcher::insertItems(QVector<QVariantMap> items, QVector<FileStats> fileStats)
+{
     int row = 0;
     int i = 0;
     for (; i < items.size(); ++i) {
@@ -526,7 +749,7 @@ void FileWatcher::insertItemsFromFiles(const QDir &dir, const BaseNameExtensions
         if ( row >= m_model->rowCount() )
             break;
 
-        createItems({item}, row);
+        createItems({item}, row, {fileStats[i]});
         ++row;
     }
 
@@ -537,9 +760,12 @@ void FileWatcher::insertItemsFromFiles(const QDir &dir, const BaseNameExtensions
             return;
 
         items.erase(items.begin(), items.begin() + i);
-        if ( space < items.size() )
+        fileStats.erase(fileStats.begin(), fileStats.begin() + i);
+        if ( space < items.size() ) {
             items.erase(items.begin(), items.begin() + space);
-        createItems( items, m_model->rowCount() );
+            fileStats.erase(fileStats.begin(), fileStats.begin() + space);
+        }
+        createItems( items, m_model->rowCount(), fileStats );
     }
 
     // TODO: Remove excessive items, but not pinned.
@@ -561,13 +787,38 @@ void FileWatcher::updateItems()
     const QDir dir(m_path);
 
     if ( m_batchIndexData.isEmpty() ) {
+        watchDirectory();
+
         const QStringList files = listFiles(dir);
         m_fileList = listFiles(files, m_formatSettings, m_maxItems);
+        m_changedFileList.clear();
+
+        m_fileIndex.clear();
+        m_fileIndex.reserve(m_fileList.size());
+        for (int i = 0; i < m_fileList.size(); ++i)
+            m_fileIndex.insert(m_fileList[i].baseName, i);
+
+        m_fileNames.clear();
+        m_fileNames.reserve(files.size());
+        for (const auto &filePath : files)
+            m_fileNames.insert( QFileInfo(filePath).fileName() );
+
+        for (auto it = m_fileStats.begin(); it != m_fileStats.end(); ) {
+            if ( m_fileNames.contains(it.key()) )
+                ++it;
+            else
+                it = m_fileStats.erase(it);
+        }
+
+        m_indexByBaseName.clear();
         m_batchIndexData.reserve(m_model->rowCount());
         for (int row = 0; row < m_model->rowCount(); ++row) {
             const QModelIndex index = m_model->index(row, 0);
-            if ( !oldBaseName(index).isEmpty() )
+            const QString baseName = oldBaseName(index);
+            if ( !baseName.isEmpty() ) {
                 m_batchIndexData.append(index);
+                m_indexByBaseName.insert(baseName, index);
+            }
         }
 
         m_lastBatchIndex = -1;
@@ -583,26 +834,15 @@ void FileWatcher::updateItems()
         if ( baseName.isEmpty() )
             continue;
 
-        const auto it = std::find_if(
-            std::begin(m_fileList), std::end(m_fileList),
-            [&](const BaseNameExtensions &baseNameExtensions) {
-                return baseNameExtensions.baseName == baseName;
-            });
-
-        QVariantMap dataMap;
-        QVariantMap mimeToExtension;
-
-        if ( it != m_fileList.cend() ) {
-            updateDataAndWatchFile(dir, *it, &dataMap, &mimeToExtension);
-            m_fileList.erase(it);
-        }
-
-        if ( mimeToExtension.isEmpty() ) {
+        // Files already used by an item have no extensions left.
+        const int fileIndex = m_fileIndex.value(baseName, -1);
+        if ( fileIndex == -1 || m_fileList[fileIndex].exts.empty() ) {
             m_model->removeRow(index.row());
         } else {
-            dataMap.insert(mimeBaseName, baseName);
-            dataMap.insert(mimeExtensionMap, mimeToExtension);
-            updateIndexData(index, &dataMap);
+            BaseNameExtensions &baseNameWithExts = m_fileList[fileIndex];
+            if ( !isItemUpToDate(dir, index, baseNameWithExts) )
+                m_changedFileList.append(baseNameWithExts);
+            baseNameWithExts.exts.clear();
         }
 
         if ( t.elapsed() > 20 ) {
@@ -617,20 +857,111 @@ void FileWatcher::updateItems()
         }
     }
 
-    t.restart();
-
-    insertItemsFromFiles(dir, m_fileList);
-
-    if ( t.elapsed() > 100 )
-        log( QStringLiteral("ItemSync: Items created in %1 ms").arg(t.elapsed()) );
+    // Read changed and new files in background.
+    for (const auto &baseNameWithExts : m_fileList) {
+        if ( !baseNameWithExts.exts.empty() )
+            m_changedFileList.append(baseNameWithExts);
+    }
+    readFilesInBackground(m_changedFileList);
 
     m_fileList.clear();
+    m_fileIndex.clear();
+    m_changedFileList.clear();
     m_batchIndexData.clear();
 
     unlock();
 
     if (m_updatesEnabled)
-        m_updateTimer.start(m_interval);
+        m_updateTimer.start( fullUpdateInterval() );
+}
+
+void FileWatcher::updateChangedItems()
+{
+    if ( !m_updatesEnabled )
+        return;
+
+    // Wait for full update to finish, changes since listing the files are
+    // handled afterwards.
+    if ( !m_batchIndexData.isEmpty() || !lock() ) {
+        m_changeTimer.start(batchItemUpdateIntervalMs);
+        return;
+    }
+
+    QElapsedTimer t;
+    t.start();
+
+    const QDir dir(m_path);
+    const QStringList fileNames = listFileNames(dir);
+
+    QSet<QString> currentFileNames;
+    currentFileNames.reserve(fileNames.size());
+    QSet<QString> changedBaseNames;
+    QString baseName;
+    Ext ext;
+
+    for (const auto &fileName : fileNames) {
+        currentFileNames.insert(fileName);
+        const bool isNew = !m_fileNames.remove(fileName);
+        if ( !getBaseNameExtension(fileName, m_formatSettings, &baseName, &ext) )
+            continue;
+
+        // Existing files can be modified in place or replaced (renamed over).
+        if (!isNew) {
+            const auto it = m_fileStats.constFind(fileName);
+            if ( it == m_fileStats.constEnd()
+                 || isSameFile(*it, fileStat(dir.absoluteFilePath(fileName))) )
+            {
+                continue;
+            }
+        }
+
+        changedBaseNames.insert(baseName);
+    }
+
+    // Remaining files were removed.
+    for (const auto &fileName : m_fileNames) {
+        if ( getBaseNameExtension(fileName, m_formatSettings, &baseName, &ext) )
+            changedBaseNames.insert(baseName);
+    }
+
+    m_fileNames = currentFileNames;
+
+    if ( changedBaseNames.isEmpty() ) {
+        unlock();
+        return;
+    }
+
+    QStringList changedFileNames;
+    for (const auto &fileName : fileNames) {
+        if ( getBaseNameExtension(fileName, m_formatSettings, &baseName, &ext)
+             && changedBaseNames.contains(baseName) )
+        {
+            changedFileNames.append(fileName);
+        }
+    }
+
+    bool indexRebuilt = false;
+    BaseNameExtensionsList fileListToRead;
+    for ( const auto &baseNameWithExts : listFiles(changedFileNames, m_formatSettings, changedFileNames.size()) ) {
+        changedBaseNames.remove(baseNameWithExts.baseName);
+        const QPersistentModelIndex index = indexForBaseName(baseNameWithExts.baseName, &indexRebuilt);
+        if ( !index.isValid() || !isItemUpToDate(dir, index, baseNameWithExts) )
+            fileListToRead.append(baseNameWithExts);
+    }
+
+    // Remaining base names have no files left.
+    for (const auto &removedBaseName : changedBaseNames) {
+        const QPersistentModelIndex index = indexForBaseName(removedBaseName, &indexRebuilt);
+        if ( index.isValid() )
+            m_model->removeRow(index.row());
+    }
+
+    readFilesInBackground(fileListToRead);
+
+    COPYQ_LOG_VERBOSE( QStringLiteral("ItemSync: Changed files updated in %1 ms")
+         .arg(t.elapsed()) );
+
+    unlock();
 }
 
 void FileWatcher::updateItemsIfNeeded()
@@ -645,10 +976,13 @@ void FileWatcher::updateItemsIfNeeded()
 void FileWatcher::setUpdatesEnabled(bool enabled)
 {
     m_updatesEnabled = enabled;
-    if (enabled)
+    if (enabled) {
         updateItems();
-    else if ( m_batchIndexData.isEmpty() )
-        m_updateTimer.stop();
+    } else {
+        m_changeTimer.stop();
+        if ( m_batchIndexData.isEmpty() )
+            m_updateTimer.stop();
+    }
 }
 
 void FileWatcher::onRowsInserted(const QModelIndex &, int first, int last)
@@ -720,7 +1054,8 @@ QString FileWatcher::oldBaseName(const QModelIndex &index) const
     return index.data(contentType::data).toMap().value(mimeOldBaseName).toString();
 }
 
-void FileWatcher::createItems(const QVector<QVariantMap> &items, int targetRow)
+void FileWatcher::createItems(
+        const QVector<QVariantMap> &items, int targetRow, const QVector<FileStats> &fileStats)
 {
     if ( items.isEmpty() )
         return;
@@ -737,7 +1072,8 @@ void FileWatcher::createItems(const QVector<QVariantMap> &items, int targetRow)
         auto index = m_model->index(row2, 0);
         if ( getBaseName(index).isEmpty() ) {
             QVariantMap data = *it;
-            updateIndexData(index, &data);
+            const int i2 = static_cast<int>(it - std::begin(items));
+            updateIndexData( index, &data, i2 < fileStats.size() ? fileStats[i2] : FileStats() );
             ++it;
             if (it == std::end(items))
                 break;
@@ -745,7 +1081,8 @@ void FileWatcher::createItems(const QVector<QVariantMap> &items, int targetRow)
     }
 }
 
-void FileWatcher::updateIndexData(const QModelIndex &index, QVariantMap *itemData)
+void FileWatcher::updateIndexData(
+        const QModelIndex &index, QVariantMap *itemData, const FileStats &fileStats)
 {
     const QString baseName = getBaseName(*itemData);
     if ( baseName.isEmpty() ) {
@@ -754,19 +1091,174 @@ void FileWatcher::updateIndexData(const QModelIndex &index, QVariantMap *itemDat
     }
 
     itemData->insert(mimeOldBaseName, baseName);
+    m_indexByBaseName.insert(baseName, index);
 
     const QVariantMap mimeToExtension = itemData->value(mimeExtensionMap).toMap();
     for ( auto it = mimeToExtension.begin(); it != mimeToExtension.end(); ++it ) {
         if ( !it.key().startsWith(COPYQ_MIME_PREFIX_ITEMSYNC) ) {
             const QString ext = it.value().toString();
-            const Hash hash = calculateHash(itemData->value(it.key()).toByteArray());
+            const auto stat = fileStats.constFind(baseName + ext);
+            const Hash hash = stat != fileStats.constEnd() && !stat->hash.isEmpty()
+                ? stat->hash
+                : calculateHash(itemData->value(it.key()).toByteArray());
             const QString mime = mimeHashPrefix + ext;
             itemData->insert(mime, hash);
         }
     }
+
+    for (auto it = fileStats.constBegin(); it != fileStats.constEnd(); ++it)
+        m_fileStats.insert( it.key(), it.value() );
+
     m_model->setData(index, *itemData, contentType::data);
 }
 
+void FileWatcher::updateFileStat(const QDir &dir, const QString &fileName, const Hash &hash)
+{
+    FileStat stat = fileStat( dir.absoluteFilePath(fileName) );
+    stat.hash = hash;
+    m_fileStats.insert(fileName, stat);
+}
+
+bool FileWatcher::isItemUpToDate(
+        const QDir &dir, const QModelIndex &index, const BaseNameExtensions &baseNameWithExts) const
+{
+    const QVariantMap mimeToExtension =
+        index.data(contentType::data).toMap().value(mimeExtensionMap).toMap();
+    if ( mimeToExtension.size() != static_cast<int>(baseNameWithExts.exts.size()) )
+        return false;
+
+    for (const auto &ext : baseNameWithExts.exts) {
+        const bool hasExtension = std::any_of(
+            std::begin(mimeToExtension), std::end(mimeToExtension),
+            [&](const QVariant &itemExt) { return itemExt.toString() == ext.extension; });
+        if (!hasExtension)
+            return false;
+
+        const QString fileName = baseNameWithExts.baseName + ext.extension;
+        const auto it = m_fileStats.constFind(fileName);
+        if ( it == m_fileStats.constEnd()
+             || !isSameFile(*it, fileStat(dir.absoluteFilePath(fileName))) )
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void FileWatcher::readFilesInBackground(const BaseNameExtensionsList &fileList)
+{
+    if ( fileList.isEmpty() )
+        return;
+
+    auto reader = new ItemFilesReader(m_path, fileList, m_fileStats);
+    connect( reader, &ItemFilesReader::finished,
+             this, [this, reader]() { updateItemsFromFiles(reader->itemFilesList()); } );
+    connect( reader, &ItemFilesReader::finished,
+             reader, &QObject::deleteLater );
+    QThreadPool::globalInstance()->start(reader);
+}
+
+void FileWatcher::updateItemsFromFiles(const QVector<ItemFiles> &itemFilesList)
+{
+    // Changed files will be read again in next update.
+    if ( !lock() )
+        return;
+
+    QElapsedTimer t;
+    t.start();
+
+    const QDir dir(m_path);
+    bool indexRebuilt = false;
+    QVector<QVariantMap> newItems;
+    QVector<FileStats> newItemFileStats;
+
+    for (const auto &itemFiles : itemFilesList) {
+        // Skip if files changed since read.
+        if ( !hasSameFileStats(dir, itemFiles.fileStats) )
+            continue;
+
+        QVariantMap dataMap = itemFiles.dataMap;
+        const QPersistentModelIndex index = indexForBaseName(itemFiles.baseName, &indexRebuilt);
+        if ( index.isValid() ) {
+            if ( itemFiles.mimeToExtension.isEmpty() ) {
+                m_model->removeRow(index.row());
+            } else {
+                dataMap.insert(mimeBaseName, itemFiles.baseName);
+                dataMap.insert(mimeExtensionMap, itemFiles.mimeToExtension);
+                updateIndexData(index, &dataMap, itemFiles.fileStats);
+            }
+        } else if ( !itemFiles.mimeToExtension.isEmpty() ) {
+            dataMap.insert(mimeBaseName, itemFiles.baseName);
+            dataMap.insert(mimeOldBaseName, itemFiles.baseName);
+            dataMap.insert(mimeExtensionMap, itemFiles.mimeToExtension);
+            newItems.append(dataMap);
+            newItemFileStats.append(itemFiles.fileStats);
+        }
+    }
+
+    // Keep order of new items same as for full update.
+    QVector<int> order(newItems.size());
+    std::iota(std::begin(order), std::end(order), 0);
+    std::stable_sort(
+        std::begin(order), std::end(order),
+        [&](int lhs, int rhs) {
+            return isBaseNameLessThan(getBaseName(newItems[lhs]), getBaseName(newItems[rhs]));
+        });
+
+    QVector<QVariantMap> sortedItems;
+    QVector<FileStats> sortedFileStats;
+    sortedItems.reserve(order.size());
+    sortedFileStats.reserve(order.size());
+    for (int i : order) {
+        sortedItems.append(newItems[i]);
+        sortedFileStats.append(newItemFileStats[i]);
+    }
+
+    insertItems(sortedItems, sortedFileStats);
+
+    if ( t.elapsed() > 100 )
+        log( QStringLiteral("ItemSync: Items updated from files in %1 ms").arg(t.elapsed()) );
+
+    unlock();
+}
+
+QPersistentModelIndex FileWatcher::indexForBaseName(const QString &baseName, bool *indexRebuilt)
+{
+    const auto it = m_indexByBaseName.constFind(baseName);
+    if ( it != m_indexByBaseName.constEnd() && it->isValid() && oldBaseName(*it) == baseName )
+        return *it;
+
+    // Items can be added or renamed without updating the hash,
+    // so rebuild it (at most once for each update).
+    if (*indexRebuilt)
+        return QPersistentModelIndex();
+
+    *indexRebuilt = true;
+    m_indexByBaseName.clear();
+    for (int row = 0; row < m_model->rowCount(); ++row) {
+        const QModelIndex index = m_model->index(row, 0);
+        const QString rowBaseName = oldBaseName(index);
+        if ( !rowBaseName.isEmpty() )
+            m_indexByBaseName.insert(rowBaseName, index);
+    }
+
+    return m_indexByBaseName.value(baseName);
+}
+
+void FileWatcher::watchDirectory()
+{
+    if ( m_watcher.directories().isEmpty() && QDir(m_path).exists() )
+        m_watcher.addPath(m_path);
+}
+
+int FileWatcher::fullUpdateInterval() const
+{
+    if ( m_intervalOverridden || m_watcher.directories().isEmpty() )
+        return m_interval;
+    return defaultFullUpdateIntervalMs;
+}
+
 QList<QPersistentModelIndex> FileWatcher::indexList(int first, int last)
 {
     QList<QPersistentModelIndex> indexList;
@@ -837,8 +1329,13 @@ void FileWatcher::saveItems(int first, int last)
             } else {
                 mimeToExtension.insert(format, ext);
                 const Hash oldHash = index.data(contentType::data).toMap().value(mimeHashPrefix + ext).toByteArray();
+                const bool save = hash != oldHash || !existingFiles.contains(filePath + ext);
+                if (save)
+                    m_fileStats.remove(baseName + ext);
                 if ( !saveItemFile(filePath + ext, bytes, &existingFiles, hash != oldHash) )
                     return;
+                if (save)
+                    updateFileStat(dir, baseName + ext, hash);
             }
         }
 
@@ -852,8 +1349,10 @@ void FileWatcher::saveItems(int first, int last)
         if ( mimeToExtension.isEmpty() || !dataMapUnknown.isEmpty() ) {
             mimeToExtension.insert(mimeUnknownFormats, dataFileSuffix);
             QByteArray data = serializeData(dataMapUnknown);
+            m_fileStats.remove(baseName + dataFileSuffix);
             if ( !saveItemFile(filePath + dataFileSuffix, data, &existingFiles) )
                 return;
+            updateFileStat(dir, baseName + dataFileSuffix, Hash());
         }
 
         if ( !noSaveData.isEmpty() || mimeToExtension != oldMimeToExtension ) {
@@ -924,36 +1423,6 @@ bool FileWatcher::renameMoveCopy(const QDir &dir, const QList<QPersistentModelIn
     return true;
 }
 
-void FileWatcher::updateDataAndWatchFile(const QDir &dir, const BaseNameExtensions &baseNameWithExts,
-                            QVariantMap *dataMap, QVariantMap *mimeToExtension)
-{
-    const QString basePath = dir.absoluteFilePath(baseNameWithExts.baseName);
-
-    for (const auto &ext : baseNameWithExts.exts) {
-        if ( ext.format.isEmpty() )
-            continue;
-
-        const QString fileName = basePath + ext.extension;
-
-        QFile f( dir.absoluteFilePath(fileName) );
-        if ( !f.open(QIODevice::ReadOnly) )
-            continue;
-
-        if ( ext.extension == dataFileSuffix ) {
-            QDataStream stream(&f);
-            if ( deserializeData(&stream, dataMap) )
-                mimeToExtension->insert(mimeUnknownFormats, dataFileSuffix);
-        } else if ( f.size() > sizeLimit || ext.format.startsWith(mimeNoFormat)
-                    || dataMap->contains(ext.format) )
-        {
-            mimeToExtension->insert(mimeNoFormat + ext.extension, ext.extension);
-        } else {
-            dataMap->insert(ext.format, f.readAll());
-            mimeToExtension->insert(ext.format, ext.extension);
-        }
-    }
-}
-
 bool FileWatcher::copyFilesFromUriList(const QByteArray &uriData, int targetRow, const QStringList &baseNames)
 {
     QMimeData tmpData;
@@ -995,3 +1464,5 @@ bool FileWatcher::copyFilesFromUriList(const QByteArray &uriData, int targetRow,
     createItems(items, targetRow);
     return !items.isEmpty();
 }
+
+#include "filewatcher.moc"
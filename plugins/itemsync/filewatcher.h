@@ -5,10 +5,14 @@
 
 #include "common/mimetypes.h"
 
+#include <QFileSystemWatcher>
+#include <QHash>
 #include <QObject>
 #include <QPersistentModelIndex>
+#include <QSet>
 #include <QStringList>
 #include <QTimer>
+#include <QVariantMap>
 #include <QVector>
 
 class QAbstractItemModel;
@@ -16,6 +20,7 @@ class QDir;
 
 struct Ext;
 struct BaseNameExtensions;
+struct ItemFiles;
 
 #define COPYQ_MIME_PREFIX_ITEMSYNC COPYQ_MIME_PREFIX "itemsync-"
 #define COPYQ_MIME_PREFIX_ITEMSYNC_PRIVATE COPYQ_MIME_PREFIX "itemsync-private-"
@@ -41,6 +46,18 @@ using BaseNameExtensionsList = QList<BaseNameExtensions>;
 
 using Hash = QByteArray;
 
+/// File metadata used to detect changes without reading the file.
+struct FileStat {
+    qint64 size = -1;
+    qint64 modified = 0;
+    quint64 inode = 0;
+    /// Hash of file content (empty if not calculated).
+    Hash hash;
+};
+
+/// File stats by file name (without path).
+using FileStats = QHash<QString, FileStat>;
+
 class FileWatcher final : public QObject {
 public:
     static QString getBaseName(const QModelIndex &index);
@@ -57,7 +74,8 @@ public:
     static Hash calculateHash(const QByteArray &bytes);
 
     FileWatcher(const QString &path, const QStringList &paths, QAbstractItemModel *model,
-                int maxItems, const QList<FileFormat> &formatSettings, QObject *parent = nullptr);
+                int maxItems, const QList<FileFormat> &formatSettings,
+                const QVariantMap &fileStats = QVariantMap(), QObject *parent = nullptr);
 
     const QString &path() const { return m_path; }
 
@@ -67,7 +85,12 @@ public:
 
     void unlock();
 
-    QVariantMap itemDataFromFiles(const QDir &dir, const BaseNameExtensions &baseNameWithExts);
+    /// Returns file stats of synchronized files to be stored with tab data.
+    QVariantMap fileStatsData() const;
+
+    QVariantMap itemDataFromFiles(
+            const QDir &dir, const BaseNameExtensions &baseNameWithExts,
+            FileStats *fileStats = nullptr);
 
     void prependItemsFromFiles(const QDir &dir, const BaseNameExtensionsList &fileList);
     void insertItemsFromFiles(const QDir &dir, const BaseNameExtensionsList &fileList);
@@ -77,6 +100,16 @@ public:
      */
     void updateItems();
 
+    /**
+     * Update only items with files added, removed or replaced (renamed over)
+     * since last update.
+     *
+     * Called when the directory changes. Stats of other files are compared
+     * too, but a file modified in place does not change the directory, so
+     * its content is usually picked up only by the periodic full update.
+     */
+    void updateChangedItems();
+
     void updateItemsIfNeeded();
 
     void setUpdatesEnabled(bool enabled);
@@ -92,9 +125,37 @@ private:
 
     QString oldBaseName(const QModelIndex &index) const;
 
-    void createItems(const QVector<QVariantMap> &dataMaps, int targetRow);
+    void createItems(const QVector<QVariantMap> &dataMaps, int targetRow,
+                     const QVector<FileStats> &fileStats = QVector<FileStats>());
+
+    void insertItems(QVector<QVariantMap> items, QVector<FileStats> fileStats);
 
-    void updateIndexData(const QModelIndex &index, QVariantMap *itemData);
+    /**
+     * Updates item data.
+     *
+     * Hashes of formats are taken from @a fileStats (if the files were just
+     * read) or calculated.
+     */
+    void updateIndexData(const QModelIndex &index, QVariantMap *itemData,
+                         const FileStats &fileStats = FileStats());
+
+    /// Returns true only if files of the item have not changed since last read or write.
+    bool isItemUpToDate(const QDir &dir, const QModelIndex &index,
+                        const BaseNameExtensions &baseNameWithExts) const;
+
+    void updateFileStat(const QDir &dir, const QString &fileName, const Hash &hash);
+
+    /// Reads files and calculates hashes in a thread pool and updates items afterwards.
+    void readFilesInBackground(const BaseNameExtensionsList &fileList);
+
+    void updateItemsFromFiles(const QVector<ItemFiles> &itemFilesList);
+
+    /// Returns item index for base name or invalid index if there is no such item.
+    QPersistentModelIndex indexForBaseName(const QString &baseName, bool *indexRebuilt);
+
+    void watchDirectory();
+
+    int fullUpdateInterval() const;
 
     QList<QPersistentModelIndex> indexList(int first, int last);
 
@@ -102,15 +163,14 @@ private:
 
     bool renameMoveCopy(const QDir &dir, const QList<QPersistentModelIndex> &indexList);
 
-    void updateDataAndWatchFile(
-            const QDir &dir, const BaseNameExtensions &baseNameWithExts,
-            QVariantMap *dataMap, QVariantMap *mimeToExtension);
-
     bool copyFilesFromUriList(const QByteArray &uriData, int targetRow, const QStringList &baseNames);
 
     QAbstractItemModel *m_model;
     QTimer m_updateTimer;
+    QTimer m_changeTimer;
+    QFileSystemWatcher m_watcher;
     int m_interval = 0;
+    bool m_intervalOverridden = false;
     const QList<FileFormat> &m_formatSettings;
     QString m_path;
     bool m_valid;
@@ -120,7 +180,15 @@ private:
 
     QList<QPersistentModelIndex> m_batchIndexData;
     BaseNameExtensionsList m_fileList;
+    QHash<QString, int> m_fileIndex;
+    BaseNameExtensionsList m_changedFileList;
     int m_lastBatchIndex = -1;
+
+    /// File names in directory from last update.
+    QSet<QString> m_fileNames;
+    QHash<QString, QPersistentModelIndex> m_indexByBaseName;
+    /// Stats of files when last read or written.
+    FileStats m_fileStats;
 };
 
 #endif // FILEWATCHER_H
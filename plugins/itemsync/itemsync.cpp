@@ -63,6 +63,7 @@ const QLatin1String configSyncTabs("sync_tabs");
 const QLatin1String configFormatSettings("format_settings");
 
 const QLatin1String tabConfigSavedFiles("saved_files");
+const QLatin1String tabConfigFileStats("file_stats");
 
 bool readConfigHeader(QDataStream *stream)
 {
@@ -85,11 +86,14 @@ bool readConfig(QIODevice *file, QVariantMap *config)
             && config->value(configVersion, 0).toInt() == currentVersion;
 }
 
-void writeConfiguration(QIODevice *file, const QStringList &savedFiles)
+void writeConfiguration(QIODevice *file, const QStringList &savedFiles,
+                        const QVariantMap &fileStats = QVariantMap())
 {
     QVariantMap config;
     config.insert(configVersion, currentVersion);
     config.insert(tabConfigSavedFiles, savedFiles);
+    if ( !fileStats.isEmpty() )
+        config.insert(tabConfigFileStats, fileStats);
 
     QDataStream stream(file);
     stream.setVersion(QDataStream::Qt_4_7);
@@ -442,7 +446,7 @@ bool ItemSyncSaver::saveItems(const QString &tabName, const QAbstractItemModel &
             savedFiles.prepend( filePath + ext.toString() );
     }
 
-    writeConfiguration(file, savedFiles);
+    writeConfiguration( file, savedFiles, m_watcher->fileStatsData() );
 
     return true;
 }
@@ -666,12 +670,13 @@ ItemSaverPtr ItemSyncLoader::loadItems(const QString &tabName, QAbstractItemMode
         return nullptr;
 
     const QStringList files = config.value(tabConfigSavedFiles).toStringList();
-    return loadItems(tabName, model, files, maxItems);
+    const QVariantMap fileStats = config.value(tabConfigFileStats).toMap();
+    return loadItems(tabName, model, files, fileStats, maxItems);
 }
 
 ItemSaverPtr ItemSyncLoader::initializeTab(const QString &tabName, QAbstractItemModel *model, int maxItems)
 {
-    return loadItems(tabName, model, QStringList(), maxItems);
+    return loadItems(tabName, model, QStringList(), QVariantMap(), maxItems);
 }
 
 ItemWidget *ItemSyncLoader::transform(ItemWidget *itemWidget, const QVariantMap &data)
@@ -756,7 +761,9 @@ void ItemSyncLoader::onBrowseButtonClicked()
         item->setText(path);
 }
 
-ItemSaverPtr ItemSyncLoader::loadItems(const QString &tabName, QAbstractItemModel *model, const QStringList &files, int maxItems)
+ItemSaverPtr ItemSyncLoader::loadItems(
+        const QString &tabName, QAbstractItemModel *model, const QStringList &files,
+        const QVariantMap &fileStats, int maxItems)
 {
     const auto tabPath = m_tabPaths.value(tabName);
     const auto path = files.isEmpty() ? tabPath : QFileInfo(files.first()).absolutePath();
@@ -769,6 +776,6 @@ ItemSaverPtr ItemSyncLoader::loadItems(const QString &tabName, QAbstractItemMode
         return nullptr;
     }
 
-    auto *watcher = new FileWatcher(path, files, model, maxItems, m_formatSettings);
+    auto *watcher = new FileWatcher(path, files, model, maxItems, m_formatSettings, fileStats);
     return std::make_shared<ItemSyncSaver>(tabPath, watcher);
 }
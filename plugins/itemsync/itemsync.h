@@ -152,7 +152,9 @@ private slots:
     void onBrowseButtonClicked();
 
 private:
-    ItemSaverPtr loadItems(const QString &tabName, QAbstractItemModel *model, const QStringList &files, int maxItems);
+    ItemSaverPtr loadItems(
+            const QString &tabName, QAbstractItemModel *model, const QStringList &files,
+            const QVariantMap &fileStats, int maxItems);
 
     std::unique_ptr<Ui::ItemSyncSettings> ui;
     ItemSyncTabPaths m_tabPaths;
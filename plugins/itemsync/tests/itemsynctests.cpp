@@ -7,6 +7,7 @@
 
 #include <QDir>
 #include <QFile>
+#include <QSaveFile>
 
 #include <memory>
 
@@ -16,6 +17,8 @@ using FilePtr = std::shared_ptr<QFile>;
 
 const char sep[] = " ;; ";
 
+const auto updateIntervalMs = "100";
+
 const auto clipboardBrowserId = "focus:ClipboardBrowser";
 const auto confirmRemoveDialogId = "focus::QPushButton in :QMessageBox";
 
@@ -101,7 +104,7 @@ ItemSyncTests::ItemSyncTests(const TestInterfacePtr &test, QObject *parent)
     : QObject(parent)
     , m_test(test)
 {
-    m_test->setEnv("COPYQ_SYNC_UPDATE_INTERVAL_MS", "100");
+    m_test->setEnv("COPYQ_SYNC_UPDATE_INTERVAL_MS", updateIntervalMs);
 }
 
 QString ItemSyncTests::testTab(int i)
@@ -139,6 +142,7 @@ void ItemSyncTests::init()
 
 void ItemSyncTests::cleanup()
 {
+    m_test->setEnv("COPYQ_SYNC_UPDATE_INTERVAL_MS", updateIntervalMs);
     TEST( m_test->cleanup() );
 }
 
@@ -424,6 +428,37 @@ void ItemSyncTests::modifyFiles()
     RUN(args << "size", "4\n");
 }
 
+void ItemSyncTests::directoryChangesUpdateItems()
+{
+    // Disable periodic full updates so only directory changes update items.
+    m_test->setEnv("COPYQ_SYNC_UPDATE_INTERVAL_MS", "3600000");
+    TEST( m_test->stopServer() );
+    TEST( m_test->startServer() );
+
+    TestDir dir1(1);
+    const QString tab1 = testTab(1);
+    RUN(Args() << "show" << tab1, "");
+
+    const Args args = Args() << "tab" << tab1;
+    RUN(args << "size", "0\n");
+
+    // Add
+    TEST(createFile(dir1, "test1.txt", "A"));
+    WAIT_ON_OUTPUT(args << "read" << "0", "A");
+
+    // Rename over (atomic save)
+    QSaveFile saveFile( dir1.filePath("test1.txt") );
+    QVERIFY(saveFile.open(QIODevice::WriteOnly));
+    saveFile.write("C");
+    QVERIFY(saveFile.commit());
+    WAIT_ON_OUTPUT(args << "read" << "0", "C");
+    RUN(args << "size", "1\n");
+
+    // Remove
+    QVERIFY(dir1.remove("test1.txt"));
+    WAIT_ON_OUTPUT(args << "size", "0\n");
+}
+
 void ItemSyncTests::itemToClipboard()
 {
     TestDir dir1(1);
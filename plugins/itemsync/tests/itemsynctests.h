@@ -36,6 +36,8 @@ private slots:
     void modifyItems();
     void modifyFiles();
 
+    void directoryChangesUpdateItems();
+
     void itemToClipboard();
 
     void notes();
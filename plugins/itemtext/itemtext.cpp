@@ -5,7 +5,6 @@
 
 #include "common/mimetypes.h"
 #include "common/sanitize_text_document.h"
-#include "common/textdata.h"
 
 #include <QAbstractTextDocumentLayout>
 #include <QCoreApplication>
@@ -46,22 +45,80 @@ void removeTrailingNull(QString *text)
         text->chop(1);
 }
 
+/// Decodes only data needed to show maxCharacters.
+QString getTextPrefix(const QByteArray &bytes)
+{
+    // A character takes at most 3 bytes in UTF-8 (or 4 bytes for 2 QChars).
+    const int maxBytes = 3 * maxCharacters;
+    return QString::fromUtf8( bytes.constData(), qMin(bytes.size(), maxBytes) );
+}
+
+QString getTextPrefix(const QVariantMap &data)
+{
+    for (const auto &mime : {mimeTextUtf8, mimeText, mimeUriList}) {
+        const auto it = data.find(mime);
+        if ( it != data.constEnd() )
+            return getTextPrefix( it->toByteArray() );
+    }
+
+    return QString();
+}
+
 bool getRichText(const QVariantMap &dataMap, QString *text)
 {
-    if ( dataMap.contains(mimeHtml) ) {
-        *text = getTextData(dataMap, mimeHtml);
+    const auto it = dataMap.find(mimeHtml);
+    if ( it != dataMap.constEnd() ) {
+        *text = getTextPrefix( it->toByteArray() );
         return true;
     }
 
     return false;
 }
 
+/**
+ * Returns position of the line break after given number of lines
+ * or -1 if the text is not longer.
+ */
+int lineBreakPosition(const QString &text, int lineCount)
+{
+    int position = -1;
+    for (int i = 0; i < lineCount; ++i) {
+        position = text.indexOf('\n', position + 1);
+        if (position == -1)
+            return -1;
+    }
+    return position;
+}
+
 QString normalizeText(QString text)
 {
     removeTrailingNull(&text);
     return text.left(maxCharacters);
 }
 
+/**
+ * Gets normalized texts to show.
+ *
+ * Returns false if there is nothing to show.
+ */
+bool getTexts(const QVariantMap &data, bool useRichText, QString *text, QString *richText)
+{
+    if ( data.value(mimeHidden).toBool() )
+        return false;
+
+    const bool isRichText = useRichText && getRichText(data, richText);
+
+    *text = getTextPrefix(data);
+    const bool isPlainText = !text->isEmpty();
+
+    if (!isRichText && !isPlainText)
+        return false;
+
+    *richText = normalizeText(*richText);
+    *text = normalizeText(*text);
+    return true;
+}
+
 void insertEllipsis(QTextCursor *tc)
 {
     tc->insertHtml( " &nbsp;"
@@ -76,6 +133,7 @@ ItemText::ItemText(
         const QString &text,
         const QString &richText,
         const QString &defaultStyleSheet,
+        bool useRichText,
         int maxLines,
         int lineLength,
         int maximumHeight,
@@ -84,6 +142,9 @@ ItemText::ItemText(
     , ItemWidget(this)
     , m_textDocument()
     , m_maximumHeight(maximumHeight)
+    , m_maxLines(maxLines)
+    , m_lineLength(lineLength)
+    , m_useRichText(useRichText)
 {
     m_textDocument.setDefaultFont(font());
 
@@ -101,43 +162,7 @@ ItemText::ItemText(
     setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
     setFrameStyle(QFrame::NoFrame);
 
-    if ( !richText.isEmpty() ) {
-        m_textDocument.setHtml(richText);
-        // Use plain text instead if rendering HTML fails or result is empty.
-        m_isRichText = !m_textDocument.isEmpty();
-    }
-
-    if (!m_isRichText)
-        m_textDocument.setPlainText(text);
-
-    if (maxLines > 0) {
-        QTextBlock block = m_textDocument.findBlockByLineNumber(maxLines);
-        if (block.isValid()) {
-            QTextCursor tc(&m_textDocument);
-            tc.setPosition(block.position() - 1);
-            tc.movePosition(QTextCursor::End, QTextCursor::KeepAnchor);
-
-            m_elidedFragment = tc.selection();
-            tc.removeSelectedText();
-
-            m_ellipsisPosition = tc.position();
-            insertEllipsis(&tc);
-        }
-    }
-
-    if (lineLength > 0) {
-        for ( auto block = m_textDocument.begin(); block.isValid(); block = block.next() ) {
-            if ( block.length() > lineLength ) {
-                QTextCursor tc(&m_textDocument);
-                tc.setPosition(block.position() + lineLength);
-                tc.setPosition(block.position() + block.length() - 1, QTextCursor::KeepAnchor);
-                insertEllipsis(&tc);
-            }
-        }
-    }
-
-    if (m_isRichText)
-        sanitizeTextDocument(&m_textDocument);
+    setTexts(text, richText);
 
     connect( this, &QTextEdit::selectionChanged,
              this, &ItemText::onSelectionChanged );
@@ -180,6 +205,28 @@ void ItemText::updateSize(QSize maximumSize, int idealWidth)
     }
 }
 
+bool ItemText::rebind(const QVariantMap &data)
+{
+    QString text;
+    QString richText;
+    if ( !getTexts(data, m_useRichText, &text, &richText) )
+        return false;
+
+    QTextCursor tc = textCursor();
+    tc.clearSelection();
+    setTextCursor(tc);
+    verticalScrollBar()->setValue(0);
+
+    m_elidedFragment = QTextDocumentFragment();
+    m_elidedText.clear();
+    m_ellipsisPosition = -1;
+    m_isRichText = false;
+
+    setTexts(text, richText);
+
+    return true;
+}
+
 bool ItemText::eventFilter(QObject *, QEvent *event)
 {
     return ItemWidget::filterMouseEvents(this, event);
@@ -204,6 +251,58 @@ QMimeData *ItemText::createMimeDataFromSelection() const
     return data;
 }
 
+void ItemText::setTexts(const QString &text, const QString &richText)
+{
+    if ( !richText.isEmpty() ) {
+        m_textDocument.setHtml(richText);
+        // Use plain text instead if rendering HTML fails or result is empty.
+        m_isRichText = !m_textDocument.isEmpty();
+    }
+
+    if (!m_isRichText) {
+        // Lay out only the lines shown, the rest is added if selected.
+        const int end = m_maxLines > 0 ? lineBreakPosition(text, m_maxLines) : -1;
+        if (end == -1) {
+            m_textDocument.setPlainText(text);
+        } else {
+            m_textDocument.setPlainText( text.left(end) );
+            m_elidedText = text.mid(end);
+
+            QTextCursor tc(&m_textDocument);
+            tc.movePosition(QTextCursor::End);
+            m_ellipsisPosition = tc.position();
+            insertEllipsis(&tc);
+        }
+    } else if (m_maxLines > 0) {
+        QTextBlock block = m_textDocument.findBlockByLineNumber(m_maxLines);
+        if (block.isValid()) {
+            QTextCursor tc(&m_textDocument);
+            tc.setPosition(block.position() - 1);
+            tc.movePosition(QTextCursor::End, QTextCursor::KeepAnchor);
+
+            m_elidedFragment = tc.selection();
+            tc.removeSelectedText();
+
+            m_ellipsisPosition = tc.position();
+            insertEllipsis(&tc);
+        }
+    }
+
+    if (m_lineLength > 0) {
+        for ( auto block = m_textDocument.begin(); block.isValid(); block = block.next() ) {
+            if ( block.length() > m_lineLength ) {
+                QTextCursor tc(&m_textDocument);
+                tc.setPosition(block.position() + m_lineLength);
+                tc.setPosition(block.position() + block.length() - 1, QTextCursor::KeepAnchor);
+                insertEllipsis(&tc);
+            }
+        }
+    }
+
+    if (m_isRichText)
+        sanitizeTextDocument(&m_textDocument);
+}
+
 void ItemText::onSelectionChanged()
 {
     // Expand the ellipsis if selected.
@@ -215,8 +314,13 @@ void ItemText::onSelectionChanged()
     m_ellipsisPosition = -1;
     tc.movePosition(QTextCursor::End, QTextCursor::KeepAnchor);
 
-    tc.insertFragment(m_elidedFragment);
-    m_elidedFragment = QTextDocumentFragment();
+    if (m_isRichText) {
+        tc.insertFragment(m_elidedFragment);
+        m_elidedFragment = QTextDocumentFragment();
+    } else {
+        tc.insertText(m_elidedText);
+        m_elidedText.clear();
+    }
 }
 
 ItemTextLoader::ItemTextLoader()
@@ -227,26 +331,16 @@ ItemTextLoader::~ItemTextLoader() = default;
 
 ItemWidget *ItemTextLoader::create(const QVariantMap &data, QWidget *parent, bool preview) const
 {
-    if ( data.value(mimeHidden).toBool() )
-        return nullptr;
-
+    QString text;
     QString richText;
-    const bool isRichText = m_useRichText && getRichText(data, &richText);
-
-    QString text = getTextData(data);
-    const bool isPlainText = !text.isEmpty();
-
-    if (!isRichText && !isPlainText)
+    if ( !getTexts(data, m_useRichText, &text, &richText) )
         return nullptr;
 
-    richText = normalizeText(richText);
-    text = normalizeText(text);
-
     ItemText *item = nullptr;
     Qt::TextInteractionFlags interactionFlags(Qt::LinksAccessibleByMouse);
     // Always limit text size for performance reasons.
     if (preview) {
-        item = new ItemText(text, richText, m_defaultStyleSheet, maxLineCountInPreview, maxLineLengthInPreview, -1, parent);
+        item = new ItemText(text, richText, m_defaultStyleSheet, m_useRichText, maxLineCountInPreview, maxLineLengthInPreview, -1, parent);
         item->setFocusPolicy(Qt::StrongFocus);
         interactionFlags = interactionFlags
                 | Qt::TextSelectableByKeyboard
@@ -255,7 +349,7 @@ ItemWidget *ItemTextLoader::create(const QVariantMap &data, QWidget *parent, boo
         int maxLines = m_maxLines;
         if (maxLines <= 0 || maxLines > maxLineCount)
             maxLines = maxLineCount;
-        item = new ItemText(text, richText, m_defaultStyleSheet, maxLines, maxLineLength, m_maxHeight, parent);
+        item = new ItemText(text, richText, m_defaultStyleSheet, m_useRichText, maxLines, maxLineLength, m_maxHeight, parent);
         item->viewport()->installEventFilter(item);
         item->setContextMenuPolicy(Qt::NoContextMenu);
     }
@@ -25,6 +25,7 @@ public:
         const QString &text,
         const QString &richText,
         const QString &defaultStyleSheet,
+        bool useRichText,
         int maxLines,
         int lineLength,
         int maximumHeight,
@@ -33,17 +34,25 @@ public:
 protected:
     void updateSize(QSize maximumSize, int idealWidth) override;
 
+    bool rebind(const QVariantMap &data) override;
+
     bool eventFilter(QObject *, QEvent *event) override;
 
     QMimeData *createMimeDataFromSelection() const override;
 
 private:
+    void setTexts(const QString &text, const QString &richText);
+
     void onSelectionChanged();
 
     QTextDocument m_textDocument;
     QTextDocumentFragment m_elidedFragment;
+    QString m_elidedText;
     int m_ellipsisPosition = -1;
     int m_maximumHeight;
+    int m_maxLines;
+    int m_lineLength;
+    bool m_useRichText;
     bool m_isRichText = false;
 };
 
@@ -59,6 +68,8 @@ public:
 
     ItemWidget *create(const QVariantMap &data, QWidget *parent, bool preview) const override;
 
+    bool canRebindItems() const override { return true; }
+
     QString id() const override { return "itemtext"; }
     QString name() const override { return tr("Text"); }
     QString author() const override { return QString(); }
@@ -87,7 +87,9 @@ void ClipboardClient::onMessageReceived(const QByteArray &data, int messageCode)
     }
 
     case CommandData:
-        emit dataReceived(data);
+        // Data are handled later, copy them in case they refer
+        // to shared memory (see ClientSocket::messageReceived()).
+        emit dataReceived( QByteArray(data.constData(), data.size()) );
         break;
 
     default:
@@ -12,6 +12,8 @@
 #include "platform/platformclipboard.h"
 
 #include <QApplication>
+#include <QElapsedTimer>
+#include <QMimeData>
 
 namespace {
 
@@ -44,18 +46,42 @@ bool isClipboardDataHidden(const QVariantMap &data)
     return data.value(mimeHidden).toByteArray() == "1";
 }
 
+bool hasOnlyInternalData(const QVariantMap &data)
+{
+    for (auto it = data.constBegin(); it != data.constEnd(); ++it) {
+        if ( !it.key().startsWith(COPYQ_MIME_PREFIX) && !it.value().toByteArray().isEmpty() )
+            return false;
+    }
+
+    return true;
+}
+
 } // namespace
 
-ClipboardMonitor::ClipboardMonitor(const QStringList &formats)
+ClipboardMonitor::ClipboardMonitor(const QStringList &formats, const QStringList &immediateFormats)
     : m_clipboard(platformNativeInterface()->clipboard())
-    , m_formats(formats)
 {
     const AppConfig config;
     m_storeClipboard = config.option<Config::check_clipboard>();
     m_clipboardTab = config.option<Config::clipboard_tab>();
+    m_delayedFormatMaxSize = config.option<Config::delayed_clipboard_format_max_size>();
+    m_delayedFormatMaxMs = config.option<Config::delayed_clipboard_format_max_ms>();
+
+    for (const auto &format : formats) {
+        if ( isDelayedDataFormat(format) && !immediateFormats.contains(format) )
+            m_delayedFormats.append(format);
+        else
+            m_formats.append(format);
+    }
 
     m_formats.append({mimeOwner, mimeWindowTitle, mimeItemNotes, mimeHidden});
     m_formats.removeDuplicates();
+    m_delayedFormats.removeDuplicates();
+
+    m_timerDelayedData.setSingleShot(true);
+    m_timerDelayedData.setInterval(0);
+    connect( &m_timerDelayedData, &QTimer::timeout,
+             this, &ClipboardMonitor::retrieveNextDelayedFormat );
 
     m_clipboard->startMonitoring(m_formats);
     connect( m_clipboard.get(), &PlatformClipboard::changed,
@@ -84,6 +110,13 @@ void ClipboardMonitor::onClipboardChanged(ClipboardMode mode)
     auto clipboardData = mode == ClipboardMode::Clipboard
             ? &m_clipboardData : &m_selectionData;
 
+    // If there is no text to show early (e.g. only image was copied), get all formats now.
+    bool hasAllFormats = m_delayedFormats.isEmpty();
+    if ( !hasAllFormats && hasOnlyInternalData(data) ) {
+        cloneDelayedData(mode, &data);
+        hasAllFormats = true;
+    }
+
     if ( hasSameData(data, *clipboardData) ) {
 #ifdef HAS_MOUSE_SELECTIONS
         if ( !m_runSelection && mode == ClipboardMode::Selection )
@@ -97,6 +130,14 @@ void ClipboardMonitor::onClipboardChanged(ClipboardMode mode)
 
     *clipboardData = data;
 
+    auto delayedData = mode == ClipboardMode::Clipboard
+            ? &m_clipboardDelayedData : &m_selectionDelayedData;
+    if ( !delayedData->formats.isEmpty() ) {
+        COPYQ_LOG( QStringLiteral("Skipping delayed formats, the data changed: %1")
+                   .arg(delayedData->formats.join(", ")) );
+        *delayedData = DelayedData();
+    }
+
     COPYQ_LOG( QString("%1 changed, owner is \"%2\"")
                .arg(mode == ClipboardMode::Clipboard ? "Clipboard" : "Selection",
                     getTextData(data, mimeOwner)) );
@@ -154,6 +195,132 @@ void ClipboardMonitor::onClipboardChanged(ClipboardMode mode)
             setTextData(&data, m_clipboardTab, mimeOutputTab);
         }
 
+        if (!hasAllFormats) {
+            // Add the new item with text right away and the slow formats later,
+            // but only if automatic commands don't need the formats.
+            quint64 itemHash = 0;
+            if ( data.contains(mimeOutputTab) )
+                emit clipboardChangedBeforeDelayedData(data, delayedFormats(data), &itemHash);
+
+            if (itemHash != 0) {
+                startRetrievingDelayedData(mode, data, itemHash);
+                return;
+            }
+
+            cloneDelayedData(mode, &data);
+        }
+
         emit clipboardChanged(data, ClipboardOwnership::Foreign);
     }
 }
+
+void ClipboardMonitor::cloneDelayedData(ClipboardMode mode, QVariantMap *data)
+{
+    const QStringList formats = delayedFormats(*data);
+    if ( formats.isEmpty() )
+        return;
+
+    const QMimeData *mimeData = m_clipboard->mimeData(mode);
+    if (mimeData == nullptr)
+        return;
+
+    const QVariantMap delayedData = cloneData(*mimeData, formats);
+    for (auto it = delayedData.constBegin(); it != delayedData.constEnd(); ++it)
+        data->insert(it.key(), it.value());
+}
+
+void ClipboardMonitor::startRetrievingDelayedData(
+    ClipboardMode mode, const QVariantMap &data, quint64 itemHash)
+{
+    auto delayedData = mode == ClipboardMode::Clipboard
+            ? &m_clipboardDelayedData : &m_selectionDelayedData;
+    delayedData->data = data;
+    delayedData->formats = delayedFormats(data);
+    delayedData->itemHash = itemHash;
+    delayedData->updated = false;
+
+    if ( !delayedData->formats.isEmpty() ) {
+        COPYQ_LOG( QStringLiteral("Retrieving delayed formats: %1")
+                   .arg(delayedData->formats.join(", ")) );
+        m_timerDelayedData.start();
+    }
+}
+
+void ClipboardMonitor::retrieveNextDelayedFormat()
+{
+    // Only single format is retrieved at a time so that
+    // clipboard changes can be handled in the meantime.
+    const ClipboardMode mode = m_clipboardDelayedData.formats.isEmpty()
+            ? ClipboardMode::Selection : ClipboardMode::Clipboard;
+    auto delayedData = mode == ClipboardMode::Clipboard
+            ? &m_clipboardDelayedData : &m_selectionDelayedData;
+    if ( delayedData->formats.isEmpty() )
+        return;
+
+    const QString format = delayedData->formats.takeFirst();
+    const QMimeData *mimeData = m_clipboard->mimeData(mode);
+    if (mimeData == nullptr) {
+        *delayedData = DelayedData();
+    } else {
+        QElapsedTimer elapsed;
+        elapsed.start();
+        const QByteArray bytes = cloneData(*mimeData, {format}).value(format).toByteArray();
+        const qint64 elapsedMs = elapsed.elapsed();
+
+        if (bytes.size() > m_delayedFormatMaxSize) {
+            log( QStringLiteral("Ignoring format \"%1\" with size %2 bytes (limit is %3 bytes)")
+                 .arg(format).arg(bytes.size()).arg(m_delayedFormatMaxSize), LogNote );
+        } else if ( !bytes.isEmpty() ) {
+            delayedData->data.insert(format, bytes);
+            delayedData->updated = true;
+        }
+
+        if ( elapsedMs > m_delayedFormatMaxMs && !delayedData->formats.isEmpty() ) {
+            log( QStringLiteral("Skipping formats, retrieving \"%1\" took %2 ms: %3")
+                 .arg(format).arg(elapsedMs).arg(delayedData->formats.join(", ")), LogNote );
+            delayedData->formats.clear();
+        }
+
+        if ( delayedData->formats.isEmpty() )
+            finishRetrievingDelayedData(mode, delayedData);
+    }
+
+    if ( !m_clipboardDelayedData.formats.isEmpty() || !m_selectionDelayedData.formats.isEmpty() )
+        m_timerDelayedData.start();
+}
+
+void ClipboardMonitor::finishRetrievingDelayedData(ClipboardMode mode, DelayedData *delayedData)
+{
+    const QVariantMap data = delayedData->data;
+    const quint64 itemHash = delayedData->itemHash;
+    const bool updated = delayedData->updated;
+    *delayedData = DelayedData();
+
+    if (!updated)
+        return;
+
+    // Drop the formats if the clipboard owner changed the data in the meantime.
+    const QMimeData *mimeData = m_clipboard->mimeData(mode);
+    if ( mimeData == nullptr
+         || cloneData(*mimeData, {mimeText}).value(mimeText) != data.value(mimeText) )
+    {
+        COPYQ_LOG("Ignoring delayed formats, the data changed");
+        return;
+    }
+
+    emit clipboardDataUpdated(data, itemHash);
+}
+
+QStringList ClipboardMonitor::delayedFormats(const QVariantMap &data) const
+{
+    // Same as in cloneData(), ignore images if text is available.
+    if ( !data.contains(mimeText) )
+        return m_delayedFormats;
+
+    QStringList formats;
+    for (const auto &format : m_delayedFormats) {
+        if ( !isBinaryImageFormat(format) )
+            formats.append(format);
+    }
+    return formats;
+}
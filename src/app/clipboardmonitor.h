@@ -7,6 +7,7 @@
 #include "platform/platformnativeinterface.h"
 #include "platform/platformclipboard.h"
 
+#include <QTimer>
 #include <QVariantMap>
 
 enum class ClipboardOwnership {
@@ -20,21 +21,71 @@ class ClipboardMonitor final : public QObject
     Q_OBJECT
 
 public:
-    explicit ClipboardMonitor(const QStringList &formats);
+    /**
+     * Formats which can be slow to retrieve (see isDelayedDataFormat()) are
+     * retrieved only after clipboardChangedBeforeDelayedData() is handled,
+     * unless these are in @a immediateFormats (e.g. input formats of
+     * automatic commands).
+     */
+    explicit ClipboardMonitor(
+        const QStringList &formats, const QStringList &immediateFormats = QStringList());
 
 signals:
     void clipboardChanged(const QVariantMap &data, ClipboardOwnership ownership);
     void clipboardUnchanged(const QVariantMap &data);
     void synchronizeSelection(ClipboardMode sourceMode, const QString &text, uint targetTextHash);
 
+    /**
+     * Emitted for new clipboard data before retrieving formats which can be
+     * slow to retrieve.
+     *
+     * The @a delayedFormats are the formats which are not yet retrieved.
+     *
+     * If a slot adds new item with the data (there are no automatic commands
+     * to run), it should set @a itemHash to hash of the added item. Other
+     * formats are then retrieved in background and passed to
+     * clipboardDataUpdated().
+     *
+     * Otherwise, all formats are retrieved and clipboardChanged() is emitted.
+     */
+    void clipboardChangedBeforeDelayedData(
+        const QVariantMap &data, const QStringList &delayedFormats, quint64 *itemHash);
+
+    /**
+     * Emitted after formats were retrieved for data previously handled in
+     * clipboardChangedBeforeDelayedData() (@a data contains both the previous
+     * and new formats; @a itemHash is the hash set by the slot).
+     */
+    void clipboardDataUpdated(const QVariantMap &data, quint64 itemHash);
+
 private:
+    struct DelayedData {
+        QVariantMap data;
+        QStringList formats;
+        quint64 itemHash = 0;
+        bool updated = false;
+    };
+
     void onClipboardChanged(ClipboardMode mode);
 
+    void cloneDelayedData(ClipboardMode mode, QVariantMap *data);
+    void startRetrievingDelayedData(ClipboardMode mode, const QVariantMap &data, quint64 itemHash);
+    void retrieveNextDelayedFormat();
+    void finishRetrievingDelayedData(ClipboardMode mode, DelayedData *delayedData);
+    QStringList delayedFormats(const QVariantMap &data) const;
+
     QVariantMap m_clipboardData;
     QVariantMap m_selectionData;
 
+    DelayedData m_clipboardDelayedData;
+    DelayedData m_selectionDelayedData;
+    QTimer m_timerDelayedData;
+
     PlatformClipboardPtr m_clipboard;
     QStringList m_formats;
+    QStringList m_delayedFormats;
+    int m_delayedFormatMaxSize;
+    int m_delayedFormatMaxMs;
 
     QString m_clipboardTab;
     bool m_storeClipboard;
@@ -731,6 +731,7 @@ void ClipboardServer::loadSettings(AppConfig *appConfig)
     m_sharedData->saveDelayMsOnItemMoved = appConfig->option<Config::save_delay_ms_on_item_moved>();
     m_sharedData->saveDelayMsOnItemEdited = appConfig->option<Config::save_delay_ms_on_item_edited>();
     m_sharedData->rowIndexFromOne = appConfig->option<Config::row_index_from_one>();
+    m_sharedData->itemWidgetPoolSize = appConfig->option<Config::item_widget_pool_size>();
 
     m_wnd->loadSettings(settings, appConfig);
 
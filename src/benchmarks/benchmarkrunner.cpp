@@ -0,0 +1,167 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "benchmarkrunner.h"
+
+#include "common/version.h"
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+
+#include <algorithm>
+#include <numeric>
+
+#if defined(Q_OS_UNIX) && !defined(Q_OS_LINUX)
+#   include <sys/resource.h>
+#endif
+
+namespace {
+
+#ifdef Q_OS_LINUX
+/// Resets peak resident set size of the process (needs Linux 4.0 or later).
+void resetPeakRss()
+{
+    QFile file(QStringLiteral("/proc/self/clear_refs"));
+    if ( file.open(QIODevice::WriteOnly) )
+        file.write("5");
+}
+
+qint64 peakRssKiB()
+{
+    QFile file(QStringLiteral("/proc/self/status"));
+    if ( !file.open(QIODevice::ReadOnly) )
+        return -1;
+
+    // Line format: "VmHWM:    12345 kB"
+    for ( QByteArray line = file.readLine(); !line.isEmpty(); line = file.readLine() ) {
+        if ( line.startsWith("VmHWM:") ) {
+            const QList<QByteArray> parts = line.mid(6).simplified().split(' ');
+            bool ok;
+            const qint64 value = parts.value(0).toLongLong(&ok);
+            return ok ? value : -1;
+        }
+    }
+
+    return -1;
+}
+#elif defined(Q_OS_UNIX)
+/// Peak can be only read for whole process lifetime.
+void resetPeakRss() {}
+
+qint64 peakRssKiB()
+{
+    struct rusage usage;
+    if ( getrusage(RUSAGE_SELF, &usage) != 0 )
+        return -1;
+#   ifdef Q_OS_MAC
+    return usage.ru_maxrss / 1024;
+#   else
+    return usage.ru_maxrss;
+#   endif
+}
+#else
+void resetPeakRss() {}
+qint64 peakRssKiB() { return -1; }
+#endif
+
+double median(QVector<double> values)
+{
+    if ( values.isEmpty() )
+        return 0;
+
+    std::sort(values.begin(), values.end());
+    const int middle = values.size() / 2;
+    if (values.size() % 2 == 1)
+        return values[middle];
+    return (values[middle - 1] + values[middle]) / 2;
+}
+
+} // namespace
+
+BenchmarkRunner::BenchmarkRunner(int iterations, const QRegularExpression &nameFilter)
+    : m_iterations(iterations)
+    , m_nameFilter(nameFilter)
+{
+}
+
+bool BenchmarkRunner::isEnabled(const QString &name) const
+{
+    return m_nameFilter.pattern().isEmpty() || name.contains(m_nameFilter);
+}
+
+void BenchmarkRunner::run(const QString &name, int itemCount, const Function &benchmark)
+{
+    run(name, itemCount, Function(), benchmark);
+}
+
+void BenchmarkRunner::run(
+        const QString &name, int itemCount, const Function &setUp, const Function &benchmark)
+{
+    if ( !isEnabled(name) )
+        return;
+
+    Result result;
+    result.name = name;
+    result.itemCount = itemCount;
+
+    resetPeakRss();
+
+    QElapsedTimer timer;
+    for (int i = 0; i <= m_iterations; ++i) {
+        if (setUp)
+            setUp();
+
+        timer.start();
+        benchmark();
+        const double elapsedMs = static_cast<double>(timer.nsecsElapsed()) / 1e6;
+
+        // Skip warm-up run.
+        if (i > 0)
+            result.timesMs.append(elapsedMs);
+    }
+
+    result.peakRssKiB = peakRssKiB();
+
+    QTextStream(stderr)
+        << name << ": " << QString::number(median(result.timesMs), 'f', 3) << " ms"
+        << " (peak RSS " << result.peakRssKiB << " KiB)\n";
+
+    m_results.append(result);
+}
+
+QByteArray BenchmarkRunner::toJson() const
+{
+    QJsonArray benchmarks;
+    for (const auto &result : m_results) {
+        const auto &times = result.timesMs;
+        const auto minMax = std::minmax_element(times.begin(), times.end());
+        const double sum = std::accumulate(times.begin(), times.end(), 0.0);
+
+        QJsonArray timesArray;
+        for (const double time : times)
+            timesArray.append(time);
+
+        benchmarks.append(QJsonObject{
+            {QStringLiteral("name"), result.name},
+            {QStringLiteral("items"), result.itemCount},
+            {QStringLiteral("min_ms"), times.isEmpty() ? 0.0 : *minMax.first},
+            {QStringLiteral("median_ms"), median(times)},
+            {QStringLiteral("mean_ms"), times.isEmpty() ? 0.0 : sum / times.size()},
+            {QStringLiteral("max_ms"), times.isEmpty() ? 0.0 : *minMax.second},
+            {QStringLiteral("times_ms"), timesArray},
+            {QStringLiteral("peak_rss_kib"), result.peakRssKiB},
+        });
+    }
+
+    const QJsonObject root{
+        {QStringLiteral("version"), QString(versionString)},
+        {QStringLiteral("qt_version"), QString::fromLatin1(qVersion())},
+        {QStringLiteral("iterations"), m_iterations},
+        {QStringLiteral("benchmarks"), benchmarks},
+    };
+
+    return QJsonDocument(root).toJson();
+}
@@ -0,0 +1,51 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef BENCHMARKRUNNER_H
+#define BENCHMARKRUNNER_H
+
+#include <QRegularExpression>
+#include <QString>
+#include <QVector>
+
+#include <functional>
+
+class QByteArray;
+
+/**
+ * Runs benchmarks and collects timings and peak memory usage.
+ *
+ * Each benchmark runs once to warm up and then given number of times.
+ * Only the benchmark function is measured, not the set up.
+ */
+class BenchmarkRunner final
+{
+public:
+    using Function = std::function<void()>;
+
+    BenchmarkRunner(int iterations, const QRegularExpression &nameFilter);
+
+    /// Returns true if benchmark with given name should run.
+    bool isEnabled(const QString &name) const;
+
+    void run(const QString &name, int itemCount, const Function &benchmark);
+
+    /// Calls @a setUp before each iteration of @a benchmark.
+    void run(const QString &name, int itemCount, const Function &setUp, const Function &benchmark);
+
+    /// Results in JSON suitable for comparing between versions.
+    QByteArray toJson() const;
+
+private:
+    struct Result {
+        QString name;
+        int itemCount = 0;
+        QVector<double> timesMs;
+        qint64 peakRssKiB = -1;
+    };
+
+    int m_iterations;
+    QRegularExpression m_nameFilter;
+    QVector<Result> m_results;
+};
+
+#endif // BENCHMARKRUNNER_H
@@ -0,0 +1,440 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "benchmarks/benchmarkrunner.h"
+
+#include "common/clientsocket.h"
+#include "common/client_server.h"
+#include "common/contenttype.h"
+#include "common/log.h"
+#include "common/mimetypes.h"
+#include "common/server.h"
+#include "common/textdata.h"
+#include "gui/clipboardbrowser.h"
+#include "gui/clipboardbrowsershared.h"
+#include "gui/filterlineedit.h"
+#include "item/clipboardmodel.h"
+#include "item/itemfactory.h"
+#include "item/serialize.h"
+#include "platform/platformnativeinterface.h"
+
+#include <QApplication>
+#include <QBuffer>
+#include <QColor>
+#include <QDataStream>
+#include <QEventLoop>
+#include <QFile>
+#include <QImage>
+#include <QSettings>
+#include <QTemporaryDir>
+#include <QTextStream>
+
+#include <memory>
+
+namespace {
+
+const QLatin1String mimePng("image/png");
+
+enum class ItemKind {
+    Text,
+    Html,
+    Image,
+};
+
+struct Options {
+    QVector<int> itemCounts{1000, 10000, 200000};
+    int iterations = 5;
+    QString outputPath;
+    QRegularExpression nameFilter;
+};
+
+QString kindName(ItemKind kind)
+{
+    switch (kind) {
+    case ItemKind::Text: return QStringLiteral("text");
+    case ItemKind::Html: return QStringLiteral("html");
+    case ItemKind::Image: return QStringLiteral("image");
+    }
+    return QString();
+}
+
+QString benchmarkName(const QString &name, ItemKind kind, int itemCount)
+{
+    return QStringLiteral("%1/%2/%3").arg(name, kindName(kind)).arg(itemCount);
+}
+
+QByteArray createImage(int i)
+{
+    QImage image(32, 32, QImage::Format_RGB32);
+    image.fill( QColor::fromHsv((i * 37) % 360, 200, 200) );
+    for (int y = 0; y < image.height(); ++y)
+        image.setPixel( i % image.width(), y, qRgb(0, 0, 0) );
+
+    QByteArray bytes;
+    QBuffer buffer(&bytes);
+    buffer.open(QIODevice::WriteOnly);
+    image.save(&buffer, "PNG");
+    return bytes;
+}
+
+QString createText(int i)
+{
+    // Texts of different lengths with some common words.
+    const int wordCount = 5 + (i * 7) % 60;
+    QString text = QStringLiteral("Item %1:").arg(i);
+    for (int j = 0; j < wordCount; ++j)
+        text.append( QStringLiteral(" word%1").arg((i + j * 13) % 1000) );
+    if (i % 10 == 0)
+        text.append( QStringLiteral("\nhttps://example.com/page/%1").arg(i) );
+    return text;
+}
+
+QList<QVariantMap> createItems(ItemKind kind, int itemCount)
+{
+    // Reuse few different images, generating each would take too long.
+    QVector<QByteArray> images;
+    if (kind == ItemKind::Image) {
+        for (int i = 0; i < 64; ++i)
+            images.append( createImage(i) );
+    }
+
+    QList<QVariantMap> items;
+    items.reserve(itemCount);
+    for (int i = 0; i < itemCount; ++i) {
+        QVariantMap data;
+        switch (kind) {
+        case ItemKind::Text:
+            data.insert( mimeText, createText(i).toUtf8() );
+            break;
+        case ItemKind::Html: {
+            const QString text = createText(i);
+            data.insert( mimeText, text.toUtf8() );
+            data.insert( mimeHtml, QStringLiteral("<html><body><p><b>%1</b></p></body></html>")
+                         .arg(text.toHtmlEscaped()).toUtf8() );
+            break;
+        }
+        case ItemKind::Image:
+            data.insert( mimePng, images[i % images.size()] );
+            break;
+        }
+        items.append(data);
+    }
+
+    return items;
+}
+
+QByteArray serializeItemList(const QList<QVariantMap> &items)
+{
+    QByteArray bytes;
+    QDataStream stream(&bytes, QIODevice::WriteOnly);
+    for (const auto &data : items)
+        stream << data;
+    return bytes;
+}
+
+void clearModel(QAbstractItemModel *model)
+{
+    model->removeRows(0, model->rowCount());
+}
+
+void benchmarkSerialization(BenchmarkRunner *runner, ItemKind kind, int itemCount)
+{
+    const QString serializeName = benchmarkName("serialize", kind, itemCount);
+    const QString deserializeName = benchmarkName("deserialize", kind, itemCount);
+    if ( !runner->isEnabled(serializeName) && !runner->isEnabled(deserializeName) )
+        return;
+
+    ClipboardModel model;
+    model.insertItems( createItems(kind, itemCount), 0 );
+
+    QByteArray bytes;
+    runner->run(serializeName, itemCount, [&]() {
+        bytes.clear();
+        QDataStream stream(&bytes, QIODevice::WriteOnly);
+        serializeData(model, &stream);
+    });
+
+    if ( bytes.isEmpty() ) {
+        QDataStream stream(&bytes, QIODevice::WriteOnly);
+        serializeData(model, &stream);
+    }
+
+    ClipboardModel model2;
+    runner->run(deserializeName, itemCount,
+        [&]() { clearModel(&model2); },
+        [&]() {
+            QDataStream stream(bytes);
+            deserializeData(&model2, &stream, itemCount);
+        });
+}
+
+void benchmarkModel(BenchmarkRunner *runner, ItemKind kind, int itemCount)
+{
+    const QString insertName = benchmarkName("model/insert", kind, itemCount);
+    const QString moveName = benchmarkName("model/move", kind, itemCount);
+    const QString findName = benchmarkName("model/findItem", kind, itemCount);
+    if ( !runner->isEnabled(insertName) && !runner->isEnabled(moveName) && !runner->isEnabled(findName) )
+        return;
+
+    const QList<QVariantMap> items = createItems(kind, itemCount);
+    ClipboardModel model;
+
+    runner->run(insertName, itemCount,
+        [&]() { clearModel(&model); },
+        [&]() {
+            for (const auto &data : items)
+                model.insertItem(data, 0);
+        });
+
+    if ( model.rowCount() != itemCount ) {
+        clearModel(&model);
+        model.insertItems(items, 0);
+    }
+
+    // Move old items to the top, same as re-copying text already in history.
+    const int moveCount = qMin(itemCount, 1000);
+    runner->run(moveName, moveCount, [&]() {
+        for (int i = 0; i < moveCount; ++i)
+            model.moveRows(QModelIndex(), itemCount - 1, 1, QModelIndex(), 0);
+    });
+
+    QVector<quint64> hashes;
+    const int findCount = qMin(itemCount, 1000);
+    for (int i = 0; i < findCount; ++i) {
+        const int row = static_cast<int>( static_cast<qint64>(i) * itemCount / findCount );
+        hashes.append( hash(model.data(model.index(row), contentType::data).toMap()) );
+    }
+
+    runner->run(findName, findCount, [&]() {
+        for (const auto itemHash : hashes)
+            model.findItem(itemHash);
+    });
+}
+
+std::unique_ptr<ClipboardBrowser> createBrowser(
+        ItemFactory *itemFactory, ItemKind kind, int itemCount)
+{
+    const auto sharedData = std::make_shared<ClipboardBrowserShared>();
+    sharedData->itemFactory = itemFactory;
+    sharedData->maxItems = itemCount;
+
+    std::unique_ptr<ClipboardBrowser> browser(
+        new ClipboardBrowser(QStringLiteral("benchmark %1 %2").arg(kindName(kind)).arg(itemCount), sharedData) );
+    browser->loadItems();
+    browser->setStoreItems(false);
+
+    QVariantMap data;
+    data.insert( mimeItems, serializeItemList(createItems(kind, itemCount)) );
+    browser->add(data);
+
+    return browser;
+}
+
+void benchmarkFilter(BenchmarkRunner *runner, ItemFactory *itemFactory, ItemKind kind, int itemCount)
+{
+    const QString name = benchmarkName("filter", kind, itemCount);
+    if ( !runner->isEnabled(name) )
+        return;
+
+    auto browser = createBrowser(itemFactory, kind, itemCount);
+
+    FilterLineEdit filterLineEdit;
+    filterLineEdit.setText( QStringLiteral("word42 word55") );
+    const ItemFilterPtr filter = filterLineEdit.filter();
+
+    runner->run(name, itemCount,
+        [&]() { browser->filterItems(nullptr); },
+        [&]() {
+            browser->filterItems(filter);
+            while ( browser->isFiltering() )
+                QCoreApplication::processEvents(QEventLoop::WaitForMoreEvents);
+        });
+}
+
+void benchmarkDelegate(BenchmarkRunner *runner, ItemFactory *itemFactory, ItemKind kind, int itemCount)
+{
+    const QString scrollName = benchmarkName("delegate/scroll", kind, itemCount);
+    const QString resizeName = benchmarkName("delegate/resize", kind, itemCount);
+    if ( !runner->isEnabled(scrollName) && !runner->isEnabled(resizeName) )
+        return;
+
+    auto browser = createBrowser(itemFactory, kind, itemCount);
+    browser->resize(400, 600);
+    browser->show();
+    QCoreApplication::processEvents();
+
+    // Scrolling creates and lays out item widgets for the visible rows.
+    const int rowCount = qMin(itemCount, 1000);
+    runner->run(scrollName, rowCount,
+        [&]() {
+            browser->scrollToTop();
+            QCoreApplication::processEvents();
+        },
+        [&]() {
+            for (int row = 0; row < rowCount; row += 5) {
+                browser->scrollTo( browser->index(row) );
+                QCoreApplication::processEvents();
+            }
+        });
+
+    int width = 400;
+    runner->run(resizeName, itemCount, [&]() {
+        width = width == 400 ? 600 : 400;
+        browser->resize(width, 600);
+        QCoreApplication::processEvents();
+    });
+}
+
+void benchmarkSocket(BenchmarkRunner *runner, int messageSize, int messageCount)
+{
+    const QString name = QStringLiteral("ipc/roundtrip/%1").arg(messageSize);
+    if ( !runner->isEnabled(name) )
+        return;
+
+    Server server( clipboardServerName() );
+    if ( !server.isListening() ) {
+        log("Skipping IPC benchmarks, failed to start server", LogWarning);
+        return;
+    }
+
+    // Echo messages back to client.
+    ClientSocketPtr serverSocket;
+    QObject::connect( &server, &Server::newConnection,
+        [&](const ClientSocketPtr &socket) {
+            serverSocket = socket;
+            QObject::connect( socket.get(), &ClientSocket::messageReceived,
+                socket.get(), [echoSocket = socket.get()](const QByteArray &message, int messageCode) {
+                    // Message can refer to shared memory (see ClientSocket::messageReceived()).
+                    echoSocket->sendMessage(QByteArray(message.constData(), message.size()), messageCode);
+                });
+            socket->start();
+        });
+    server.start();
+
+    ClientSocket client( clipboardServerName() );
+    QEventLoop loop;
+    QObject::connect( &client, &ClientSocket::messageReceived, &loop, &QEventLoop::quit );
+    QObject::connect( &client, &ClientSocket::disconnected, &loop, &QEventLoop::quit );
+    if ( !client.start() ) {
+        log("Skipping IPC benchmarks, failed to connect to server", LogWarning);
+        return;
+    }
+
+    const QByteArray message(messageSize, 'x');
+    runner->run(name, messageCount, [&]() {
+        for (int i = 0; i < messageCount; ++i) {
+            client.sendMessage(message, 0);
+            loop.exec();
+        }
+    });
+
+    client.close();
+    if (serverSocket)
+        serverSocket->close();
+}
+
+bool parseItemCounts(const QString &arg, QVector<int> *itemCounts)
+{
+    itemCounts->clear();
+    for ( const auto &value : arg.split(',') ) {
+        bool ok;
+        const int itemCount = value.toInt(&ok);
+        if (!ok || itemCount <= 0)
+            return false;
+        itemCounts->append(itemCount);
+    }
+    return !itemCounts->isEmpty();
+}
+
+bool parseArguments(const QStringList &args, Options *options)
+{
+    for (int i = 1; i < args.size(); ++i) {
+        const QString &arg = args[i];
+        const bool hasValue = i + 1 < args.size();
+        if (arg == QLatin1String("--items") && hasValue) {
+            if ( !parseItemCounts(args[++i], &options->itemCounts) )
+                return false;
+        } else if (arg == QLatin1String("--iterations") && hasValue) {
+            bool ok;
+            options->iterations = args[++i].toInt(&ok);
+            if (!ok || options->iterations <= 0)
+                return false;
+        } else if (arg == QLatin1String("--output") && hasValue) {
+            options->outputPath = args[++i];
+        } else if ( !arg.startsWith('-') && options->nameFilter.pattern().isEmpty() ) {
+            options->nameFilter.setPattern(arg);
+        } else {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void printUsage()
+{
+    QTextStream(stderr)
+        << "Usage: copyq-benchmarks [--items N[,N...]] [--iterations N] [--output FILE] [REGEXP]\n"
+        << "\n"
+        << "Runs benchmarks with names matching REGEXP and prints results in JSON.\n"
+        << "  --items       Numbers of items in generated tabs (default: 1000,10000,200000).\n"
+        << "  --iterations  Number of measured runs of each benchmark (default: 5).\n"
+        << "  --output      Write JSON to file instead of standard output.\n";
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    const auto platform = platformNativeInterface();
+    std::unique_ptr<QApplication> app( platform->createServerApplication(argc, argv) );
+
+    Options options;
+    if ( !parseArguments(QCoreApplication::arguments(), &options) ) {
+        printUsage();
+        return 2;
+    }
+
+    // Keep user configuration, tabs and items untouched.
+    QTemporaryDir settingsDir;
+    QSettings::setPath(QSettings::IniFormat, QSettings::UserScope, settingsDir.path());
+    QSettings::setDefaultFormat(QSettings::IniFormat);
+
+    const QString session = "copyq.benchmarks";
+    QCoreApplication::setOrganizationName(session);
+    QCoreApplication::setApplicationName(session);
+    initLogging();
+
+    ItemFactory itemFactory;
+    itemFactory.loadPlugins();
+
+    BenchmarkRunner runner(options.iterations, options.nameFilter);
+
+    for (const int itemCount : options.itemCounts) {
+        for (const auto kind : {ItemKind::Text, ItemKind::Html, ItemKind::Image}) {
+            benchmarkSerialization(&runner, kind, itemCount);
+            benchmarkModel(&runner, kind, itemCount);
+            benchmarkFilter(&runner, &itemFactory, kind, itemCount);
+            benchmarkDelegate(&runner, &itemFactory, kind, itemCount);
+        }
+    }
+
+    benchmarkSocket(&runner, 16, 1000);
+    benchmarkSocket(&runner, 64 * 1024, 200);
+    benchmarkSocket(&runner, 16 * 1024 * 1024, 10);
+
+    const QByteArray json = runner.toJson();
+    if ( options.outputPath.isEmpty() ) {
+        QFile output;
+        output.open(stdout, QIODevice::WriteOnly);
+        output.write(json);
+    } else {
+        QFile output(options.outputPath);
+        if ( !output.open(QIODevice::WriteOnly) || output.write(json) != json.size() ) {
+            log( QStringLiteral("Failed to write benchmark results to %1: %2")
+                 .arg(options.outputPath, output.errorString()), LogError );
+            return 1;
+        }
+    }
+
+    return 0;
+}
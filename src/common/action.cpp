@@ -2,10 +2,12 @@
 
 #include "action.h"
 
+#include "common/imagedata.h"
 #include "common/log.h"
 #include "common/mimetypes.h"
 #include "common/processsignals.h"
 #include "common/timer.h"
+#include "common/trace.h"
 #include "item/serialize.h"
 
 #include <QCoreApplication>
@@ -192,6 +194,8 @@ Action::Action(QObject *parent)
 Action::~Action()
 {
     closeSubCommands();
+    if (m_imageConverter)
+        m_imageConverter->wait();
 }
 
 QString Action::commandLine() const
@@ -221,9 +225,15 @@ void Action::setCommand(const QStringList &arguments)
 
 void Action::setInputWithFormat(const QVariantMap &data, const QString &inputFormat)
 {
+    m_inputImageData.clear();
     if (inputFormat == mimeItems) {
         m_input = serializeData(data);
         m_inputFormats = data.keys();
+    } else if ( lazyImageFormats(data).contains(inputFormat) ) {
+        // Image is converted in a worker thread when the action starts.
+        m_input.clear();
+        m_inputImageData = data;
+        m_inputFormats = QStringList(inputFormat);
     } else {
         m_input = data.value(inputFormat).toByteArray();
         m_inputFormats = QStringList(inputFormat);
@@ -232,6 +242,15 @@ void Action::setInputWithFormat(const QVariantMap &data, const QString &inputFor
 
 void Action::start()
 {
+    if ( !m_inputImageData.isEmpty() ) {
+        m_imageConverter = new ImageConverter(m_inputImageData, m_inputFormats.value(0), this);
+        m_inputImageData.clear();
+        connect( m_imageConverter, &QThread::finished,
+                 this, &Action::onInputImageConverted );
+        m_imageConverter->start();
+        return;
+    }
+
     closeSubCommands();
 
     if ( m_currentLine + 1 >= m_cmds.size() ) {
@@ -244,6 +263,8 @@ void Action::start()
 
     Q_ASSERT( !cmds.isEmpty() );
 
+    COPYQ_TRACE_DETAIL("action", "start action", m_name.isEmpty() ? commandLine() : m_name);
+
     QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
     if (m_id != -1)
         env.insert("COPYQ_ACTION_ID", QString::number(m_id));
@@ -321,7 +342,8 @@ bool Action::waitForFinished(int msecs)
 
 bool Action::isRunning() const
 {
-    return !m_processes.empty() && m_processes.back()->state() != QProcess::NotRunning;
+    return m_imageConverter
+        || (!m_processes.empty() && m_processes.back()->state() != QProcess::NotRunning);
 }
 
 void Action::setData(const QVariantMap &data)
@@ -412,8 +434,20 @@ void Action::onBytesWritten()
         m_processes.front()->closeWriteChannel();
 }
 
+void Action::onInputImageConverted()
+{
+    m_input = m_imageConverter->bytes();
+    m_imageConverter->deleteLater();
+    m_imageConverter = nullptr;
+    start();
+}
+
 void Action::terminate()
 {
+    // Skip the commands after the input conversion finishes.
+    if (m_imageConverter)
+        m_cmds.clear();
+
     if (m_processes.empty())
         return;
 
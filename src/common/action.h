@@ -10,6 +10,7 @@
 
 #include <vector>
 
+class ImageConverter;
 class QAction;
 
 /**
@@ -108,11 +109,14 @@ private:
     void onSubProcessErrorOutput();
     void writeInput();
     void onBytesWritten();
+    void onInputImageConverted();
 
     void closeSubCommands();
     void finish();
 
     QByteArray m_input;
+    QVariantMap m_inputImageData;
+    ImageConverter *m_imageConverter = nullptr;
     QList< QList<QStringList> > m_cmds;
     QStringList m_inputFormats;
     QString m_workingDirectoryPath;
@@ -342,6 +342,25 @@ struct max_process_manager_rows : Config<uint> {
     }
 };
 
+struct script_worker_pool_size : Config<int> {
+    static QString name() { return "script_worker_pool_size"; }
+    static Value defaultValue() { return 1; }
+    static Value value(Value v) { return qBound(0, v, 16); }
+    static const char *description() {
+        return "Number of long-running processes handling clipboard changes"
+               " (set to 0 to start a new process for each change)";
+    }
+};
+
+struct script_worker_max_events : Config<int> {
+    static QString name() { return "script_worker_max_events"; }
+    static Value defaultValue() { return 100; }
+    static Value value(Value v) { return qMax(1, v); }
+    static const char *description() {
+        return "Number of clipboard changes handled by a process before it is restarted";
+    }
+};
+
 struct save_delay_ms_on_item_added : Config<int> {
     static QString name() { return "save_delay_ms_on_item_added"; }
     static Value defaultValue() { return 5 * 60 * 1000; }
@@ -494,6 +513,26 @@ struct change_clipboard_owner_delay_ms : Config<int> {
     }
 };
 
+struct delayed_clipboard_format_max_size : Config<int> {
+    static QString name() { return "delayed_clipboard_format_max_size"; }
+    static Value defaultValue() { return 32 * 1024 * 1024; }
+    static Value value(Value v) { return qMax(0, v); }
+    static const char *description() {
+        return "Maximum size in bytes of HTML, image or other custom clipboard format"
+               " retrieved after text of a new item (bigger data is not stored)";
+    }
+};
+
+struct delayed_clipboard_format_max_ms : Config<int> {
+    static QString name() { return "delayed_clipboard_format_max_ms"; }
+    static Value defaultValue() { return 2000; }
+    static Value value(Value v) { return qMax(0, v); }
+    static const char *description() {
+        return "Skip remaining clipboard formats of a new item if retrieving"
+               " one takes longer than this (in milliseconds)";
+    }
+};
+
 struct row_index_from_one : Config<bool> {
     static QString name() { return "row_index_from_one"; }
     static Value defaultValue() { return true; }
@@ -503,6 +542,15 @@ struct row_index_from_one : Config<bool> {
     }
 };
 
+struct item_widget_pool_size : Config<int> {
+    static QString name() { return "item_widget_pool_size"; }
+    static Value defaultValue() { return 20; }
+    static const char *description() {
+        return "Maximum number of hidden item widgets kept for reuse in each tab"
+               " (0 to always create new widgets)";
+    }
+};
+
 struct style : Config<QString> {
     static QString name() { return "style"; }
     static const char *description() {
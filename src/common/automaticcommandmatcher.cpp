@@ -0,0 +1,142 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "automaticcommandmatcher.h"
+
+#include "common/imagedata.h"
+#include "common/mimetypes.h"
+#include "common/textdata.h"
+#include "common/trace.h"
+
+#include <QVariantList>
+
+namespace {
+
+/// Text is decoded only once and only if some command needs it.
+class LazyText final {
+public:
+    LazyText(const QVariantMap &data, const QString &format)
+        : m_data(data)
+        , m_format(format)
+    {
+    }
+
+    const QString &text()
+    {
+        if (!m_decoded) {
+            m_text = getTextData(m_data, m_format);
+            m_decoded = true;
+        }
+        return m_text;
+    }
+
+private:
+    const QVariantMap &m_data;
+    QString m_format;
+    QString m_text;
+    bool m_decoded = false;
+};
+
+bool matchText(const QRegularExpression &re, LazyText *text)
+{
+    return re.pattern().isEmpty() || text->text().contains(re);
+}
+
+} // namespace
+
+void AutomaticCommandMatcher::setCommands(const QVector<Command> &commands)
+{
+    m_matchers.clear();
+    m_matchers.reserve(commands.size());
+    m_checkedCount = 0;
+    m_unmatchedCount = 0;
+
+    for (const auto &command : commands) {
+        Matcher matcher;
+        matcher.name = command.name;
+        matcher.input = command.input;
+        matcher.output = command.output;
+        matcher.re = command.re;
+        matcher.wndre = command.wndre;
+        matcher.hasFilter = !command.matchCmd.isEmpty();
+        matcher.re.optimize();
+        matcher.wndre.optimize();
+        m_matchers.append(matcher);
+    }
+}
+
+bool AutomaticCommandMatcher::canMatch(const QVariantMap &data, const QStringList &pendingFormats) const
+{
+    return !matchingCommands(data, pendingFormats, true).isEmpty();
+}
+
+bool AutomaticCommandMatcher::countMatches(const QVariantMap &data)
+{
+    // All commands are checked to keep statistics for each.
+    const QVector<int> matched = matchingCommands(data, QStringList(), false);
+    if ( matched.isEmpty() ) {
+        countUnmatched();
+        return false;
+    }
+
+    for (const int i : matched)
+        ++m_matchers[i].matchCount;
+
+    ++m_checkedCount;
+    return true;
+}
+
+void AutomaticCommandMatcher::countUnmatched()
+{
+    ++m_checkedCount;
+    ++m_unmatchedCount;
+    traceCounter("commands", "unmatched clipboard changes", m_unmatchedCount);
+}
+
+QVector<int> AutomaticCommandMatcher::matchingCommands(
+    const QVariantMap &data, const QStringList &pendingFormats, bool firstOnly) const
+{
+    COPYQ_TRACE("commands", "match automatic commands");
+
+    LazyText text(data, mimeText);
+    LazyText windowTitle(data, mimeWindowTitle);
+
+    QVector<int> matched;
+    for (int i = 0; i < m_matchers.size(); ++i) {
+        const auto &matcher = m_matchers[i];
+        if ( !matcher.input.isEmpty() ) {
+            if (matcher.input == mimeItems || matcher.input == QLatin1String("!OUTPUT")) {
+                if ( data.contains(matcher.output) )
+                    continue;
+            } else if ( !hasDataFormat(data, matcher.input) && !pendingFormats.contains(matcher.input) ) {
+                continue;
+            }
+        }
+
+        if ( !matchText(matcher.re, &text) || !matchText(matcher.wndre, &windowTitle) )
+            continue;
+
+        matched.append(i);
+        if (firstOnly)
+            break;
+    }
+
+    return matched;
+}
+
+QVariantMap AutomaticCommandMatcher::statistics() const
+{
+    QVariantList commands;
+    for (const auto &matcher : m_matchers) {
+        commands.append(QVariantMap{
+            {QStringLiteral("name"), matcher.name},
+            {QStringLiteral("matches"), matcher.matchCount},
+            {QStringLiteral("filter"), matcher.hasFilter},
+        });
+    }
+
+    return QVariantMap{
+        {QStringLiteral("checked"), m_checkedCount},
+        {QStringLiteral("unmatched"), m_unmatchedCount},
+        {QStringLiteral("commands"), commands},
+    };
+}
@@ -0,0 +1,74 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef AUTOMATICCOMMANDMATCHER_H
+#define AUTOMATICCOMMANDMATCHER_H
+
+#include "common/command.h"
+
+#include <QRegularExpression>
+#include <QString>
+#include <QVariantMap>
+#include <QVector>
+
+/**
+ * Matches new clipboard data against format, text and window title
+ * constraints of all automatic commands without starting a script.
+ *
+ * Commands with a filter (Command::matchCmd) cannot be fully evaluated
+ * natively so these are treated as matching if the other constraints pass.
+ *
+ * Counts checked and matched clipboard changes (see statistics()).
+ */
+class AutomaticCommandMatcher final
+{
+public:
+    /// Replaces matched commands and resets statistics.
+    void setCommands(const QVector<Command> &commands);
+
+    /**
+     * Returns true if any automatic command can possibly match the data.
+     *
+     * Same rules as for automatic commands run by scripts apply
+     * (see Scriptable::canExecuteCommand()). Input formats in
+     * @a pendingFormats are treated as available (these are retrieved later).
+     *
+     * Statistics are not updated.
+     */
+    bool canMatch(const QVariantMap &data, const QStringList &pendingFormats = QStringList()) const;
+
+    /// Same as canMatch() but counts the clipboard change and matches of each command.
+    bool countMatches(const QVariantMap &data);
+
+    /// Counts clipboard change for which canMatch() returned false.
+    void countUnmatched();
+
+    /**
+     * Returns statistics:
+     *
+     * - "checked": number of checked clipboard changes,
+     * - "unmatched": number of changes no command matched,
+     * - "commands": list of {"name", "matches", "filter"} for each command.
+     */
+    QVariantMap statistics() const;
+
+private:
+    /// Returns indexes of matching commands (only the first one if @a firstOnly is true).
+    QVector<int> matchingCommands(
+        const QVariantMap &data, const QStringList &pendingFormats, bool firstOnly) const;
+
+    struct Matcher {
+        QString name;
+        QString input;
+        QString output;
+        QRegularExpression re;
+        QRegularExpression wndre;
+        bool hasFilter = false;
+        int matchCount = 0;
+    };
+
+    QVector<Matcher> m_matchers;
+    int m_checkedCount = 0;
+    int m_unmatchedCount = 0;
+};
+
+#endif // AUTOMATICCOMMANDMATCHER_H
@@ -7,6 +7,12 @@
 #include "common/sleeptimer.h"
 
 #include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QTemporaryFile>
+
+#include <climits>
 
 #define SOCKET_LOG(text) \
     COPYQ_LOG_VERBOSE( QString("Socket %1: %2").arg(m_socketId).arg(text) )
@@ -18,6 +24,30 @@ ClientSocketId lastSocketId = 0;
 const quint32 protocolMagicNumber = 0x0C090701;
 const quint32 protocolVersion = 1;
 
+/// Magic number for messages with data passed in a shared memory file.
+const quint32 sharedMessageMagicNumber = 0x0C090702;
+
+/// Pass bigger messages in shared memory instead of socket (if available).
+const int sharedMessageMinSize = 1024 * 1024;
+
+const char sharedMessageFilePrefix[] = "copyq-message-";
+
+/// Maximum length of file name passed instead of a message in shared memory.
+const int maxSharedMessageReferenceLength = 1024;
+
+/**
+ * Message codes handled only by ClientSocket.
+ *
+ * Client sends the handshake after connecting and server replies with the
+ * same message. Messages are passed in shared memory only if the peer sent
+ * the handshake, so older clients and servers receive only plain messages.
+ *
+ * Receiver of a message in shared memory acknowledges it by sending back
+ * the file name so the sender can forget it.
+ */
+const int sharedMessagesSupportedCode = -0x0C0901;
+const int sharedMessageReceivedCode = -0x0C0902;
+
 template <typename T>
 int doStreamDataSize(T value)
 {
@@ -48,38 +78,118 @@ int headerDataSize()
     return bytes.length();
 }
 
-template <typename T>
-bool readValue(T *value, QByteArray *message)
+/// Size of data written to socket at once.
+const int writeChunkSize = 64 * 1024;
+
+/// Stop writing if there is more data in socket buffer (continue after some is sent).
+const qint64 maxBytesToWrite = 1024 * 1024;
+
+/**
+ * Message header: magic number, version, length of the rest and message code.
+ *
+ * Message data follows the header.
+ */
+QByteArray messageHeader(int messageCode, int messageLength, quint32 magicNumber = protocolMagicNumber)
 {
-    QDataStream stream(*message);
-    stream.setVersion(QDataStream::Qt_5_0);
-    stream >> *value;
-    message->remove(0, streamDataSize(*value));
-    return stream.status() == QDataStream::Ok;
+    QByteArray bytes;
+    QDataStream out(&bytes, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_5_0);
+    const auto codeSize = streamDataSize( static_cast<qint32>(messageCode) );
+    out << magicNumber << protocolVersion
+        << static_cast<quint32>(codeSize + messageLength)
+        << static_cast<qint32>(messageCode);
+    return bytes;
 }
 
-bool writeMessage(QLocalSocket *socket, const QByteArray &msg)
+/**
+ * Writes message to a new file in shared memory and returns the file name.
+ *
+ * Returns empty string on failure so the message can be sent through socket.
+ */
+QString writeSharedMessage(const QByteArray &message)
 {
-    COPYQ_LOG_VERBOSE( QString("Write message (%1 bytes).").arg(msg.size()) );
+    const QString path = sharedMessageDirectory();
+    if ( path.isEmpty() )
+        return QString();
+
+    // Temporary file is readable and writable only by the user.
+    QTemporaryFile file( path + '/' + sharedMessageFilePrefix + "XXXXXX" );
+    file.setAutoRemove(false);
+    if ( !file.open() )
+        return QString();
+
+    if ( file.write(message) != message.size() || !file.flush() ) {
+        COPYQ_LOG( QString("Failed to write message to shared memory: %1").arg(file.errorString()) );
+        file.remove();
+        return QString();
+    }
 
-    QDataStream out(socket);
-    out.setVersion(QDataStream::Qt_5_0);
-    // length is serialized as a quint32, followed by msg
-    const auto length = static_cast<quint32>(msg.length());
-    out << protocolMagicNumber << protocolVersion;
-    out.writeBytes( msg.constData(), length );
+    return QFileInfo(file.fileName()).fileName();
+}
 
-    if (out.status() != QDataStream::Ok) {
-        COPYQ_LOG("Cannot write message!");
+/**
+ * Maps message from a file in shared memory and removes the file.
+ *
+ * The message data refer to the mapped memory without copying and are valid
+ * only until the file is closed.
+ */
+bool readSharedMessage(const QString &fileName, QFile *file, QByteArray *message)
+{
+    // Accept only files created by writeSharedMessage().
+    const QString path = sharedMessageDirectory();
+    if ( path.isEmpty()
+         || !fileName.startsWith(sharedMessageFilePrefix)
+         || fileName.contains('/') )
+    {
         return false;
     }
 
-    COPYQ_LOG_VERBOSE("Message written.");
-    return true;
+    file->setFileName(path + '/' + fileName);
+    if ( !file->open(QIODevice::ReadOnly) )
+        return false;
+
+    // The data stay available until the file is closed.
+    file->remove();
+
+    const qint64 size = file->size();
+    if (size > INT_MAX)
+        return false;
+
+    if (size == 0) {
+        message->clear();
+        return true;
+    }
+
+    const uchar *data = file->map(0, size);
+    if (data) {
+        *message = QByteArray::fromRawData(reinterpret_cast<const char*>(data), static_cast<int>(size));
+        return true;
+    }
+
+    *message = file->readAll();
+    return message->size() == size;
 }
 
 } //namespace
 
+QString sharedMessageDirectory()
+{
+#ifdef Q_OS_LINUX
+    static const QString path = []() {
+        const QFileInfo info( QStringLiteral("/dev/shm") );
+        return info.isDir() && info.isWritable() ? info.absoluteFilePath() : QString();
+    }();
+    return path;
+#else
+    return QString();
+#endif
+}
+
+QString sharedMessageFileNamePattern()
+{
+    return QLatin1String(sharedMessageFilePrefix) + QLatin1Char('*');
+}
+
 LocalSocketGuard::LocalSocketGuard(QLocalSocket *socket)
     : m_socket(socket)
 {
@@ -108,6 +218,7 @@ ClientSocket::ClientSocket(const QString &serverName, QObject *parent)
     , m_socket(new QLocalSocket)
     , m_socketId(++lastSocketId)
     , m_closed(false)
+    , m_sendsHandshake(true)
 {
     m_socket->connectToServer(serverName);
 
@@ -155,6 +266,12 @@ bool ClientSocket::start()
              this, &ClientSocket::onError );
     connect( m_socket.get(), &QLocalSocket::readyRead,
              this, &ClientSocket::onReadyRead );
+    connect( m_socket.get(), &QLocalSocket::bytesWritten,
+             this, &ClientSocket::onBytesWritten );
+    m_started = true;
+
+    if ( m_sendsHandshake && !sharedMessageDirectory().isEmpty() )
+        sendMessage(QByteArray(), sharedMessagesSupportedCode);
 
     onStateChanged(m_socket->state());
 
@@ -172,21 +289,35 @@ void ClientSocket::sendMessage(const QByteArray &message, int messageCode)
     } else if (m_closed) {
         SOCKET_LOG("Client disconnected!");
     } else {
-        QByteArray msg;
-        QDataStream out(&msg, QIODevice::WriteOnly);
-        out.setVersion(QDataStream::Qt_5_0);
-        out << static_cast<qint32>(messageCode);
-        out.writeRawData( message.constData(), message.length() );
-        if ( writeMessage(m_socket, msg) )
-            SOCKET_LOG("Message sent to client.");
-        else
-            SOCKET_LOG("Failed to send message to client!");
+        COPYQ_LOG_VERBOSE( QString("Write message (%1 bytes).").arg(message.size()) );
+
+        const QString sharedFileName =
+            m_peerSupportsSharedMessages && !m_closing && message.size() >= sharedMessageMinSize
+            ? writeSharedMessage(message) : QString();
+        if ( sharedFileName.isEmpty() ) {
+            m_writeQueue.append( messageHeader(messageCode, message.size()) );
+            if ( !message.isEmpty() )
+                m_writeQueue.append(message);
+        } else {
+            SOCKET_LOG( QString("Passing message in shared memory: %1").arg(sharedFileName) );
+            m_sharedFileNames.append(sharedFileName);
+            const QByteArray reference = sharedFileName.toUtf8();
+            m_writeQueue.append( messageHeader(messageCode, reference.size(), sharedMessageMagicNumber) );
+            m_writeQueue.append(reference);
+        }
+
+        writeQueued(!m_started);
     }
 }
 
 void ClientSocket::close()
 {
+    m_closing = true;
     if (m_socket) {
+        writeQueued(true);
+
+        // Messages in shared memory not received by the peer
+        // are removed once disconnected (see onStateChanged()).
         SOCKET_LOG("Disconnecting socket.");
         m_socket->disconnectFromServer();
     }
@@ -194,65 +325,153 @@ void ClientSocket::close()
 
 void ClientSocket::onReadyRead()
 {
-    if (!m_socket) {
-        SOCKET_LOG("Cannot read message from client. Socket is already deleted.");
-        return;
-    }
+    const int preambleSize = headerDataSize()
+        + streamDataSize(m_messageLength)
+        + streamDataSize(m_messageCode);
 
-    const qint64 available = m_socket->bytesAvailable();
-    m_message.append( m_socket->read(available) );
+    for (;;) {
+        if (!m_socket) {
+            SOCKET_LOG("Cannot read message from client. Socket is already deleted.");
+            return;
+        }
 
-    while ( !m_message.isEmpty() ) {
         if (!m_hasMessageLength) {
-            const int preambleSize = headerDataSize() + streamDataSize(m_messageLength);
-            if ( m_message.length() < preambleSize )
+            if ( m_socket->bytesAvailable() < preambleSize )
                 break;
 
-            {
-                QDataStream stream(m_message);
-                stream.setVersion(QDataStream::Qt_5_0);
-                quint32 magicNumber;
-                quint32 version;
-                stream >> magicNumber >> version >> m_messageLength;
-                if ( stream.status() != QDataStream::Ok ) {
-                    error("Failed to read message length from client!");
-                    return;
-                }
-
-                if (magicNumber != protocolMagicNumber) {
-                    error("Unexpected message magic number from client!");
-                    return;
-                }
-
-                if (version != protocolVersion) {
-                    error("Unexpected message version from client!");
-                    return;
-                }
+            const QByteArray preamble = m_socket->read(preambleSize);
+            QDataStream stream(preamble);
+            stream.setVersion(QDataStream::Qt_5_0);
+            quint32 magicNumber;
+            quint32 version;
+            stream >> magicNumber >> version >> m_messageLength >> m_messageCode;
+            if ( stream.status() != QDataStream::Ok ) {
+                error("Failed to read message length from client!");
+                return;
+            }
+
+            if (magicNumber != protocolMagicNumber && magicNumber != sharedMessageMagicNumber) {
+                error("Unexpected message magic number from client!");
+                return;
+            }
+            m_isSharedMessage = magicNumber == sharedMessageMagicNumber;
+
+            if (version != protocolVersion) {
+                error("Unexpected message version from client!");
+                return;
+            }
+
+            const auto codeSize = static_cast<quint32>( streamDataSize(m_messageCode) );
+            if ( m_messageLength < codeSize || m_messageLength - codeSize > static_cast<quint32>(INT_MAX) ) {
+                error("Unexpected message length from client!");
+                return;
+            }
+
+            m_expectedLength = static_cast<int>(m_messageLength - codeSize);
+            if ( m_isSharedMessage && m_expectedLength > maxSharedMessageReferenceLength ) {
+                error("Unexpected message length from client!");
+                return;
             }
 
-            m_message.remove(0, preambleSize);
+            // The length is not trusted, the buffer grows only as data arrive.
+            m_message.clear();
+            m_receivedLength = 0;
             m_hasMessageLength = true;
         }
 
-        const auto length = static_cast<int>(m_messageLength);
-        if ( m_message.length() < length )
-            break;
-
-        QByteArray msg = m_message.mid(0, length);
-        qint32 messageCode;
+        const int remaining = m_expectedLength - m_receivedLength;
+        if (remaining > 0) {
+            const qint64 available = m_socket->bytesAvailable();
+            if (available <= 0)
+                break;
 
-        if ( !readValue(&messageCode, &msg) ) {
-            error("Failed to read message code from client!");
-            return;
+            const int bytesToRead = static_cast<int>( qMin<qint64>(remaining, available) );
+            m_message.resize(m_receivedLength + bytesToRead);
+            const qint64 bytesRead = m_socket->read(m_message.data() + m_receivedLength, bytesToRead);
+            if (bytesRead < 0) {
+                error("Failed to read message from client!");
+                return;
+            }
+            m_receivedLength += static_cast<int>(bytesRead);
+            m_message.resize(m_receivedLength);
+            if (m_receivedLength < m_expectedLength)
+                break;
         }
 
         m_hasMessageLength = false;
-        m_message = m_message.mid(length);
+        QByteArray msg = m_message;
+        m_message = QByteArray();
+
+        if (m_messageCode == sharedMessagesSupportedCode) {
+            if ( !m_peerSupportsSharedMessages && !sharedMessageDirectory().isEmpty() ) {
+                SOCKET_LOG("Peer supports messages in shared memory.");
+                m_peerSupportsSharedMessages = true;
+                if (!m_sendsHandshake)
+                    sendMessage(QByteArray(), sharedMessagesSupportedCode);
+            }
+            continue;
+        }
+
+        if (m_messageCode == sharedMessageReceivedCode) {
+            m_sharedFileNames.removeOne( QString::fromUtf8(msg) );
+            continue;
+        }
+
+        // Mapped until the message is handled.
+        QFile sharedFile;
+        if (m_isSharedMessage) {
+            const QString fileName = QString::fromUtf8(msg);
+            if ( !readSharedMessage(fileName, &sharedFile, &msg) ) {
+                error( QString("Failed to read message from shared memory: %1").arg(fileName) );
+                return;
+            }
+            sendMessage(fileName.toUtf8(), sharedMessageReceivedCode);
+        }
+
+        // Only acknowledgements are handled while closing.
+        if (m_closing)
+            continue;
 
-        emit messageReceived(msg, messageCode, id());
+        emit messageReceived(msg, m_messageCode, id());
     }
 }
 
+void ClientSocket::onBytesWritten()
+{
+    writeQueued(false);
+}
+
+void ClientSocket::writeQueued(bool flush)
+{
+    if ( m_writeQueue.isEmpty() )
+        return;
+
+    while ( m_socket && !m_writeQueue.isEmpty()
+            && (flush || m_socket->bytesToWrite() < maxBytesToWrite) )
+    {
+        const QByteArray &bytes = m_writeQueue.first();
+        const int size = flush
+            ? bytes.size() - m_writeOffset
+            : qMin(bytes.size() - m_writeOffset, writeChunkSize);
+        const qint64 written = m_socket->write(bytes.constData() + m_writeOffset, size);
+        if (written < 0) {
+            m_writeQueue.clear();
+            m_writeOffset = 0;
+            SOCKET_LOG("Failed to send message to client!");
+            return;
+        }
+
+        m_writeOffset += static_cast<int>(written);
+        if (m_writeOffset >= bytes.size()) {
+            m_writeQueue.removeFirst();
+            m_writeOffset = 0;
+        }
+    }
+
+    if ( m_writeQueue.isEmpty() )
+        COPYQ_LOG_VERBOSE("Message written.");
+}
+
 void ClientSocket::onError(QLocalSocket::LocalSocketError error)
 {
     if (error == QLocalSocket::SocketTimeoutError)
@@ -275,6 +494,14 @@ void ClientSocket::onStateChanged(QLocalSocket::LocalSocketState state)
     if (!m_closed) {
         m_closed = state == QLocalSocket::UnconnectedState;
         if (m_closed) {
+            m_writeQueue.clear();
+            m_writeOffset = 0;
+
+            // Remove messages in shared memory not received by the peer.
+            for (const auto &fileName : m_sharedFileNames)
+                QFile::remove(sharedMessageDirectory() + '/' + fileName);
+            m_sharedFileNames.clear();
+
             if (m_hasMessageLength)
                 log("ERROR: Socket disconnected before receiving message", LogError);
 
@@ -3,12 +3,24 @@
 #ifndef CLIENTSOCKET_H
 #define CLIENTSOCKET_H
 
+#include <QByteArray>
+#include <QList>
 #include <QLocalSocket>
 #include <QObject>
 #include <QPointer>
+#include <QStringList>
 
 using ClientSocketId = qulonglong;
 
+/**
+ * Directory for passing message data in shared memory
+ * or empty string if not available.
+ */
+QString sharedMessageDirectory();
+
+/// Pattern matching names of files with messages in sharedMessageDirectory().
+QString sharedMessageFileNamePattern();
+
 class LocalSocketGuard final
 {
 public:
@@ -45,7 +57,16 @@ public:
     /// Start emitting messageReceived().
     bool start();
 
-    /** Send message to client. */
+    /**
+     * Send message to client.
+     *
+     * Large messages are written in chunks as the socket is able to send
+     * them so the data are not copied to the socket buffer all at once.
+     *
+     * Very large messages are passed in shared memory if available and
+     * the peer declared support for it when connecting (only a file
+     * reference is sent through the socket).
+     */
     void sendMessage(
             const QByteArray &message, //!< Message for client.
             int messageCode //!< Custom message code.
@@ -54,24 +75,51 @@ public:
     void close();
 
 signals:
+    /**
+     * Emitted when a message is received.
+     *
+     * A message passed in shared memory refers to the mapped file without
+     * copying and the data are valid only while the signal is emitted.
+     * Receivers must parse the message or copy the data to keep them
+     * (copies of the QByteArray share the mapped memory too).
+     */
     void messageReceived(const QByteArray &message, int messageCode, ClientSocketId clientId);
     void disconnected(ClientSocketId clientId);
     void connectionFailed(ClientSocketId clientId);
 
 private:
     void onReadyRead();
+    void onBytesWritten();
     void onError(QLocalSocket::LocalSocketError error);
     void onStateChanged(QLocalSocket::LocalSocketState state);
 
+    /// Write queued data to socket until its buffer is full (or all if @a flush is true).
+    void writeQueued(bool flush);
+
     void error(const QString &errorMessage);
 
     LocalSocketGuard m_socket;
     ClientSocketId m_socketId;
     bool m_closed;
+    bool m_closing = false;
+    bool m_started = false;
 
     bool m_hasMessageLength = false;
     quint32 m_messageLength = 0;
+    qint32 m_messageCode = 0;
     QByteArray m_message;
+    int m_expectedLength = 0;
+    int m_receivedLength = 0;
+    bool m_isSharedMessage = false;
+
+    /// Implicitly shared data waiting to be written to socket.
+    QList<QByteArray> m_writeQueue;
+    int m_writeOffset = 0;
+
+    /// Messages sent in shared memory and not yet received by the peer (removed on disconnect).
+    QStringList m_sharedFileNames;
+    bool m_peerSupportsSharedMessages = false;
+    bool m_sendsHandshake = false;
 };
 
 #endif // CLIENTSOCKET_H
@@ -3,9 +3,11 @@
 #include "common/common.h"
 
 #include "common/display.h"
+#include "common/imagedata.h"
 #include "common/log.h"
 #include "common/mimetypes.h"
 #include "common/textdata.h"
+#include "common/trace.h"
 
 #include <QApplication>
 #include <QBuffer>
@@ -14,7 +16,6 @@
 #include <QFont>
 #include <QFontMetrics>
 #include <QImage>
-#include <QImageWriter>
 #include <QKeyEvent>
 #include <QMimeData>
 #include <QMovie>
@@ -77,6 +78,16 @@ private:
 #endif
 
 class MimeData final : public QMimeData {
+public:
+    /// Provides image formats converted only when requested.
+    void setLazyImageFormats(const QVariantMap &data, const QStringList &formats)
+    {
+        m_imageData = data;
+        m_lazyImageFormats = formats;
+        for (const auto &format : formats)
+            setData(format, QByteArray());
+    }
+
 protected:
 #if QT_VERSION >= QT_VERSION_CHECK(6,0,0)
     QVariant retrieveData(const QString &mimeType, QMetaType preferredType) const override
@@ -85,8 +96,14 @@ protected:
 #endif
     {
         COPYQ_LOG_VERBOSE( QString("Providing \"%1\"").arg(mimeType) );
+        if ( m_lazyImageFormats.contains(mimeType) )
+            return convertImageData(m_imageData, mimeType);
         return QMimeData::retrieveData(mimeType, preferredType);
     }
+
+private:
+    QVariantMap m_imageData;
+    QStringList m_lazyImageFormats;
 };
 
 // Avoids accessing old clipboard/drag'n'drop data.
@@ -226,32 +243,6 @@ QString getImageFormatFromMime(const QString &mime)
     return mime.startsWith(imageMimePrefix) ? mime.mid(prefixLength) : QString();
 }
 
-/**
- * Sometimes only Qt internal image data are available in clipboard,
- * so this tries to convert the image data (if available) to given format.
- */
-void cloneImageData(
-        const QImage &image, const QString &format,
-        const QString &mime, QVariantMap *dataMap)
-{
-    if (image.isNull())
-        return;
-
-    // Omit converting unsupported formats (takes too much time and still fails).
-    if ( !QImageWriter::supportedImageFormats().contains(format.toUtf8()) )
-        return;
-
-    QBuffer buffer;
-    bool saved = image.save(&buffer, format.toUtf8().constData());
-
-    COPYQ_LOG( QString("Converting image to \"%1\" format: %2")
-               .arg(format,
-                    saved ? "Done" : "Failed") );
-
-    if (saved)
-        dataMap->insert(mime, buffer.buffer());
-}
-
 /**
  * Allow cloning images only with reasonable size.
  */
@@ -327,6 +318,13 @@ bool findFormatsWithPrefix(bool hasPrefix, const QString &prefix, const QVariant
     return !hasPrefix;
 }
 
+} // namespace
+
+bool isMainThread()
+{
+    return QThread::currentThread() == qApp->thread();
+}
+
 bool isBinaryImageFormat(const QString &format)
 {
     return format.startsWith(QStringLiteral("image/"))
@@ -334,15 +332,18 @@ bool isBinaryImageFormat(const QString &format)
            && !format.contains(QStringLiteral("svg"));
 }
 
-} // namespace
-
-bool isMainThread()
+bool isDelayedDataFormat(const QString &format)
 {
-    return QThread::currentThread() == qApp->thread();
+    return format != mimeText
+        && format != mimeTextUtf8
+        && format != mimeUriList
+        && !format.startsWith(QLatin1String(COPYQ_MIME_PREFIX));
 }
 
 QVariantMap cloneData(const QMimeData &rawData, QStringList formats, bool *abortCloning)
 {
+    COPYQ_TRACE_DETAIL("clipboard", "clone data", formats.join(QLatin1String(", ")));
+
     ClipboardDataGuard data(rawData, abortCloning);
 
     QVariantMap newdata;
@@ -378,13 +379,8 @@ QVariantMap cloneData(const QMimeData &rawData, QStringList formats, bool *abort
     // Retrieve images last since this can take a while.
     if ( !imageFormats.isEmpty() ) {
         const QImage image = data.getImageData();
-        if ( canCloneImageData(image) ) {
-            for (const auto &mime : imageFormats) {
-                const QString format = getImageFormatFromMime(mime);
-                if ( !format.isEmpty() )
-                    cloneImageData(image, format, mime, &newdata);
-            }
-        }
+        if ( canCloneImageData(image) )
+            storeImageData(image, imageFormats, &newdata);
     }
 
     // Drop duplicate UTF-8 text format.
@@ -435,12 +431,17 @@ QMimeData* createMimeData(const QVariantMap &data)
 {
     QStringList copyFormats = data.keys();
     copyFormats.removeOne(mimeClipboardMode);
+    copyFormats.removeOne(mimeImageFormats);
 
-    std::unique_ptr<QMimeData> newClipboardData(new MimeData);
+    std::unique_ptr<MimeData> newClipboardData(new MimeData);
 
     for ( const auto &format : copyFormats )
         newClipboardData->setData( format, data[format].toByteArray() );
 
+    const QStringList imageFormats = lazyImageFormats(data);
+    if ( !imageFormats.isEmpty() )
+        newClipboardData->setLazyImageFormats(data, imageFormats);
+
     if ( !copyFormats.contains(mimeOwner) ) {
         const auto owner = makeClipboardOwnerData();
         if ( !owner.isEmpty() )
@@ -630,6 +631,48 @@ bool isClipboardData(const QVariantMap &data)
     return data.value(mimeClipboardMode).toByteArray().isEmpty();
 }
 
+bool isInternalDataFormat(const QString &format)
+{
+    return format == mimeWindowTitle
+        || format == mimeItems
+        || format == mimeOwner
+        || format == mimeClipboardMode
+        || format == mimeCurrentTab
+        || format == mimeSelectedItems
+        || format == mimeCurrentItem
+        || format == mimeShortcut
+        || format == mimeOutputTab;
+}
+
+QVariantMap copyWithoutInternalData(const QVariantMap &data) {
+    QVariantMap newData;
+    for (auto it = data.constBegin(); it != data.constEnd(); ++it) {
+        const auto &format = it.key();
+        if ( !isInternalDataFormat(format) )
+            newData.insert(format, it.value());
+    }
+
+    return newData;
+}
+
+bool hasNonEmptyData(const QVariantMap &data)
+{
+    for (auto it = data.constBegin(); it != data.constEnd(); ++it) {
+        const auto &format = it.key();
+        if ( isInternalDataFormat(format) )
+            continue;
+
+        const auto bytes = it.value().toByteArray();
+        for (const auto &byte : bytes) {
+            const QChar c(byte);
+            if ( !c.isSpace() && !c.isNull() )
+                return true;
+        }
+    }
+
+    return false;
+}
+
 bool handleViKey(QKeyEvent *event, QObject *eventReceiver)
 {
     int key = event->key();
@@ -28,6 +28,17 @@ bool isMainThread();
 
 QByteArray makeClipboardOwnerData();
 
+/** Return true for image formats other than SVG and XML (these can take long to convert). */
+bool isBinaryImageFormat(const QString &format);
+
+/**
+ * Return true if the clipboard owner can take long to provide data in the format.
+ *
+ * Only plain text, URIs and internal formats are expected to be fast to retrieve.
+ * Other formats (HTML, images, custom formats) can be retrieved after the text.
+ */
+bool isDelayedDataFormat(const QString &format);
+
 /** Clone data for given formats (text or HTML will be UTF8 encoded). */
 QVariantMap cloneData(const QMimeData &data, QStringList formats, bool *abortCloning = nullptr);
 
@@ -82,6 +93,14 @@ QString dataToText(const QByteArray &bytes, const QString &mime = QString());
 
 bool isClipboardData(const QVariantMap &data);
 
+/// Returns true for formats added by the application (window title, output tab etc.).
+bool isInternalDataFormat(const QString &format);
+
+QVariantMap copyWithoutInternalData(const QVariantMap &data);
+
+/// Returns true only if data contains a non-internal format with non-whitespace content.
+bool hasNonEmptyData(const QVariantMap &data);
+
 /**
  * Handle key for Vi mode.
  */
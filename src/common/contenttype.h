@@ -42,7 +42,13 @@ enum {
     color,
 
     /// If true, hide content of item (not notes, tags etc.).
-    isHidden
+    isHidden,
+
+    /// Item data without formats left in tab file (see ItemPayload).
+    inlineData,
+
+    /// Item data with formats left in tab file as ItemPayload values.
+    storedData
 };
 
 }
@@ -0,0 +1,198 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "imagedata.h"
+
+#include "common/compatibility.h"
+#include "common/log.h"
+#include "common/mimetypes.h"
+#include "common/trace.h"
+
+#include <QBuffer>
+#include <QImage>
+#include <QImageWriter>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QVector>
+
+namespace {
+
+const int imageCacheSize = 4;
+
+struct ConvertedImage {
+    QByteArray source;
+    QString mime;
+    QByteArray bytes;
+};
+
+struct ImageCache {
+    QMutex mutex;
+    /// Most recently used image is last.
+    QVector<ConvertedImage> images;
+};
+
+ImageCache &imageCache()
+{
+    static ImageCache cache;
+    return cache;
+}
+
+QByteArray imageFormatFromMime(const QString &mime)
+{
+    const QLatin1String prefix("image/");
+    return mime.startsWith(prefix) ? mime.mid(prefix.size()).toUtf8() : QByteArray();
+}
+
+bool canWriteImage(const QString &mime)
+{
+    const QByteArray format = imageFormatFromMime(mime);
+    return !format.isEmpty() && QImageWriter::supportedImageFormats().contains(format);
+}
+
+QByteArray encodeImage(const QImage &image, const QString &mime)
+{
+    COPYQ_TRACE_DETAIL("image", "encode image", mime);
+
+    QBuffer buffer;
+    const bool saved = image.save(&buffer, imageFormatFromMime(mime).constData());
+
+    COPYQ_LOG( QStringLiteral("Converting image to \"%1\": %2")
+               .arg(mime, saved ? "Done" : "Failed") );
+
+    return saved ? buffer.buffer() : QByteArray();
+}
+
+/// Returns stored image format followed by the formats it can be converted to.
+QStringList imageFormats(const QVariantMap &data)
+{
+    const QByteArray formats = data.value(mimeImageFormats).toByteArray();
+    if ( formats.isEmpty() )
+        return QStringList();
+
+    return QString::fromUtf8(formats).split('\n', SKIP_EMPTY_PARTS);
+}
+
+bool findConvertedImage(const QByteArray &source, const QString &mime, QByteArray *bytes)
+{
+    auto &cache = imageCache();
+    QMutexLocker lock(&cache.mutex);
+    for (int i = cache.images.size() - 1; i >= 0; --i) {
+        const auto &image = cache.images[i];
+        if (image.mime == mime && image.source == source) {
+            *bytes = image.bytes;
+            cache.images.append( cache.images.takeAt(i) );
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void addConvertedImage(const QByteArray &source, const QString &mime, const QByteArray &bytes)
+{
+    auto &cache = imageCache();
+    QMutexLocker lock(&cache.mutex);
+    cache.images.append({source, mime, bytes});
+    if (cache.images.size() > imageCacheSize)
+        cache.images.removeFirst();
+}
+
+} // namespace
+
+void storeImageData(const QImage &image, const QStringList &mimes, QVariantMap *data)
+{
+    QStringList formats;
+    for (const auto &mime : mimes) {
+        if ( !formats.contains(mime) && canWriteImage(mime) )
+            formats.append(mime);
+    }
+
+    if ( formats.isEmpty() )
+        return;
+
+    // Prefer lossless compressed format.
+    const int pngIndex = formats.indexOf(QStringLiteral("image/png"));
+    if (pngIndex > 0)
+        formats.move(pngIndex, 0);
+
+    const QByteArray bytes = encodeImage(image, formats[0]);
+    if ( bytes.isEmpty() )
+        return;
+
+    data->insert(formats[0], bytes);
+    if (formats.size() > 1)
+        data->insert( mimeImageFormats, formats.join('\n').toUtf8() );
+}
+
+QStringList lazyImageFormats(const QVariantMap &data)
+{
+    QStringList formats = imageFormats(data).mid(1);
+    for (int i = formats.size() - 1; i >= 0; --i) {
+        if ( data.contains(formats[i]) )
+            formats.removeAt(i);
+    }
+    return formats;
+}
+
+QByteArray convertImageData(const QVariantMap &data, const QString &mime)
+{
+    const QStringList formats = imageFormats(data);
+    if ( formats.size() < 2 || !formats.contains(mime) )
+        return QByteArray();
+
+    const QString &sourceMime = formats[0];
+    const QByteArray source = data.value(sourceMime).toByteArray();
+    if ( source.isEmpty() )
+        return QByteArray();
+
+    QByteArray bytes;
+    if ( findConvertedImage(source, mime, &bytes) )
+        return bytes;
+
+    const QImage image = QImage::fromData( source, imageFormatFromMime(sourceMime).constData() );
+    if ( image.isNull() ) {
+        log( QStringLiteral("Failed to load image in \"%1\"").arg(sourceMime), LogWarning );
+        return QByteArray();
+    }
+
+    bytes = encodeImage(image, mime);
+    if ( !bytes.isEmpty() )
+        addConvertedImage(source, mime, bytes);
+
+    return bytes;
+}
+
+bool hasDataFormat(const QVariantMap &data, const QString &mime)
+{
+    return data.contains(mime) || lazyImageFormats(data).contains(mime);
+}
+
+QStringList availableDataFormats(const QVariantMap &data)
+{
+    QStringList formats = data.keys();
+    formats.removeOne(mimeImageFormats);
+    return formats + lazyImageFormats(data);
+}
+
+QByteArray dataForFormat(const QVariantMap &data, const QString &mime)
+{
+    const auto it = data.constFind(mime);
+    if ( it != data.constEnd() )
+        return it.value().toByteArray();
+
+    return convertImageData(data, mime);
+}
+
+QStringList imageSourceFormats(const QVariantMap &data, const QStringList &mimes)
+{
+    for ( const auto &format : lazyImageFormats(data) ) {
+        if ( mimes.contains(format) )
+            return {QString(mimeImageFormats), imageFormats(data).value(0)};
+    }
+
+    return QStringList();
+}
+
+void ImageConverter::run()
+{
+    m_bytes = convertImageData(m_data, m_mime);
+}
@@ -0,0 +1,65 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef IMAGEDATA_H
+#define IMAGEDATA_H
+
+#include <QByteArray>
+#include <QStringList>
+#include <QThread>
+#include <QVariantMap>
+
+class QImage;
+
+/**
+ * Stores image only in single format (PNG, if requested).
+ *
+ * Other requested image formats are only listed in the data and are
+ * converted when needed with convertImageData().
+ */
+void storeImageData(const QImage &image, const QStringList &mimes, QVariantMap *data);
+
+/// Returns image formats which are not stored in @a data but can be converted to.
+QStringList lazyImageFormats(const QVariantMap &data);
+
+/**
+ * Converts stored image to given format (see lazyImageFormats()).
+ *
+ * Few recently converted images are cached.
+ */
+QByteArray convertImageData(const QVariantMap &data, const QString &mime);
+
+/// Returns true if @a data contains given format or the image can be converted to it.
+bool hasDataFormat(const QVariantMap &data, const QString &mime);
+
+/// Returns stored and lazily converted formats (without the internal list of image formats).
+QStringList availableDataFormats(const QVariantMap &data);
+
+/// Returns data for given format, converting the image if needed.
+QByteArray dataForFormat(const QVariantMap &data, const QString &mime);
+
+/// Returns formats needed to convert the image to any of lazy image formats in @a mimes.
+QStringList imageSourceFormats(const QVariantMap &data, const QStringList &mimes);
+
+/// Converts image with convertImageData() in a worker thread.
+class ImageConverter final : public QThread
+{
+public:
+    ImageConverter(const QVariantMap &data, const QString &mime, QObject *parent = nullptr)
+        : QThread(parent)
+        , m_data(data)
+        , m_mime(mime)
+    {
+    }
+
+    const QByteArray &bytes() const { return m_bytes; }
+
+protected:
+    void run() override;
+
+private:
+    QVariantMap m_data;
+    QString m_mime;
+    QByteArray m_bytes;
+};
+
+#endif // IMAGEDATA_H
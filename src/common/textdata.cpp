@@ -4,6 +4,7 @@
 
 #include "common/mimetypes.h"
 
+#include <QHash>
 #include <QLocale>
 #include <QString>
 #include <Qt>
@@ -13,6 +14,19 @@
 
 namespace {
 
+/// Uses two 32-bit hashes with different seeds if qHash() is not 64-bit.
+template <typename T>
+quint64 hash64(const T &value, quint64 seed)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(6,0,0) && QT_POINTER_SIZE == 8
+    return qHash(value, static_cast<size_t>(seed));
+#else
+    const uint high = qHash( value, static_cast<uint>(seed >> 32) ^ 0x9e3779b9u );
+    const uint low = qHash( value, static_cast<uint>(seed) );
+    return (static_cast<quint64>(high) << 32) | low;
+#endif
+}
+
 QString escapeHtmlSpaces(const QString &str)
 {
     QString str2 = str;
@@ -23,10 +37,9 @@ QString escapeHtmlSpaces(const QString &str)
 
 } // namespace
 
-uint hash(const QVariantMap &data)
+quint64 hash(const QVariantMap &data)
 {
-    uint seed = 0;
-    QtPrivate::QHashCombine hash;
+    quint64 seed = 0;
 
     for (auto it = data.constBegin(); it != data.constEnd(); ++it) {
         const auto &mime = it.key();
@@ -35,11 +48,12 @@ uint hash(const QVariantMap &data)
         if (mime == mimeWindowTitle || mime == mimeOwner || mime == mimeClipboardMode)
             continue;
 
-        seed = hash(seed, mime);
-        seed = hash(seed, data[mime].toByteArray());
+        seed = hash64(mime, seed);
+        seed = hash64(it.value().toByteArray(), seed);
     }
 
-    return seed;
+    // Avoid zero which means "not computed" in ClipboardItem.
+    return seed == 0 ? 1 : seed;
 }
 
 QString quoteString(const QString &str)
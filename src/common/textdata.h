@@ -8,7 +8,8 @@
 class QByteArray;
 class QString;
 
-uint hash(const QVariantMap &data);
+/** Returns 64-bit hash of item data (stable only within the process, do not store it). */
+quint64 hash(const QVariantMap &data);
 
 QString quoteString(const QString &str);
 
@@ -0,0 +1,269 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "trace.h"
+
+#include "common/log.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
+#include <QVector>
+
+#include <atomic>
+
+namespace {
+
+struct TraceEvent {
+    const char *category = nullptr;
+    const char *name = nullptr;
+    QString detail;
+    qint64 timestampUs = 0;
+    /// Duration for spans, value for counters.
+    qint64 value = 0;
+    quint64 threadId = 0;
+    char phase = 'X';
+};
+
+struct TraceBuffer {
+    QMutex mutex;
+    QVector<TraceEvent> events;
+    int next = 0;
+    bool wrapped = false;
+    QHash<quint64, QString> threadNames;
+};
+
+std::atomic_bool tracingEnabled{false};
+
+QElapsedTimer &traceTimer()
+{
+    static QElapsedTimer timer;
+    return timer;
+}
+
+TraceBuffer &traceBuffer()
+{
+    static TraceBuffer buffer;
+    return buffer;
+}
+
+qint64 nowUs()
+{
+    return traceTimer().nsecsElapsed() / 1000;
+}
+
+quint64 currentThreadId()
+{
+    return static_cast<quint64>( reinterpret_cast<quintptr>(QThread::currentThreadId()) );
+}
+
+QString currentThreadName()
+{
+    QThread *thread = QThread::currentThread();
+    const QString name = thread ? thread->objectName() : QString();
+    if ( !name.isEmpty() )
+        return name;
+
+    const auto app = QCoreApplication::instance();
+    if (app && thread == app->thread())
+        return QStringLiteral("main");
+
+    return QString();
+}
+
+void addEvent(TraceEvent &&event)
+{
+    // Avoid locking if tracing was stopped in the meantime.
+    if (!tracingEnabled)
+        return;
+
+    event.threadId = currentThreadId();
+
+    auto &buffer = traceBuffer();
+    QMutexLocker lock(&buffer.mutex);
+    if ( !tracingEnabled || buffer.events.isEmpty() )
+        return;
+
+    if ( !buffer.threadNames.contains(event.threadId) )
+        buffer.threadNames.insert( event.threadId, currentThreadName() );
+
+    buffer.events[buffer.next] = std::move(event);
+    ++buffer.next;
+    if ( buffer.next == buffer.events.size() ) {
+        buffer.next = 0;
+        buffer.wrapped = true;
+    }
+}
+
+QJsonObject toJson(const TraceEvent &event, qint64 pid)
+{
+    QJsonObject object{
+        {QStringLiteral("cat"), QString::fromLatin1(event.category)},
+        {QStringLiteral("name"), QString::fromLatin1(event.name)},
+        {QStringLiteral("ph"), QString(QLatin1Char(event.phase))},
+        {QStringLiteral("ts"), event.timestampUs},
+        {QStringLiteral("pid"), pid},
+        {QStringLiteral("tid"), static_cast<qint64>(event.threadId)},
+    };
+
+    if (event.phase == 'C') {
+        object.insert( QStringLiteral("args"),
+                       QJsonObject{{QString::fromLatin1(event.name), event.value}} );
+    } else {
+        object.insert( QStringLiteral("dur"), event.value );
+        if ( !event.detail.isEmpty() ) {
+            object.insert( QStringLiteral("args"),
+                           QJsonObject{{QStringLiteral("detail"), event.detail}} );
+        }
+    }
+
+    return object;
+}
+
+bool writeEvent(QFile *file, const QJsonObject &object, bool *first)
+{
+    const QByteArray separator = *first ? "\n" : ",\n";
+    *first = false;
+    return file->write(separator) != -1
+        && file->write( QJsonDocument(object).toJson(QJsonDocument::Compact) ) != -1;
+}
+
+bool writeTrace(
+        const QString &fileName, const QVector<TraceEvent> &events,
+        const QHash<quint64, QString> &threadNames)
+{
+    QFile file(fileName);
+    if ( !file.open(QIODevice::WriteOnly) ) {
+        log( QStringLiteral("Failed to open trace file \"%1\": %2")
+             .arg(fileName, file.errorString()), LogError );
+        return false;
+    }
+
+    const qint64 pid = QCoreApplication::applicationPid();
+    bool first = true;
+    bool ok = file.write("{\"traceEvents\":[") != -1;
+
+    for (auto it = threadNames.constBegin(); ok && it != threadNames.constEnd(); ++it) {
+        if ( it.value().isEmpty() )
+            continue;
+        const QJsonObject object{
+            {QStringLiteral("name"), QStringLiteral("thread_name")},
+            {QStringLiteral("ph"), QStringLiteral("M")},
+            {QStringLiteral("pid"), pid},
+            {QStringLiteral("tid"), static_cast<qint64>(it.key())},
+            {QStringLiteral("args"), QJsonObject{{QStringLiteral("name"), it.value()}}},
+        };
+        ok = writeEvent(&file, object, &first);
+    }
+
+    for (int i = 0; ok && i < events.size(); ++i)
+        ok = writeEvent(&file, toJson(events[i], pid), &first);
+
+    ok = ok && file.write("\n],\"displayTimeUnit\":\"ms\"}\n") != -1;
+
+    if (!ok) {
+        log( QStringLiteral("Failed to write trace file \"%1\": %2")
+             .arg(fileName, file.errorString()), LogError );
+    }
+
+    return ok;
+}
+
+} // namespace
+
+void startTracing(int maxEventCount)
+{
+    auto &buffer = traceBuffer();
+    QMutexLocker lock(&buffer.mutex);
+
+    buffer.events.clear();
+    buffer.events.resize( qMax(1, maxEventCount) );
+    buffer.next = 0;
+    buffer.wrapped = false;
+    buffer.threadNames.clear();
+
+    if ( !traceTimer().isValid() )
+        traceTimer().start();
+
+    tracingEnabled = true;
+    log( QStringLiteral("Tracing started"), LogNote );
+}
+
+bool stopTracing(const QString &fileName)
+{
+    QVector<TraceEvent> events;
+    QHash<quint64, QString> threadNames;
+
+    {
+        auto &buffer = traceBuffer();
+        QMutexLocker lock(&buffer.mutex);
+        if (!tracingEnabled)
+            return false;
+
+        tracingEnabled = false;
+
+        // Oldest events first.
+        if (buffer.wrapped) {
+            events = buffer.events.mid(buffer.next);
+            events.append( buffer.events.mid(0, buffer.next) );
+        } else {
+            events = buffer.events.mid(0, buffer.next);
+        }
+
+        buffer.events.clear();
+        buffer.next = 0;
+        buffer.wrapped = false;
+        threadNames.swap(buffer.threadNames);
+    }
+
+    log( QStringLiteral("Tracing stopped, writing %1 events to: %2")
+         .arg(events.size()).arg(fileName), LogNote );
+
+    return writeTrace(fileName, events, threadNames);
+}
+
+bool isTracing()
+{
+    return tracingEnabled;
+}
+
+void traceCounter(const char *category, const char *name, qint64 value)
+{
+    if (!tracingEnabled)
+        return;
+
+    TraceEvent event;
+    event.category = category;
+    event.name = name;
+    event.timestampUs = nowUs();
+    event.value = value;
+    event.phase = 'C';
+    addEvent(std::move(event));
+}
+
+TraceSpan::TraceSpan(const char *category, const char *name)
+    : m_category(category)
+    , m_name(name)
+{
+    if (tracingEnabled)
+        m_startUs = nowUs();
+}
+
+TraceSpan::~TraceSpan()
+{
+    if ( !isActive() )
+        return;
+
+    TraceEvent event;
+    event.category = m_category;
+    event.name = m_name;
+    event.detail = m_detail;
+    event.timestampUs = m_startUs;
+    event.value = nowUs() - m_startUs;
+    addEvent(std::move(event));
+}
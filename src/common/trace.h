@@ -0,0 +1,71 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <QString>
+
+/**
+ * Starts recording trace events in memory.
+ *
+ * Only last @a maxEventCount events are kept (ring buffer).
+ */
+void startTracing(int maxEventCount = 100000);
+
+/**
+ * Stops recording and writes events to a file in Chrome trace JSON format
+ * (can be opened in Perfetto UI or chrome://tracing).
+ */
+bool stopTracing(const QString &fileName);
+
+bool isTracing();
+
+/// Records value of a counter (shown as a graph in trace viewer).
+void traceCounter(const char *category, const char *name, qint64 value);
+
+/**
+ * Records duration of a scope if tracing is enabled.
+ *
+ * Category and name must be string literals (they are stored as pointers).
+ * Additional info is returned by @a detail function which is called only
+ * if tracing is enabled.
+ */
+class TraceSpan final
+{
+public:
+    TraceSpan(const char *category, const char *name);
+
+    template <typename DetailFunction>
+    TraceSpan(const char *category, const char *name, DetailFunction detail)
+        : TraceSpan(category, name)
+    {
+        if ( isActive() )
+            m_detail = detail();
+    }
+
+    ~TraceSpan();
+
+    TraceSpan(const TraceSpan &) = delete;
+    TraceSpan &operator=(const TraceSpan &) = delete;
+
+    bool isActive() const { return m_startUs >= 0; }
+
+private:
+    const char *m_category;
+    const char *m_name;
+    QString m_detail;
+    qint64 m_startUs = -1;
+};
+
+#define COPYQ_TRACE_CONCAT_(a, b) a ## b
+#define COPYQ_TRACE_CONCAT(a, b) COPYQ_TRACE_CONCAT_(a, b)
+
+#define COPYQ_TRACE(category, name) \
+    const TraceSpan COPYQ_TRACE_CONCAT(traceSpan, __LINE__)(category, name)
+
+/// Evaluates @a detail only if tracing is enabled.
+#define COPYQ_TRACE_DETAIL(category, name, detail) \
+    const TraceSpan COPYQ_TRACE_CONCAT(traceSpan, __LINE__)( \
+        category, name, [&]() -> QString { return (detail); })
+
+#endif // TRACE_H
@@ -9,6 +9,7 @@
 #include "common/temporaryfile.h"
 #include "common/textdata.h"
 #include "common/timer.h"
+#include "common/trace.h"
 #include "gui/clipboarddialog.h"
 #include "gui/iconfactory.h"
 #include "gui/icons.h"
@@ -17,6 +18,7 @@
 #include "item/itemeditor.h"
 #include "item/itemeditorwidget.h"
 #include "item/itemfactory.h"
+#include "item/itemfilterworker.h"
 #include "item/itemstore.h"
 #include "item/itemwidget.h"
 #include "item/persistentdisplayitem.h"
@@ -24,6 +26,7 @@
 #include <QApplication>
 #include <QDrag>
 #include <QElapsedTimer>
+#include <QFile>
 #include <QKeyEvent>
 #include <QMimeData>
 #include <QProgressBar>
@@ -47,6 +50,12 @@ enum class MoveType {
     Relative
 };
 
+/// Time to filter items in GUI thread before continuing in background.
+const int filterSynchronouslyMs = 20;
+
+/// Postpone delayed saving while items are loaded in background.
+const int saveDelayMsWhileLoading = 1000;
+
 /// Save drag'n'drop image data in temporary file (required by some applications).
 class TemporaryDragAndDropImage final : public QObject {
 public:
@@ -216,6 +225,7 @@ ClipboardBrowser::ClipboardBrowser(
     , m_tabName(tabName)
     , m_maxItemCount(sharedData->maxItems)
     , m(this)
+    , m_searchIndex(&m)
     , d(this, sharedData)
     , m_editor(nullptr)
     , m_sharedData(sharedData)
@@ -234,7 +244,7 @@ ClipboardBrowser::ClipboardBrowser(
     setEditTriggers(QAbstractItemView::NoEditTriggers);
     setAlternatingRowColors(true);
 
-    initSingleShotTimer( &m_timerSave, 0, this, &ClipboardBrowser::saveItems );
+    initSingleShotTimer( &m_timerSave, 0, this, &ClipboardBrowser::onSaveTimeout );
     initSingleShotTimer( &m_timerEmitItemCount, 0, this, &ClipboardBrowser::emitItemCount );
     initSingleShotTimer( &m_timerUpdateSizes, 0, this, &ClipboardBrowser::updateSizes );
     initSingleShotTimer( &m_timerUpdateCurrent, 0, this, &ClipboardBrowser::updateCurrent );
@@ -260,10 +270,14 @@ ClipboardBrowser::ClipboardBrowser(
 ClipboardBrowser::~ClipboardBrowser()
 {
     delete m_editor.data();
+
+    // Wait for any canceled filtering to finish before the model and item factory are gone.
+    qDeleteAll( findChildren<ItemFilterWorker*>(QString(), Qt::FindDirectChildrenOnly) );
+
     saveUnsavedItems();
 }
 
-bool ClipboardBrowser::moveToTop(uint itemHash)
+bool ClipboardBrowser::moveToTop(quint64 itemHash)
 {
     const int row = m.findItem(itemHash);
     if (row < 0)
@@ -326,9 +340,14 @@ bool ClipboardBrowser::isFiltered(int row) const
     if ( filter->matchesNone() )
         return true;
 
+    if (m_filterRow == row)
+        return false;
+
+    if ( !m_searchIndex.isCandidate(row) )
+        return true;
+
     const QModelIndex ind = m.index(row);
-    return m_filterRow != row
-            && m_sharedData->itemFactory
+    return m_sharedData->itemFactory
             && !m_sharedData->itemFactory->matches(ind, *filter);
 }
 
@@ -340,10 +359,115 @@ QVariantMap ClipboardBrowser::itemData(const QModelIndex &index) const
 bool ClipboardBrowser::hideFiltered(int row)
 {
     const bool hide = isFiltered(row);
-    setRowHidden(row, hide);
+    hideRow(row, hide);
     return hide;
 }
 
+void ClipboardBrowser::hideRow(int row, bool hide)
+{
+    setRowHidden(row, hide);
+    d.setRowHidden(row, hide);
+}
+
+void ClipboardBrowser::startFiltering(int firstRow)
+{
+    const auto filter = d.itemFilter();
+    if ( !filter || filter->matchesAll() || filter->matchesNone()
+         || !m_itemSaver || !m_sharedData->itemFactory )
+    {
+        for (int row = firstRow; row < length(); ++row)
+            hideFiltered(row);
+        onFilteringFinished();
+        return;
+    }
+
+    // Rows which cannot match according to the index are hidden right away.
+    QVector<int> rows;
+    for (int row = firstRow; row < length(); ++row) {
+        if (row == m_filterRow)
+            hideRow(row, false);
+        else if ( !m_searchIndex.isCandidate(row) )
+            hideRow(row, true);
+        else
+            rows.append(row);
+    }
+
+    if ( rows.isEmpty() ) {
+        onFilteringFinished();
+        return;
+    }
+
+    m_filterWorker = new ItemFilterWorker(
+        m, rows, filter, m_sharedData->itemFactory->matchingLoaders(), this);
+    connect( m_filterWorker, &ItemFilterWorker::rowsFiltered,
+             this, &ClipboardBrowser::onRowsFiltered );
+    connect( m_filterWorker, &QThread::finished,
+             this, &ClipboardBrowser::onFilteringFinished );
+    m_filterWorker->start(QThread::LowPriority);
+}
+
+void ClipboardBrowser::stopFiltering()
+{
+    if (!m_filterWorker)
+        return;
+
+    ItemFilterWorker *worker = m_filterWorker;
+    m_filterWorker = nullptr;
+
+    // Avoid blocking GUI while waiting for the thread to stop.
+    worker->disconnect(this);
+    worker->requestInterruption();
+    connect( worker, &QThread::finished, worker, &QObject::deleteLater );
+    if ( worker->isFinished() )
+        worker->deleteLater();
+}
+
+void ClipboardBrowser::onRowsFiltered(const QVector<int> &visibleRows, const QVector<int> &hiddenRows)
+{
+    // Ignore results from canceled filtering.
+    if ( sender() != m_filterWorker.data() )
+        return;
+
+    // Rows inserted in the meantime are filtered in onRowsInserted().
+    for (const int snapshotRow : hiddenRows) {
+        const int row = m_filterWorker->currentRow(snapshotRow);
+        if (row != -1)
+            hideRow(row, true);
+    }
+
+    int firstVisibleRow = -1;
+    for (const int snapshotRow : visibleRows) {
+        const int row = m_filterWorker->currentRow(snapshotRow);
+        if (row == -1)
+            continue;
+        hideRow(row, false);
+        if (firstVisibleRow == -1)
+            firstVisibleRow = row;
+    }
+
+    if ( m_filterSetsCurrent && firstVisibleRow != -1 ) {
+        m_filterSetsCurrent = false;
+        setCurrent(firstVisibleRow);
+    }
+}
+
+void ClipboardBrowser::onFilteringFinished()
+{
+    if (m_filterWorker) {
+        if ( sender() != m_filterWorker.data() )
+            return;
+        m_filterWorker->deleteLater();
+        m_filterWorker = nullptr;
+    }
+
+    if (m_filterSetsCurrent) {
+        m_filterSetsCurrent = false;
+        setCurrent( length() );
+    }
+
+    d.updateAllRows();
+}
+
 bool ClipboardBrowser::startEditor(QObject *editor)
 {
     connect( editor, SIGNAL(fileModified(QByteArray,QString,QModelIndex)),
@@ -575,14 +699,12 @@ void ClipboardBrowser::focusEditedIndex()
 
 int ClipboardBrowser::findNextVisibleRow(int row)
 {
-    while ( row < length() && isRowHidden(row) ) { ++row; }
-    return row < length() ? row : -1;
+    return row < length() ? d.findVisibleRow(row, 1) : -1;
 }
 
 int ClipboardBrowser::findPreviousVisibleRow(int row)
 {
-    while ( row >= 0 && isRowHidden(row) ) { --row; }
-    return row >= 0 ? row : -1;
+    return row >= 0 ? d.findVisibleRow(qMin(row, length() - 1), -1) : -1;
 }
 
 int ClipboardBrowser::findVisibleRowFrom(int row)
@@ -617,13 +739,11 @@ void ClipboardBrowser::preload(int pixels, int direction, const QModelIndex &sta
 
     const int s = spacing();
     int y = -d.sizeHint(start).height();
-    for ( QModelIndex ind = start;
-          ind.isValid() && y < pixels;
-          ind = index(ind.row() + direction) )
+    for ( int row = d.findVisibleRow(start.row(), direction);
+          row != -1 && y < pixels;
+          row = d.findVisibleRow(row + direction, direction) )
     {
-        if ( isIndexHidden(ind) )
-            continue;
-
+        const QModelIndex ind = index(row);
         d.createItemWidget(ind);
         y += d.sizeHint(ind).height() + 2 * s;
     }
@@ -1280,7 +1400,10 @@ void ClipboardBrowser::filterItems(const ItemFilterPtr &filter)
     if (oldSearch == newSearch)
         return;
 
+    COPYQ_TRACE_DETAIL("filter", "filter items", newSearch);
+
     d.setItemFilter(filter);
+    m_searchIndex.search( filter ? filter->searchTerms() : QStringList() );
 
     // If search string is a number, highlight item in that row.
     bool filterByRowNumber = !m_sharedData->numberSearch;
@@ -1292,6 +1415,9 @@ void ClipboardBrowser::filterItems(const ItemFilterPtr &filter)
     if (!filterByRowNumber)
         m_filterRow = -1;
 
+    stopFiltering();
+    m_filterSetsCurrent = false;
+
     int row = 0;
 
     if ( !filter || filter->matchesAll() ) {
@@ -1300,15 +1426,33 @@ void ClipboardBrowser::filterItems(const ItemFilterPtr &filter)
 
         scrollTo(currentIndex(), PositionAtCenter);
     } else {
-        for ( ; row < length() && hideFiltered(row); ++row ) {}
+        // Filter first items immediately and continue in background
+        // so slow filters do not block the GUI.
+        QElapsedTimer elapsed;
+        elapsed.start();
+
+        m_filterSetsCurrent = true;
+        for ( ; row < length() && !elapsed.hasExpired(filterSynchronouslyMs); ++row ) {
+            if ( !hideFiltered(row) && m_filterSetsCurrent ) {
+                m_filterSetsCurrent = false;
+                setCurrent(row);
+            }
+        }
 
-        setCurrent(row);
+        if ( filterByRowNumber && m_filterRow >= 0 && m_filterRow < m.rowCount() ) {
+            m_filterSetsCurrent = false;
+            setCurrent(m_filterRow);
+        }
 
-        for ( ; row < length(); ++row )
-            hideFiltered(row);
+        if ( row < length() ) {
+            startFiltering(row);
+            return;
+        }
 
-        if ( filterByRowNumber && m_filterRow >= 0 && m_filterRow < m.rowCount() )
-            setCurrent(m_filterRow);
+        if (m_filterSetsCurrent) {
+            m_filterSetsCurrent = false;
+            setCurrent(row);
+        }
     }
 
     d.updateAllRows();
@@ -1655,6 +1799,32 @@ void ClipboardBrowser::addUnique(const QVariantMap &data, ClipboardMode mode)
     add(data);
 }
 
+void ClipboardBrowser::addDelayedData(quint64 itemHash, const QVariantMap &data)
+{
+    const int row = m.findItem(itemHash);
+    if (row < 0) {
+        COPYQ_LOG("New item: Skipping delayed formats, the item changed or was removed");
+        return;
+    }
+
+    const QModelIndex itemIndex = index(row);
+    if ( isInternalEditorOpen() && currentIndex() == itemIndex )
+        return;
+
+    // Keep any formats changed in the meantime.
+    const QVariantMap itemData = itemIndex.data(contentType::data).toMap();
+    QVariantMap newData = itemData;
+    for (auto it = data.constBegin(); it != data.constEnd(); ++it) {
+        if ( !newData.contains(it.key()) )
+            newData.insert(it.key(), it.value());
+    }
+
+    if ( newData.size() != itemData.size() ) {
+        COPYQ_LOG("New item: Adding delayed formats");
+        m.setData(itemIndex, newData, contentType::updateData);
+    }
+}
+
 bool ClipboardBrowser::loadItems()
 {
     if ( isLoaded() )
@@ -1669,7 +1839,15 @@ bool ClipboardBrowser::loadItems()
     if ( !isLoaded() )
         return false;
 
-    d.rowsInserted(QModelIndex(), 0, m.rowCount());
+    // Search index contains texts of items so it is stored only for tabs
+    // saved without plugins (e.g. not for encrypted tabs).
+    m_searchIndex.reset();
+    if ( hasDefaultItemSaver(m) )
+        m_searchIndex.load( itemSearchIndexFileName(m_tabName) );
+    else
+        QFile::remove( itemSearchIndexFileName(m_tabName) );
+
+    d.rowsInserted(QModelIndex(), 0, m.rowCount() - 1);
     if ( hasFocus() )
         setCurrent(0);
     onItemCountChanged();
@@ -1690,6 +1868,15 @@ bool ClipboardBrowser::saveItems()
     return ::saveItems(m_tabName, m, m_itemSaver);
 }
 
+void ClipboardBrowser::onSaveTimeout()
+{
+    // Saving would block until all items are loaded.
+    if ( isLoadingItems(m) || (m_itemSaver && m_itemSaver->isLoading()) )
+        m_timerSave.start(saveDelayMsWhileLoading);
+    else
+        saveItems();
+}
+
 void ClipboardBrowser::moveToClipboard()
 {
     moveToClipboard( selectionModel()->selectedIndexes() );
@@ -1737,6 +1924,9 @@ void ClipboardBrowser::saveUnsavedItems()
 {
     if ( m_timerSave.isActive() )
         saveItems();
+
+    if ( isLoaded() && m_storeItems && !m_tabName.isEmpty() && hasDefaultItemSaver(m) )
+        m_searchIndex.save( itemSearchIndexFileName(m_tabName) );
 }
 
 const QString ClipboardBrowser::selectedText() const
@@ -1834,6 +2024,13 @@ bool ClipboardBrowser::isLoaded() const
     return !m_sharedData->itemFactory || m_itemSaver || tabName().isEmpty();
 }
 
+void ClipboardBrowser::waitForLoaded()
+{
+    waitForItemsLoaded(m);
+    if (m_itemSaver)
+        m_itemSaver->waitForLoaded();
+}
+
 bool ClipboardBrowser::maybeCloseEditors()
 {
     if ( (isInternalEditorOpen() && m_editor->hasChanges())
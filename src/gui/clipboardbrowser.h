@@ -9,6 +9,7 @@
 #include "item/clipboardmodel.h"
 #include "item/itemdelegate.h"
 #include "item/itemfilter.h"
+#include "item/itemsearchindex.h"
 #include "item/itemwidget.h"
 
 #include <QListView>
@@ -21,6 +22,7 @@
 
 class ItemEditorWidget;
 class ItemFactory;
+class ItemFilterWorker;
 class PersistentDisplayItem;
 class QPersistentModelIndex;
 class QProgressBar;
@@ -45,7 +47,7 @@ class ClipboardBrowser final : public QListView
          *
          * @return true only if item exists
          */
-        bool moveToTop(uint itemHash);
+        bool moveToTop(quint64 itemHash);
 
         /** Sort selected items. */
         void sortItems(const QModelIndexList &indexes);
@@ -132,6 +134,13 @@ class ClipboardBrowser final : public QListView
          */
         void addUnique(const QVariantMap &data, ClipboardMode mode);
 
+        /**
+         * Add formats retrieved from clipboard after the text to the new item.
+         *
+         * Nothing is changed if there is no item with @a itemHash.
+         */
+        void addDelayedData(quint64 itemHash, const QVariantMap &data);
+
         /** Number of items in list. */
         int length() const { return m.rowCount(); }
 
@@ -193,6 +202,12 @@ class ClipboardBrowser final : public QListView
 
         bool isLoaded() const;
 
+        /** Block until items loaded in background are in the list. */
+        void waitForLoaded();
+
+        /** Return true only if items are being filtered in background. */
+        bool isFiltering() const { return !m_filterWorker.isNull(); }
+
         /**
          * Save items to configuration.
          * @see setID, loadItems
@@ -310,6 +325,8 @@ class ClipboardBrowser final : public QListView
          */
         void delayedSaveItems(int ms);
 
+        void onSaveTimeout();
+
         /**
          * Update item and editor sizes.
          */
@@ -323,6 +340,22 @@ class ClipboardBrowser final : public QListView
          */
         bool hideFiltered(int row);
 
+        /// Hide or show row in the view and in the delegate.
+        void hideRow(int row, bool hide);
+
+        /**
+         * Hide rows filtered out starting at @a firstRow in background.
+         * Visible rows are updated progressively.
+         */
+        void startFiltering(int firstRow);
+
+        /// Cancel filtering in background (rows stay as they are).
+        void stopFiltering();
+
+        void onRowsFiltered(const QVector<int> &visibleRows, const QVector<int> &hiddenRows);
+
+        void onFilteringFinished();
+
         /**
          * Connects signals and starts external editor.
          */
@@ -381,6 +414,7 @@ class ClipboardBrowser final : public QListView
         bool m_storeItems = true;
 
         ClipboardModel m;
+        ItemSearchIndex m_searchIndex;
         ItemDelegate d;
         QTimer m_timerSave;
         QTimer m_timerEmitItemCount;
@@ -402,6 +436,10 @@ class ClipboardBrowser final : public QListView
 
         int m_filterRow = -1;
 
+        QPointer<ItemFilterWorker> m_filterWorker;
+        /// True if current item should be set to the first matching item.
+        bool m_filterSetsCurrent = false;
+
         bool m_selectNewItems = false;
 };
 
@@ -29,6 +29,7 @@ struct ClipboardBrowserShared {
     int saveDelayMsOnItemMoved = 0;
     int saveDelayMsOnItemEdited = 0;
     bool rowIndexFromOne = true;
+    int itemWidgetPoolSize = 20;
     ItemFactory *itemFactory = nullptr;
     ActionHandler *actions = nullptr;
     NotificationDaemon *notifications = nullptr;
@@ -93,6 +93,7 @@ void addDocumentation(AddDocumentationCallback addDocumentation)
     addDocumentation("print", "print(value)", "Prints value to standard output.");
     addDocumentation("serverLog", "serverLog(value)", "Prints value to application log.");
     addDocumentation("logs", "logs() -> string", "Returns application logs.");
+    addDocumentation("trace", "trace(action, [fileName])", "Starts or stops recording performance trace of the server.");
     addDocumentation("abort", "abort()", "Aborts script evaluation.");
     addDocumentation("fail", "fail()", "Aborts script evaluation with nonzero exit code.");
     addDocumentation("setCurrentTab", "setCurrentTab(tabName)", "Focus tab without showing main window.");
@@ -108,6 +109,7 @@ void addDocumentation(AddDocumentationCallback addDocumentation)
     addDocumentation("unpack", "unpack(data) -> `Item`", "Returns deserialized object from serialized items.");
     addDocumentation("pack", "pack(Item) -> `ByteArray`", "Returns serialized item.");
     addDocumentation("getItem", "getItem(row) -> `Item`", "Returns an item in current tab.");
+    addDocumentation("getItems", "getItems([rows], [formats]) -> array of `Item`", "Returns items in current tab.");
     addDocumentation("setItem", "setItem(row, text|Item)", "Inserts item to current tab.");
     addDocumentation("toBase64", "toBase64(data) -> string", "Returns base64-encoded data.");
     addDocumentation("fromBase64", "fromBase64(base64String) -> `ByteArray`", "Returns base64-decoded data.");
@@ -158,6 +160,7 @@ void addDocumentation(AddDocumentationCallback addDocumentation)
     addDocumentation("onStart", "onStart()", "Called when application starts.");
     addDocumentation("onExit", "onExit()", "Called just before application exists.");
     addDocumentation("runAutomaticCommands", "runAutomaticCommands() -> bool", "Executes automatic commands on current data.");
+    addDocumentation("automaticCommandStatistics", "automaticCommandStatistics() -> object", "Returns how many clipboard changes were checked by automatic commands since the commands were last changed.");
     addDocumentation("clearClipboardData", "clearClipboardData()", "Clear clipboard visibility in GUI.");
     addDocumentation("updateTitle", "updateTitle()", "Update main window title and tool tip from current data.");
     addDocumentation("updateClipboardData", "updateClipboardData()", "Sets current clipboard data for tray menu, window title and notification.");
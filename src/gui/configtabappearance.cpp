@@ -46,6 +46,7 @@ public:
     }
 
     QString searchString() const override { return m_text; }
+    QStringList searchTerms() const override { return {}; }
     bool matchesAll() const override { return false; }
     bool matchesNone() const override { return false; }
     bool matches(const QString &) const override { return true; }
@@ -301,6 +301,8 @@ void ConfigurationManager::initOptions()
 
     bind<Config::hide_main_window_in_task_bar>();
     bind<Config::max_process_manager_rows>();
+    bind<Config::script_worker_pool_size>();
+    bind<Config::script_worker_max_events>();
     bind<Config::show_advanced_command_settings>();
     bind<Config::text_tab_width>();
 
@@ -328,11 +330,15 @@ void ConfigurationManager::initOptions()
     bind<Config::window_wait_for_modifier_released_ms>();
 
     bind<Config::change_clipboard_owner_delay_ms>();
+    bind<Config::delayed_clipboard_format_max_size>();
+    bind<Config::delayed_clipboard_format_max_ms>();
 
     bind<Config::style>();
 
     bind<Config::row_index_from_one>();
 
+    bind<Config::item_widget_pool_size>();
+
     bind<Config::tabs>();
 
     bind<Config::restore_geometry>();
@@ -94,6 +94,15 @@ public:
         return m_searchString.isEmpty();
     }
 
+    QStringList searchTerms() const override
+    {
+        // Items can match by format name (see matchesIndex()).
+        if ( m_searchString.count('/') == 1 )
+            return {};
+
+        return requiredTexts();
+    }
+
     bool matchesIndex(const QModelIndex &index) const override
     {
         // Match formats if the filter expression contains single '/'.
@@ -109,6 +118,7 @@ public:
 
 private:
     virtual QList<QTextEdit::ExtraSelection> selections(QTextDocument *doc, const QTextCharFormat &format) const = 0;
+    virtual QStringList requiredTexts() const = 0;
 
     QString m_searchString;
 };
@@ -187,6 +197,20 @@ private:
         return selections;
     }
 
+    QStringList requiredTexts() const override
+    {
+        // Only literal expressions (optionally anchored at the beginning) are supported.
+        QString pattern = searchString();
+        if ( pattern.startsWith('^') )
+            pattern.remove(0, 1);
+
+        static const QRegularExpression reSpecial(R"([\\.^$|?*+()\[\]{}])");
+        if ( !m_re.isValid() || pattern.contains(reSpecial) )
+            return {};
+
+        return {pattern};
+    }
+
     QRegularExpression m_re;
 };
 
@@ -299,6 +323,11 @@ private:
         return selections;
     }
 
+    QStringList requiredTexts() const override
+    {
+        return m_needles;
+    }
+
     QStringList m_needles;
     Qt::CaseSensitivity m_caseSensitivity;
 };
@@ -13,6 +13,7 @@
 #include "common/contenttype.h"
 #include "common/display.h"
 #include "common/globalshortcutcommands.h"
+#include "common/imagedata.h"
 #include "common/log.h"
 #include "common/mimetypes.h"
 #include "common/shortcuts.h"
@@ -38,6 +39,7 @@
 #include "gui/notification.h"
 #include "gui/notificationbutton.h"
 #include "gui/notificationdaemon.h"
+#include "gui/scriptworkerpool.h"
 #include "gui/tabdialog.h"
 #include "gui/tabicons.h"
 #include "gui/tabwidget.h"
@@ -155,7 +157,7 @@ bool canExecuteCommand(const Command &command, const QVariantMap &data, const QS
             // Disallow applying action that takes serialized item more times.
             if ( data.contains(command.output) )
                 return false;
-        } else if ( !data.contains(command.input) ) {
+        } else if ( !hasDataFormat(data, command.input) ) {
             return false;
         }
     }
@@ -572,10 +574,14 @@ MainWindow::MainWindow(const ClipboardBrowserSharedPtr &sharedData, QWidget *par
     , m_menu( new TrayMenu(this) )
     , m_menuMaxItemCount(-1)
     , m_commandDialog(nullptr)
+    , m_scriptWorkerPool(new ScriptWorkerPool(sharedData->actions, this))
     , m_clipboard(platformNativeInterface()->clipboard())
 {
     ui->setupUi(this);
 
+    connect( m_scriptWorkerPool, &ScriptWorkerPool::sendActionData,
+             this, &MainWindow::sendActionData );
+
     m_sharedData->menuItems = menuItems();
 
 #ifdef Q_OS_MAC
@@ -2316,12 +2322,17 @@ void MainWindow::updateCommands(QVector<Command> allCommands, bool forceSave)
             m_scriptCommands.append(command);
     }
 
+    m_automaticCommandMatcher.setCommands(m_automaticCommands);
+
     if (m_displayCommands != displayCommands) {
         m_displayItemList.clear();
         m_displayCommands = displayCommands;
         reloadBrowsers();
     }
 
+    // Script commands are loaded only when a worker starts.
+    m_scriptWorkerPool->recycleWorkers();
+
     updateContextMenu(contextMenuUpdateIntervalMsec);
     updateTrayMenuCommands();
     emit commandsSaved(commands);
@@ -2607,6 +2618,10 @@ void MainWindow::loadSettings(QSettings &settings, AppConfig *appConfig)
     stopMenuCommandFilters(&m_trayMenuMatchCommands);
     terminateAction(&m_displayActionId);
 
+    m_scriptWorkerPool->setPoolSize( appConfig->option<Config::script_worker_pool_size>() );
+    m_scriptWorkerPool->setMaxEventsPerWorker( appConfig->option<Config::script_worker_max_events>() );
+    m_scriptWorkerPool->recycleWorkers();
+
     theme().decorateMainWindow(this);
     ui->scrollAreaItemPreview->setObjectName("ClipboardBrowser");
     theme().decorateItemPreview(ui->scrollAreaItemPreview);
@@ -3213,6 +3228,42 @@ QVariantMap MainWindow::setDisplayData(int actionId, const QVariantMap &data)
     return m_currentDisplayItem.data();
 }
 
+void MainWindow::runScriptWorkerCallback(const QString &callback, const QVariantMap &data)
+{
+    m_scriptWorkerPool->runCallback(callback, data);
+}
+
+QVariantMap MainWindow::takeScriptWorkerEvent(int actionId)
+{
+    return m_scriptWorkerPool->takeEvent(actionId);
+}
+
+bool MainWindow::needsClipboardScript(const QVariantMap &data)
+{
+    // Automatic commands run only if there is some data.
+    const bool canMatch = hasNonEmptyData(data)
+        && m_automaticCommandMatcher.countMatches(data);
+
+    return canMatch
+        || !m_scriptCommands.isEmpty()
+        || m_scriptWorkerPool->isBusy();
+}
+
+bool MainWindow::mayNeedClipboardScript(const QVariantMap &data, const QStringList &pendingFormats)
+{
+    const bool hasData = hasNonEmptyData(data);
+    if ( hasData && m_automaticCommandMatcher.canMatch(data, pendingFormats) )
+        return true;
+
+    if ( !m_scriptCommands.isEmpty() || m_scriptWorkerPool->isBusy() )
+        return true;
+
+    if (hasData)
+        m_automaticCommandMatcher.countUnmatched();
+
+    return false;
+}
+
 void MainWindow::nextTab()
 {
     ui->tabWidget->nextTab();
@@ -3,6 +3,7 @@
 #ifndef MAINWINDOW_H
 #define MAINWINDOW_H
 
+#include "common/automaticcommandmatcher.h"
 #include "common/clipboardmode.h"
 #include "common/command.h"
 #include "gui/clipboardbrowsershared.h"
@@ -29,6 +30,7 @@ class ConfigurationManager;
 class Notification;
 class QAction;
 class QMimeData;
+class ScriptWorkerPool;
 class SystemTrayIcon;
 class Tabs;
 class Theme;
@@ -272,6 +274,35 @@ public:
 
     QVariantMap setDisplayData(int actionId, const QVariantMap &data);
 
+    /** Run script callback for clipboard change in a script worker. */
+    void runScriptWorkerCallback(const QString &callback, const QVariantMap &data);
+
+    /** Return next event for script worker (see ScriptWorkerPool::takeEvent()). */
+    QVariantMap takeScriptWorkerEvent(int actionId);
+
+    /**
+     * Return true if clipboard change needs to be handled by a script.
+     *
+     * Default handling is enough if no automatic command can match the data,
+     * there are no script commands which could override the callbacks and
+     * no earlier callback is still running.
+     *
+     * The change is counted in automatic command statistics.
+     */
+    bool needsClipboardScript(const QVariantMap &data);
+
+    /**
+     * Same as needsClipboardScript() for data without @a pendingFormats
+     * which are retrieved later.
+     *
+     * The change is counted only if the script is not needed, otherwise it
+     * is counted later by needsClipboardScript() with all formats.
+     */
+    bool mayNeedClipboardScript(const QVariantMap &data, const QStringList &pendingFormats);
+
+    /** Return match statistics for automatic commands (see AutomaticCommandMatcher). */
+    QVariantMap automaticCommandStatistics() const { return m_automaticCommandMatcher.statistics(); }
+
     QVector<Command> automaticCommands() const { return m_automaticCommands; }
     QVector<Command> displayCommands() const { return m_displayCommands; }
     QVector<Command> scriptCommands() const { return m_scriptCommands; }
@@ -652,6 +683,7 @@ private:
     ClipboardBrowserSharedPtr m_sharedData;
 
     QVector<Command> m_automaticCommands;
+    AutomaticCommandMatcher m_automaticCommandMatcher;
     QVector<Command> m_displayCommands;
     QVector<Command> m_menuCommands;
     QVector<Command> m_trayMenuCommands;
@@ -689,6 +721,8 @@ private:
     PersistentDisplayItem m_currentDisplayItem;
     int m_displayActionId = -1;
 
+    ScriptWorkerPool *m_scriptWorkerPool;
+
     MenuMatchCommands m_trayMenuMatchCommands;
     MenuMatchCommands m_itemMenuMatchCommands;
 
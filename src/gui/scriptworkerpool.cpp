@@ -0,0 +1,218 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "scriptworkerpool.h"
+
+#include "common/action.h"
+#include "common/log.h"
+#include "gui/actionhandler.h"
+
+namespace {
+
+/// Fall back to one-shot processes if workers repeatedly fail to start.
+const int maxFailedStarts = 3;
+
+/// Number of times an event is passed to a new worker if the previous one died.
+const int maxEventAttempts = 2;
+
+} // namespace
+
+ScriptWorkerPool::ScriptWorkerPool(ActionHandler *actions, QObject *parent)
+    : QObject(parent)
+    , m_actions(actions)
+{
+}
+
+void ScriptWorkerPool::setPoolSize(int poolSize)
+{
+    m_poolSize = poolSize;
+    m_failedStarts = 0;
+}
+
+void ScriptWorkerPool::runCallback(const QString &callback, const QVariantMap &data)
+{
+    Event event;
+    event.callback = callback;
+    event.data = data;
+    m_events.append(event);
+    dispatch();
+}
+
+QVariantMap ScriptWorkerPool::takeEvent(int actionId)
+{
+    Worker *worker = findWorker(actionId);
+    if (worker == nullptr)
+        return QVariantMap();
+
+    worker->started = true;
+    worker->hasEvent = false;
+    m_failedStarts = 0;
+
+    if ( worker->retired || worker->eventCount >= m_maxEventsPerWorker ) {
+        COPYQ_LOG( QStringLiteral("Restarting script worker %1 after %2 events")
+                   .arg(actionId).arg(worker->eventCount) );
+        stopWorker(worker);
+        dispatch();
+        return QVariantMap();
+    }
+
+    if ( m_events.isEmpty() ) {
+        worker->idle = true;
+        return QVariantMap();
+    }
+
+    Event event = m_events.takeFirst();
+    ++event.attempts;
+    worker->event = event;
+    worker->hasEvent = true;
+    worker->idle = false;
+    ++worker->eventCount;
+    m_actions->setActionData(actionId, event.data);
+
+    // Keys are read in Scriptable::runScriptWorker().
+    return QVariantMap{
+        {QStringLiteral("callback"), event.callback},
+        {QStringLiteral("data"), event.data},
+    };
+}
+
+void ScriptWorkerPool::recycleWorkers()
+{
+    for (auto &worker : m_workers) {
+        if (worker.retired)
+            continue;
+
+        // Busy workers exit after finishing current event.
+        if (worker.idle)
+            stopWorker(&worker);
+        else
+            worker.retired = true;
+    }
+}
+
+bool ScriptWorkerPool::isBusy() const
+{
+    if ( !m_events.isEmpty() )
+        return true;
+
+    for (const auto &worker : m_workers) {
+        if (worker.started && !worker.idle)
+            return true;
+    }
+
+    return false;
+}
+
+void ScriptWorkerPool::dispatch()
+{
+    if ( m_events.isEmpty() )
+        return;
+
+    if ( !isEnabled() ) {
+        for (const auto &event : m_events)
+            runOneShot(event);
+        m_events.clear();
+        return;
+    }
+
+    for (auto &worker : m_workers) {
+        if (worker.idle && !worker.retired) {
+            worker.idle = false;
+            emit sendActionData(worker.actionId, QByteArray());
+            return;
+        }
+    }
+
+    if ( activeWorkerCount() < m_poolSize )
+        startWorker();
+}
+
+void ScriptWorkerPool::startWorker()
+{
+    auto action = new Action();
+    action->setCommand(QStringList() << "copyq" << "eval" << "--" << "runScriptWorker()");
+    connect( action, &Action::actionFinished,
+             this, &ScriptWorkerPool::onWorkerFinished );
+    m_actions->internalAction(action);
+
+    const int actionId = action->id();
+    if ( !m_actions->isInternalActionId(actionId) ) {
+        ++m_failedStarts;
+        dispatch();
+        return;
+    }
+
+    COPYQ_LOG( QStringLiteral("Started script worker %1").arg(actionId) );
+    Worker worker;
+    worker.actionId = actionId;
+    m_workers.append(worker);
+}
+
+void ScriptWorkerPool::stopWorker(Worker *worker)
+{
+    worker->retired = true;
+    worker->idle = false;
+    emit sendActionData(worker->actionId, "ABORT");
+}
+
+void ScriptWorkerPool::runOneShot(const Event &event)
+{
+    auto action = new Action();
+    action->setCommand(QStringList() << "copyq" << event.callback);
+    action->setData(event.data);
+    m_actions->internalAction(action);
+}
+
+void ScriptWorkerPool::onWorkerFinished(Action *action)
+{
+    for (int i = 0; i < m_workers.size(); ++i) {
+        if (m_workers[i].actionId != action->id())
+            continue;
+
+        const Worker worker = m_workers.takeAt(i);
+        if (!worker.started) {
+            ++m_failedStarts;
+            log( QStringLiteral("Script worker failed to start: %1")
+                 .arg(action->errorString()), LogWarning );
+        } else {
+            COPYQ_LOG( QStringLiteral("Script worker %1 finished").arg(worker.actionId) );
+        }
+
+        if (worker.hasEvent) {
+            if (worker.event.attempts < maxEventAttempts) {
+                log( QStringLiteral("Script worker %1 exited while handling \"%2\", retrying")
+                     .arg(worker.actionId).arg(worker.event.callback), LogWarning );
+                m_events.prepend(worker.event);
+            } else {
+                log( QStringLiteral("Script worker %1 exited while handling \"%2\", dropping event")
+                     .arg(worker.actionId).arg(worker.event.callback), LogError );
+            }
+        }
+
+        dispatch();
+        return;
+    }
+}
+
+int ScriptWorkerPool::activeWorkerCount() const
+{
+    int count = 0;
+    for (const auto &worker : m_workers) {
+        if (!worker.retired)
+            ++count;
+    }
+    return count;
+}
+
+ScriptWorkerPool::Worker *ScriptWorkerPool::findWorker(int actionId)
+{
+    for (auto &worker : m_workers) {
+        if (worker.actionId == actionId)
+            return &worker;
+    }
+    return nullptr;
+}
+
+bool ScriptWorkerPool::isEnabled() const
+{
+    return m_poolSize > 0 && m_failedStarts < maxFailedStarts;
+}
@@ -0,0 +1,93 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef SCRIPTWORKERPOOL_H
+#define SCRIPTWORKERPOOL_H
+
+#include <QList>
+#include <QObject>
+#include <QVariantMap>
+
+class Action;
+class ActionHandler;
+
+/**
+ * Pool of long-running script processes handling clipboard callbacks.
+ *
+ * Instead of starting new "copyq onClipboardChanged" process for each
+ * clipboard change, events are queued and taken by idle workers
+ * (each running "runScriptWorker()") which keep the script engine warm.
+ *
+ * Global script state is restored after each event. An event is queued
+ * again once if its worker exits before finishing it.
+ *
+ * Workers are restarted after handling given number of events and if the
+ * pool is disabled or the workers fail to start, the callbacks fall back to
+ * running in new processes.
+ */
+class ScriptWorkerPool final : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ScriptWorkerPool(ActionHandler *actions, QObject *parent = nullptr);
+
+    /// Set maximum number of workers (zero disables the pool).
+    void setPoolSize(int poolSize);
+
+    /// Set number of events after which a worker is restarted.
+    void setMaxEventsPerWorker(int maxEvents) { m_maxEventsPerWorker = maxEvents; }
+
+    /// Call a script function (e.g. "onClipboardChanged") with given data.
+    void runCallback(const QString &callback, const QVariantMap &data);
+
+    /**
+     * Return next event for a worker.
+     *
+     * Returns empty map if there is no event or the worker should exit.
+     */
+    QVariantMap takeEvent(int actionId);
+
+    /// Restart workers once they finish current event (e.g. after commands change).
+    void recycleWorkers();
+
+    /// Return true if there are queued events or a worker is handling one.
+    bool isBusy() const;
+
+signals:
+    void sendActionData(int actionId, const QByteArray &bytes);
+
+private:
+    struct Event {
+        QString callback;
+        QVariantMap data;
+        int attempts = 0;
+    };
+
+    struct Worker {
+        int actionId = -1;
+        int eventCount = 0;
+        /// Event being handled, re-queued if the worker dies.
+        Event event;
+        bool hasEvent = false;
+        bool idle = false;
+        bool started = false;
+        bool retired = false;
+    };
+
+    void dispatch();
+    void startWorker();
+    void stopWorker(Worker *worker);
+    void runOneShot(const Event &event);
+    void onWorkerFinished(Action *action);
+    int activeWorkerCount() const;
+    Worker *findWorker(int actionId);
+    bool isEnabled() const;
+
+    ActionHandler *m_actions;
+    QList<Worker> m_workers;
+    QList<Event> m_events;
+    int m_poolSize = 1;
+    int m_maxEventsPerWorker = 100;
+    int m_failedStarts = 0;
+};
+
+#endif // SCRIPTWORKERPOOL_H
@@ -15,16 +15,33 @@
 
 namespace {
 
-void clearDataExceptInternal(QVariantMap *data)
+template <typename Map>
+void clearDataExceptInternal(Map *data)
 {
-    QMutableMapIterator<QString, QVariant> it(*data);
-    while (it.hasNext()) {
-        const auto item = it.next();
-        if ( !item.key().startsWith(COPYQ_MIME_PREFIX) )
-            it.remove();
+    for (auto it = data->begin(); it != data->end(); ) {
+        if ( it.key().startsWith(COPYQ_MIME_PREFIX) )
+            ++it;
+        else
+            it = data->erase(it);
     }
 }
 
+template <typename Map>
+void clearTextData(Map *data)
+{
+    for (auto it = data->begin(); it != data->end(); ) {
+        if ( it.key().startsWith("text/") )
+            it = data->erase(it);
+        else
+            ++it;
+    }
+}
+
+bool isPayload(const QVariant &value)
+{
+    return value.userType() == qMetaTypeId<ItemPayload>();
+}
+
 } // namespace
 
 ClipboardItem::ClipboardItem()
@@ -34,9 +51,10 @@ ClipboardItem::ClipboardItem()
 }
 
 ClipboardItem::ClipboardItem(const QVariantMap &data)
-    : m_data(data)
+    : m_data()
     , m_hash(0)
 {
+    assignData(data);
 }
 
 bool ClipboardItem::operator ==(const ClipboardItem &item) const
@@ -46,12 +64,8 @@ bool ClipboardItem::operator ==(const ClipboardItem &item) const
 
 void ClipboardItem::setText(const QString &text)
 {
-    QMutableMapIterator<QString, QVariant> it(m_data);
-    while (it.hasNext()) {
-        const auto item = it.next();
-        if ( item.key().startsWith("text/") )
-            it.remove();
-    }
+    clearTextData(&m_data);
+    clearTextData(&m_payloads);
 
     setTextData(&m_data, text);
 
@@ -60,33 +74,42 @@ void ClipboardItem::setText(const QString &text)
 
 bool ClipboardItem::setData(const QVariantMap &data)
 {
-    if (m_data == data)
+    // Compare without copying large data from file.
+    if ( m_payloads.isEmpty() ? m_data == data : dataMap(true) == data )
         return false;
 
-    m_data = data;
+    assignData(data);
     invalidateDataHash();
     return true;
 }
 
 bool ClipboardItem::updateData(const QVariantMap &data)
 {
-    const int oldSize = m_data.size();
+    const int oldSize = m_data.size() + m_payloads.size();
     for (auto it = data.constBegin(); it != data.constEnd(); ++it) {
         const auto &format = it.key();
         if ( !format.startsWith(COPYQ_MIME_PREFIX) ) {
             clearDataExceptInternal(&m_data);
+            clearDataExceptInternal(&m_payloads);
             break;
         }
     }
 
-    bool changed = (oldSize != m_data.size());
+    bool changed = (oldSize != m_data.size() + m_payloads.size());
 
     for (auto it = data.constBegin(); it != data.constEnd(); ++it) {
         const auto &format = it.key();
         const auto &value = it.value();
         if ( !value.isValid() ) {
             m_data.remove(format);
+            m_payloads.remove(format);
             changed = true;
+        } else if ( m_payloads.contains(format) ) {
+            if ( m_payloads[format].rawBytes() != value.toByteArray() ) {
+                m_payloads.remove(format);
+                m_data.insert(format, value);
+                changed = true;
+            }
         } else if ( m_data.value(format) != value ) {
             m_data.insert(format, value);
             changed = true;
@@ -101,6 +124,7 @@ bool ClipboardItem::updateData(const QVariantMap &data)
 void ClipboardItem::removeData(const QString &mimeType)
 {
     m_data.remove(mimeType);
+    m_payloads.remove(mimeType);
     invalidateDataHash();
 }
 
@@ -109,10 +133,8 @@ bool ClipboardItem::removeData(const QStringList &mimeTypeList)
     bool removed = false;
 
     for (const auto &mimeType : mimeTypeList) {
-        if ( m_data.contains(mimeType) ) {
-            m_data.remove(mimeType);
+        if ( m_data.remove(mimeType) + m_payloads.remove(mimeType) > 0 )
             removed = true;
-        }
     }
 
     if (removed)
@@ -123,6 +145,7 @@ bool ClipboardItem::removeData(const QStringList &mimeTypeList)
 
 void ClipboardItem::setData(const QString &mimeType, const QByteArray &data)
 {
+    m_payloads.remove(mimeType);
     m_data.insert(mimeType, data);
     invalidateDataHash();
 }
@@ -132,39 +155,52 @@ QVariant ClipboardItem::data(int role) const
     switch(role) {
     case Qt::DisplayRole:
     case Qt::EditRole:
-        if ( m_data.contains(mimeText) )
-            return getTextData(m_data);
-        if ( m_data.contains(mimeUriList) )
-            return getTextData(m_data, mimeUriList);
+        if ( hasFormat(mimeText) )
+            return textData();
+        if ( hasFormat(mimeUriList) )
+            return textData(mimeUriList);
         break;
 
     case contentType::data:
-        return m_data; // copy-on-write, so this should be fast
+        return dataMap(false);
+    case contentType::inlineData:
+        return m_data;
+    case contentType::storedData:
+        return storedDataMap();
     case contentType::hash:
         return dataHash();
     case contentType::hasText:
-        return m_data.contains(mimeText) || m_data.contains(mimeUriList);
+        return hasFormat(mimeText) || hasFormat(mimeUriList);
     case contentType::hasHtml:
-        return m_data.contains(mimeHtml);
+        return hasFormat(mimeHtml);
     case contentType::text:
-        return getTextData(m_data);
+        return textData();
     case contentType::html:
-        return getTextData(m_data, mimeHtml);
+        return textData(mimeHtml);
     case contentType::notes:
-        return getTextData(m_data, mimeItemNotes);
+        return textData(mimeItemNotes);
     case contentType::color:
-        return getTextData(m_data, mimeColor);
+        return textData(mimeColor);
     case contentType::isHidden:
-        return m_data.contains(mimeHidden);
+        return hasFormat(mimeHidden);
     }
 
     return QVariant();
 }
 
-unsigned int ClipboardItem::dataHash() const
+QByteArray ClipboardItem::data(const QString &format) const
+{
+    const auto it = m_payloads.constFind(format);
+    if ( it != m_payloads.constEnd() )
+        return it->bytes();
+
+    return m_data.value(format).toByteArray();
+}
+
+quint64 ClipboardItem::dataHash() const
 {
     if (m_hash == 0)
-        m_hash = hash(m_data);
+        m_hash = hash( m_payloads.isEmpty() ? m_data : dataMap(true) );
 
     return m_hash;
 }
@@ -173,3 +209,54 @@ void ClipboardItem::invalidateDataHash()
 {
     m_hash = 0;
 }
+
+void ClipboardItem::assignData(const QVariantMap &data)
+{
+    m_data = data;
+    m_payloads.clear();
+
+    for (auto it = m_data.begin(); it != m_data.end(); ) {
+        if ( isPayload(it.value()) ) {
+            m_payloads.insert( it.key(), it.value().value<ItemPayload>() );
+            it = m_data.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+bool ClipboardItem::hasFormat(const QString &format) const
+{
+    return m_data.contains(format) || m_payloads.contains(format);
+}
+
+QString ClipboardItem::textData(const QString &format) const
+{
+    return getTextData( data(format) );
+}
+
+QString ClipboardItem::textData() const
+{
+    for (const auto &format : {mimeTextUtf8, mimeText, mimeUriList}) {
+        if ( hasFormat(format) )
+            return textData(format);
+    }
+
+    return QString();
+}
+
+QVariantMap ClipboardItem::storedDataMap() const
+{
+    QVariantMap data = m_data;
+    for (auto it = m_payloads.constBegin(); it != m_payloads.constEnd(); ++it)
+        data.insert( it.key(), QVariant::fromValue(it.value()) );
+    return data;
+}
+
+QVariantMap ClipboardItem::dataMap(bool raw) const
+{
+    QVariantMap data = m_data; // copy-on-write, so this should be fast
+    for (auto it = m_payloads.constBegin(); it != m_payloads.constEnd(); ++it)
+        data.insert( it.key(), raw ? it->rawBytes() : it->bytes() );
+    return data;
+}
@@ -3,6 +3,9 @@
 #ifndef CLIPBOARDITEM_H
 #define CLIPBOARDITEM_H
 
+#include "item/itempayload.h"
+
+#include <QMap>
 #include <QVariant>
 
 class QByteArray;
@@ -13,6 +16,9 @@ class QString;
  *
  * Clipboard item stores data of different MIME types and has single default
  * MIME type for displaying the contents.
+ *
+ * Large data loaded from tab file can be kept in the file (see ItemPayload)
+ * until requested.
  */
 class ClipboardItem final
 {
@@ -55,16 +61,29 @@ public:
     QVariant data(int role) const;
 
     /** Return data for format. */
-    QByteArray data(const QString &format) const { return m_data.value(format).toByteArray(); }
+    QByteArray data(const QString &format) const;
 
     /** Return hash for item's data. */
-    unsigned int dataHash() const;
+    quint64 dataHash() const;
 
 private:
     void invalidateDataHash();
 
+    void assignData(const QVariantMap &data);
+
+    bool hasFormat(const QString &format) const;
+
+    QString textData(const QString &format) const;
+
+    QString textData() const;
+
+    /// Returns all data, large data are copied from file only if @a raw is false.
+    QVariantMap dataMap(bool raw) const;
+    QVariantMap storedDataMap() const;
+
     QVariantMap m_data;
-    mutable unsigned int m_hash;
+    QMap<QString, ItemPayload> m_payloads;
+    mutable quint64 m_hash;
 };
 
 #endif // CLIPBOARDITEM_H
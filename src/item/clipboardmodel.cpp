@@ -84,6 +84,8 @@ bool ClipboardModel::setData(const QModelIndex &index, const QVariant &value, in
 
     int row = index.row();
 
+    const quint64 oldHash = m_hashIndexValid ? m_clipboardList[row].dataHash() : 0;
+
     if (role == Qt::EditRole) {
         m_clipboardList[row].setText(value.toString());
     } else if (role == contentType::notes) {
@@ -108,6 +110,11 @@ bool ClipboardModel::setData(const QModelIndex &index, const QVariant &value, in
         return false;
     }
 
+    if (m_hashIndexValid) {
+        removeFromHashIndex(oldHash);
+        addToHashIndex(row, row);
+    }
+
     emit dataChanged(index, index);
 
     return true;
@@ -121,6 +128,10 @@ void ClipboardModel::insertItem(const QVariantMap &data, int row)
     beginInsertRows(QModelIndex(), row, row);
 
     m_clipboardList.insert(row, item);
+    if (m_hashIndexValid) {
+        shiftHashIndexRows(row + 1, 1);
+        addToHashIndex(row, row);
+    }
 
     endInsertRows();
 }
@@ -140,6 +151,11 @@ void ClipboardModel::insertItems(const QList<QVariantMap> &dataList, int row)
         ++targetRow;
     }
 
+    if (m_hashIndexValid) {
+        shiftHashIndexRows(targetRow, dataList.size());
+        addToHashIndex(row, targetRow - 1);
+    }
+
     endInsertRows();
 }
 
@@ -153,6 +169,11 @@ bool ClipboardModel::insertRows(int position, int rows, const QModelIndex&)
     for (int row = 0; row < rows; ++row)
         m_clipboardList.insert(position, ClipboardItem());
 
+    if (m_hashIndexValid) {
+        shiftHashIndexRows(position + rows, rows);
+        addToHashIndex(position, position + rows - 1);
+    }
+
     endInsertRows();
 
     return true;
@@ -167,7 +188,11 @@ bool ClipboardModel::removeRows(int position, int rows, const QModelIndex&)
 
     beginRemoveRows(QModelIndex(), position, last);
 
+    if (m_hashIndexValid)
+        removeFromHashIndex(position, last);
     m_clipboardList.remove(position, last - position + 1);
+    if (m_hashIndexValid)
+        shiftHashIndexRows(position, position - last - 1);
 
     endRemoveRows();
 
@@ -193,6 +218,11 @@ bool ClipboardModel::moveRows(
 
     beginMoveRows(sourceParent, sourceRow, last, destinationParent, destinationRow);
     m_clipboardList.move(sourceRow, rows, destinationRow);
+    if (m_hashIndexValid) {
+        // Only rows between the source and the target moved.
+        const int targetRow = destinationRow > sourceRow ? destinationRow - rows : destinationRow;
+        updateHashIndexRows( qMin(sourceRow, targetRow), qMax(sourceRow, targetRow) + rows - 1 );
+    }
     endMoveRows();
 
     return true;
@@ -215,6 +245,8 @@ void ClipboardModel::sortItems(const QList<QPersistentModelIndex> &sorted)
             if (targetRow != sourceRow) {
                 beginMoveRows(QModelIndex(), sourceRow, sourceRow, QModelIndex(), targetRow);
                 m_clipboardList.move(sourceRow, targetRow);
+                if (m_hashIndexValid)
+                    updateHashIndexRows( qMin(sourceRow, targetRow), qMax(sourceRow, targetRow) );
                 endMoveRows();
 
                 // If the moved item was removed or moved further (as reaction on moving the item),
@@ -228,12 +260,76 @@ void ClipboardModel::sortItems(const QList<QPersistentModelIndex> &sorted)
     }
 }
 
-int ClipboardModel::findItem(uint itemHash) const
+int ClipboardModel::findItem(quint64 itemHash) const
 {
+    if (!m_hashIndexValid) {
+        m_hashIndex.clear();
+        m_hashIndex.reserve( m_clipboardList.size() );
+        m_hashIndexRowOffset = 0;
+        addToHashIndex(0, m_clipboardList.size() - 1);
+        m_hashIndexValid = true;
+    }
+
+    const auto it = m_hashIndex.find(itemHash);
+    if ( it == m_hashIndex.end() )
+        return -1;
+
+    const int row = it->position + m_hashIndexRowOffset;
+    if ( row >= 0 && row < m_clipboardList.size() && m_clipboardList[row].dataHash() == itemHash )
+        return row;
+
+    // Stored row is outdated only if an item with the same hash was removed
+    // or changed.
     for (int i = 0; i < m_clipboardList.size(); ++i) {
-        if ( m_clipboardList[i].dataHash() == itemHash )
+        if ( m_clipboardList[i].dataHash() == itemHash ) {
+            it->position = i - m_hashIndexRowOffset;
             return i;
+        }
     }
 
     return -1;
 }
+
+void ClipboardModel::addToHashIndex(int first, int last) const
+{
+    for (int row = first; row <= last; ++row) {
+        auto &entry = m_hashIndex[ m_clipboardList[row].dataHash() ];
+        ++entry.count;
+        entry.position = row - m_hashIndexRowOffset;
+    }
+}
+
+void ClipboardModel::removeFromHashIndex(int first, int last)
+{
+    for (int row = first; row <= last; ++row)
+        removeFromHashIndex( m_clipboardList[row].dataHash() );
+}
+
+void ClipboardModel::updateHashIndexRows(int first, int last)
+{
+    for (int row = first; row <= last; ++row) {
+        const auto it = m_hashIndex.find( m_clipboardList[row].dataHash() );
+        if ( it != m_hashIndex.end() )
+            it->position = row - m_hashIndexRowOffset;
+    }
+}
+
+void ClipboardModel::shiftHashIndexRows(int first, int count)
+{
+    // Shift all rows by changing the offset and fix the rows before
+    // if there are fewer of these.
+    const int size = m_clipboardList.size();
+    if (first <= size - first) {
+        m_hashIndexRowOffset += count;
+        updateHashIndexRows(0, first - 1);
+    } else {
+        updateHashIndexRows(first, size - 1);
+    }
+}
+
+void ClipboardModel::removeFromHashIndex(quint64 itemHash)
+{
+    const auto it = m_hashIndex.find(itemHash);
+    if ( it != m_hashIndex.end() && --it->count <= 0 )
+        m_hashIndex.erase(it);
+}
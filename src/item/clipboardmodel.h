@@ -6,6 +6,7 @@
 #include "item/clipboarditem.h"
 
 #include <QAbstractListModel>
+#include <QHash>
 #include <QList>
 
 /**
@@ -118,10 +119,37 @@ public:
      * Find item with given @a hash.
      * @return Row number with found item or -1 if no item was found.
      */
-    int findItem(uint itemHash) const;
+    int findItem(quint64 itemHash) const;
+
+    /** Return copy of items (items are implicitly shared so this is fast). */
+    ClipboardItemList items() const { return m_clipboardList; }
 
 private:
+    /**
+     * Number of items with a hash and row of one of them.
+     *
+     * The row is stored relative to m_hashIndexRowOffset so shifting all
+     * rows (e.g. inserting at top) does not need to update each entry.
+     */
+    struct HashIndexEntry {
+        int count = 0;
+        int position = -1;
+    };
+
+    void addToHashIndex(int first, int last) const;
+    void removeFromHashIndex(int first, int last);
+    void removeFromHashIndex(quint64 itemHash);
+    void updateHashIndexRows(int first, int last);
+
+    /// Updates index after rows starting at @a first moved by @a count.
+    void shiftHashIndexRows(int first, int count);
+
     ClipboardItemList m_clipboardList;
+
+    /// Built on first search and then updated with each change.
+    mutable QHash<quint64, HashIndexEntry> m_hashIndex;
+    mutable bool m_hashIndexValid = false;
+    mutable int m_hashIndexRowOffset = 0;
 };
 
 #endif // CLIPBOARDMODEL_H
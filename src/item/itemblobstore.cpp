@@ -0,0 +1,408 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "itemblobstore.h"
+
+#include "common/config.h"
+#include "common/log.h"
+#include "item/itempayload.h"
+#include "item/serialize.h"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QSaveFile>
+#include <QThreadPool>
+#include <QVariant>
+
+#include <atomic>
+#include <memory>
+
+namespace {
+
+const int minBlobSize = 64 * 1024;
+
+/// Blob file starts with a byte which is 1 if the rest is compressed.
+const char blobRaw = 0;
+const char blobCompressed = 1;
+
+const int digestSize = 32;
+
+struct BlobStore {
+    QMutex mutex;
+    bool referencesLoaded = false;
+    /// Blobs referenced by each tab file.
+    QHash<QString, QSet<QByteArray>> references;
+    /// Number of tab files referencing each blob.
+    QHash<QByteArray, int> referenceCounts;
+    /// Blobs stored but not yet referenced from a saved tab file.
+    QSet<QByteArray> pending;
+    /// Mapped blob files shared by items.
+    QHash<QByteArray, std::weak_ptr<ItemPayloadFile>> mappedFiles;
+    std::atomic_bool collecting{false};
+    std::atomic_bool collectAgain{false};
+};
+
+BlobStore &blobStore()
+{
+    static BlobStore store;
+    return store;
+}
+
+QString blobDirectoryPath()
+{
+    return getConfigurationFilePath("_blobs");
+}
+
+QString referencesDirectoryPath()
+{
+    return blobDirectoryPath() + QLatin1String("/refs");
+}
+
+QString blobFileName(const QByteArray &digest)
+{
+    return blobDirectoryPath() + QLatin1Char('/') + QString::fromLatin1( digest.toHex() );
+}
+
+QString referencesFileName(const QString &tabFileName)
+{
+    return referencesDirectoryPath() + QLatin1Char('/') + QFileInfo(tabFileName).fileName();
+}
+
+/// Returns digest for blob file name or empty digest for other files.
+QByteArray digestFromFileName(const QString &fileName)
+{
+    if ( fileName.size() != 2 * digestSize )
+        return QByteArray();
+
+    const QByteArray digest = QByteArray::fromHex( fileName.toLatin1() );
+    return QString::fromLatin1( digest.toHex() ) == fileName ? digest : QByteArray();
+}
+
+bool readReferences(const QString &fileName, QString *tabFileName, QSet<QByteArray> *digests)
+{
+    QFile file(fileName);
+    if ( !file.open(QIODevice::ReadOnly) )
+        return false;
+
+    *tabFileName = QString::fromUtf8( file.readLine() ).trimmed();
+    while ( !file.atEnd() ) {
+        const QByteArray digest = QByteArray::fromHex( file.readLine().trimmed() );
+        if ( digest.size() == digestSize )
+            digests->insert(digest);
+    }
+
+    return !tabFileName->isEmpty();
+}
+
+bool writeReferences(const QString &tabFileName, const QSet<QByteArray> &digests)
+{
+    const QString fileName = referencesFileName(tabFileName);
+    if ( digests.isEmpty() )
+        return !QFile::exists(fileName) || QFile::remove(fileName);
+
+    if ( !QDir().mkpath(referencesDirectoryPath()) )
+        return false;
+
+    QByteArray bytes = tabFileName.toUtf8() + '\n';
+    for (const auto &digest : digests)
+        bytes.append( digest.toHex() + '\n' );
+
+    QSaveFile file(fileName);
+    return file.open(QIODevice::WriteOnly)
+        && file.write(bytes) == bytes.size()
+        && file.commit();
+}
+
+/// Loads references of all tab files on first use, expects locked mutex.
+void ensureReferencesLoaded(BlobStore *store)
+{
+    if (store->referencesLoaded)
+        return;
+
+    store->referencesLoaded = true;
+
+    QDir dir( referencesDirectoryPath() );
+    for ( const auto &fileName : dir.entryList(QDir::Files) ) {
+        const QString path = dir.absoluteFilePath(fileName);
+        QString tabFileName;
+        QSet<QByteArray> digests;
+        if ( !readReferences(path, &tabFileName, &digests) ) {
+            log( QStringLiteral("Blob store: Failed to read references from %1").arg(path), LogWarning );
+            continue;
+        }
+
+        // Tab was removed while the references could not be updated.
+        if ( !QFile::exists(tabFileName) ) {
+            COPYQ_LOG( QStringLiteral("Blob store: Dropping references of missing %1").arg(tabFileName) );
+            QFile::remove(path);
+            ItemBlobStore::collectGarbage();
+            continue;
+        }
+
+        for (const auto &digest : digests)
+            ++store->referenceCounts[digest];
+        store->references.insert(tabFileName, digests);
+    }
+}
+
+/// Updates references, expects locked mutex. Returns true if a blob is no longer referenced.
+bool updateReferences(BlobStore *store, const QString &tabFileName, const QSet<QByteArray> &digests)
+{
+    ensureReferencesLoaded(store);
+
+    const QSet<QByteArray> oldDigests = store->references.value(tabFileName);
+    if (oldDigests == digests)
+        return false;
+
+    bool unreferenced = false;
+    for (const auto &digest : oldDigests) {
+        if ( digests.contains(digest) )
+            continue;
+
+        auto it = store->referenceCounts.find(digest);
+        if ( it != store->referenceCounts.end() && --it.value() <= 0 ) {
+            store->referenceCounts.erase(it);
+            unreferenced = true;
+        }
+    }
+
+    for (const auto &digest : digests) {
+        if ( !oldDigests.contains(digest) )
+            ++store->referenceCounts[digest];
+        store->pending.remove(digest);
+    }
+
+    if ( digests.isEmpty() )
+        store->references.remove(tabFileName);
+    else
+        store->references.insert(tabFileName, digests);
+
+    if ( !writeReferences(tabFileName, digests) ) {
+        log( QStringLiteral("Blob store: Failed to save references for %1").arg(tabFileName),
+             LogError );
+    }
+
+    return unreferenced;
+}
+
+class BlobGarbageCollector final : public QRunnable
+{
+public:
+    void run() override
+    {
+        BlobStore &store = blobStore();
+        do {
+            store.collectAgain = false;
+            collect(&store);
+        } while (store.collectAgain);
+        store.collecting = false;
+    }
+
+private:
+    static void collect(BlobStore *store)
+    {
+        QDir dir( blobDirectoryPath() );
+        int removed = 0;
+        for ( const auto &fileName : dir.entryList(QDir::Files) ) {
+            const QByteArray digest = digestFromFileName(fileName);
+            if ( digest.isEmpty() )
+                continue;
+
+            // Check and remove with lock held so the blob cannot be stored
+            // and referenced again in the meantime.
+            QMutexLocker lock(&store->mutex);
+            ensureReferencesLoaded(store);
+            if ( store->referenceCounts.contains(digest) || store->pending.contains(digest) )
+                continue;
+
+            if ( QFile::remove(dir.absoluteFilePath(fileName)) )
+                ++removed;
+        }
+
+        COPYQ_LOG( QStringLiteral("Blob store: Removed %1 unreferenced blobs").arg(removed) );
+    }
+};
+
+class BlobStorage final : public ItemBlobStorage
+{
+public:
+    int minSize() const override { return ItemBlobStore::minSize(); }
+
+    QByteArray store(const QByteArray &bytes, bool compress) const override
+    {
+        return ItemBlobStore::store(bytes, compress);
+    }
+
+    bool load(const QByteArray &digest, QVariant *value) const override
+    {
+        return ItemBlobStore::load(digest, value);
+    }
+};
+
+} // namespace
+
+int ItemBlobStore::minSize()
+{
+    return minBlobSize;
+}
+
+const ItemBlobStorage *ItemBlobStore::storage()
+{
+    static const BlobStorage storage;
+    return &storage;
+}
+
+QByteArray ItemBlobStore::store(const QByteArray &bytes, bool compress)
+{
+    const QByteArray digest = QCryptographicHash::hash(bytes, QCryptographicHash::Sha256);
+
+    // Keep the blob until it is referenced.
+    {
+        BlobStore &store = blobStore();
+        QMutexLocker lock(&store.mutex);
+        store.pending.insert(digest);
+    }
+
+    const QString fileName = blobFileName(digest);
+    if ( QFile::exists(fileName) )
+        return digest;
+
+    QByteArray data;
+    if (compress) {
+        data = qCompress(bytes);
+        if ( data.size() < bytes.size() )
+            data.prepend(blobCompressed);
+        else
+            data.clear();
+    }
+
+    if ( data.isEmpty() ) {
+        data.reserve(bytes.size() + 1);
+        data.append(blobRaw);
+        data.append(bytes);
+    }
+
+    if ( !QDir().mkpath(blobDirectoryPath()) ) {
+        log( QStringLiteral("Blob store: Failed to create %1").arg(blobDirectoryPath()), LogError );
+        return QByteArray();
+    }
+
+    QSaveFile file(fileName);
+    if ( !file.open(QIODevice::WriteOnly)
+         || file.write(data) != data.size()
+         || !file.commit() )
+    {
+        log( QStringLiteral("Blob store: Failed to save %1: %2")
+             .arg(fileName, file.errorString()), LogError );
+        return QByteArray();
+    }
+
+    return digest;
+}
+
+bool ItemBlobStore::load(const QByteArray &digest, QVariant *value)
+{
+    const QString fileName = blobFileName(digest);
+    const qint64 size = QFileInfo(fileName).size();
+    if (size < 1) {
+        log( QStringLiteral("Blob store: Missing blob %1").arg(fileName), LogError );
+        return false;
+    }
+
+    ItemPayloadFilePtr mappedFile;
+    {
+        BlobStore &store = blobStore();
+        QMutexLocker lock(&store.mutex);
+        auto &weakFile = store.mappedFiles[digest];
+        mappedFile = weakFile.lock();
+        if (!mappedFile) {
+            mappedFile = ItemPayload::mapFile(fileName, size);
+            weakFile = mappedFile;
+        }
+    }
+
+    if (mappedFile) {
+        const bool compressed = ItemPayload(mappedFile, 0, 1).rawBytes().at(0) == blobCompressed;
+        *value = QVariant::fromValue( ItemPayload(mappedFile, 1, static_cast<int>(size - 1), compressed) );
+        return true;
+    }
+
+    QFile file(fileName);
+    if ( !file.open(QIODevice::ReadOnly) ) {
+        log( QStringLiteral("Blob store: Failed to open %1: %2")
+             .arg(fileName, file.errorString()), LogError );
+        return false;
+    }
+
+    char header = blobRaw;
+    QByteArray bytes;
+    if ( file.getChar(&header) )
+        bytes = file.readAll();
+    if (header == blobCompressed)
+        bytes = qUncompress(bytes);
+
+    if ( bytes.isEmpty() ) {
+        log( QStringLiteral("Blob store: Failed to read %1").arg(fileName), LogError );
+        return false;
+    }
+
+    *value = bytes;
+    return true;
+}
+
+void ItemBlobStore::setReferences(const QString &tabFileName, const QSet<QByteArray> &digests)
+{
+    bool unreferenced;
+    {
+        BlobStore &store = blobStore();
+        QMutexLocker lock(&store.mutex);
+        unreferenced = updateReferences(&store, tabFileName, digests);
+    }
+
+    if (unreferenced)
+        collectGarbage();
+}
+
+void ItemBlobStore::addReferences(const QString &tabFileName, const QSet<QByteArray> &digests)
+{
+    if ( digests.isEmpty() )
+        return;
+
+    BlobStore &store = blobStore();
+    QMutexLocker lock(&store.mutex);
+    ensureReferencesLoaded(&store);
+    updateReferences( &store, tabFileName, store.references.value(tabFileName) + digests );
+}
+
+void ItemBlobStore::moveReferences(const QString &oldTabFileName, const QString &newTabFileName)
+{
+    BlobStore &store = blobStore();
+    QMutexLocker lock(&store.mutex);
+    ensureReferencesLoaded(&store);
+    const QSet<QByteArray> digests = store.references.value(oldTabFileName);
+    if ( digests.isEmpty() )
+        return;
+
+    updateReferences( &store, newTabFileName, store.references.value(newTabFileName) + digests );
+    updateReferences( &store, oldTabFileName, QSet<QByteArray>() );
+}
+
+void ItemBlobStore::removeReferences(const QString &tabFileName)
+{
+    setReferences( tabFileName, QSet<QByteArray>() );
+}
+
+void ItemBlobStore::collectGarbage()
+{
+    BlobStore &store = blobStore();
+    store.collectAgain = true;
+    if ( store.collecting.exchange(true) )
+        return;
+
+    QThreadPool::globalInstance()->start( new BlobGarbageCollector() );
+}
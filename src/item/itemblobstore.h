@@ -0,0 +1,68 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef ITEMBLOBSTORE_H
+#define ITEMBLOBSTORE_H
+
+#include <QByteArray>
+#include <QSet>
+
+class ItemBlobStorage;
+class QString;
+class QVariant;
+
+/**
+ * Content-addressed store for large item data shared by all tabs.
+ *
+ * Each blob is stored once in a file named by SHA-256 digest of the data.
+ * Tab files contain only the digests (see serializeDataCompressed() with
+ * storage()). Only the item log uses the store, other users of the serializer
+ * do not depend on it.
+ *
+ * Blobs referenced by each tab file are recorded so blobs can be counted and
+ * removed in background once no tab references them.
+ *
+ * All functions are thread-safe.
+ */
+class ItemBlobStore final
+{
+public:
+    /// Smaller data are stored directly in tab files.
+    static int minSize();
+
+    /// Storage for serializer, see serializeDataCompressed() and deserializeData().
+    static const ItemBlobStorage *storage();
+
+    /**
+     * Stores data (if not stored already) and returns its digest.
+     *
+     * Data are compressed if @a compress is true and it helps.
+     *
+     * Returns empty digest on failure.
+     */
+    static QByteArray store(const QByteArray &bytes, bool compress);
+
+    /**
+     * Returns data for given digest.
+     *
+     * Data are left in the memory-mapped blob file if possible (see ItemPayload)
+     * so items with the same data share memory.
+     */
+    static bool load(const QByteArray &digest, QVariant *value);
+
+    /// Replaces blobs referenced by given tab file.
+    static void setReferences(const QString &tabFileName, const QSet<QByteArray> &digests);
+
+    /// Adds blobs referenced by given tab file.
+    static void addReferences(const QString &tabFileName, const QSet<QByteArray> &digests);
+
+    /// Moves references after tab file is renamed.
+    static void moveReferences(const QString &oldTabFileName, const QString &newTabFileName);
+
+    /// Drops references after tab file is removed.
+    static void removeReferences(const QString &tabFileName);
+
+    /// Starts removing unreferenced blobs in background.
+    static void collectGarbage();
+};
+
+#endif // ITEMBLOBSTORE_H
@@ -8,6 +8,7 @@
 #include "common/sanitize_text_document.h"
 #include "common/textdata.h"
 #include "common/timer.h"
+#include "common/trace.h"
 #include "gui/clipboardbrowser.h"
 #include "gui/iconfactory.h"
 #include "item/itemfactory.h"
@@ -36,6 +37,7 @@ ItemDelegate::ItemDelegate(ClipboardBrowser *view, const ClipboardBrowserSharedP
     , m_sharedData(sharedData)
     , m_maxWidth(2048)
     , m_idealWidth(m_view->viewport()->contentsRect().width())
+    , m_widgetPool(sharedData->itemWidgetPoolSize)
 {
     initSingleShotTimer(
         &m_timerInvalidateHidden, 0, this, &ItemDelegate::invalidateAllHiddenNow );
@@ -72,7 +74,7 @@ bool ItemDelegate::eventFilter(QObject *obj, QEvent *event)
 void ItemDelegate::dataChanged(const QModelIndex &a, const QModelIndex &b)
 {
     for ( int row = a.row(); row <= b.row(); ++row )
-        m_items[row].item.reset();
+        releaseItemWidget(&m_items[row]);
 
     updateLater();
 }
@@ -80,7 +82,7 @@ void ItemDelegate::dataChanged(const QModelIndex &a, const QModelIndex &b)
 void ItemDelegate::rowsRemoved(const QModelIndex &, int start, int end)
 {
     for (int row = start; row <= end; ++row) {
-        if ( m_view->isRowHidden(row) )
+        if (m_items[row].hidden)
             continue;
 
         if (m_items[row]) {
@@ -90,7 +92,18 @@ void ItemDelegate::rowsRemoved(const QModelIndex &, int start, int end)
         }
     }
 
+    const int count = end - start + 1;
     m_items.erase(std::begin(m_items) + start, std::begin(m_items) + end + 1);
+    m_rowHeights.remove(start, count);
+
+    const auto removed = [start, end](int row) { return start <= row && row <= end; };
+    m_widgetRows.erase(
+        std::remove_if(std::begin(m_widgetRows), std::end(m_widgetRows), removed),
+        std::end(m_widgetRows) );
+    for (int &row : m_widgetRows) {
+        if (row > end)
+            row -= count;
+    }
 
     updateLater();
 }
@@ -102,6 +115,20 @@ void ItemDelegate::rowsMoved(const QModelIndex &, int sourceStart, int sourceEnd
     auto from = sourceStart;
     auto to = destinationRow;
 
+    m_rowHeights.move(sourceStart, count, destinationRow);
+
+    for (int &row : m_widgetRows) {
+        if (sourceStart <= row && row <= sourceEnd) {
+            row += destinationRow > sourceEnd
+                ? destinationRow - sourceEnd - 1
+                : destinationRow - sourceStart;
+        } else if (sourceEnd < row && row < destinationRow) {
+            row -= count;
+        } else if (destinationRow <= row && row < sourceStart) {
+            row += count;
+        }
+    }
+
     if (to < from) {
         std::swap(from, to);
         to += count;
@@ -138,6 +165,9 @@ QWidget *ItemDelegate::createPreview(const QVariantMap &data, QWidget *parent)
 
 void ItemDelegate::rowsInserted(const QModelIndex &, int start, int end)
 {
+    if (end < start)
+        return;
+
     const auto count = static_cast<size_t>(end - start + 1);
     const auto oldSize = m_items.size();
     m_items.resize(oldSize + count);
@@ -145,6 +175,13 @@ void ItemDelegate::rowsInserted(const QModelIndex &, int start, int end)
                  std::begin(m_items) + oldSize,
                  std::end(m_items) );
 
+    m_rowHeights.insert( start, static_cast<int>(count), rowHeight(start) );
+
+    for (int &row : m_widgetRows) {
+        if (row >= start)
+            row += static_cast<int>(count);
+    }
+
     updateLater();
 }
 
@@ -153,6 +190,7 @@ void ItemDelegate::createItemWidget(const QModelIndex &index)
     const int row = index.row();
     ItemWidget *w = m_items[row].get();
     if (w == nullptr) {
+        COPYQ_TRACE("widget", "create item widget");
         auto data = m_view->itemData(index);
         data.insert(mimeCurrentTab, m_view->tabName());
         w = updateWidget(index, data);
@@ -194,7 +232,7 @@ void ItemDelegate::setItemSizes(int maxWidth, int idealWidth)
     m_maxWidth = maxWidth - margin;
     m_idealWidth = idealWidth - margin;
 
-    for (int row = 0; static_cast<size_t>(row) < m_items.size(); ++row) {
+    for (int row : m_widgetRows) {
         if (m_items[row])
             updateItemWidgetSize(row);
     }
@@ -226,6 +264,7 @@ void ItemDelegate::updateItemSize(const QModelIndex &index, QSize itemWidgetSize
         return;
 
     m_items[row].size = newSize;
+    m_rowHeights.setHeight( row, rowHeight(row) );
     emit sizeHintChanged(index);
 }
 
@@ -317,36 +356,37 @@ void ItemDelegate::highlightMatches(ItemWidget *itemWidget) const
 
 void ItemDelegate::updateAllRows()
 {
-    const int s = m_view->spacing();
-    const int space = 2 * s;
-    int y = -m_view->verticalOffset() + s;
+    updateRowHeights();
+    pruneWidgetRows();
 
-    for (int row = 0; static_cast<size_t>(row) < m_items.size(); ++row) {
-        const bool hide = m_view->isRowHidden(row);
+    const int y = -m_view->verticalOffset() + m_view->spacing();
+
+    // Only widgets near the visible area are positioned, others are hidden
+    // until scrolled to (and removed later in invalidateAllHiddenNow()).
+    for (int row : m_widgetRows) {
         auto &item = m_items[row];
-        if (item) {
-            QWidget *ww = item->widget();
-            if (hide) {
+
+        QWidget *ww = item->widget();
+        if ( item.hidden || !isRowAlmostVisible(row) ) {
+            if ( !ww->isHidden() ) {
                 ww->removeEventFilter(this);
                 ww->hide();
-            } else {
-                if (item.appliedFilterId != m_filterId) {
-                    highlightMatches(item.get());
-                    item.appliedFilterId = m_filterId;
-                }
-                ww->move( QPoint(ww->x(), y) );
-                if ( ww->isHidden() ) {
-                    ww->show();
-                    updateItemWidgetSize(row);
-                    ww->installEventFilter(this);
-                    const auto index = m_view->index(row);
-                    updateItemSize(index, ww->size());
-                }
             }
+            continue;
         }
 
-        if (!hide)
-            y += m_items[row].size.height() + space;
+        if (item.appliedFilterId != m_filterId) {
+            highlightMatches(item.get());
+            item.appliedFilterId = m_filterId;
+        }
+        ww->move( QPoint(ww->x(), y + m_rowHeights.offset(row)) );
+        if ( ww->isHidden() ) {
+            ww->show();
+            updateItemWidgetSize(row);
+            ww->installEventFilter(this);
+            const auto index = m_view->index(row);
+            updateItemSize(index, ww->size());
+        }
     }
 }
 
@@ -402,12 +442,16 @@ void ItemDelegate::setIndexWidget(const QModelIndex &index, ItemWidget *w)
 {
     const int row = index.row();
     const QPoint pos = w ? findPositionForWidget(index) : QPoint();
-    const bool show = w && !m_view->isIndexHidden(index);
+    const bool show = w && !m_items[row].hidden;
 
     auto &item = m_items[row];
+    releaseItemWidget(&item);
     item.item.reset(w);
     item.appliedFilterId = 0;
     if (w) {
+        if ( std::find(std::begin(m_widgetRows), std::end(m_widgetRows), row) == std::end(m_widgetRows) )
+            m_widgetRows.push_back(row);
+
         QWidget *ww = w->widget();
 
         // Make background transparent.
@@ -432,34 +476,83 @@ void ItemDelegate::setIndexWidget(const QModelIndex &index, ItemWidget *w)
     }
 }
 
+void ItemDelegate::releaseItemWidget(Item *item)
+{
+    if (!item->item)
+        return;
+
+    item->item->widget()->removeEventFilter(this);
+    m_widgetPool.release( std::move(item->item) );
+}
+
 QPoint ItemDelegate::findPositionForWidget(const QModelIndex &index) const
 {
     const QSize margins = m_sharedData->theme.margins();
     const QSize rowNumberSize = m_sharedData->theme.rowNumberSize(index.row());
     const int s = m_view->spacing();
 
-    int y = 0;
-    int skipped = 0;
-    for (int row = index.row() - 1; row >= 0; --row) {
-        if (!m_items[row]) {
-            if ( !m_view->isRowHidden(row) )
-                ++skipped;
-            continue;
-        }
+    return QPoint(
+        s + margins.width() + rowNumberSize.width(),
+        s - m_view->verticalOffset() + m_rowHeights.offset(index.row())
+    );
+}
 
-        QWidget *ww = m_items[row]->widget();
-        if ( ww->isHidden() )
-            continue;
+int ItemDelegate::rowHeight(int row) const
+{
+    const auto &item = m_items[row];
+    return item.hidden ? 0 : item.size.height() + 2 * m_rowHeightsSpacing;
+}
+
+void ItemDelegate::updateRowHeights()
+{
+    const int spacing = m_view->spacing();
+    if ( spacing == m_rowHeightsSpacing && static_cast<size_t>(m_rowHeights.size()) == m_items.size() )
+        return;
+
+    m_rowHeightsSpacing = spacing;
+    m_rowHeights.clear();
+    m_rowHeights.insert( 0, static_cast<int>(m_items.size()), 0 );
+    for (int row = 0; row < m_rowHeights.size(); ++row)
+        m_rowHeights.setHeight( row, rowHeight(row) );
+}
+
+bool ItemDelegate::isRowAlmostVisible(int row) const
+{
+    if ( row < 0 || static_cast<size_t>(row) >= m_items.size() || m_items[row].hidden )
+        return false;
+
+    const int viewHeight = m_view->viewport()->contentsRect().height();
+    const int minY = m_view->verticalOffset() - viewHeight - defaultItemHeight;
+    const int maxY = m_view->verticalOffset() + 2 * viewHeight + defaultItemHeight;
+    const int top = m_rowHeights.offset(row);
+    return minY < top + m_rowHeights.height(row) && top < maxY;
+}
+
+void ItemDelegate::setRowHidden(int row, bool hidden)
+{
+    auto &item = m_items[row];
+    if (item.hidden == hidden)
+        return;
+
+    item.hidden = hidden;
+    m_rowHeights.setHeight( row, rowHeight(row) );
+    updateLater();
+}
 
-        y = ww->geometry().top() - margins.height() + m_items[row].size.height()
-            + skipped * (defaultItemHeight + 2 * s);
-        break;
+int ItemDelegate::findVisibleRow(int row, int direction) const
+{
+    const int count = m_rowHeights.size();
+    if (direction > 0) {
+        if (row >= count)
+            return -1;
+        const int visibleRow = m_rowHeights.rowAt( m_rowHeights.offset(qMax(0, row)) );
+        return visibleRow < count ? visibleRow : -1;
     }
 
-    return QPoint(
-        s + margins.width() + rowNumberSize.width(),
-        s + margins.height() + y
-    );
+    if (row < 0)
+        return -1;
+    const int y = m_rowHeights.offset( qMin(row, count - 1) + 1 );
+    return y > 0 ? m_rowHeights.rowAt(y - 1) : -1;
 }
 
 void ItemDelegate::setCurrentRow(int row, bool current)
@@ -488,7 +581,7 @@ void ItemDelegate::setWidgetSelected(QWidget *ww, bool selected)
 
 int ItemDelegate::findWidgetRow(const QObject *obj) const
 {
-    for (int row = 0; static_cast<size_t>(row) < m_items.size(); ++row) {
+    for (int row : m_widgetRows) {
         auto w = m_items[row].get();
         if (w && w->widget() == obj)
             return row;
@@ -504,7 +597,8 @@ ItemWidget *ItemDelegate::updateWidget(const QModelIndex &index, const QVariantM
 
     auto w = m_sharedData->showSimpleItems
             ? m_sharedData->itemFactory->createSimpleItem(data, parent, antialiasing)
-            : m_sharedData->itemFactory->createItem(data, parent, antialiasing);
+            : m_sharedData->itemFactory->createItem(
+                  data, parent, antialiasing, true, false, &m_widgetPool);
 
     setIndexWidget(index, w);
 
@@ -535,23 +629,9 @@ void ItemDelegate::invalidateAllHiddenNow()
     // Make sure item widgets have up-to-date positions for invalidation.
     updateAllRows();
 
-    const QRect viewRect = m_view->viewport()->contentsRect();
-    const int maxY = viewRect.bottom() + viewRect.height() + defaultItemHeight;
-    const int minY = viewRect.top() - viewRect.height() - defaultItemHeight;
     const int currentRow = m_view->currentIndex().row();
-    const auto isRowAlmostVisible = [&](int row){
-        if (row < 0 || static_cast<size_t>(row) >= m_items.size() || !m_items[row])
-            return false;
-
-        QWidget *ww = m_items[row]->widget();
-        if ( ww->isHidden() )
-            return false;
-
-        const QRect g = ww->geometry();
-        return minY < g.bottom() && g.top() < maxY;
-    };
-
-    for (int row = 0; static_cast<size_t>(row) < m_items.size(); ++row) {
+    const auto widgetRows = m_widgetRows;
+    for (int row : widgetRows) {
         if (!m_items[row] || row == currentRow)
             continue;
 
@@ -565,6 +645,16 @@ void ItemDelegate::invalidateAllHiddenNow()
         m_items[row]->widget()->removeEventFilter(this);
         setIndexWidget(index, nullptr);
     }
+
+    pruneWidgetRows();
+}
+
+void ItemDelegate::pruneWidgetRows()
+{
+    const auto noWidget = [this](int row) { return !m_items[row]; };
+    m_widgetRows.erase(
+        std::remove_if(std::begin(m_widgetRows), std::end(m_widgetRows), noWidget),
+        std::end(m_widgetRows) );
 }
 
 void ItemDelegate::setItemFilter(const ItemFilterPtr &filter)
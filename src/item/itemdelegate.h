@@ -4,6 +4,8 @@
 #define ITEMDELEGATE_H
 
 #include "item/itemfilter.h"
+#include "item/itemheightindex.h"
+#include "item/itemwidgetpool.h"
 #include "gui/clipboardbrowsershared.h"
 
 #include <QItemDelegate>
@@ -77,7 +79,7 @@ class ItemDelegate final : public QItemDelegate
          */
         void highlightMatches(ItemWidget *itemWidget) const;
 
-        /// Update positions of all widgets
+        /// Update positions of widgets near visible area
         /// (after filtering out items or invalidating).
         void updateAllRows();
         void updateLater();
@@ -107,6 +109,17 @@ class ItemDelegate final : public QItemDelegate
 
         QWidget *createPreview(const QVariantMap &data, QWidget *parent);
 
+        /// Must be called whenever a row is hidden or shown in the view.
+        void setRowHidden(int row, bool hidden);
+
+        bool isRowHidden(int row) const { return m_items[row].hidden; }
+
+        /**
+         * Returns the first row from @a row which is not hidden in given
+         * @a direction (1 or -1) or -1 if there is no such row.
+         */
+        int findVisibleRow(int row, int direction) const;
+
         void setCurrentRow(int row, bool current);
 
     signals:
@@ -122,13 +135,17 @@ class ItemDelegate final : public QItemDelegate
             ItemWidget *get() const noexcept { return item.get(); }
             operator bool() const noexcept { return static_cast<bool>(item); }
 
-            std::shared_ptr<ItemWidget> item;
+            std::unique_ptr<ItemWidget> item;
             int appliedFilterId = 0;
             QSize size = QSize(0, defaultItemHeight);
+            bool hidden = false;
         };
 
         void setIndexWidget(const QModelIndex &index, ItemWidget *w);
 
+        /// Moves item widget to the pool for reuse.
+        void releaseItemWidget(Item *item);
+
         /// Updates style for selected/unselected widgets.
         void setWidgetSelected(QWidget *ww, bool selected);
 
@@ -141,8 +158,20 @@ class ItemDelegate final : public QItemDelegate
 
         QPoint findPositionForWidget(const QModelIndex &index) const;
 
+        /// Height of row including spacing in the view (zero if hidden).
+        int rowHeight(int row) const;
+
+        /// Rebuilds row heights if spacing changed.
+        void updateRowHeights();
+
+        /// Returns true if the row is on the current page or near it.
+        bool isRowAlmostVisible(int row) const;
+
         void invalidateAllHiddenNow();
 
+        /// Removes rows without item widget from m_widgetRows.
+        void pruneWidgetRows();
+
         ClipboardBrowser *m_view;
         ClipboardBrowserSharedPtr m_sharedData;
         ItemFilterPtr m_filter;
@@ -152,7 +181,12 @@ class ItemDelegate final : public QItemDelegate
 
         QTimer m_timerInvalidateHidden;
 
+        ItemWidgetPool m_widgetPool;
         std::vector<Item> m_items;
+        /// Rows which may have an item widget (unordered, only few rows).
+        std::vector<int> m_widgetRows;
+        ItemHeightIndex m_rowHeights;
+        int m_rowHeightsSpacing = 0;
 };
 
 #endif // ITEMDELEGATE_H
@@ -10,8 +10,10 @@
 #include "common/mimetypes.h"
 #include "common/textdata.h"
 #include "item/itemfilter.h"
+#include "item/itemlog.h"
 #include "item/itemstore.h"
 #include "item/itemwidget.h"
+#include "item/itemwidgetpool.h"
 #include "item/serialize.h"
 #include "platform/platformnativeinterface.h"
 
@@ -22,6 +24,7 @@
 #include <QMessageBox>
 #include <QMetaObject>
 #include <QModelIndex>
+#include <QPointer>
 #include <QSettings>
 #include <QPluginLoader>
 
@@ -189,10 +192,28 @@ private:
 class DummySaver final : public ItemSaverInterface
 {
 public:
+    explicit DummySaver(QAbstractItemModel *model)
+        : m_itemLog(ItemLog::attach(model))
+    {
+    }
+
+    ~DummySaver()
+    {
+        delete m_itemLog;
+    }
+
     bool saveItems(const QString & /* tabName */, const QAbstractItemModel &model, QIODevice *file) override
     {
+        if ( m_itemLog && m_itemLog->model() == &model )
+            return m_itemLog->write(file);
+
         return serializeData(model, file);
     }
+
+    ItemLog *itemLog() const { return m_itemLog; }
+
+private:
+    QPointer<ItemLog> m_itemLog;
 };
 
 class DummyLoader final : public ItemLoaderInterface
@@ -214,6 +235,19 @@ public:
 
     ItemSaverPtr loadItems(const QString &tabName, QAbstractItemModel *model, QIODevice *file, int maxItems) override
     {
+        auto saver = std::make_shared<DummySaver>(model);
+
+        if ( ItemLog::canLoad(file) ) {
+            file->seek(0);
+            if ( !saver->itemLog()->load(file, maxItems) ) {
+                model->removeRows(0, model->rowCount());
+                return nullptr;
+            }
+            return saver;
+        }
+
+        // Tab in older format is converted on next save.
+        file->seek(0);
         if ( file->size() > 0 ) {
             if ( !deserializeData(model, file, maxItems) ) {
                 const int itemsLoadedCount = model->rowCount();
@@ -221,7 +255,6 @@ public:
                     log(QStringLiteral("Keeping corrupted tab on user request"));
                     file->close();
                     file->open(QIODevice::WriteOnly);
-                    auto saver = std::make_shared<DummySaver>();
                     saver->saveItems(tabName, *model, file);
                     return saver;
                 }
@@ -231,12 +264,12 @@ public:
             }
         }
 
-        return std::make_shared<DummySaver>();
+        return saver;
     }
 
-    ItemSaverPtr initializeTab(const QString &, QAbstractItemModel *, int) override
+    ItemSaverPtr initializeTab(const QString &, QAbstractItemModel *model, int) override
     {
-        return std::make_shared<DummySaver>();
+        return std::make_shared<DummySaver>(model);
     }
 
     bool matches(const QModelIndex &index, const ItemFilter &filter) const override
@@ -283,6 +316,10 @@ ItemSaverPtr saveWithOther(
     COPYQ_LOG( QString("Tab \"%1\": Saving items using other plugin")
                .arg(tabName) );
 
+    // Whole tab file must be rewritten by the new saver.
+    if ( ItemLog *itemLog = ItemLog::find(*model) )
+        itemLog->invalidate();
+
     auto newSaver = newLoader->initializeTab(tabName, model, maxItems);
     if ( !newSaver || !saveItems(tabName, *model, newSaver) ) {
         COPYQ_LOG( QString("Tab \"%1\": Failed to re-save items")
@@ -313,13 +350,22 @@ ItemFactory::~ItemFactory()
 
 ItemWidget *ItemFactory::createItem(
         const ItemLoaderPtr &loader, const QVariantMap &data,
-        QWidget *parent, bool antialiasing, bool transform, bool preview)
+        QWidget *parent, bool antialiasing, bool transform, bool preview,
+        ItemWidgetPool *pool)
 {
-    ItemWidget *item = loader->create(data, parent, preview);
+    ItemWidget *item = pool ? pool->acquire(loader->id(), data) : nullptr;
+    if (item != nullptr)
+        item->widget()->setToolTip(QString());
+    else
+        item = loader->create(data, parent, preview);
 
     if (item != nullptr) {
+        ItemWidget *baseItem = item;
         if (transform)
             item = transformItem(item, data);
+        if ( pool && item == baseItem && loader->canRebindItems() )
+            ItemWidgetPool::setReusable(item, loader->id());
+
         QWidget *w = item->widget();
         const auto notes = getTextData(data, mimeItemNotes);
         if (!notes.isEmpty())
@@ -333,8 +379,10 @@ ItemWidget *ItemFactory::createItem(
                 child->setFont(f);
         }
 
-        m_loaderChildren[w] = loader;
-        connect(w, &QObject::destroyed, this, &ItemFactory::loaderChildDestroyed);
+        if ( !m_loaderChildren.contains(w) ) {
+            m_loaderChildren[w] = loader;
+            connect(w, &QObject::destroyed, this, &ItemFactory::loaderChildDestroyed);
+        }
         return item;
     }
 
@@ -342,10 +390,11 @@ ItemWidget *ItemFactory::createItem(
 }
 
 ItemWidget *ItemFactory::createItem(
-        const QVariantMap &data, QWidget *parent, bool antialiasing, bool transform, bool preview)
+        const QVariantMap &data, QWidget *parent, bool antialiasing, bool transform, bool preview,
+        ItemWidgetPool *pool)
 {
     for ( auto &loader : enabledLoaders() ) {
-        ItemWidget *item = createItem(loader, data, parent, antialiasing, transform, preview);
+        ItemWidget *item = createItem(loader, data, parent, antialiasing, transform, preview, pool);
         if (item != nullptr)
             return item;
     }
@@ -443,12 +492,18 @@ ItemSaverPtr ItemFactory::initializeTab(const QString &tabName, QAbstractItemMod
 }
 
 bool ItemFactory::matches(const QModelIndex &index, const ItemFilter &filter) const
+{
+    return matches(enabledLoaders(), index, filter);
+}
+
+bool ItemFactory::matches(
+        const ItemLoaderList &loaders, const QModelIndex &index, const ItemFilter &filter)
 {
     if ( filter.matchesIndex(index) )
         return true;
 
-    for ( const auto &loader : enabledLoaders() ) {
-        if ( isLoaderEnabled(loader) && loader->matches(index, filter) )
+    for ( const auto &loader : loaders ) {
+        if ( loader->matches(index, filter) )
             return true;
     }
 
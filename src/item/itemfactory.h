@@ -14,6 +14,7 @@
 
 class ItemLoaderInterface;
 class ItemWidget;
+class ItemWidgetPool;
 class ScriptableProxy;
 class QAbstractItemModel;
 class QIODevice;
@@ -43,16 +44,20 @@ public:
 
     /**
      * Instantiate ItemWidget using given @a loader if possible.
+     *
+     * If @a pool is set, a released widget from the pool is reused if possible
+     * and the new widget is marked as reusable.
      */
     ItemWidget *createItem(
             const ItemLoaderPtr &loader, const QVariantMap &data, QWidget *parent,
-            bool antialiasing, bool transform = true, bool preview = false);
+            bool antialiasing, bool transform = true, bool preview = false,
+            ItemWidgetPool *pool = nullptr);
 
     /**
      * Instantiate ItemWidget using appropriate loader or creates simple ItemWidget (DummyItem).
      */
     ItemWidget *createItem(const QVariantMap &data, QWidget *parent, bool antialiasing,
-            bool transform = true, bool preview = false);
+            bool transform = true, bool preview = false, ItemWidgetPool *pool = nullptr);
 
     ItemWidget *createSimpleItem(const QVariantMap &data, QWidget *parent, bool antialiasing);
 
@@ -108,6 +113,17 @@ public:
      */
     bool matches(const QModelIndex &index, const ItemFilter &filter) const;
 
+    /**
+     * Return copy of enabled loaders for matching items in other threads.
+     *
+     * The list is not affected by later changes in enabled plugins.
+     */
+    ItemLoaderList matchingLoaders() const { return enabledLoaders(); }
+
+    /// Same as matches() but uses loaders from matchingLoaders().
+    static bool matches(
+            const ItemLoaderList &loaders, const QModelIndex &index, const ItemFilter &filter);
+
     ItemScriptable* scriptableObject(const QString &name) const;
 
     /**
@@ -4,6 +4,7 @@
 
 class QModelIndex;
 class QString;
+class QStringList;
 class QTextCharFormat;
 class QTextEdit;
 
@@ -18,6 +19,13 @@ public:
     virtual void highlight(QTextEdit *edit, const QTextCharFormat &format) const = 0;
     virtual void search(QTextEdit *edit, bool backwards) const = 0;
     virtual QString searchString() const = 0;
+
+    /**
+     * Texts which must be contained in matching items (ignoring case and accents).
+     *
+     * Empty if any item can match (used to skip items with ItemSearchIndex).
+     */
+    virtual QStringList searchTerms() const = 0;
 };
 
 using ItemFilterPtr = std::shared_ptr<ItemFilter>;
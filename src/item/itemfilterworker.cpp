@@ -0,0 +1,152 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "itemfilterworker.h"
+
+#include "common/trace.h"
+
+#include <QAbstractListModel>
+#include <QElapsedTimer>
+
+namespace {
+
+const int minChunkSize = 32;
+const int maxChunkSize = 1024;
+
+/// Report matched rows at least this often even if the chunk is not full.
+const int maxChunkIntervalMs = 100;
+
+const int rowsInserted = -1;
+const int rowsRemoved = -2;
+
+/// Read-only model for item loaders to match items in the worker thread.
+class ItemSnapshotModel final : public QAbstractListModel
+{
+public:
+    explicit ItemSnapshotModel(const ClipboardItemList &items)
+        : m_items(items)
+    {
+    }
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override
+    {
+        return parent.isValid() ? 0 : m_items.size();
+    }
+
+    QVariant data(const QModelIndex &index, int role) const override
+    {
+        if ( !index.isValid() || index.row() >= m_items.size() )
+            return QVariant();
+
+        return m_items[index.row()].data(role);
+    }
+
+private:
+    const ClipboardItemList &m_items;
+};
+
+} // namespace
+
+ItemFilterWorker::ItemFilterWorker(
+        const ClipboardModel &model,
+        const QVector<int> &rows,
+        const ItemFilterPtr &filter,
+        const ItemLoaderList &loaders,
+        QObject *parent)
+    : QThread(parent)
+    , m_items(model.items())
+    , m_rows(rows)
+    , m_filter(filter)
+    , m_loaders(loaders)
+{
+    // The worker object lives in the GUI thread so row changes are recorded
+    // there and only read from currentRow() called in the same thread.
+    connect( &model, &QAbstractItemModel::rowsInserted, this,
+             [this](const QModelIndex &, int first, int last) {
+                 addRowChange(first, last, rowsInserted);
+             } );
+    connect( &model, &QAbstractItemModel::rowsRemoved, this,
+             [this](const QModelIndex &, int first, int last) {
+                 addRowChange(first, last, rowsRemoved);
+             } );
+    connect( &model, &QAbstractItemModel::rowsMoved, this,
+             [this](const QModelIndex &, int first, int last, const QModelIndex &, int destination) {
+                 addRowChange(first, last, destination);
+             } );
+}
+
+ItemFilterWorker::~ItemFilterWorker()
+{
+    requestInterruption();
+    wait();
+}
+
+int ItemFilterWorker::currentRow(int snapshotRow) const
+{
+    int row = snapshotRow;
+    for (const auto &change : m_rowChanges) {
+        const int count = change.last - change.first + 1;
+        if (change.destination == rowsInserted) {
+            if (row >= change.first)
+                row += count;
+        } else if (change.destination == rowsRemoved) {
+            if (row > change.last)
+                row -= count;
+            else if (row >= change.first)
+                return -1;
+        } else if (row >= change.first && row <= change.last) {
+            row += (change.destination > change.last)
+                ? change.destination - count - change.first
+                : change.destination - change.first;
+        } else if (change.destination > change.last) {
+            if (row > change.last && row < change.destination)
+                row -= count;
+        } else if (row >= change.destination && row < change.first) {
+            row += count;
+        }
+    }
+    return row;
+}
+
+void ItemFilterWorker::addRowChange(int first, int last, int destination)
+{
+    m_rowChanges.append(RowChange{first, last, destination});
+}
+
+void ItemFilterWorker::run()
+{
+    COPYQ_TRACE_DETAIL("filter", "filter items in background", m_filter->searchString());
+    traceCounter("filter", "rows to filter", m_rows.size());
+
+    const ItemSnapshotModel model(m_items);
+
+    QVector<int> visibleRows;
+    QVector<int> hiddenRows;
+    int chunkSize = minChunkSize;
+
+    QElapsedTimer elapsed;
+    elapsed.start();
+
+    for (int i = 0; i < m_rows.size(); ++i) {
+        if ( isInterruptionRequested() )
+            return;
+
+        const int row = m_rows[i];
+        const QModelIndex index = model.index(row);
+        if ( ItemFactory::matches(m_loaders, index, *m_filter) )
+            visibleRows.append(row);
+        else
+            hiddenRows.append(row);
+
+        const bool last = i + 1 == m_rows.size();
+        if ( last
+             || visibleRows.size() + hiddenRows.size() >= chunkSize
+             || elapsed.hasExpired(maxChunkIntervalMs) )
+        {
+            emit rowsFiltered(visibleRows, hiddenRows);
+            visibleRows.clear();
+            hiddenRows.clear();
+            chunkSize = qMin(chunkSize * 2, maxChunkSize);
+            elapsed.restart();
+        }
+    }
+}
@@ -0,0 +1,71 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef ITEMFILTERWORKER_H
+#define ITEMFILTERWORKER_H
+
+#include "item/clipboardmodel.h"
+#include "item/itemfactory.h"
+#include "item/itemfilter.h"
+
+#include <QThread>
+#include <QVector>
+
+/**
+ * Matches items against a filter in a background thread.
+ *
+ * Items are matched on a snapshot of the model using a snapshot of enabled
+ * item loaders (see ItemFactory::matchingLoaders()). Results are reported in
+ * growing chunks in the order of the given rows so the first page of items
+ * can be shown quickly.
+ *
+ * Reported rows are snapshot rows. Rows inserted, removed and moved in the
+ * model in the meantime are tracked so that currentRow() can map reported
+ * rows to the current rows in the model.
+ *
+ * Stops as soon as possible after requestInterruption() is called.
+ */
+class ItemFilterWorker final : public QThread
+{
+    Q_OBJECT
+
+public:
+    ItemFilterWorker(
+        const ClipboardModel &model,
+        const QVector<int> &rows,
+        const ItemFilterPtr &filter,
+        const ItemLoaderList &loaders,
+        QObject *parent = nullptr);
+
+    /// Interrupts matching and waits for the thread to finish.
+    ~ItemFilterWorker();
+
+    /**
+     * Returns current row in the model for a row reported by rowsFiltered()
+     * or -1 if the item was removed.
+     */
+    int currentRow(int snapshotRow) const;
+
+signals:
+    void rowsFiltered(const QVector<int> &visibleRows, const QVector<int> &hiddenRows);
+
+protected:
+    void run() override;
+
+private:
+    struct RowChange {
+        int first;
+        int last;
+        /// Destination row for moved rows, -1 for inserted, -2 for removed rows.
+        int destination;
+    };
+
+    void addRowChange(int first, int last, int destination);
+
+    ClipboardItemList m_items;
+    QVector<int> m_rows;
+    ItemFilterPtr m_filter;
+    ItemLoaderList m_loaders;
+    QVector<RowChange> m_rowChanges;
+};
+
+#endif // ITEMFILTERWORKER_H
@@ -0,0 +1,268 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "itemheightindex.h"
+
+void ItemHeightIndex::clear()
+{
+    m_nodes.clear();
+    m_freeNodes.clear();
+    m_root = -1;
+}
+
+void ItemHeightIndex::insert(int row, int count, int height)
+{
+    if (count <= 0)
+        return;
+
+    int left;
+    int right;
+    split(m_root, row, &left, &right);
+    m_root = merge( merge(left, build(count, height)), right );
+}
+
+void ItemHeightIndex::remove(int row, int count)
+{
+    if (count <= 0)
+        return;
+
+    int left;
+    int middle;
+    int right;
+    split(m_root, row, &left, &right);
+    split(right, count, &middle, &right);
+    freeTree(middle);
+    m_root = merge(left, right);
+}
+
+void ItemHeightIndex::move(int row, int count, int destination)
+{
+    if (count <= 0 || (destination >= row && destination <= row + count))
+        return;
+
+    int left;
+    int moved;
+    int right;
+    split(m_root, row, &left, &right);
+    split(right, count, &moved, &right);
+    m_root = merge(left, right);
+
+    if (destination > row)
+        destination -= count;
+
+    split(m_root, destination, &left, &right);
+    m_root = merge( merge(left, moved), right );
+}
+
+int ItemHeightIndex::height(int row) const
+{
+    int node = m_root;
+    while (node != -1) {
+        const Node &n = m_nodes[node];
+        const int leftCount = count(n.left);
+        if (row < leftCount) {
+            node = n.left;
+        } else if (row == leftCount) {
+            return n.height;
+        } else {
+            row -= leftCount + 1;
+            node = n.right;
+        }
+    }
+
+    return 0;
+}
+
+void ItemHeightIndex::setHeight(int row, int height)
+{
+    setHeight(m_root, row, height);
+}
+
+int ItemHeightIndex::offset(int row) const
+{
+    int result = 0;
+    int node = m_root;
+    while (node != -1 && row > 0) {
+        const Node &n = m_nodes[node];
+        const int leftCount = count(n.left);
+        if (row <= leftCount) {
+            node = n.left;
+        } else {
+            result += sum(n.left) + n.height;
+            row -= leftCount + 1;
+            node = n.right;
+        }
+    }
+
+    return result;
+}
+
+int ItemHeightIndex::rowAt(int y) const
+{
+    if (y < 0)
+        return 0;
+
+    int row = 0;
+    int node = m_root;
+    while (node != -1) {
+        const Node &n = m_nodes[node];
+        const int leftSum = sum(n.left);
+        if (y < leftSum) {
+            node = n.left;
+            continue;
+        }
+
+        y -= leftSum;
+        row += count(n.left);
+        if (y < n.height)
+            return row;
+
+        y -= n.height;
+        row += 1;
+        node = n.right;
+    }
+
+    return row;
+}
+
+void ItemHeightIndex::update(int node)
+{
+    Node &n = m_nodes[node];
+    n.count = count(n.left) + count(n.right) + 1;
+    n.sum = sum(n.left) + sum(n.right) + n.height;
+}
+
+int ItemHeightIndex::newNode(int height)
+{
+    Node n;
+    n.height = height;
+    n.sum = height;
+    n.priority = nextPriority();
+
+    if ( m_freeNodes.isEmpty() ) {
+        m_nodes.append(n);
+        return m_nodes.size() - 1;
+    }
+
+    const int node = m_freeNodes.takeLast();
+    m_nodes[node] = n;
+    return node;
+}
+
+void ItemHeightIndex::freeTree(int node)
+{
+    if (node == -1)
+        return;
+
+    QVector<int> stack{node};
+    while ( !stack.isEmpty() ) {
+        const int i = stack.takeLast();
+        const Node &n = m_nodes[i];
+        if (n.left != -1)
+            stack.append(n.left);
+        if (n.right != -1)
+            stack.append(n.right);
+        m_freeNodes.append(i);
+    }
+}
+
+void ItemHeightIndex::split(int node, int count, int *left, int *right)
+{
+    if (node == -1) {
+        *left = -1;
+        *right = -1;
+        return;
+    }
+
+    Node &n = m_nodes[node];
+    const int leftCount = this->count(n.left);
+    if (count <= leftCount) {
+        int l;
+        split(n.left, count, left, &l);
+        m_nodes[node].left = l;
+        *right = node;
+    } else {
+        int r;
+        split(n.right, count - leftCount - 1, &r, right);
+        m_nodes[node].right = r;
+        *left = node;
+    }
+    update(node);
+}
+
+int ItemHeightIndex::merge(int left, int right)
+{
+    if (left == -1)
+        return right;
+    if (right == -1)
+        return left;
+
+    if (m_nodes[left].priority > m_nodes[right].priority) {
+        const int r = merge(m_nodes[left].right, right);
+        m_nodes[left].right = r;
+        update(left);
+        return left;
+    }
+
+    const int l = merge(left, m_nodes[right].left);
+    m_nodes[right].left = l;
+    update(right);
+    return right;
+}
+
+int ItemHeightIndex::build(int count, int height)
+{
+    // Builds Cartesian tree from nodes in row order using a stack
+    // of the rightmost path.
+    QVector<int> stack;
+    for (int i = 0; i < count; ++i) {
+        const int node = newNode(height);
+        int last = -1;
+        while ( !stack.isEmpty() && m_nodes[stack.last()].priority < m_nodes[node].priority ) {
+            last = stack.takeLast();
+            update(last);
+        }
+        m_nodes[node].left = last;
+        if ( !stack.isEmpty() )
+            m_nodes[stack.last()].right = node;
+        stack.append(node);
+    }
+
+    while ( stack.size() > 1 )
+        update( stack.takeLast() );
+
+    if ( stack.isEmpty() )
+        return -1;
+
+    update(stack.first());
+    return stack.first();
+}
+
+int ItemHeightIndex::setHeight(int node, int row, int height)
+{
+    if (node == -1)
+        return 0;
+
+    Node &n = m_nodes[node];
+    const int leftCount = count(n.left);
+    int diff;
+    if (row < leftCount) {
+        diff = setHeight(n.left, row, height);
+    } else if (row == leftCount) {
+        diff = height - n.height;
+        n.height = height;
+    } else {
+        diff = setHeight(n.right, row - leftCount - 1, height);
+    }
+
+    m_nodes[node].sum += diff;
+    return diff;
+}
+
+quint32 ItemHeightIndex::nextPriority()
+{
+    // xorshift32
+    m_seed ^= m_seed << 13;
+    m_seed ^= m_seed >> 17;
+    m_seed ^= m_seed << 5;
+    return m_seed;
+}
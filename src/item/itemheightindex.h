@@ -0,0 +1,81 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef ITEMHEIGHTINDEX_H
+#define ITEMHEIGHTINDEX_H
+
+#include <QVector>
+
+/**
+ * Heights of rows in a list with fast lookup of row offsets.
+ *
+ * Rows are kept in an implicit treap (balanced binary tree ordered by row
+ * position) with subtree sums, so inserting, removing and moving rows,
+ * changing height of a row, getting offset of a row and finding row at an
+ * offset all take O(log n) on average.
+ *
+ * Hidden rows should have zero height.
+ */
+class ItemHeightIndex final
+{
+public:
+    int size() const { return count(m_root); }
+
+    void clear();
+
+    /// Inserts @a count rows with given @a height before @a row.
+    void insert(int row, int count, int height);
+
+    void remove(int row, int count);
+
+    /// Moves rows the same way as QAbstractItemModel::moveRows().
+    void move(int row, int count, int destination);
+
+    int height(int row) const;
+    void setHeight(int row, int height);
+
+    /// Sum of heights of rows before @a row (or all rows if @a row is size()).
+    int offset(int row) const;
+
+    int totalHeight() const { return sum(m_root); }
+
+    /**
+     * Returns row at given @a y offset (skipping rows with zero height)
+     * or size() if @a y is not above the bottom of the last row.
+     */
+    int rowAt(int y) const;
+
+private:
+    struct Node {
+        int height = 0;
+        int sum = 0;
+        int count = 1;
+        quint32 priority = 0;
+        int left = -1;
+        int right = -1;
+    };
+
+    int count(int node) const { return node == -1 ? 0 : m_nodes[node].count; }
+    int sum(int node) const { return node == -1 ? 0 : m_nodes[node].sum; }
+    void update(int node);
+
+    int newNode(int height);
+    void freeTree(int node);
+
+    /// Splits tree into first @a count rows (@a left) and the rest (@a right).
+    void split(int node, int count, int *left, int *right);
+    int merge(int left, int right);
+
+    /// Builds tree of @a count rows with the same @a height in O(count).
+    int build(int count, int height);
+
+    int setHeight(int node, int row, int height);
+
+    quint32 nextPriority();
+
+    QVector<Node> m_nodes;
+    QVector<int> m_freeNodes;
+    int m_root = -1;
+    quint32 m_seed = 2463534242u;
+};
+
+#endif // ITEMHEIGHTINDEX_H
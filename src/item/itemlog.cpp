@@ -0,0 +1,1087 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "itemlog.h"
+
+#include "common/contenttype.h"
+#include "common/log.h"
+#include "item/itemblobstore.h"
+#include "item/itempayload.h"
+#include "item/serialize.h"
+
+#include <QAbstractItemModel>
+#include <QCoreApplication>
+#include <QDataStream>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QHash>
+#include <QSaveFile>
+#include <QThread>
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <memory>
+
+namespace {
+
+/// Header magic; cannot be confused with item count in the older format.
+const quint32 logMagic = 0x8C0F1060;
+/// Version 2 can reference data in ItemBlobStore.
+const quint32 logVersion = 2;
+
+/// Record is: type (quint8), payload size (quint32), payload, checksum (quint16).
+const qint64 recordHeaderSize = 5;
+const qint64 recordFooterSize = 2;
+
+/// Compact only files larger than this and with less than half of live data.
+const qint64 minCompactionFileSize = 1024 * 1024;
+
+/// Number of items loaded before showing the tab, the rest is loaded in background.
+const int firstPageItemCount = 100;
+
+/// Number of items serialized (and compressed in parallel) before writing them to file.
+const int writeChunkItemCount = 256;
+
+/// Items loaded in background are added to the model in batches.
+const int maxLoadBatchSize = 1000;
+const int maxLoadBatchIntervalMs = 100;
+
+enum RecordType : quint8 {
+    /// Item data: id (qint64) and serialized item.
+    RecordItem = 1,
+    /// Inserted rows: row, count (qint32) and ids (qint64).
+    RecordInsert = 2,
+    /// Removed rows: row and count (qint32).
+    RecordRemove = 3,
+    /// Moved rows: row, count and destination row (qint32) as in QAbstractItemModel::rowsMoved.
+    RecordMove = 4,
+    /// Marks end of a save; records after last commit are discarded.
+    RecordCommit = 5,
+};
+
+quint16 checksum(const QByteArray &bytes)
+{
+#if QT_VERSION < QT_VERSION_CHECK(6,0,0)
+    return qChecksum(bytes.constData(), static_cast<uint>(bytes.size()));
+#else
+    return qChecksum(QByteArrayView(bytes));
+#endif
+}
+
+void appendRecord(QByteArray *bytes, RecordType type, const QByteArray &payload)
+{
+    QDataStream stream(bytes, QIODevice::Append);
+    stream.setVersion(QDataStream::Qt_4_7);
+    stream << static_cast<quint8>(type) << static_cast<quint32>(payload.size());
+    stream.writeRawData(payload.constData(), payload.size());
+    stream << checksum(payload);
+}
+
+QByteArray logHeader()
+{
+    QByteArray bytes;
+    QDataStream stream(&bytes, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_4_7);
+    stream << logMagic << logVersion;
+    return bytes;
+}
+
+/// Large data are left in the mapped tab file (see ItemPayload).
+QVariantMap storedItemData(const QAbstractItemModel &model, int row)
+{
+    const QModelIndex index = model.index(row, 0);
+    const QVariant data = index.data(contentType::storedData);
+    return data.isValid() ? data.toMap() : index.data(contentType::data).toMap();
+}
+
+QByteArray itemPayload(qint64 id, const QByteArray &serializedData)
+{
+    QByteArray payload;
+    QDataStream stream(&payload, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_4_7);
+    stream << id;
+    stream.writeRawData( serializedData.constData(), serializedData.size() );
+    return payload;
+}
+
+template <typename Ids>
+QByteArray insertPayload(int row, const Ids &ids)
+{
+    QByteArray payload;
+    QDataStream stream(&payload, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_4_7);
+    stream << static_cast<qint32>(row) << static_cast<qint32>(ids.size());
+    for (const qint64 id : ids)
+        stream << id;
+    return payload;
+}
+
+QByteArray rowsPayload(int row, int count, int destination = -1)
+{
+    QByteArray payload;
+    QDataStream stream(&payload, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_4_7);
+    stream << static_cast<qint32>(row) << static_cast<qint32>(count);
+    if (destination != -1)
+        stream << static_cast<qint32>(destination);
+    return payload;
+}
+
+/// Moves rows the same way as QAbstractItemModel::moveRows().
+template <typename T>
+bool moveRows(QVector<T> *rows, int start, int count, int destination)
+{
+    if ( start < 0 || count < 0 || start + count > rows->size()
+         || destination < 0 || destination > rows->size() )
+    {
+        return false;
+    }
+
+    const auto begin = rows->begin();
+    if (destination < start)
+        std::rotate(begin + destination, begin + start, begin + start + count);
+    else if (destination > start + count)
+        std::rotate(begin + start, begin + start + count, begin + destination);
+
+    return true;
+}
+
+struct ItemLocation {
+    qint64 offset = -1;
+    qint64 size = 0;
+    QSet<QByteArray> blobs;
+};
+
+/// Reads and replays committed records.
+class ItemLogReader final {
+public:
+    explicit ItemLogReader(QIODevice *file)
+        : m_file(file)
+        , m_stream(file)
+    {
+        m_stream.setVersion(QDataStream::Qt_4_7);
+    }
+
+    bool readHeader()
+    {
+        quint32 magic;
+        quint32 version;
+        m_stream >> magic >> version;
+        if ( m_stream.status() != QDataStream::Ok || magic != logMagic ) {
+            log("Corrupted data: Invalid item log header", LogError);
+            return false;
+        }
+
+        if (version < 1 || version > logVersion) {
+            log( QStringLiteral("Unsupported item log version %1").arg(version), LogError );
+            return false;
+        }
+
+        m_validEnd = m_file->pos();
+        return true;
+    }
+
+    void readRecords()
+    {
+        const qint64 fileSize = m_file->size();
+        while ( m_file->pos() < fileSize ) {
+            const qint64 offset = m_file->pos();
+
+            quint8 type;
+            quint32 size;
+            m_stream >> type >> size;
+            if ( m_stream.status() != QDataStream::Ok
+                 || size > static_cast<quint32>(std::numeric_limits<int>::max())
+                 || offset + recordHeaderSize + size + recordFooterSize > fileSize )
+            {
+                return;
+            }
+
+            QByteArray payload(static_cast<int>(size), Qt::Uninitialized);
+            quint16 sum;
+            if ( m_stream.readRawData(payload.data(), payload.size()) != payload.size() )
+                return;
+            m_stream >> sum;
+            if ( m_stream.status() != QDataStream::Ok || sum != checksum(payload) )
+                return;
+
+            const qint64 recordSize = m_file->pos() - offset;
+            if ( !readRecord(static_cast<RecordType>(type), payload, offset, recordSize) )
+                return;
+        }
+    }
+
+    qint64 validEnd() const { return m_validEnd; }
+    qint64 maxId() const { return m_maxId; }
+    const QVector<qint64> &ids() const { return m_ids; }
+    ItemLocation location(qint64 id) const { return m_locations.value(id); }
+
+private:
+    struct Operation {
+        RecordType type;
+        qint32 row;
+        qint32 count;
+        qint32 destination;
+        QVector<qint64> ids;
+    };
+
+    bool readRecord(RecordType type, const QByteArray &payload, qint64 offset, qint64 recordSize)
+    {
+        QDataStream stream(payload);
+        stream.setVersion(QDataStream::Qt_4_7);
+
+        if (type == RecordItem) {
+            qint64 id;
+            stream >> id;
+            if ( stream.status() != QDataStream::Ok )
+                return false;
+
+            // Corrupted item data are reported when the item is loaded.
+            ItemLocation location{offset, recordSize, {}};
+            readBlobDigests(&stream, &location.blobs);
+            m_batchLocations.append(qMakePair(id, location));
+            m_maxId = qMax(m_maxId, id);
+            return true;
+        }
+
+        if (type == RecordCommit)
+            return commit(offset + recordSize);
+
+        Operation op;
+        op.type = type;
+        op.destination = -1;
+        stream >> op.row >> op.count;
+        if (type == RecordInsert) {
+            if (op.count < 0 || op.count > payload.size() / 8)
+                return false;
+            op.ids.resize(op.count);
+            for (auto &id : op.ids) {
+                stream >> id;
+                m_maxId = qMax(m_maxId, id);
+            }
+        } else if (type == RecordMove) {
+            stream >> op.destination;
+        } else if (type != RecordRemove) {
+            return false;
+        }
+
+        if ( stream.status() != QDataStream::Ok )
+            return false;
+
+        m_batchOperations.append(op);
+        return true;
+    }
+
+    bool commit(qint64 end)
+    {
+        for (const auto &op : m_batchOperations) {
+            if (op.type == RecordInsert) {
+                if (op.row < 0 || op.row > m_ids.size())
+                    return false;
+                m_ids.insert(op.row, op.count, 0);
+                std::copy( op.ids.begin(), op.ids.end(), m_ids.begin() + op.row );
+            } else if (op.type == RecordRemove) {
+                if (op.row < 0 || op.count < 0 || op.row + op.count > m_ids.size())
+                    return false;
+                for (int i = op.row; i < op.row + op.count; ++i)
+                    m_locations.remove(m_ids[i]);
+                m_ids.remove(op.row, op.count);
+            } else if ( !moveRows(&m_ids, op.row, op.count, op.destination) ) {
+                return false;
+            }
+        }
+
+        for (const auto &idLocation : m_batchLocations)
+            m_locations[idLocation.first] = idLocation.second;
+
+        m_batchOperations.clear();
+        m_batchLocations.clear();
+        m_validEnd = end;
+        return true;
+    }
+
+    QIODevice *m_file;
+    QDataStream m_stream;
+    QVector<qint64> m_ids;
+    QHash<qint64, ItemLocation> m_locations;
+    QVector<Operation> m_batchOperations;
+    QVector<QPair<qint64, ItemLocation>> m_batchLocations;
+    qint64 m_validEnd = 0;
+    qint64 m_maxId = 0;
+};
+
+} // namespace
+
+/// Copies live item records to a new file without deserializing them.
+class ItemLogCompaction final : public QThread
+{
+public:
+    ItemLogCompaction(const QString &fileName, const QVector<ItemLog::Entry> &entries, qint64 snapshotSize)
+        : m_fileName(fileName)
+        , m_entries(entries)
+        , m_snapshotSize(snapshotSize)
+        , m_target(fileName)
+    {
+        m_target.setDirectWriteFallback(false);
+    }
+
+    void cancel() { m_canceled = true; }
+
+    const QString &fileName() const { return m_fileName; }
+    qint64 snapshotSize() const { return m_snapshotSize; }
+    qint64 compactedSize() const { return m_compactedSize; }
+    QSaveFile *target() { return &m_target; }
+    const QHash<qint64, qint64> &offsets() const { return m_offsets; }
+    const QString &errorString() const { return m_errorString; }
+
+protected:
+    void run() override
+    {
+        QFile source(m_fileName);
+        if ( !source.open(QIODevice::ReadOnly) ) {
+            m_errorString = source.errorString();
+            return;
+        }
+
+        if ( !m_target.open(QIODevice::WriteOnly) ) {
+            m_errorString = m_target.errorString();
+            return;
+        }
+
+        QByteArray bytes = logHeader();
+        QVector<qint64> ids;
+        ids.reserve(m_entries.size());
+        for (const auto &entry : m_entries) {
+            if (m_canceled)
+                return;
+
+            if ( !source.seek(entry.offset) ) {
+                m_errorString = source.errorString();
+                return;
+            }
+
+            const QByteArray record = source.read(entry.size);
+            if (record.size() != entry.size) {
+                m_errorString = QStringLiteral("Failed to read item record");
+                return;
+            }
+
+            m_offsets.insert(entry.id, m_target.pos() + bytes.size());
+            bytes.append(record);
+            ids.append(entry.id);
+
+            if ( !flush(&bytes) )
+                return;
+        }
+
+        appendRecord(&bytes, RecordInsert, insertPayload(0, ids));
+        appendRecord(&bytes, RecordCommit, QByteArray());
+        if ( !flush(&bytes, true) )
+            return;
+
+        m_compactedSize = m_target.pos();
+    }
+
+private:
+    bool flush(QByteArray *bytes, bool force = false)
+    {
+        if ( !force && bytes->size() < 64 * 1024 )
+            return true;
+
+        if ( m_target.write(*bytes) != bytes->size() ) {
+            m_errorString = m_target.errorString();
+            return false;
+        }
+
+        bytes->clear();
+        return true;
+    }
+
+    QString m_fileName;
+    QVector<ItemLog::Entry> m_entries;
+    qint64 m_snapshotSize;
+    qint64 m_compactedSize = -1;
+    QSaveFile m_target;
+    QHash<qint64, qint64> m_offsets;
+    QString m_errorString;
+    std::atomic_bool m_canceled{false};
+};
+
+/// Reads item records in background.
+class ItemLogLoader final : public QThread
+{
+    Q_OBJECT
+public:
+    ItemLogLoader(
+            const QString &fileName, const QVector<qint64> &ids,
+            const QVector<qint64> &offsets, const ItemPayloadFilePtr &payloadFile)
+        : m_fileName(fileName)
+        , m_ids(ids)
+        , m_offsets(offsets)
+        , m_payloadFile(payloadFile)
+    {
+    }
+
+    void cancel() { m_canceled = true; }
+
+signals:
+    /// Successfully read items in the original order.
+    void itemsLoaded(const QVector<qint64> &ids, const QVector<QVariantMap> &items);
+
+protected:
+    void run() override
+    {
+        QFile file(m_fileName);
+        if ( !file.open(QIODevice::ReadOnly) ) {
+            log( QStringLiteral("Item log: Failed to open %1: %2")
+                 .arg(m_fileName, file.errorString()), LogError );
+            return;
+        }
+
+        QDataStream stream(&file);
+        stream.setVersion(QDataStream::Qt_4_7);
+
+        QVector<qint64> ids;
+        QVector<QVariantMap> items;
+        QElapsedTimer elapsed;
+        elapsed.start();
+
+        for (int i = 0; i < m_ids.size(); ++i) {
+            if (m_canceled)
+                return;
+
+            const qint64 id = m_ids[i];
+            QVariantMap data;
+            qint64 storedId = -1;
+            if ( file.seek(m_offsets[i] + recordHeaderSize) ) {
+                stream.resetStatus();
+                stream >> storedId;
+            }
+
+            if ( storedId == id && deserializeData(&stream, &data, m_payloadFile, ItemBlobStore::storage()) ) {
+                ids.append(id);
+                items.append(data);
+            } else {
+                log( QStringLiteral("Item log: Failed to read item %1").arg(id), LogError );
+            }
+
+            if ( i + 1 == m_ids.size()
+                 || items.size() >= maxLoadBatchSize
+                 || elapsed.hasExpired(maxLoadBatchIntervalMs) )
+            {
+                emit itemsLoaded(ids, items);
+                ids.clear();
+                items.clear();
+                elapsed.restart();
+            }
+        }
+    }
+
+private:
+    QString m_fileName;
+    QVector<qint64> m_ids;
+    QVector<qint64> m_offsets;
+    ItemPayloadFilePtr m_payloadFile;
+    std::atomic_bool m_canceled{false};
+};
+
+ItemLog::ItemLog(QAbstractItemModel *model)
+    : QObject(model)
+    , m_model(model)
+{
+    m_entries.resize( model->rowCount() );
+    for (auto &entry : m_entries)
+        entry.id = m_nextId++;
+
+    connect( model, &QAbstractItemModel::rowsInserted,
+             this, &ItemLog::onRowsInserted );
+    connect( model, &QAbstractItemModel::rowsRemoved,
+             this, &ItemLog::onRowsRemoved );
+    connect( model, &QAbstractItemModel::rowsMoved,
+             this, &ItemLog::onRowsMoved );
+    connect( model, &QAbstractItemModel::dataChanged,
+             this, &ItemLog::onDataChanged );
+    connect( model, &QAbstractItemModel::modelReset,
+             this, &ItemLog::invalidate );
+    connect( model, &QAbstractItemModel::layoutChanged,
+             this, &ItemLog::invalidate );
+}
+
+ItemLog::~ItemLog()
+{
+    cancelLoading();
+    cancelCompaction();
+}
+
+ItemLog *ItemLog::attach(QAbstractItemModel *model)
+{
+    delete find(*model);
+    return new ItemLog(model);
+}
+
+ItemLog *ItemLog::find(const QAbstractItemModel &model)
+{
+    return model.findChild<ItemLog*>(QString(), Qt::FindDirectChildrenOnly);
+}
+
+bool ItemLog::canLoad(QIODevice *file)
+{
+    QDataStream stream(file);
+    stream.setVersion(QDataStream::Qt_4_7);
+
+    quint32 magic;
+    stream >> magic;
+    return stream.status() == QDataStream::Ok && magic == logMagic;
+}
+
+bool ItemLog::load(QIODevice *file, int maxItems)
+{
+    cancelLoading();
+    cancelCompaction();
+    m_synced = false;
+
+    ItemLogReader reader(file);
+    if ( !reader.readHeader() )
+        return false;
+
+    reader.readRecords();
+
+    const qint64 fileSize = file->size();
+    if ( reader.validEnd() < fileSize ) {
+        log( QStringLiteral("Item log: Discarding %1 bytes of incomplete changes")
+             .arg(fileSize - reader.validEnd()), LogWarning );
+    }
+
+    const QVector<qint64> &ids = reader.ids();
+    const int count = qBound(0, maxItems - m_model->rowCount(), ids.size());
+    bool synced = count == ids.size();
+
+    QVector<Entry> entries;
+    QVector<QVariantMap> items;
+    entries.reserve(count);
+    items.reserve(count);
+
+    // Large data are read from mapped file only when needed.
+    auto fileDevice = qobject_cast<QFileDevice*>(file);
+    const QString fileName = fileDevice ? fileDevice->fileName() : QString();
+    const ItemPayloadFilePtr payloadFile = fileName.isEmpty()
+        ? nullptr : ItemPayload::mapFile(fileName, reader.validEnd());
+
+    // Load only the first page now if the rest can be read from the file later.
+    const int countNow = fileName.isEmpty() ? count : qMin(count, firstPageItemCount);
+
+    QDataStream stream(file);
+    stream.setVersion(QDataStream::Qt_4_7);
+    for (int i = 0; i < countNow; ++i) {
+        const qint64 id = ids[i];
+        const ItemLocation location = reader.location(id);
+        QVariantMap data;
+        qint64 storedId = -1;
+        if ( location.offset != -1 && file->seek(location.offset + recordHeaderSize) ) {
+            stream.resetStatus();
+            stream >> storedId;
+        }
+
+        if ( storedId != id || !deserializeData(&stream, &data, payloadFile, ItemBlobStore::storage()) ) {
+            log( QStringLiteral("Item log: Failed to read item %1").arg(id), LogError );
+            synced = false;
+            continue;
+        }
+
+        Entry entry;
+        entry.id = id;
+        entry.offset = location.offset;
+        entry.size = location.size;
+        entry.blobs = location.blobs;
+        entries.append(entry);
+        items.append(data);
+    }
+
+    if ( !items.isEmpty() && !m_model->insertRows(0, items.size()) )
+        return false;
+
+    for (int i = 0; i < items.size(); ++i) {
+        if ( !m_model->setData(m_model->index(i, 0), items[i], contentType::data) ) {
+            log("Failed to set model data", LogError);
+            return false;
+        }
+    }
+
+    // Rows added before loading (if any) are not in the file yet.
+    const int rowsBefore = m_model->rowCount() - entries.size();
+    m_entries = entries;
+    m_nextId = reader.maxId() + 1;
+    for (int i = 0; i < rowsBefore; ++i) {
+        Entry entry;
+        entry.id = m_nextId++;
+        m_entries.append(entry);
+    }
+
+    m_pendingOperations.clear();
+    m_fileSize = reader.validEnd();
+    m_fileName = fileName;
+    m_synced = synced && rowsBefore == 0 && !m_fileName.isEmpty();
+
+    if (countNow < count) {
+        QVector<qint64> loaderIds;
+        QVector<qint64> loaderOffsets;
+        loaderIds.reserve(count - countNow);
+        loaderOffsets.reserve(count - countNow);
+        for (int i = countNow; i < count; ++i) {
+            const qint64 id = ids[i];
+            const ItemLocation location = reader.location(id);
+            if (location.offset == -1) {
+                log( QStringLiteral("Item log: Failed to read item %1").arg(id), LogError );
+                m_synced = false;
+                continue;
+            }
+
+            Entry entry;
+            entry.id = id;
+            entry.offset = location.offset;
+            entry.size = location.size;
+            entry.blobs = location.blobs;
+            m_loadingEntries.insert(id, entry);
+            loaderIds.append(id);
+            loaderOffsets.append(location.offset);
+        }
+
+        if ( !loaderIds.isEmpty() ) {
+            COPYQ_LOG( QStringLiteral("Item log: Loading %1 items in background from %2")
+                       .arg(loaderIds.size()).arg(fileName) );
+
+            m_maxItems = maxItems;
+            m_syncedAfterLoading = m_synced;
+            m_synced = false;
+
+            // Ignore signals still queued from a canceled loader.
+            const int loadId = ++m_lastLoadId;
+            m_loader = new ItemLogLoader(fileName, loaderIds, loaderOffsets, payloadFile);
+            connect( m_loader, &ItemLogLoader::itemsLoaded, this,
+                     [this, loadId](const QVector<qint64> &ids, const QVector<QVariantMap> &items) {
+                         if (loadId == m_lastLoadId && m_loader)
+                             onItemsLoaded(ids, items);
+                     });
+            connect( m_loader, &QThread::finished, this, [this, loadId]() {
+                if (loadId == m_lastLoadId && m_loader)
+                    finishLoading();
+            });
+            m_loader->start();
+        }
+    }
+
+    return true;
+}
+
+void ItemLog::waitForLoaded()
+{
+    if (!m_loader)
+        return;
+
+    COPYQ_LOG( QStringLiteral("Item log: Waiting for items to load from %1").arg(m_fileName) );
+
+    // Deliver pending batches in order; finished() is delivered after them.
+    m_loader->wait();
+    QCoreApplication::sendPostedEvents(this, QEvent::MetaCall);
+
+    if (m_loader)
+        finishLoading();
+}
+
+
+bool ItemLog::write(QIODevice *file)
+{
+    cancelCompaction();
+    m_synced = false;
+    m_pendingOperations.clear();
+
+    const int rowCount = m_model->rowCount();
+    if ( m_entries.size() != rowCount ) {
+        m_entries.resize(rowCount);
+        for (auto &entry : m_entries)
+            entry.id = m_nextId++;
+    }
+
+    auto fileDevice = qobject_cast<QFileDevice*>(file);
+    const QString fileName = fileDevice ? fileDevice->fileName() : QString();
+
+    // Large data are shared with other tabs if the references can be tracked.
+    QSet<QByteArray> blobs;
+    QVector<QSet<QByteArray>> itemBlobs;
+    QVector<QSet<QByteArray>> *blobsToStore = fileName.isEmpty() ? nullptr : &itemBlobs;
+
+    QByteArray bytes = logHeader();
+    QVector<Entry> entries = m_entries;
+    qint64 offset = 0;
+    QVector<QVariantMap> items;
+    for (int chunkRow = 0; chunkRow < rowCount; chunkRow += writeChunkItemCount) {
+        const int chunkSize = qMin(writeChunkItemCount, rowCount - chunkRow);
+        items.resize(chunkSize);
+        for (int i = 0; i < chunkSize; ++i)
+            items[i] = storedItemData(*m_model, chunkRow + i);
+
+        // Compress item data in parallel.
+        const QVector<QByteArray> serialized =
+            serializeDataCompressed(items, ItemBlobStore::storage(), blobsToStore);
+        QSet<QByteArray> chunkBlobs;
+        for (int i = 0; i < chunkSize; ++i) {
+            auto &entry = entries[chunkRow + i];
+            entry.offset = offset + bytes.size();
+            appendRecord( &bytes, RecordItem, itemPayload(entry.id, serialized[i]) );
+            entry.size = offset + bytes.size() - entry.offset;
+            entry.blobs = blobsToStore ? itemBlobs[i] : QSet<QByteArray>();
+            chunkBlobs.unite(entry.blobs);
+        }
+
+        // Reference blobs before the file references them so they are not
+        // collected if the application exits before the save is committed.
+        if (blobsToStore)
+            ItemBlobStore::addReferences(fileName, chunkBlobs);
+        blobs.unite(chunkBlobs);
+
+        if ( file->write(bytes) != bytes.size() )
+            return false;
+        offset += bytes.size();
+        bytes.clear();
+    }
+
+    QVector<qint64> ids;
+    ids.reserve(rowCount);
+    for (const auto &entry : entries)
+        ids.append(entry.id);
+    appendRecord(&bytes, RecordInsert, insertPayload(0, ids));
+    appendRecord(&bytes, RecordCommit, QByteArray());
+    if ( file->write(bytes) != bytes.size() )
+        return false;
+
+    m_entries = entries;
+    m_fileSize = offset + bytes.size();
+    m_fileName = fileName;
+    m_synced = !m_fileName.isEmpty();
+
+    // Keep blobs referenced by the old file until the new file replaces it.
+    m_writtenBlobs = blobs;
+
+    return true;
+}
+
+void ItemLog::commitWrite()
+{
+    if ( !m_fileName.isEmpty() )
+        ItemBlobStore::setReferences(m_fileName, m_writtenBlobs);
+    m_writtenBlobs.clear();
+}
+
+bool ItemLog::canAppend(const QString &fileName) const
+{
+    return !m_loader
+        && m_synced
+        && m_fileName == fileName
+        && m_entries.size() == m_model->rowCount();
+}
+
+bool ItemLog::append(const QString &fileName)
+{
+    if ( !canAppend(fileName) )
+        return false;
+
+    QByteArray bytes;
+    QVector<QPair<int, Entry>> written;
+    QSet<QByteArray> blobs;
+    for (int row = 0; row < m_entries.size(); ++row) {
+        Entry entry = m_entries[row];
+        if (entry.offset != -1)
+            continue;
+
+        entry.offset = m_fileSize + bytes.size();
+        entry.blobs.clear();
+        const QByteArray serialized = serializeDataCompressed(
+            storedItemData(*m_model, row), ItemBlobStore::storage(), &entry.blobs );
+        appendRecord( &bytes, RecordItem, itemPayload(entry.id, serialized) );
+        entry.size = m_fileSize + bytes.size() - entry.offset;
+        blobs.unite(entry.blobs);
+        written.append(qMakePair(row, entry));
+    }
+
+    if ( bytes.isEmpty() && m_pendingOperations.isEmpty() )
+        return true;
+
+    // Reference new blobs before appending records which use them so they
+    // are not collected if the application exits before references are
+    // updated below. Extra references after a failed append are dropped with
+    // the next update.
+    ItemBlobStore::addReferences(m_fileName, blobs);
+
+    bytes.append(m_pendingOperations);
+    appendRecord(&bytes, RecordCommit, QByteArray());
+
+    QFile file(fileName);
+    if ( !file.open(QIODevice::ReadWrite) ) {
+        log( QStringLiteral("Item log: Failed to open %1: %2")
+             .arg(fileName, file.errorString()), LogError );
+        invalidate();
+        return false;
+    }
+
+    // Drop incomplete changes from an interrupted save.
+    if ( file.size() != m_fileSize && (file.size() < m_fileSize || !file.resize(m_fileSize)) ) {
+        log( QStringLiteral("Item log: Unexpected size of %1").arg(fileName), LogWarning );
+        invalidate();
+        return false;
+    }
+
+    if ( !file.seek(m_fileSize) || file.write(bytes) != bytes.size() || !file.flush() ) {
+        log( QStringLiteral("Item log: Failed to append to %1: %2")
+             .arg(fileName, file.errorString()), LogError );
+        file.resize(m_fileSize);
+        invalidate();
+        return false;
+    }
+
+    for (const auto &rowEntry : written)
+        m_entries[rowEntry.first] = rowEntry.second;
+    m_fileSize += bytes.size();
+    m_pendingOperations.clear();
+
+    // Records of changed and removed items are no longer loaded from the file.
+    updateBlobReferences();
+
+    COPYQ_LOG_VERBOSE( QStringLiteral("Item log: Appended %1 bytes (%2 items) to %3")
+                       .arg(bytes.size()).arg(written.size()).arg(fileName) );
+
+    startCompaction();
+    return true;
+}
+
+void ItemLog::updateBlobReferences()
+{
+    QSet<QByteArray> blobs;
+    for (const auto &entry : m_entries)
+        blobs.unite(entry.blobs);
+    ItemBlobStore::setReferences(m_fileName, blobs);
+}
+
+void ItemLog::invalidate()
+{
+    cancelCompaction();
+    m_synced = false;
+    m_pendingOperations.clear();
+}
+
+void ItemLog::onRowsInserted(const QModelIndex &parent, int first, int last)
+{
+    if ( parent.isValid() )
+        return;
+
+    if (m_loader && !m_insertingLoadedRows)
+        m_syncedAfterLoading = false;
+
+    QVector<Entry> entries(last - first + 1);
+    QVector<qint64> ids;
+    ids.reserve(entries.size());
+    for (auto &entry : entries) {
+        entry.id = m_nextId++;
+        ids.append(entry.id);
+    }
+
+    if ( first < 0 || first > m_entries.size() ) {
+        m_synced = false;
+        return;
+    }
+
+    m_entries.insert( first, entries.size(), Entry() );
+    std::copy( entries.begin(), entries.end(), m_entries.begin() + first );
+
+    if (m_synced)
+        appendRecord( &m_pendingOperations, RecordInsert, insertPayload(first, ids) );
+}
+
+void ItemLog::onRowsRemoved(const QModelIndex &parent, int first, int last)
+{
+    if ( parent.isValid() )
+        return;
+
+    if (m_loader)
+        m_syncedAfterLoading = false;
+
+    const int count = last - first + 1;
+    if ( first < 0 || first + count > m_entries.size() ) {
+        m_synced = false;
+        return;
+    }
+
+    m_entries.remove(first, count);
+
+    if (m_synced)
+        appendRecord( &m_pendingOperations, RecordRemove, rowsPayload(first, count) );
+}
+
+void ItemLog::onRowsMoved(
+        const QModelIndex &parent, int start, int end, const QModelIndex &destination, int row)
+{
+    if ( parent.isValid() || destination.isValid() )
+        return;
+
+    if (m_loader)
+        m_syncedAfterLoading = false;
+
+    const int count = end - start + 1;
+    if ( !moveRows(&m_entries, start, count, row) ) {
+        m_synced = false;
+        return;
+    }
+
+    if (m_synced)
+        appendRecord( &m_pendingOperations, RecordMove, rowsPayload(start, count, row) );
+}
+
+void ItemLog::onDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight)
+{
+    const int last = qMin(bottomRight.row(), m_entries.size() - 1);
+    for (int row = qMax(0, topLeft.row()); row <= last; ++row)
+        m_entries[row].offset = -1;
+}
+
+void ItemLog::onItemsLoaded(const QVector<qint64> &ids, const QVector<QVariantMap> &items)
+{
+    // Items added while loading count towards the maximum.
+    const int row = m_model->rowCount();
+    const int count = qBound(0, m_maxItems - row, items.size());
+    if (count < ids.size())
+        m_syncedAfterLoading = false;
+    if (count == 0)
+        return;
+
+    m_insertingLoadedRows = true;
+    const bool inserted = m_model->insertRows(row, count);
+    m_insertingLoadedRows = false;
+    if (!inserted) {
+        m_syncedAfterLoading = false;
+        return;
+    }
+
+    for (int i = 0; i < count; ++i) {
+        if ( !m_model->setData(m_model->index(row + i, 0), items[i], contentType::data) ) {
+            log("Failed to set model data", LogError);
+            m_syncedAfterLoading = false;
+        }
+    }
+
+    // Loaded items are already stored in the file.
+    if (m_entries.size() == m_model->rowCount()) {
+        for (int i = 0; i < count; ++i)
+            m_entries[row + i] = m_loadingEntries.take(ids[i]);
+    } else {
+        m_syncedAfterLoading = false;
+    }
+}
+
+void ItemLog::finishLoading()
+{
+    std::unique_ptr<ItemLogLoader> loader(m_loader);
+    m_loader = nullptr;
+    loader->wait();
+
+    COPYQ_LOG( QStringLiteral("Item log: %1 items loaded from %2")
+               .arg(m_model->rowCount()).arg(m_fileName) );
+
+    m_synced = m_syncedAfterLoading && m_loadingEntries.isEmpty();
+    m_loadingEntries.clear();
+    m_pendingOperations.clear();
+}
+
+void ItemLog::cancelLoading()
+{
+    if (!m_loader)
+        return;
+
+    m_loader->cancel();
+    m_loader->wait();
+    delete m_loader;
+    m_loader = nullptr;
+    m_loadingEntries.clear();
+}
+
+void ItemLog::startCompaction()
+{
+    if ( m_compaction || m_fileSize < minCompactionFileSize )
+        return;
+
+    qint64 liveSize = 0;
+    for (const auto &entry : m_entries)
+        liveSize += entry.size;
+
+    if (liveSize * 2 > m_fileSize)
+        return;
+
+    COPYQ_LOG( QStringLiteral("Item log: Compacting %1 (%2 of %3 bytes used)")
+               .arg(m_fileName).arg(liveSize).arg(m_fileSize) );
+
+    auto compaction = new ItemLogCompaction(m_fileName, m_entries, m_fileSize);
+    m_compaction = compaction;
+    connect( compaction, &QThread::finished, this, [this, compaction]() {
+        if (compaction == m_compaction)
+            finishCompaction();
+    });
+    compaction->start(QThread::LowPriority);
+}
+
+void ItemLog::finishCompaction()
+{
+    std::unique_ptr<ItemLogCompaction> compaction(m_compaction);
+    m_compaction = nullptr;
+    compaction->wait();
+
+    if ( compaction->compactedSize() == -1 ) {
+        log( QStringLiteral("Item log: Failed to compact %1: %2")
+             .arg(compaction->fileName(), compaction->errorString()), LogWarning );
+        return;
+    }
+
+    if ( !m_synced || compaction->fileName() != m_fileName )
+        return;
+
+    // Copy changes appended while compacting.
+    const qint64 snapshotSize = compaction->snapshotSize();
+    QFile source(m_fileName);
+    QByteArray tail;
+    if ( source.open(QIODevice::ReadOnly) && source.seek(snapshotSize) )
+        tail = source.read(m_fileSize - snapshotSize);
+
+    QSaveFile *target = compaction->target();
+    if ( tail.size() != m_fileSize - snapshotSize
+         || target->write(tail) != tail.size()
+         || !target->commit() )
+    {
+        log( QStringLiteral("Item log: Failed to compact %1: %2")
+             .arg(m_fileName, target->errorString()), LogWarning );
+        return;
+    }
+
+    const qint64 compactedSize = compaction->compactedSize();
+    const auto &offsets = compaction->offsets();
+    for (auto &entry : m_entries) {
+        if (entry.offset >= snapshotSize)
+            entry.offset += compactedSize - snapshotSize;
+        else if (entry.offset != -1)
+            entry.offset = offsets.value(entry.id, -1);
+    }
+
+    COPYQ_LOG( QStringLiteral("Item log: Compacted %1 from %2 to %3 bytes")
+               .arg(m_fileName).arg(m_fileSize).arg(compactedSize + tail.size()) );
+
+    m_fileSize = compactedSize + tail.size();
+}
+
+void ItemLog::cancelCompaction()
+{
+    if (!m_compaction)
+        return;
+
+    m_compaction->cancel();
+    m_compaction->wait();
+    delete m_compaction;
+    m_compaction = nullptr;
+}
+
+#include "itemlog.moc"
@@ -0,0 +1,131 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+#ifndef ITEMLOG_H
+#define ITEMLOG_H
+
+#include <QHash>
+#include <QObject>
+#include <QSet>
+#include <QString>
+#include <QVariantMap>
+#include <QVector>
+
+class ItemLogCompaction;
+class ItemLogLoader;
+class QAbstractItemModel;
+class QIODevice;
+class QModelIndex;
+
+/**
+ * Append-only storage for items in a tab.
+ *
+ * The tab file starts with a header followed by records. Full save writes
+ * a record for each item and the item order. After that, saving a tab only
+ * appends records for changed items and for inserted, removed or moved rows,
+ * followed by a commit record. Incomplete records at the end of the file
+ * (e.g. after a crash) are ignored on load and truncated on next save.
+ *
+ * Offsets of live item records are kept in memory so the file can be
+ * compacted in a background thread once it contains mostly stale records.
+ *
+ * Only the first page of items is loaded immediately, the rest is read in
+ * a background thread and appended to the model in batches. Saving has to
+ * wait until loading finishes (see waitForLoaded()).
+ *
+ * The log is a child of the tracked model and is owned by the default saver.
+ */
+class ItemLog final : public QObject
+{
+    Q_OBJECT
+public:
+    ~ItemLog();
+
+    /// Start tracking changes in a model (replaces current log of the model).
+    static ItemLog *attach(QAbstractItemModel *model);
+
+    /// Return log tracking the model or nullptr.
+    static ItemLog *find(const QAbstractItemModel &model);
+
+    /// Returns true if file is in the log format.
+    static bool canLoad(QIODevice *file);
+
+    const QAbstractItemModel *model() const { return m_model; }
+
+    /// Load items to the model (most of them in background if possible).
+    bool load(QIODevice *file, int maxItems);
+
+    /// Returns true if items are still being loaded in background.
+    bool isLoading() const { return m_loader != nullptr; }
+
+    /// Block until all items are loaded.
+    void waitForLoaded();
+
+    /// Write all items (and compacts the log).
+    bool write(QIODevice *file);
+
+    /**
+     * Called after the file written by write() replaced the tab file.
+     *
+     * Releases blobs (see ItemBlobStore) referenced only by the old file.
+     */
+    void commitWrite();
+
+    /// Returns true if only changes can be appended to the tab file.
+    bool canAppend(const QString &fileName) const;
+
+    /// Append changes since last save to the tab file.
+    bool append(const QString &fileName);
+
+    /// Force rewriting whole file on next save.
+    void invalidate();
+
+private:
+    friend class ItemLogCompaction;
+
+    struct Entry {
+        qint64 id = 0;
+        qint64 offset = -1;
+        qint64 size = 0;
+        /// Blobs (see ItemBlobStore) referenced by the item record.
+        QSet<QByteArray> blobs;
+    };
+
+    explicit ItemLog(QAbstractItemModel *model);
+
+    void onRowsInserted(const QModelIndex &parent, int first, int last);
+    void onRowsRemoved(const QModelIndex &parent, int first, int last);
+    void onRowsMoved(const QModelIndex &parent, int start, int end, const QModelIndex &destination, int row);
+    void onDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight);
+
+    void onItemsLoaded(const QVector<qint64> &ids, const QVector<QVariantMap> &items);
+    void finishLoading();
+    void cancelLoading();
+
+    /// Sets blobs referenced by the tab file to the blobs of current items.
+    void updateBlobReferences();
+
+    void startCompaction();
+    void finishCompaction();
+    void cancelCompaction();
+
+    QAbstractItemModel *m_model;
+    QVector<Entry> m_entries;
+    QByteArray m_pendingOperations;
+    QString m_fileName;
+    /// Blobs referenced by items written by the last write().
+    QSet<QByteArray> m_writtenBlobs;
+    qint64 m_fileSize = 0;
+    qint64 m_nextId = 1;
+    bool m_synced = false;
+    ItemLogCompaction *m_compaction = nullptr;
+
+    ItemLogLoader *m_loader = nullptr;
+    /// Entries for items still being loaded.
+    QHash<qint64, Entry> m_loadingEntries;
+    int m_maxItems = 0;
+    /// Cleared if rows change while loading (file no longer matches the model).
+    bool m_syncedAfterLoading = false;
+    bool m_insertingLoadedRows = false;
+    int m_lastLoadId = 0;
+};
+
+#endif // ITEMLOG_H
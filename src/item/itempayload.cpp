@@ -0,0 +1,173 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "itempayload.h"
+
+#include "common/log.h"
+
+#include <QCache>
+#include <QFile>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QPair>
+
+#include <atomic>
+
+namespace {
+
+/// Maximum size of the copied data in KiB.
+const int cacheSizeKiB = 64 * 1024;
+
+const int minPayloadSize = 64 * 1024;
+
+using CacheKey = QPair<quint64, qint64>;
+
+QMutex &cacheMutex()
+{
+    static QMutex mutex;
+    return mutex;
+}
+
+QCache<CacheKey, QByteArray> &cache()
+{
+    static QCache<CacheKey, QByteArray> cache(cacheSizeKiB);
+    return cache;
+}
+
+quint64 newFileId()
+{
+    static std::atomic<quint64> lastId{0};
+    return ++lastId;
+}
+
+} // namespace
+
+class ItemPayloadFile final
+{
+public:
+    explicit ItemPayloadFile(const QString &fileName)
+        : m_file(fileName)
+        , m_id(newFileId())
+    {
+    }
+
+    ~ItemPayloadFile()
+    {
+        if (m_data)
+            m_file.unmap(m_data);
+    }
+
+    bool map(qint64 size)
+    {
+        if ( !m_file.open(QIODevice::ReadOnly) )
+            return false;
+
+        m_data = m_file.map(0, size);
+        m_size = m_data ? size : 0;
+        return m_data != nullptr;
+    }
+
+    QString errorString() const { return m_file.errorString(); }
+    const uchar *data() const { return m_data; }
+    qint64 size() const { return m_size; }
+    quint64 id() const { return m_id; }
+
+private:
+    QFile m_file;
+    uchar *m_data = nullptr;
+    qint64 m_size = 0;
+    quint64 m_id;
+};
+
+ItemPayload::ItemPayload(const ItemPayloadFilePtr &file, qint64 offset, int size, bool compressed)
+{
+    if ( file && offset >= 0 && size >= 0 && offset + size <= file->size() ) {
+        m_file = file;
+        m_offset = offset;
+        m_size = size;
+        m_compressed = compressed;
+    }
+}
+
+ItemPayloadFilePtr ItemPayload::mapFile(const QString &fileName, qint64 size)
+{
+#ifdef Q_OS_WIN
+    // Mapped file could not be replaced when saving the tab.
+    Q_UNUSED(fileName)
+    Q_UNUSED(size)
+    return nullptr;
+#else
+    if (size <= 0)
+        return nullptr;
+
+    auto file = std::make_shared<ItemPayloadFile>(fileName);
+    if ( !file->map(size) ) {
+        COPYQ_LOG( QStringLiteral("Failed to map %1: %2").arg(fileName, file->errorString()) );
+        return nullptr;
+    }
+
+    return file;
+#endif
+}
+
+int ItemPayload::minSize()
+{
+    return minPayloadSize;
+}
+
+QByteArray ItemPayload::bytes() const
+{
+    if ( !isValid() )
+        return QByteArray();
+
+    const CacheKey key(m_file->id(), m_offset);
+    QMutexLocker lock(&cacheMutex());
+
+    const QByteArray *cached = cache().object(key);
+    if (cached)
+        return *cached;
+
+    const auto data = m_file->data() + m_offset;
+    if (!m_compressed) {
+        const QByteArray bytes(reinterpret_cast<const char*>(data), m_size);
+        cache().insert( key, new QByteArray(bytes), m_size / 1024 + 1 );
+        return bytes;
+    }
+
+    // Allow decompressing other data in parallel.
+    lock.unlock();
+    const QByteArray bytes = qUncompress(data, m_size);
+    if ( bytes.isEmpty() )
+        log("Corrupted data: Failed to decompress data", LogError);
+    lock.relock();
+
+    cache().insert( key, new QByteArray(bytes), bytes.size() / 1024 + 1 );
+    return bytes;
+}
+
+QByteArray ItemPayload::rawBytes() const
+{
+    if ( !isValid() )
+        return QByteArray();
+
+    if (m_compressed)
+        return bytes();
+
+    return storedBytes();
+}
+
+QByteArray ItemPayload::storedBytes() const
+{
+    if ( !isValid() )
+        return QByteArray();
+
+    return QByteArray::fromRawData(
+        reinterpret_cast<const char*>(m_file->data() + m_offset), m_size);
+}
+
+bool ItemPayload::operator==(const ItemPayload &other) const
+{
+    return m_file == other.m_file
+        && m_offset == other.m_offset
+        && m_size == other.m_size
+        && m_compressed == other.m_compressed;
+}
@@ -0,0 +1,76 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef ITEMPAYLOAD_H
+#define ITEMPAYLOAD_H
+
+#include <QByteArray>
+#include <QMetaType>
+
+#include <memory>
+
+class ItemPayloadFile;
+class QString;
+
+using ItemPayloadFilePtr = std::shared_ptr<ItemPayloadFile>;
+
+/**
+ * Item data in single format left in memory-mapped tab file.
+ *
+ * Bytes are copied from the file only when requested and are kept in an LRU
+ * cache shared by all items which limits the size of the copied data.
+ *
+ * Compressed data are decompressed only when requested.
+ */
+class ItemPayload final
+{
+public:
+    ItemPayload() = default;
+
+    ItemPayload(const ItemPayloadFilePtr &file, qint64 offset, int size, bool compressed = false);
+
+    /**
+     * Maps first @a size bytes of a tab file.
+     *
+     * Returns nullptr if mapping fails or is not supported on the platform.
+     */
+    static ItemPayloadFilePtr mapFile(const QString &fileName, qint64 size);
+
+    /// Data smaller than this are always kept in memory.
+    static int minSize();
+
+    /// Returns false if the payload is outside of the mapped file.
+    bool isValid() const { return m_file != nullptr; }
+
+    /// Returns size of the data in the file.
+    int size() const { return m_size; }
+
+    bool isCompressed() const { return m_compressed; }
+
+    /// Returns copy of the data (cached).
+    QByteArray bytes() const;
+
+    /**
+     * Returns data without copying, valid only while this object exists.
+     *
+     * Compressed data are always copied.
+     */
+    QByteArray rawBytes() const;
+
+    /**
+     * Returns data as stored in the file (compressed if isCompressed())
+     * without copying, valid only while this object exists.
+     */
+    QByteArray storedBytes() const;
+
+    bool operator==(const ItemPayload &other) const;
+
+private:
+    ItemPayloadFilePtr m_file;
+    qint64 m_offset = 0;
+    int m_size = 0;
+    bool m_compressed = false;
+};
+
+Q_DECLARE_METATYPE(ItemPayload)
+
+#endif // ITEMPAYLOAD_H
@@ -39,3 +39,13 @@ void ItemSaverWrapper::setFocus(bool focus)
 {
     return m_saver->setFocus(focus);
 }
+
+bool ItemSaverWrapper::isLoading() const
+{
+    return m_saver->isLoading();
+}
+
+void ItemSaverWrapper::waitForLoaded()
+{
+    m_saver->waitForLoaded();
+}
@@ -21,6 +21,10 @@ public:
 
     void setFocus(bool focus) override;
 
+    bool isLoading() const override;
+
+    void waitForLoaded() override;
+
 protected:
     ItemSaverInterface *wrapped() const { return m_saver.get(); }
 
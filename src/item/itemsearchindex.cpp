@@ -0,0 +1,374 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "itemsearchindex.h"
+
+#include "common/contenttype.h"
+#include "common/log.h"
+#include "common/mimetypes.h"
+#include "common/textdata.h"
+
+#include <QAbstractItemModel>
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QFile>
+#include <QSaveFile>
+#include <QStringList>
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+const quint32 indexMagic = 0x8C0F1D01;
+const quint32 indexVersion = 1;
+
+/// Items with longer texts are not indexed (always need to be matched).
+const int maxIndexedTextLength = 100000;
+
+/// Rebuild postings when there are more removed items than indexed ones.
+const int minRemovedCountToRebuild = 1000;
+
+QString foldText(const QString &text)
+{
+    return accentsRemoved(text).toLower();
+}
+
+void addTrigrams(const QString &text, QVector<quint64> *trigrams)
+{
+    for (int i = 0; i + 2 < text.size(); ++i) {
+        trigrams->append(
+            (static_cast<quint64>(text[i].unicode()) << 32)
+            | (static_cast<quint64>(text[i + 1].unicode()) << 16)
+            | static_cast<quint64>(text[i + 2].unicode()) );
+    }
+}
+
+/**
+ * Returns hash of the texts stored in index file.
+ *
+ * Unlike hash(), the result does not change between application runs.
+ */
+quint64 textsHash(const QVariantMap &texts)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha256);
+    for (auto it = texts.constBegin(); it != texts.constEnd(); ++it) {
+        const QByteArray format = it.key().toUtf8();
+        const QByteArray bytes = it.value().toByteArray();
+        for (const auto &value : {format, bytes}) {
+            hash.addData( QByteArray::number(value.size()) + ':' );
+            hash.addData(value);
+        }
+    }
+
+    quint64 result;
+    std::memcpy( &result, hash.result().constData(), sizeof(result) );
+    return result;
+}
+
+void sortUnique(QVector<quint64> *trigrams)
+{
+    std::sort(trigrams->begin(), trigrams->end());
+    trigrams->erase( std::unique(trigrams->begin(), trigrams->end()), trigrams->end() );
+}
+
+/// Texts matched by item loaders (see ItemLoaderInterface::matches()).
+QVariantMap searchTexts(const QModelIndex &index)
+{
+    QVariantMap texts;
+
+    const QVariantMap data = index.data(contentType::inlineData).toMap();
+    for (auto it = data.constBegin(); it != data.constEnd(); ++it) {
+        const QString &format = it.key();
+        if ( format.startsWith(COPYQ_MIME_PREFIX)
+             && format != mimeWindowTitle
+             && format != mimeOwner
+             && format != mimeClipboardMode )
+        {
+            texts.insert(format, it.value());
+        }
+    }
+
+    texts.insert( mimeItemNotes, index.data(contentType::notes).toString().toUtf8() );
+    texts.insert( mimeText, index.data(contentType::text).toString().toUtf8() );
+
+    return texts;
+}
+
+} // namespace
+
+ItemSearchIndex::ItemSearchIndex(QAbstractItemModel *model, QObject *parent)
+    : QObject(parent)
+    , m_model(model)
+{
+    connect( model, &QAbstractItemModel::rowsInserted,
+             this, &ItemSearchIndex::onRowsInserted );
+    connect( model, &QAbstractItemModel::rowsRemoved,
+             this, &ItemSearchIndex::onRowsRemoved );
+    connect( model, &QAbstractItemModel::rowsMoved,
+             this, &ItemSearchIndex::onRowsMoved );
+    connect( model, &QAbstractItemModel::dataChanged,
+             this, &ItemSearchIndex::onDataChanged );
+    connect( model, &QAbstractItemModel::modelReset,
+             this, &ItemSearchIndex::reset );
+    connect( model, &QAbstractItemModel::layoutChanged,
+             this, &ItemSearchIndex::reset );
+
+    reset();
+}
+
+void ItemSearchIndex::reset()
+{
+    m_rowIds.fill( 0, m_model->rowCount() );
+    m_entries.clear();
+    m_postings.clear();
+    m_candidates.clear();
+    m_removedCount = 0;
+    m_searching = false;
+}
+
+void ItemSearchIndex::load(const QString &fileName)
+{
+    QFile file(fileName);
+    if ( !file.open(QIODevice::ReadOnly) )
+        return;
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+
+    quint32 magic;
+    quint32 version;
+    qint32 count;
+    stream >> magic >> version >> count;
+    if ( stream.status() != QDataStream::Ok || magic != indexMagic || version != indexVersion ) {
+        COPYQ_LOG( QStringLiteral("Ignoring search index file: %1").arg(fileName) );
+        return;
+    }
+
+    m_savedEntries.clear();
+    for (qint32 i = 0; i < count && stream.status() == QDataStream::Ok; ++i) {
+        Entry entry;
+        stream >> entry.textHash >> entry.complete >> entry.trigrams;
+        m_savedEntries.insert(entry.textHash, entry);
+    }
+
+    if ( stream.status() != QDataStream::Ok ) {
+        log( QStringLiteral("Corrupted search index file: %1").arg(fileName), LogWarning );
+        m_savedEntries.clear();
+    }
+}
+
+bool ItemSearchIndex::save(const QString &fileName)
+{
+    if (!m_changed)
+        return true;
+
+    QSaveFile file(fileName);
+    if ( !file.open(QIODevice::WriteOnly) ) {
+        log( QStringLiteral("Failed to save search index %1: %2")
+             .arg(fileName, file.errorString()), LogWarning );
+        return false;
+    }
+
+    // Keep saved entries for items not indexed yet.
+    QHash<quint64, Entry> entries = m_savedEntries;
+    for (const auto &entry : m_entries)
+        entries.insert(entry.textHash, entry);
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream << indexMagic << indexVersion << static_cast<qint32>(entries.size());
+    for (const auto &entry : entries)
+        stream << entry.textHash << entry.complete << entry.trigrams;
+
+    if ( stream.status() != QDataStream::Ok || !file.commit() ) {
+        log( QStringLiteral("Failed to save search index %1: %2")
+             .arg(fileName, file.errorString()), LogWarning );
+        return false;
+    }
+
+    m_changed = false;
+    return true;
+}
+
+bool ItemSearchIndex::search(const QStringList &terms)
+{
+    m_searching = false;
+    m_candidates.clear();
+
+    QVector<quint64> trigrams;
+    for (const auto &term : terms)
+        addTrigrams( foldText(term), &trigrams );
+
+    if ( trigrams.isEmpty() )
+        return false;
+
+    sortUnique(&trigrams);
+    indexItems();
+
+    // Each matching item is in the shortest posting list.
+    const QVector<quint32> *shortest = nullptr;
+    for (const quint64 trigram : trigrams) {
+        const auto it = m_postings.constFind(trigram);
+        if ( it == m_postings.constEnd() ) {
+            m_searching = true;
+            return true;
+        }
+        if ( !shortest || it->size() < shortest->size() )
+            shortest = &it.value();
+    }
+
+    for (const quint32 id : *shortest) {
+        const auto it = m_entries.constFind(id);
+        if ( it == m_entries.constEnd() )
+            continue;
+
+        const auto &itemTrigrams = it->trigrams;
+        const bool matches = std::all_of(
+            trigrams.begin(), trigrams.end(), [&](quint64 trigram) {
+                return std::binary_search(itemTrigrams.begin(), itemTrigrams.end(), trigram);
+            });
+        if (matches)
+            m_candidates.insert(id);
+    }
+
+    m_searching = true;
+    return true;
+}
+
+bool ItemSearchIndex::isCandidate(int row) const
+{
+    if (!m_searching)
+        return true;
+
+    const quint32 id = m_rowIds.value(row);
+    if (id == 0)
+        return true;
+
+    const auto it = m_entries.constFind(id);
+    return it == m_entries.constEnd() || !it->complete || m_candidates.contains(id);
+}
+
+void ItemSearchIndex::onRowsInserted(const QModelIndex &parent, int first, int last)
+{
+    if ( parent.isValid() || first < 0 || first > m_rowIds.size() ) {
+        reset();
+        return;
+    }
+
+    m_rowIds.insert(first, last - first + 1, 0);
+}
+
+void ItemSearchIndex::onRowsRemoved(const QModelIndex &parent, int first, int last)
+{
+    if ( parent.isValid() || first < 0 || last >= m_rowIds.size() ) {
+        reset();
+        return;
+    }
+
+    for (int row = first; row <= last; ++row)
+        removeEntry(m_rowIds[row]);
+    m_rowIds.remove(first, last - first + 1);
+}
+
+void ItemSearchIndex::onRowsMoved(
+        const QModelIndex &parent, int start, int end, const QModelIndex &destination, int row)
+{
+    if ( parent.isValid() || destination.isValid() ) {
+        reset();
+        return;
+    }
+
+    const auto begin = m_rowIds.begin();
+    if (row < start)
+        std::rotate(begin + row, begin + start, begin + end + 1);
+    else if (row > end + 1)
+        std::rotate(begin + start, begin + end + 1, begin + row);
+}
+
+void ItemSearchIndex::onDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight)
+{
+    const int last = qMin(bottomRight.row(), m_rowIds.size() - 1);
+    for (int row = qMax(0, topLeft.row()); row <= last; ++row) {
+        removeEntry(m_rowIds[row]);
+        m_rowIds[row] = 0;
+    }
+}
+
+void ItemSearchIndex::indexItems()
+{
+    if ( m_rowIds.size() != m_model->rowCount() )
+        reset();
+
+    if ( m_removedCount > minRemovedCountToRebuild && m_removedCount > m_entries.size() )
+        rebuildPostings();
+
+    for (int row = 0; row < m_rowIds.size(); ++row) {
+        if (m_rowIds[row] != 0)
+            continue;
+
+        const quint32 id = m_nextId++;
+        const Entry entry = createEntry(row);
+        m_entries.insert(id, entry);
+        m_rowIds[row] = id;
+
+        for (const quint64 trigram : entry.trigrams)
+            m_postings[trigram].append(id);
+    }
+
+    // Remaining saved entries are for removed or changed items.
+    if ( !m_savedEntries.isEmpty() ) {
+        m_savedEntries.clear();
+        m_changed = true;
+    }
+}
+
+ItemSearchIndex::Entry ItemSearchIndex::createEntry(int row)
+{
+    const QVariantMap texts = searchTexts( m_model->index(row, 0) );
+    const quint64 textHash = textsHash(texts);
+
+    const auto it = m_savedEntries.find(textHash);
+    if ( it != m_savedEntries.end() ) {
+        const Entry entry = it.value();
+        m_savedEntries.erase(it);
+        return entry;
+    }
+
+    m_changed = true;
+
+    Entry entry;
+    entry.textHash = textHash;
+
+    int length = 0;
+    for (const auto &value : texts) {
+        const QString text = foldText( getTextData(value.toByteArray()) );
+        length += text.size();
+        if (length > maxIndexedTextLength) {
+            entry.complete = false;
+            entry.trigrams.clear();
+            return entry;
+        }
+        addTrigrams(text, &entry.trigrams);
+    }
+
+    sortUnique(&entry.trigrams);
+    return entry;
+}
+
+void ItemSearchIndex::removeEntry(quint32 id)
+{
+    if ( id != 0 && m_entries.remove(id) > 0 ) {
+        ++m_removedCount;
+        m_changed = true;
+    }
+}
+
+void ItemSearchIndex::rebuildPostings()
+{
+    m_postings.clear();
+    for (auto it = m_entries.constBegin(); it != m_entries.constEnd(); ++it) {
+        for (const quint64 trigram : it->trigrams)
+            m_postings[trigram].append(it.key());
+    }
+    m_removedCount = 0;
+}
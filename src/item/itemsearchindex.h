@@ -0,0 +1,84 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef ITEMSEARCHINDEX_H
+#define ITEMSEARCHINDEX_H
+
+#include <QHash>
+#include <QObject>
+#include <QSet>
+#include <QVector>
+
+class QAbstractItemModel;
+class QModelIndex;
+class QString;
+class QStringList;
+
+/**
+ * Trigram index of item texts used to skip items when filtering.
+ *
+ * Indexed texts are the item text, notes and other internal formats
+ * (e.g. tags) with accents removed and converted to lower case. Items are
+ * indexed lazily on first search after they are added or changed.
+ *
+ * Saved index is used to avoid re-indexing unchanged items after restart
+ * (items are matched by hash of the indexed texts).
+ */
+class ItemSearchIndex final : public QObject
+{
+public:
+    explicit ItemSearchIndex(QAbstractItemModel *model, QObject *parent = nullptr);
+
+    /// Forget indexed items (e.g. after the model is loaded with blocked signals).
+    void reset();
+
+    /// Load saved index.
+    void load(const QString &fileName);
+
+    /// Save index if changed.
+    bool save(const QString &fileName);
+
+    /**
+     * Find items containing all search terms.
+     *
+     * Returns false if the index cannot be used (e.g. terms are too short),
+     * i.e. all items are candidates.
+     */
+    bool search(const QStringList &terms);
+
+    /**
+     * Returns false if the item at the row cannot match the last search
+     * (i.e. other matching is not needed).
+     */
+    bool isCandidate(int row) const;
+
+private:
+    struct Entry {
+        quint64 textHash = 0;
+        QVector<quint64> trigrams;
+        /// False if the texts are too long to index.
+        bool complete = true;
+    };
+
+    void onRowsInserted(const QModelIndex &parent, int first, int last);
+    void onRowsRemoved(const QModelIndex &parent, int first, int last);
+    void onRowsMoved(const QModelIndex &parent, int start, int end, const QModelIndex &destination, int row);
+    void onDataChanged(const QModelIndex &topLeft, const QModelIndex &bottomRight);
+
+    void indexItems();
+    Entry createEntry(int row);
+    void removeEntry(quint32 id);
+    void rebuildPostings();
+
+    QAbstractItemModel *m_model;
+    QVector<quint32> m_rowIds;
+    QHash<quint32, Entry> m_entries;
+    QHash<quint64, QVector<quint32>> m_postings;
+    QHash<quint64, Entry> m_savedEntries;
+    QSet<quint32> m_candidates;
+    quint32 m_nextId = 1;
+    int m_removedCount = 0;
+    bool m_searching = false;
+    bool m_changed = false;
+};
+
+#endif // ITEMSEARCHINDEX_H
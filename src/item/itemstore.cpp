@@ -5,7 +5,10 @@
 #include "common/config.h"
 #include "common/log.h"
 #include "common/textdata.h"
+#include "common/trace.h"
+#include "item/itemblobstore.h"
 #include "item/itemfactory.h"
+#include "item/itemlog.h"
 
 #include <QAbstractItemModel>
 #include <QDir>
@@ -83,6 +86,8 @@ ItemSaverPtr createTab(
 
 ItemSaverPtr loadItems(const QString &tabName, QAbstractItemModel &model, ItemFactory *itemFactory, int maxItems)
 {
+    COPYQ_TRACE_DETAIL("tab", "load tab", tabName);
+
     if ( !createItemDirectory() )
         return nullptr;
 
@@ -92,6 +97,7 @@ ItemSaverPtr loadItems(const QString &tabName, QAbstractItemModel &model, ItemFa
 
     ItemSaverPtr saver = loadItems(tabName, tabFileName, model, itemFactory, maxItems);
     if (saver) {
+        traceCounter("tab", "loaded items", model.rowCount());
         COPYQ_LOG( QStringLiteral("Tab \"%1\": %2 items loaded from: %3")
                       .arg(tabName, QString::number(model.rowCount()), tabFileName) );
         return saver;
@@ -105,16 +111,34 @@ ItemSaverPtr loadItems(const QString &tabName, QAbstractItemModel &model, ItemFa
 
 bool saveItems(const QString &tabName, const QAbstractItemModel &model, const ItemSaverPtr &saver)
 {
+    COPYQ_TRACE_DETAIL("tab", "save tab", tabName);
+
     const QString tabFileName = itemFileName(tabName);
 
     if ( !createItemDirectory() )
         return false;
 
+    // Items still loading in background would be lost.
+    ItemLog *itemLog = ItemLog::find(model);
+    if (itemLog)
+        itemLog->waitForLoaded();
+
+    // Append only changed items if possible.
+    if ( itemLog && itemLog->canAppend(tabFileName) ) {
+        COPYQ_LOG( QStringLiteral("Tab \"%1\": Saving changes").arg(tabName) );
+        if ( itemLog->append(tabFileName) ) {
+            COPYQ_LOG( QStringLiteral("Tab \"%1\": Items saved").arg(tabName) );
+            return true;
+        }
+    }
+
     // Save tab data to a new temporary file.
     QSaveFile tabFile(tabFileName);
     tabFile.setDirectWriteFallback(false);
     if ( !tabFile.open(QIODevice::WriteOnly) ) {
         printItemFileError("save tab (open temporary file)", tabName, tabFile);
+        if (itemLog)
+            itemLog->invalidate();
         return false;
     }
 
@@ -124,29 +148,63 @@ bool saveItems(const QString &tabName, const QAbstractItemModel &model, const It
     if ( !saver->saveItems(tabName, model, &tabFile) ) {
         tabFile.cancelWriting();
         printItemFileError("save tab (save items to temporary file)", tabName, tabFile);
+        if (itemLog)
+            itemLog->invalidate();
         return false;
     }
 
     if ( !tabFile.flush() ) {
         tabFile.cancelWriting();
         printItemFileError("save tab (flush to temporary file)", tabName, tabFile);
+        if (itemLog)
+            itemLog->invalidate();
         return false;
     }
 
     if ( !tabFile.commit() ) {
         printItemFileError("save tab (commit)", tabName, tabFile);
+        if (itemLog)
+            itemLog->invalidate();
         return false;
     }
 
+    if (itemLog)
+        itemLog->commitWrite();
+
     COPYQ_LOG( QStringLiteral("Tab \"%1\": Items saved").arg(tabName) );
 
     return true;
 }
 
+bool isLoadingItems(const QAbstractItemModel &model)
+{
+    const ItemLog *itemLog = ItemLog::find(model);
+    return itemLog && itemLog->isLoading();
+}
+
+void waitForItemsLoaded(const QAbstractItemModel &model)
+{
+    ItemLog *itemLog = ItemLog::find(model);
+    if (itemLog)
+        itemLog->waitForLoaded();
+}
+
+QString itemSearchIndexFileName(const QString &tabName)
+{
+    return itemFileName(tabName) + QLatin1String(".index");
+}
+
+bool hasDefaultItemSaver(const QAbstractItemModel &model)
+{
+    return ItemLog::find(model) != nullptr;
+}
+
 void removeItems(const QString &tabName)
 {
     const QString tabFileName = itemFileName(tabName);
     QFile::remove(tabFileName);
+    QFile::remove( itemSearchIndexFileName(tabName) );
+    ItemBlobStore::removeReferences(tabFileName);
 }
 
 bool moveItems(const QString &oldId, const QString &newId)
@@ -155,7 +213,14 @@ bool moveItems(const QString &oldId, const QString &newId)
     const QString newFileName = itemFileName(newId);
 
     if ( oldFileName != newFileName && QFile::copy(oldFileName, newFileName) ) {
+        ItemBlobStore::moveReferences(oldFileName, newFileName);
         QFile::remove(oldFileName);
+
+        // Search index is optional.
+        const QString newIndexFileName = itemSearchIndexFileName(newId);
+        QFile::remove(newIndexFileName);
+        QFile::rename( itemSearchIndexFileName(oldId), newIndexFileName );
+
         return true;
     }
 
@@ -16,6 +16,22 @@ ItemSaverPtr loadItems(const QString &tabName, QAbstractItemModel &model //!< Mo
 bool saveItems(const QString &tabName, const QAbstractItemModel &model //!< Model containing items to save.
         , const ItemSaverPtr &saver);
 
+/** Return true if items are still being loaded in background (saving would block). */
+bool isLoadingItems(const QAbstractItemModel &model);
+
+/** Block until all items are loaded. */
+void waitForItemsLoaded(const QAbstractItemModel &model);
+
+/** Path to search index file for items (see ItemSearchIndex). */
+QString itemSearchIndexFileName(const QString &tabName);
+
+/**
+ * Return true only if items are saved by the default saver.
+ *
+ * Items saved by plugins (e.g. encrypted) must not be stored elsewhere.
+ */
+bool hasDefaultItemSaver(const QAbstractItemModel &model);
+
 /** Remove configuration file for items. */
 void removeItems(const QString &tabName //!< See ClipboardBrowser::getID().
         );
@@ -210,6 +210,15 @@ void ItemSaverInterface::setFocus(bool)
 {
 }
 
+bool ItemSaverInterface::isLoading() const
+{
+    return false;
+}
+
+void ItemSaverInterface::waitForLoaded()
+{
+}
+
 ItemWidget *ItemLoaderInterface::create(const QVariantMap &, QWidget *, bool) const
 {
     return nullptr;
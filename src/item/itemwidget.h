@@ -30,7 +30,7 @@ using ItemSaverPtr = std::shared_ptr<ItemSaverInterface>;
 class ItemScriptableFactoryInterface;
 using ItemScriptableFactoryPtr = std::shared_ptr<ItemScriptableFactoryInterface>;
 
-#define COPYQ_PLUGIN_ITEM_LOADER_ID "com.github.hluk.copyq.itemloader/6.3.2"
+#define COPYQ_PLUGIN_ITEM_LOADER_ID "com.github.hluk.copyq.itemloader/6.4.1"
 
 /**
  * Handles item in list.
@@ -64,6 +64,15 @@ public:
      */
     virtual void setTagged(bool) {}
 
+    /**
+     * Show different item data in the widget so it can be reused.
+     *
+     * Returns false if the data cannot be shown, i.e. the loader would not
+     * create a widget for the data, or if reusing the widget is not supported
+     * (default).
+     */
+    virtual bool rebind(const QVariantMap &) { return false; }
+
     ItemWidget(const ItemWidget &) = delete;
     ItemWidget &operator=(const ItemWidget &) = delete;
 
@@ -211,6 +220,16 @@ public:
 
     virtual void setFocus(bool focus);
 
+    /**
+     * Return true if items are still being loaded in background.
+     */
+    virtual bool isLoading() const;
+
+    /**
+     * Block until all items are loaded.
+     */
+    virtual void waitForLoaded();
+
     ItemSaverInterface(const ItemSaverInterface &) = delete;
     ItemSaverInterface &operator=(const ItemSaverInterface &) = delete;
 };
@@ -247,6 +266,12 @@ public:
      */
     virtual ItemWidget *create(const QVariantMap &data, QWidget *parent, bool preview) const;
 
+    /**
+     * Return true if widgets from create() implement ItemWidget::rebind()
+     * so these can be kept and reused for other items.
+     */
+    virtual bool canRebindItems() const { return false; }
+
     /**
      * Simple ID of plugin.
      *
@@ -342,6 +367,9 @@ public:
     /**
      * Return true if regular expression matches items content.
      * Returns false by default.
+     *
+     * Can be called from a background thread so it must only use the item
+     * data and not state changed by applySettings() or loadSettings().
      */
     virtual bool matches(const QModelIndex &index, const ItemFilter &filter) const;
 
@@ -0,0 +1,75 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "itemwidgetpool.h"
+
+#include "item/itemwidget.h"
+
+#include <QWidget>
+
+namespace {
+
+const char propertyLoaderId[] = "CopyQ_reusable_loader_id";
+const char propertyReuseCount[] = "CopyQ_reuse_count";
+
+QString reusableLoaderId(const ItemWidget &item)
+{
+    return item.widget()->property(propertyLoaderId).toString();
+}
+
+} // namespace
+
+ItemWidgetPool::ItemWidgetPool(int maxSize)
+    : m_maxSize(maxSize)
+{
+}
+
+ItemWidgetPool::~ItemWidgetPool() = default;
+
+ItemWidget *ItemWidgetPool::acquire(const QString &loaderId, const QVariantMap &data)
+{
+    for (auto it = m_items.rbegin(); it != m_items.rend(); ++it) {
+        if ( reusableLoaderId(**it) != loaderId )
+            continue;
+
+        // Widget which cannot show the data is not kept since the loader
+        // would not create widget for the data either.
+        std::unique_ptr<ItemWidget> item = std::move(*it);
+        m_items.erase( std::next(it).base() );
+        if ( !item->rebind(data) )
+            return nullptr;
+
+        QWidget *w = item->widget();
+        w->setProperty( propertyReuseCount, reuseCount(w) + 1 );
+        return item.release();
+    }
+
+    return nullptr;
+}
+
+void ItemWidgetPool::release(std::unique_ptr<ItemWidget> item)
+{
+    if ( !item || m_maxSize <= 0 || reusableLoaderId(*item).isEmpty() )
+        return;
+
+    // Drop palette of current item (see ItemDelegate::setItemWidgetCurrent()).
+    QWidget *w = item->widget();
+    w->hide();
+    w->setPalette(QPalette());
+    for (auto child : w->findChildren<QWidget *>())
+        child->setPalette(QPalette());
+
+    if ( static_cast<int>(m_items.size()) >= m_maxSize )
+        m_items.erase( m_items.begin() );
+
+    m_items.push_back( std::move(item) );
+}
+
+void ItemWidgetPool::setReusable(ItemWidget *item, const QString &loaderId)
+{
+    item->widget()->setProperty(propertyLoaderId, loaderId);
+}
+
+int ItemWidgetPool::reuseCount(const QWidget *widget)
+{
+    return widget->property(propertyReuseCount).toInt();
+}
@@ -0,0 +1,64 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef ITEMWIDGETPOOL_H
+#define ITEMWIDGETPOOL_H
+
+#include <QVariantMap>
+
+#include <memory>
+#include <vector>
+
+class ItemWidget;
+class QString;
+class QWidget;
+
+/**
+ * Keeps hidden item widgets so they can be reused for other items.
+ *
+ * Creating item widgets is expensive so instead of destroying widgets which
+ * are scrolled out of the view, these are kept here (up to maximum size) and
+ * rebound to data of newly shown items with ItemWidget::rebind().
+ *
+ * Only widgets marked with setReusable() are kept, i.e. widgets created
+ * directly by a loader which supports rebinding widgets
+ * (ItemLoaderInterface::canRebindItems()) and not wrapped by other loaders.
+ *
+ * The pool is owned by the item list which is recreated when settings
+ * change, so widgets created with old settings are not reused.
+ */
+class ItemWidgetPool final
+{
+public:
+    explicit ItemWidgetPool(int maxSize = 0);
+
+    ~ItemWidgetPool();
+
+    /**
+     * Returns the last released widget created by given loader with new data
+     * or nullptr if there is no such widget or it cannot show the data.
+     */
+    ItemWidget *acquire(const QString &loaderId, const QVariantMap &data);
+
+    /**
+     * Hides the widget and keeps it for later reuse.
+     *
+     * The widget is destroyed if it is not reusable. If the pool is full,
+     * the oldest widget is destroyed.
+     */
+    void release(std::unique_ptr<ItemWidget> item);
+
+    /// Marks widget created by given loader as reusable.
+    static void setReusable(ItemWidget *item, const QString &loaderId);
+
+    /// Returns how many times the widget was reused for a different item.
+    static int reuseCount(const QWidget *widget);
+
+    ItemWidgetPool(const ItemWidgetPool &) = delete;
+    ItemWidgetPool &operator=(const ItemWidgetPool &) = delete;
+
+private:
+    std::vector<std::unique_ptr<ItemWidget>> m_items;
+    const int m_maxSize;
+};
+
+#endif // ITEMWIDGETPOOL_H
@@ -3,6 +3,9 @@
 #include "persistentdisplayitem.h"
 
 #include "item/itemdelegate.h"
+#include "item/itemwidgetpool.h"
+
+#include <QWidget>
 
 PersistentDisplayItem::PersistentDisplayItem(ItemDelegate *delegate,
         const QVariantMap &data,
@@ -10,6 +13,7 @@ PersistentDisplayItem::PersistentDisplayItem(ItemDelegate *delegate,
     : m_data(data)
     , m_widget(widget)
     , m_delegate(delegate)
+    , m_reuseCount(ItemWidgetPool::reuseCount(widget))
 {
 }
 
@@ -18,6 +22,9 @@ bool PersistentDisplayItem::isValid()
     if ( m_widget.isNull() || m_delegate.isNull() )
         return false;
 
+    if ( ItemWidgetPool::reuseCount(m_widget) != m_reuseCount )
+        return false;
+
     return !m_delegate->invalidateHidden( m_widget.data() );
 }
 
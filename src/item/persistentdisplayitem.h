@@ -34,7 +34,8 @@ public:
     const QVariantMap &data() const noexcept { return m_data; }
 
     /**
-     * Returns true only if display item widget is still available.
+     * Returns true only if display item widget is still available
+     * (and not reused for another item).
      */
     bool isValid();
 
@@ -49,6 +50,7 @@ private:
     QVariantMap m_data;
     QPointer<QWidget> m_widget;
     QPointer<ItemDelegate> m_delegate;
+    int m_reuseCount = 0;
 };
 
 Q_DECLARE_METATYPE(PersistentDisplayItem)
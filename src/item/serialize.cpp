@@ -5,6 +5,7 @@
 #include "common/contenttype.h"
 #include "common/log.h"
 #include "common/mimetypes.h"
+#include "item/itempayload.h"
 
 #include <QAbstractItemModel>
 #include <QByteArray>
@@ -12,12 +13,31 @@
 #include <QIODevice>
 #include <QList>
 #include <QPair>
+#include <QRunnable>
+#include <QSemaphore>
 #include <QStringList>
+#include <QThread>
+#include <QThreadPool>
 
+#include <limits>
 #include <unordered_map>
 
 namespace {
 
+/// How data in a format are stored (v2); originally only a compression flag.
+enum DataStorage : quint8 {
+    StorageRaw = 0,
+    StorageCompressed = 1,
+    /// Data are stored in ItemBlobStorage, the serialized bytes are the digest.
+    StorageBlob = 2,
+};
+
+/// Smaller data are not worth compressing.
+const int minCompressSize = 512;
+
+/// Minimum number of items to compress in a separate thread.
+const int minItemsPerCompressTask = 16;
+
 template <typename T>
 bool readOrError(QDataStream *out, T *value, const char *error)
 {
@@ -92,22 +112,206 @@ QString compressMime(const QString &mime)
     return "0" + mime;
 }
 
-bool deserializeDataV2(QDataStream *out, QVariantMap *data)
+bool isCompressible(const QString &mime, int size)
+{
+    if (size < minCompressSize)
+        return false;
+
+    if ( mime.startsWith(QLatin1String("text/")) )
+        return true;
+
+    // Skip formats which are already compressed (PNG, JPEG, GIF ...).
+    static const QStringList formats{
+        QLatin1String(mimeItemNotes),
+        QStringLiteral("application/json"),
+        QStringLiteral("application/xml"),
+        QStringLiteral("image/bmp"),
+        QStringLiteral("image/svg+xml"),
+        QStringLiteral("image/x-bmp"),
+        QStringLiteral("image/x-ms-bmp"),
+        QStringLiteral("image/x-portable-pixmap"),
+        QStringLiteral("image/x-xpixmap"),
+        QStringLiteral("image/x-xbitmap"),
+    };
+    return formats.contains(mime);
+}
+
+void serializeData(
+        QDataStream *stream, const QVariantMap &data, bool compress,
+        const ItemBlobStorage *blobStorage, QSet<QByteArray> *blobs)
+{
+    if (!blobStorage)
+        blobs = nullptr;
+
+    *stream << static_cast<qint32>(-2);
+
+    const qint32 size = data.size();
+    *stream << size;
+
+    QByteArray bytes;
+    for (auto it = data.constBegin(); it != data.constEnd(); ++it) {
+        const auto &mime = it.key();
+        const auto &value = it.value();
+
+        // Data left in tab file are written without copying them to memory.
+        if ( value.userType() == qMetaTypeId<ItemPayload>() ) {
+            const auto payload = value.value<ItemPayload>();
+            if ( compress && !blobs && payload.isCompressed() ) {
+                *stream << compressMime(mime)
+                        << static_cast<quint8>(StorageCompressed)
+                        << payload.storedBytes();
+                continue;
+            }
+            bytes = payload.rawBytes();
+        } else {
+            bytes = value.toByteArray();
+        }
+
+        const bool compressible = compress && isCompressible(mime, bytes.size());
+
+        DataStorage storage = StorageRaw;
+        if ( blobs && bytes.size() >= blobStorage->minSize() ) {
+            const QByteArray digest = blobStorage->store(bytes, compressible);
+            if ( !digest.isEmpty() ) {
+                blobs->insert(digest);
+                bytes = digest;
+                storage = StorageBlob;
+            }
+        }
+
+        if (storage == StorageRaw && compressible) {
+            QByteArray compressed = qCompress(bytes);
+            if ( compressed.size() < bytes.size() ) {
+                bytes = compressed;
+                storage = StorageCompressed;
+            }
+        }
+
+        *stream << compressMime(mime)
+                << static_cast<quint8>(storage)
+                << bytes;
+    }
+}
+
+class CompressTask final : public QRunnable
+{
+public:
+    CompressTask(
+            const QVariantMap *items, QByteArray *result, int count,
+            const ItemBlobStorage *blobStorage, QSet<QByteArray> *itemBlobs, QSemaphore *done)
+        : m_items(items)
+        , m_result(result)
+        , m_count(count)
+        , m_blobStorage(blobStorage)
+        , m_itemBlobs(itemBlobs)
+        , m_done(done)
+    {
+    }
+
+    void run() override
+    {
+        for (int i = 0; i < m_count; ++i)
+            m_result[i] = serializeDataCompressed(
+                m_items[i], m_blobStorage, m_itemBlobs ? &m_itemBlobs[i] : nullptr);
+        m_done->release();
+    }
+
+private:
+    const QVariantMap *m_items;
+    QByteArray *m_result;
+    int m_count;
+    const ItemBlobStorage *m_blobStorage;
+    QSet<QByteArray> *m_itemBlobs;
+    QSemaphore *m_done;
+};
+
+bool readPayload(QDataStream *out, const ItemPayloadFilePtr &payloadFile, bool compress, QVariant *value)
+{
+    quint32 size;
+    if ( !readOrError(out, &size, "Failed to read item data size (v2)") )
+        return false;
+
+    // Same as null QByteArray in QDataStream.
+    if (size == 0xffffffff) {
+        *value = QByteArray();
+        return true;
+    }
+
+    if ( size < static_cast<quint32>(ItemPayload::minSize()) ) {
+        QByteArray bytes(static_cast<int>(size), Qt::Uninitialized);
+        if ( out->readRawData(bytes.data(), bytes.size()) != bytes.size() ) {
+            log("Corrupted data: Failed to read item data (v2)", LogError);
+            out->setStatus(QDataStream::ReadPastEnd);
+            return false;
+        }
+        if (compress) {
+            bytes = qUncompress(bytes);
+            if ( bytes.isEmpty() ) {
+                log("Corrupted data: Failed to decompress data (v2)", LogError);
+                out->setStatus(QDataStream::ReadCorruptData);
+                return false;
+            }
+        }
+        *value = bytes;
+        return true;
+    }
+
+    // Large compressed data are decompressed only when needed.
+    const ItemPayload payload(payloadFile, out->device()->pos(), static_cast<int>(size), compress);
+    if ( !payload.isValid() || out->skipRawData(payload.size()) != payload.size() ) {
+        log("Corrupted data: Item data out of range (v2)", LogError);
+        out->setStatus(QDataStream::ReadCorruptData);
+        return false;
+    }
+
+    *value = QVariant::fromValue(payload);
+    return true;
+}
+
+bool deserializeDataV2(
+        QDataStream *out, QVariantMap *data, const ItemPayloadFilePtr &payloadFile,
+        const ItemBlobStorage *blobStorage)
 {
     qint32 size;
     if ( !readOrError(out, &size, "Failed to read size (v2)") )
         return false;
 
     QByteArray tmpBytes;
-    bool compress;
+    quint8 storage;
     for (qint32 i = 0; i < size; ++i) {
         const QString mime = decompressMime(out);
         if ( out->status() != QDataStream::Ok )
             return false;
 
-        if ( !readOrError(out, &compress, "Failed to read compression flag (v2)") )
+        if ( !readOrError(out, &storage, "Failed to read data storage (v2)") )
             return false;
 
+        if (storage == StorageBlob) {
+            if ( !readOrError(out, &tmpBytes, "Failed to read blob digest (v2)") )
+                return false;
+
+            // Keep other data if a blob is missing.
+            QVariant value;
+            if ( blobStorage && blobStorage->load(tmpBytes, &value) )
+                data->insert(mime, value);
+            continue;
+        }
+
+        if (storage != StorageRaw && storage != StorageCompressed) {
+            log("Corrupted data: Unknown data storage (v2)", LogError);
+            out->setStatus(QDataStream::ReadCorruptData);
+            return false;
+        }
+
+        const bool compress = storage == StorageCompressed;
+        if (payloadFile) {
+            QVariant value;
+            if ( !readPayload(out, payloadFile, compress, &value) )
+                return false;
+            data->insert(mime, value);
+            continue;
+        }
+
         if ( !readOrError(out, &tmpBytes, "Failed to read item data (v2)") )
             return false;
 
@@ -129,22 +333,17 @@ bool deserializeDataV2(QDataStream *out, QVariantMap *data)
 
 void serializeData(QDataStream *stream, const QVariantMap &data)
 {
-    *stream << static_cast<qint32>(-2);
-
-    const qint32 size = data.size();
-    *stream << size;
-
-    QByteArray bytes;
-    for (auto it = data.constBegin(); it != data.constEnd(); ++it) {
-        const auto &mime = it.key();
-        bytes = data[mime].toByteArray();
-        *stream << compressMime(mime)
-                << /* compressData = */ false
-                << bytes;
-    }
+    serializeData(stream, data, false, nullptr, nullptr);
 }
 
 bool deserializeData(QDataStream *stream, QVariantMap *data)
+{
+    return deserializeData(stream, data, nullptr);
+}
+
+bool deserializeData(
+        QDataStream *stream, QVariantMap *data, const ItemPayloadFilePtr &payloadFile,
+        const ItemBlobStorage *blobStorage)
 {
     try {
         qint32 length;
@@ -152,7 +351,7 @@ bool deserializeData(QDataStream *stream, QVariantMap *data)
             return false;
 
         if (length == -2)
-            return deserializeDataV2(stream, data);
+            return deserializeDataV2(stream, data, payloadFile, blobStorage);
 
         if (length < 0) {
             log("Corrupted data: Invalid length (v1)", LogError);
@@ -204,6 +403,102 @@ bool deserializeData(QVariantMap *data, const QByteArray &bytes)
     return deserializeData(&out, data);
 }
 
+QByteArray serializeDataCompressed(
+        const QVariantMap &data, const ItemBlobStorage *blobStorage, QSet<QByteArray> *blobs)
+{
+    QByteArray bytes;
+    QDataStream out(&bytes, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_4_7);
+    serializeData(&out, data, true, blobStorage, blobs);
+    return bytes;
+}
+
+QVector<QByteArray> serializeDataCompressed(
+        const QVector<QVariantMap> &items,
+        const ItemBlobStorage *blobStorage, QVector<QSet<QByteArray>> *itemBlobs)
+{
+    QVector<QByteArray> result(items.size());
+    const int taskCount = qBound(
+        1, items.size() / minItemsPerCompressTask, QThread::idealThreadCount());
+    const int itemsPerTask = (items.size() + taskCount - 1) / taskCount;
+
+    // Each item has separate blob digests so tasks do not share any.
+    if (itemBlobs) {
+        itemBlobs->clear();
+        itemBlobs->resize(items.size());
+    }
+    QSet<QByteArray> *blobs = itemBlobs ? itemBlobs->data() : nullptr;
+
+    // The first range is processed in the current thread.
+    QSemaphore done;
+    int startedTasks = 0;
+    for (int begin = itemsPerTask; begin < items.size(); begin += itemsPerTask) {
+        const int count = qMin(itemsPerTask, items.size() - begin);
+        ++startedTasks;
+        QThreadPool::globalInstance()->start( new CompressTask(
+            items.constData() + begin, result.data() + begin, count,
+            blobStorage, blobs ? blobs + begin : nullptr, &done) );
+    }
+
+    for (int i = 0; i < qMin(itemsPerTask, items.size()); ++i)
+        result[i] = serializeDataCompressed(items[i], blobStorage, blobs ? blobs + i : nullptr);
+
+    done.acquire(startedTasks);
+
+    return result;
+}
+
+bool readBlobDigests(QDataStream *stream, QSet<QByteArray> *digests)
+{
+    qint32 length;
+    if ( !readOrError(stream, &length, "Failed to read length") )
+        return false;
+
+    // Only the newer format can reference blobs.
+    if (length != -2)
+        return true;
+
+    qint32 size;
+    if ( !readOrError(stream, &size, "Failed to read size (v2)") )
+        return false;
+
+    QString mime;
+    quint8 storage;
+    QByteArray digest;
+    quint32 dataSize;
+    for (qint32 i = 0; i < size; ++i) {
+        if ( !readOrError(stream, &mime, "Failed to read MIME type (v2)")
+             || !readOrError(stream, &storage, "Failed to read data storage (v2)") )
+        {
+            return false;
+        }
+
+        if (storage == StorageBlob) {
+            if ( !readOrError(stream, &digest, "Failed to read blob digest (v2)") )
+                return false;
+            digests->insert(digest);
+            continue;
+        }
+
+        if ( !readOrError(stream, &dataSize, "Failed to read item data size (v2)") )
+            return false;
+
+        // Same as null QByteArray in QDataStream.
+        if (dataSize == 0xffffffff)
+            continue;
+
+        if ( dataSize > static_cast<quint32>(std::numeric_limits<int>::max())
+             || stream->skipRawData(static_cast<int>(dataSize)) != static_cast<int>(dataSize) )
+        {
+            log("Corrupted data: Item data out of range (v2)", LogError);
+            stream->setStatus(QDataStream::ReadCorruptData);
+            return false;
+        }
+    }
+
+    return stream->status() == QDataStream::Ok;
+}
+
 bool serializeData(const QAbstractItemModel &model, QDataStream *stream)
 {
     qint32 length = model.rowCount();
@@ -3,18 +3,82 @@
 #ifndef SERIALIZE_H
 #define SERIALIZE_H
 
+#include <QSet>
 #include <QVariantMap>
+#include <QVector>
 
+#include <memory>
+
+class ItemPayloadFile;
 class QAbstractItemModel;
 class QByteArray;
 class QDataStream;
 class QIODevice;
+class QVariant;
+
+/**
+ * Storage for large item data referenced from serialized items by digest.
+ *
+ * Serializer itself does not store anything outside of the serialized bytes,
+ * the storage is provided by the caller (see ItemBlobStore used by ItemLog).
+ *
+ * Functions can be called from multiple threads.
+ */
+class ItemBlobStorage
+{
+public:
+    virtual ~ItemBlobStorage() = default;
+
+    /// Smaller data are stored directly in the serialized item.
+    virtual int minSize() const = 0;
+
+    /// Stores data and returns its digest (empty on failure).
+    virtual QByteArray store(const QByteArray &bytes, bool compress) const = 0;
+
+    virtual bool load(const QByteArray &digest, QVariant *value) const = 0;
+};
 
 void serializeData(QDataStream *stream, const QVariantMap &data);
 bool deserializeData(QDataStream *stream, QVariantMap *data);
+/**
+ * Leaves large data in mapped file (see ItemPayload), the stream must read the same file.
+ *
+ * Data referenced by digest are loaded from @a blobStorage (skipped if not set).
+ */
+bool deserializeData(
+        QDataStream *stream, QVariantMap *data, const std::shared_ptr<ItemPayloadFile> &payloadFile,
+        const ItemBlobStorage *blobStorage = nullptr);
 QByteArray serializeData(const QVariantMap &data);
 bool deserializeData(QVariantMap *data, const QByteArray &bytes);
 
+/**
+ * Serializes item data for storing in tab file.
+ *
+ * Unlike serializeData(), larger data in formats which usually compress well
+ * (text, HTML, uncompressed images) are compressed.
+ *
+ * If @a blobStorage and @a blobs are set, large data are stored in
+ * @a blobStorage and digests of the referenced blobs are added to @a blobs.
+ *
+ * Result can be read with deserializeData(QDataStream*, ...).
+ */
+QByteArray serializeDataCompressed(
+        const QVariantMap &data,
+        const ItemBlobStorage *blobStorage = nullptr, QSet<QByteArray> *blobs = nullptr);
+/**
+ * Same as above for multiple items, compresses data in parallel.
+ *
+ * If @a blobStorage and @a itemBlobs are set, large data are stored in
+ * @a blobStorage and @a itemBlobs contains digests of the referenced blobs
+ * for each item.
+ */
+QVector<QByteArray> serializeDataCompressed(
+        const QVector<QVariantMap> &items,
+        const ItemBlobStorage *blobStorage = nullptr, QVector<QSet<QByteArray>> *itemBlobs = nullptr);
+
+/// Reads digests of blobs referenced by serialized item without loading any data.
+bool readBlobDigests(QDataStream *stream, QSet<QByteArray> *digests);
+
 bool serializeData(const QAbstractItemModel &model, QDataStream *stream);
 bool deserializeData(QAbstractItemModel *model, QDataStream *stream, int maxItems);
 bool serializeData(const QAbstractItemModel &model, QIODevice *file);
@@ -171,6 +171,14 @@ QList<CommandHelp> commandHelp()
             << CommandHelp("eval, -e", Scriptable::tr("Evaluate script."))
                .addArg("[" + Scriptable::tr("SCRIPT") + "]")
                .addArg("[" + Scriptable::tr("ARGUMENTS") + "]...")
+            << CommandHelp("trace",
+                           Scriptable::tr("Start recording performance trace of the server."))
+               .addArg("start")
+            << CommandHelp("trace",
+                           Scriptable::tr("Stop recording and save trace to file\n"
+                                          "(Chrome trace format, can be opened in Perfetto)."))
+               .addArg("stop")
+               .addArg(Scriptable::tr("FILE_NAME"))
             << CommandHelp("session, -s, --session",
                            Scriptable::tr("Starts or connects to application instance with given session name."))
                .addArg(Scriptable::tr("SESSION"))
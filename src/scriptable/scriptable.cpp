@@ -8,10 +8,12 @@
 #include "common/commandstatus.h"
 #include "common/commandstore.h"
 #include "common/common.h"
+#include "common/imagedata.h"
 #include "common/log.h"
 #include "common/sleeptimer.h"
 #include "common/version.h"
 #include "common/textdata.h"
+#include "common/trace.h"
 #include "gui/clipboardspy.h"
 #include "gui/icons.h"
 #include "item/itemfactory.h"
@@ -67,10 +69,19 @@ namespace {
 
 const QLatin1String mimeIgnore(COPYQ_MIME_PREFIX "ignore");
 
+// Item data are passed to and from server in parts of this size.
+const int itemDataChunkSize = 4 * 1024 * 1024;
+
+// Number of following rows fetched at once when read() is called for consecutive rows.
+const int readAheadRowCount = 16;
+// Larger item data are not read ahead.
+const int readAheadMaxItemDataSize = 64 * 1024;
+
 class PerformanceLogger {
 public:
     explicit PerformanceLogger(const QString &label)
         : m_label(label)
+        , m_span("script", "script", [&]{ return label; })
     {
         m_timer.start();
     }
@@ -101,6 +112,7 @@ private:
 
     QString m_label;
     QElapsedTimer m_timer;
+    TraceSpan m_span;
 };
 
 QString helpHead()
@@ -507,28 +519,18 @@ bool matchData(const QRegularExpression &re, const QVariantMap &data, const QStr
     return text.contains(re);
 }
 
-bool isInternalDataFormat(const QString &format)
+/// Returns only given formats from item data, converting lazy image formats.
+QVariantMap convertImageFormats(const QVariantMap &data, const QStringList &formats)
 {
-    return format == mimeWindowTitle
-        || format == mimeItems
-        || format == mimeOwner
-        || format == mimeClipboardMode
-        || format == mimeCurrentTab
-        || format == mimeSelectedItems
-        || format == mimeCurrentItem
-        || format == mimeShortcut
-        || format == mimeOutputTab;
-}
-
-QVariantMap copyWithoutInternalData(const QVariantMap &data) {
-    QVariantMap newData;
-    for (auto it = data.constBegin(); it != data.constEnd(); ++it) {
-        const auto &format = it.key();
-        if ( !isInternalDataFormat(format) )
-            newData.insert(format, it.value());
+    QVariantMap result;
+    for (const auto &format : formats) {
+        const auto it = data.constFind(format);
+        if ( it != data.constEnd() )
+            result.insert( format, it.value() );
+        else if ( hasDataFormat(data, format) )
+            result.insert( format, convertImageData(data, format) );
     }
-
-    return newData;
+    return result;
 }
 
 QJSValue checksumForArgument(Scriptable *scriptable, QCryptographicHash::Algorithm method)
@@ -1272,6 +1274,8 @@ void Scriptable::forceUnload()
 QJSValue Scriptable::length()
 {
     m_skipArguments = 0;
+    if ( isReadAheadValid() && m_readAhead.tabName == m_tabName )
+        return m_readAhead.length;
     return m_proxy->browserLength(m_tabName);
 }
 
@@ -1345,12 +1349,28 @@ void Scriptable::edit()
     int row = -1;
 
     const int len = argumentCount();
+
+    // Item texts are fetched in a single message.
+    QVector<int> resultIndexes(len, -1);
+    {
+        ScriptableProxyBatch batch(m_proxy);
+        for ( int i = 0; i < len; ++i ) {
+            if ( toInt(argument(i), &row) && row >= 0 )
+                resultIndexes[i] = m_proxy->queueBrowserItemData(m_tabName, row, mimeText);
+        }
+        const QStringList errors = batch.finish();
+        if ( !errors.isEmpty() ) {
+            throwError( errors.join('\n') );
+            return;
+        }
+    }
+
     for ( int i = 0; i < len; ++i ) {
         value = argument(i);
         if (i > 0)
             text.append(m_inputSeparator);
         if ( toInt(value, &row) ) {
-            const QByteArray bytes = row >= 0 ? m_proxy->browserItemData(m_tabName, row, mimeText)
+            const QByteArray bytes = row >= 0 ? m_proxy->batchResult(resultIndexes[i]).toByteArray()
                                               : getClipboardData(mimeText);
             text.append( getTextData(bytes) );
         } else {
@@ -1361,6 +1381,7 @@ void Scriptable::edit()
     bool changeClipboard = row < 0;
 
     if ( !m_proxy->browserOpenEditor(m_tabName, fromString(text), changeClipboard) ) {
+        ScriptableProxyBatch batch(m_proxy);
         m_proxy->showBrowser(m_tabName);
         if (len == 1 && row >= 0) {
             m_proxy->browserSetCurrent(m_tabName, row);
@@ -1368,6 +1389,9 @@ void Scriptable::edit()
         } else {
             m_proxy->browserEditNew(m_tabName, text, changeClipboard);
         }
+        const QStringList errors = batch.finish();
+        if ( !errors.isEmpty() )
+            throwError( errors.join('\n') );
     }
 }
 
@@ -1375,31 +1399,172 @@ QJSValue Scriptable::read()
 {
     m_skipArguments = -1;
 
-    QByteArray result;
     QString mime(mimeText);
     QJSValue value;
 
-    bool used = false;
+    // Formats requested for each row argument.
+    QVector<QPair<int, QString>> requests;
     for ( int i = 0; i < argumentCount(); ++i ) {
         value = argument(i);
         int row;
-        if ( toInt(value, &row) ) {
-            if (used)
-                result.append( m_inputSeparator.toUtf8() );
-            used = true;
-            result.append( row >= 0 ? m_proxy->browserItemData(m_tabName, row, mime)
-                                    : getClipboardData(mime) );
-        } else {
+        if ( toInt(value, &row) )
+            requests.append({row, mime});
+        else
             mime = toString(value);
-        }
     }
 
-    if (!used)
-        result.append( getClipboardData(mime) );
+    if ( requests.isEmpty() )
+        return newByteArray( getClipboardData(mime) );
+
+    if ( requests.size() == 1 ) {
+        const int row = requests[0].first;
+        return newByteArray( row >= 0 ? readItemData(row, requests[0].second)
+                                      : getClipboardData(requests[0].second) );
+    }
+
+    // Fetch all items at once.
+    QVector<int> rows;
+    QStringList formats;
+    bool allFormats = false;
+    for (const auto &request : requests) {
+        if (request.first < 0)
+            continue;
+        rows.append(request.first);
+        allFormats = allFormats || request.second == "?" || request.second == mimeItems;
+        if ( !formats.contains(request.second) )
+            formats.append(request.second);
+    }
+    const QVector<QVariantMap> dataList = rows.isEmpty()
+        ? QVector<QVariantMap>()
+        : m_proxy->browserItemsData(m_tabName, rows, allFormats ? QStringList() : formats);
+
+    QByteArray result;
+    int dataIndex = 0;
+    for (int i = 0; i < requests.size(); ++i) {
+        if (i > 0)
+            result.append( m_inputSeparator.toUtf8() );
+        const auto &request = requests[i];
+        result.append( request.first >= 0
+                       ? itemDataForFormat(dataList.value(dataIndex++), request.second)
+                       : getClipboardData(request.second) );
+    }
 
     return newByteArray(result);
 }
 
+QByteArray Scriptable::readItemData(int row, const QString &format)
+{
+    // Server sends the source image and lazy image formats are converted here.
+    if ( format.startsWith(QLatin1String("image/")) ) {
+        const auto imageFormats = m_proxy->browserItemsData(m_tabName, {row}, {mimeImageFormats});
+        if ( lazyImageFormats(imageFormats.value(0)).contains(format) ) {
+            const auto dataList = m_proxy->browserItemsData(m_tabName, {row}, {format});
+            return dataForFormat(dataList.value(0), format);
+        }
+    }
+
+    const int readAheadIndex = row - m_readAhead.firstRow;
+    const bool hasReadAhead = isReadAheadValid()
+        && m_readAhead.tabName == m_tabName
+        && m_readAhead.format == format
+        && readAheadIndex >= 0 && readAheadIndex < m_readAhead.data.size();
+
+    // Fetch following rows only if rows are read one by one.
+    const bool isNextRow = row == m_readAhead.lastRow + 1
+        && m_readAhead.tabName == m_tabName
+        && m_readAhead.format == format;
+    m_readAhead.lastRow = row;
+    m_readAhead.tabName = m_tabName;
+    m_readAhead.format = format;
+
+    if (hasReadAhead) {
+        const QByteArray &cachedData = m_readAhead.data[readAheadIndex];
+        if (cachedData.size() < readAheadMaxItemDataSize)
+            return cachedData;
+    } else if (isNextRow) {
+        readAhead(row, format);
+        if ( isReadAheadValid() && !m_readAhead.data.isEmpty()
+             && m_readAhead.data[0].size() < readAheadMaxItemDataSize )
+        {
+            return m_readAhead.data[0];
+        }
+    }
+
+    QByteArray data = m_proxy->browserItemDataChunk(m_tabName, row, format, 0, itemDataChunkSize);
+    if (data.size() < itemDataChunkSize)
+        return data;
+
+    // Avoid growing the buffer while receiving large data.
+    data.reserve( m_proxy->browserItemDataSize(m_tabName, row, format) );
+    for (;;) {
+        const QByteArray chunk = m_proxy->browserItemDataChunk(
+            m_tabName, row, format, data.size(), itemDataChunkSize);
+        data.append(chunk);
+        if (chunk.size() < itemDataChunkSize)
+            break;
+    }
+
+    return data;
+}
+
+void Scriptable::readAhead(int row, const QString &format)
+{
+    m_readAhead.data.clear();
+    m_readAhead.firstRow = row;
+
+    ScriptableProxyBatch batch(m_proxy);
+    const int lengthIndex = m_proxy->queueBrowserLength(m_tabName);
+    QVector<int> dataIndexes;
+    for (int i = 0; i < readAheadRowCount; ++i) {
+        dataIndexes.append( m_proxy->queueBrowserItemDataChunk(
+            m_tabName, row + i, format, 0, readAheadMaxItemDataSize) );
+    }
+    const QStringList errors = batch.finish();
+    if ( !errors.isEmpty() ) {
+        m_readAhead.functionCallId = -2;
+        return;
+    }
+
+    m_readAhead.length = m_proxy->batchResult(lengthIndex).toInt();
+    for (int i = 0; i < dataIndexes.size() && row + i < m_readAhead.length; ++i)
+        m_readAhead.data.append( m_proxy->batchResult(dataIndexes[i]).toByteArray() );
+    m_readAhead.functionCallId = m_proxy->lastFunctionCallId();
+}
+
+bool Scriptable::isReadAheadValid() const
+{
+    // Any other call to server can change the items.
+    return m_readAhead.functionCallId == m_proxy->lastFunctionCallId();
+}
+
+int Scriptable::sendLargeItemData(QVector<QVariantMap> *items)
+{
+    int transferId = -1;
+    for (int i = 0; i < items->size(); ++i) {
+        auto &item = (*items)[i];
+        for (auto it = item.begin(); it != item.end(); ++it) {
+            if ( it.value().userType() != QMetaType::QByteArray )
+                continue;
+
+            const QByteArray bytes = it.value().toByteArray();
+            if (bytes.size() <= itemDataChunkSize)
+                continue;
+
+            if (transferId == -1)
+                transferId = ++m_lastItemDataTransferId;
+
+            // Placeholder is replaced by the data on server.
+            it.value() = QByteArray();
+            for (int offset = 0; offset < bytes.size(); offset += itemDataChunkSize) {
+                m_proxy->appendItemDataChunk(
+                    transferId, i, it.key(), bytes.mid(offset, itemDataChunkSize));
+            }
+        }
+    }
+
+    return transferId;
+}
+
 QJSValue Scriptable::write()
 {
     m_skipArguments = -1;
@@ -1425,16 +1590,23 @@ void Scriptable::action()
     int i;
     QJSValue value;
 
+    QVector<int> rows;
     for ( i = 0; i < argumentCount(); ++i ) {
         value = argument(i);
         int row;
         if (!toInt(value, &row))
             break;
-        if (anyRows)
-            text.append(m_inputSeparator);
-        else
-            anyRows = true;
-        text.append( getTextData(m_proxy->browserItemData(m_tabName, row, mimeText)) );
+        rows.append(row);
+    }
+
+    if ( !rows.isEmpty() ) {
+        anyRows = true;
+        const auto dataList = m_proxy->browserItemsData(m_tabName, rows, {mimeText});
+        for (int j = 0; j < dataList.size(); ++j) {
+            if (j > 0)
+                text.append(m_inputSeparator);
+            text.append( getTextData(dataList[j].value(mimeText).toByteArray()) );
+        }
     }
 
     QString cmd = toString(value);
@@ -1817,13 +1989,13 @@ QJSValue Scriptable::fromUnicode()
 QJSValue Scriptable::dataFormats()
 {
     m_skipArguments = 0;
-    return toScriptValue( m_data.keys(), this );
+    return toScriptValue( availableDataFormats(m_data), this );
 }
 
 QJSValue Scriptable::data()
 {
     m_skipArguments = 1;
-    return newByteArray( m_data.value(arg(0)).toByteArray() );
+    return newByteArray( dataForFormat(m_data, arg(0)) );
 }
 
 QJSValue Scriptable::setData()
@@ -1857,7 +2029,8 @@ void Scriptable::print()
 void Scriptable::abort()
 {
     m_skipArguments = 0;
-    abortEvaluation(m_action ? Abort::CurrentEvaluation : Abort::AllEvaluations);
+    abortEvaluation(m_action || m_runningWorkerCallback
+                    ? Abort::CurrentEvaluation : Abort::AllEvaluations);
 }
 
 void Scriptable::fail()
@@ -1948,6 +2121,30 @@ QJSValue Scriptable::logs()
     return QString::fromUtf8(readLogFile(50 * 1024 * 1024));
 }
 
+QJSValue Scriptable::trace()
+{
+    m_skipArguments = 2;
+
+    const QString action = arg(0);
+    if (action == QLatin1String("start")) {
+        m_proxy->startTracing();
+        return QJSValue();
+    }
+
+    if (action == QLatin1String("stop")) {
+        const QString filePath = arg(1);
+        if ( filePath.isEmpty() )
+            return throwError(argumentError());
+
+        if ( !m_proxy->stopTracing(getAbsoluteFilePath(filePath)) )
+            return throwError( tr("Tracing is not started or trace file \"%1\" cannot be saved!").arg(filePath) );
+
+        return QJSValue();
+    }
+
+    return throwError(argumentError());
+}
+
 void Scriptable::setCurrentTab()
 {
     m_skipArguments = 1;
@@ -2047,6 +2244,30 @@ QJSValue Scriptable::getItem()
     return toScriptValue( m_proxy->browserItemData(m_tabName, row), this );
 }
 
+QJSValue Scriptable::getItems()
+{
+    m_skipArguments = 2;
+
+    QVector<int> rows;
+    if ( !argument(0).isUndefined() ) {
+        rows = fromScriptValue<QVector<int>>( argument(0), this );
+        if ( rows.isEmpty() )
+            return toScriptValue( QVector<QVariantMap>(), this );
+    }
+
+    const QStringList formats = argument(1).isUndefined()
+        ? QStringList()
+        : fromScriptValue<QStringList>( argument(1), this );
+
+    QVector<QVariantMap> dataList = m_proxy->browserItemsData(m_tabName, rows, formats);
+    if ( !formats.isEmpty() ) {
+        for (auto &data : dataList)
+            data = convertImageFormats(data, formats);
+    }
+
+    return toScriptValue(dataList, this);
+}
+
 void Scriptable::setItem()
 {
     insert(2);
@@ -2600,20 +2821,7 @@ void Scriptable::saveData()
 
 QJSValue Scriptable::hasData()
 {
-    for (auto it = m_data.constBegin(); it != m_data.constEnd(); ++it) {
-        const auto &format = it.key();
-        if ( isInternalDataFormat(format) )
-            continue;
-
-        auto bytes = it.value().toByteArray();
-        for (const auto &byte : bytes) {
-            const QChar c(byte);
-            if ( !c.isSpace() && !c.isNull() )
-                return true;
-        }
-    }
-
-    return false;
+    return hasNonEmptyData(m_data);
 }
 
 void Scriptable::showDataNotification()
@@ -2652,6 +2860,11 @@ QJSValue Scriptable::runAutomaticCommands()
     return runCommands(CommandType::Automatic);
 }
 
+QJSValue Scriptable::automaticCommandStatistics()
+{
+    return toScriptValue( m_proxy->automaticCommandStatistics(), this );
+}
+
 void Scriptable::runDisplayCommands()
 {
     QEventLoop loop;
@@ -2695,6 +2908,59 @@ void Scriptable::runDisplayCommands()
         loop.exec();
 }
 
+void Scriptable::runScriptWorker()
+{
+    // Each event must start with the same global state, as in a new process.
+    m_workerGlobals.clear();
+    QJSValueIterator globalIt( engine()->globalObject() );
+    while ( globalIt.hasNext() ) {
+        globalIt.next();
+        m_workerGlobals.insert( globalIt.name(), globalIt.value() );
+    }
+
+    QEventLoop loop;
+    connect(this, &Scriptable::finished, &loop, [&]() {
+        if (m_abort == Abort::AllEvaluations)
+            loop.exit();
+    });
+
+    QTimer timer;
+    timer.setSingleShot(true);
+    timer.setInterval(0);
+    connect(this, &Scriptable::dataReceived, &loop, [&](const QByteArray &receivedBytes) {
+        if (receivedBytes == "ABORT") {
+            abortEvaluation(Abort::AllEvaluations);
+            return;
+        }
+
+        timer.start();
+    });
+
+    bool running = false;
+    connect(&timer, &QTimer::timeout, &loop, [&]() {
+        if (running)
+            return;
+        running = true;
+
+        while ( m_abort != Abort::AllEvaluations ) {
+            const QVariantMap event = m_proxy->takeScriptWorkerEvent(m_actionId);
+            if ( event.isEmpty() )
+                break;
+
+            runScriptWorkerCallback(
+                event.value(QStringLiteral("callback")).toString(),
+                event.value(QStringLiteral("data")).toMap() );
+        }
+
+        running = false;
+    });
+
+    emit receiveData();
+
+    if (m_abort == Abort::None)
+        loop.exec();
+}
+
 void Scriptable::runMenuCommandFilters()
 {
     QEventLoop loop;
@@ -2772,8 +3038,16 @@ void Scriptable::monitorClipboard()
     if (!verifyClipboardAccess())
         return;
 
+    // Input formats of automatic commands must be available when the commands run.
+    QStringList immediateFormats;
+    for (const auto &command : m_proxy->automaticCommands()) {
+        if ( !command.input.isEmpty() )
+            immediateFormats.append(command.input);
+    }
+
     ClipboardMonitor monitor(
-        fromScriptValue<QStringList>(eval("clipboardFormatsToSave()"), this) );
+        fromScriptValue<QStringList>(eval("clipboardFormatsToSave()"), this),
+        immediateFormats );
 
     QEventLoop loop;
     connect(this, &Scriptable::finished, &loop, &QEventLoop::quit);
@@ -2781,6 +3055,10 @@ void Scriptable::monitorClipboard()
              this, &Scriptable::onMonitorClipboardChanged );
     connect( &monitor, &ClipboardMonitor::clipboardUnchanged,
              this, &Scriptable::onMonitorClipboardUnchanged );
+    connect( &monitor, &ClipboardMonitor::clipboardChangedBeforeDelayedData,
+             this, &Scriptable::onMonitorClipboardChangedBeforeDelayedData );
+    connect( &monitor, &ClipboardMonitor::clipboardDataUpdated,
+             this, &Scriptable::onMonitorClipboardDataUpdated );
     connect( &monitor, &ClipboardMonitor::synchronizeSelection,
              this, &Scriptable::onSynchronizeSelection );
     loop.exec();
@@ -2850,17 +3128,29 @@ void Scriptable::onMonitorClipboardChanged(const QVariantMap &data, ClipboardOwn
                    getTextData(data, mimeOwner)
                ) );
 
-    const QString command =
-        ownership == ClipboardOwnership::Own ? "copyq onOwnClipboardChanged"
-      : ownership == ClipboardOwnership::Hidden ? "copyq onHiddenClipboardChanged"
-      : "copyq onClipboardChanged";
+    const QString callback =
+        ownership == ClipboardOwnership::Own ? "onOwnClipboardChanged"
+      : ownership == ClipboardOwnership::Hidden ? "onHiddenClipboardChanged"
+      : "onClipboardChanged";
 
-    m_proxy->runInternalAction(data, command);
+    m_proxy->runScriptWorkerCallback(data, callback);
 }
 
 void Scriptable::onMonitorClipboardUnchanged(const QVariantMap &data)
 {
-    m_proxy->runInternalAction(data, "copyq onClipboardUnchanged");
+    m_proxy->runScriptWorkerCallback(data, "onClipboardUnchanged");
+}
+
+void Scriptable::onMonitorClipboardChangedBeforeDelayedData(
+    const QVariantMap &data, const QStringList &delayedFormats, quint64 *itemHash)
+{
+    *itemHash = m_proxy->addClipboardDataBeforeDelayedData(data, delayedFormats);
+}
+
+void Scriptable::onMonitorClipboardDataUpdated(const QVariantMap &data, quint64 itemHash)
+{
+    const QString tab = getTextData(data, mimeOutputTab);
+    m_proxy->updateClipboardItem(tab, itemHash, copyWithoutInternalData(data));
 }
 
 void Scriptable::onSynchronizeSelection(ClipboardMode sourceMode, const QString &text, uint targetTextHash)
@@ -2987,6 +3277,55 @@ int Scriptable::executeArgumentsSimple(const QStringList &args)
     return exitCode;
 }
 
+void Scriptable::runScriptWorkerCallback(const QString &callback, const QVariantMap &data)
+{
+    PerformanceLogger logger( QStringLiteral("Script worker callback \"%1\"").arg(callback) );
+
+    m_data = m_oldData = data;
+
+    auto fn = engine()->globalObject().property(callback);
+    if ( !fn.isCallable() ) {
+        log( QStringLiteral("Script worker: Function \"%1\" is not available").arg(callback), LogError );
+        return;
+    }
+
+    m_runningWorkerCallback = true;
+    call(callback, &fn, QJSValueList());
+    m_runningWorkerCallback = false;
+    if ( hasUncaughtException() )
+        processUncaughtException(callback);
+
+    // Reset state so the next event starts clean, as in a new process.
+    restoreWorkerGlobals();
+    m_failed = false;
+    clearExceptions();
+    if (m_abort == Abort::CurrentEvaluation)
+        m_abort = Abort::None;
+
+    m_engine->collectGarbage();
+}
+
+void Scriptable::restoreWorkerGlobals()
+{
+    auto globalObject = engine()->globalObject();
+
+    QStringList added;
+    QJSValueIterator it(globalObject);
+    while ( it.hasNext() ) {
+        it.next();
+        if ( !m_workerGlobals.contains(it.name()) )
+            added.append( it.name() );
+    }
+
+    for (const auto &name : added)
+        globalObject.deleteProperty(name);
+
+    for (auto it = m_workerGlobals.constBegin(); it != m_workerGlobals.constEnd(); ++it) {
+        if ( !globalObject.property(it.key()).strictlyEquals(it.value()) )
+            globalObject.setProperty(it.key(), it.value());
+    }
+}
+
 void Scriptable::processUncaughtException(const QString &cmd)
 {
     if ( !hasUncaughtException() )
@@ -3184,16 +3523,23 @@ QJSValue Scriptable::changeItem(bool create)
     }
 
     QString error;
-    const QVector<QVariantMap> items = getItemArguments(i, args, &error);
+    QVector<QVariantMap> items = getItemArguments(i, args, &error);
     if ( !error.isEmpty() )
         return throwError(error);
 
+    const int transferId = sendLargeItemData(&items);
+    if ( !canContinue() ) {
+        if (transferId != -1)
+            m_proxy->discardItemDataChunks(transferId);
+        return QJSValue();
+    }
+
     if (create) {
-        error = m_proxy->browserInsert(m_tabName, row, items);
+        error = m_proxy->browserInsert(m_tabName, row, items, transferId);
         if ( !error.isEmpty() )
             return throwError(error);
     } else {
-        error = m_proxy->browserChange(m_tabName, row, items);
+        error = m_proxy->browserChange(m_tabName, row, items, transferId);
         if ( !error.isEmpty() )
             return throwError(error);
     }
@@ -3398,7 +3744,7 @@ bool Scriptable::canExecuteCommand(const Command &command)
             // Disallow applying action that takes serialized item more times.
             if ( m_data.contains(command.output) )
                 return false;
-        } else if ( !m_data.contains(command.input) ) {
+        } else if ( !hasDataFormat(m_data, command.input) ) {
             return false;
         }
     }
@@ -3489,7 +3835,7 @@ void Scriptable::insert(int row, int argumentsBegin, int argumentsEnd)
     m_skipArguments = argumentsEnd;
 
     const QVector<QVariantMap> items = getItemList(argumentsBegin, argumentsEnd, argumentsArray());
-    const auto error = m_proxy->browserInsert(m_tabName, row, items);
+    const auto error = m_proxy->browserInsert(m_tabName, row, items, -1);
     if ( !error.isEmpty() )
         throwError(error);
 }
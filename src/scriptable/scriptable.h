@@ -7,6 +7,7 @@
 #include "common/command.h"
 #include "common/mimetypes.h"
 
+#include <QHash>
 #include <QObject>
 #include <QString>
 #include <QJSValue>
@@ -249,6 +250,7 @@ public slots:
     QJSValue testSelected();
     void serverLog();
     QJSValue logs();
+    QJSValue trace();
 
     void setCurrentTab();
 
@@ -276,6 +278,8 @@ public slots:
 
     QJSValue getItem();
     QJSValue getitem() { return getItem(); }
+    QJSValue getItems();
+
     void setItem();
     void setitem() { setItem(); }
 
@@ -361,9 +365,12 @@ public slots:
     void updateClipboardData();
     void clearClipboardData();
     QJSValue runAutomaticCommands();
+    QJSValue automaticCommandStatistics();
 
     void runDisplayCommands();
 
+    void runScriptWorker();
+
     void runMenuCommandFilters();
 
     void monitorClipboard();
@@ -383,10 +390,15 @@ private:
     void onExecuteOutput(const QByteArray &output);
     void onMonitorClipboardChanged(const QVariantMap &data, ClipboardOwnership ownership);
     void onMonitorClipboardUnchanged(const QVariantMap &data);
+    void onMonitorClipboardChangedBeforeDelayedData(
+        const QVariantMap &data, const QStringList &delayedFormats, quint64 *itemHash);
+    void onMonitorClipboardDataUpdated(const QVariantMap &data, quint64 itemHash);
     void onSynchronizeSelection(ClipboardMode sourceMode, const QString &text, uint targetTextHash);
 
     bool sourceScriptCommands();
     void callDisplayFunctions(QJSValueList displayFunctions);
+    void runScriptWorkerCallback(const QString &callback, const QVariantMap &data);
+    void restoreWorkerGlobals();
     void processUncaughtException(const QString &cmd);
     void showExceptionMessage(const QString &message);
     QVector<int> getRows() const;
@@ -403,6 +415,15 @@ private:
 
     QJSValue copy(ClipboardMode mode);
     QJSValue changeItem(bool create);
+
+    /// Reads item data from server in parts (or following rows at once, see readAhead()).
+    QByteArray readItemData(int row, const QString &format);
+    /// Fetches item length and data of following rows in a single message.
+    void readAhead(int row, const QString &format);
+    bool isReadAheadValid() const;
+    /// Sends large item data in parts, returns transfer ID for browserInsert() (-1 if nothing is sent).
+    int sendLargeItemData(QVector<QVariantMap> *items);
+
     void nextToClipboard(int where);
     QJSValue screenshot(bool select);
     QByteArray serialize(const QJSValue &value);
@@ -486,6 +507,26 @@ private:
     QJSValue m_createFn;
     QJSValue m_createFnB;
     QJSValue m_createProperty;
+
+    /// Items fetched by readAhead(), valid until next call to server.
+    struct ReadAhead {
+        int functionCallId = -2;
+        QString tabName;
+        QString format;
+        int lastRow = -2;
+        int firstRow = 0;
+        int length = 0;
+        QVector<QByteArray> data;
+    };
+    ReadAhead m_readAhead;
+
+    /// Last ID passed to ScriptableProxy::appendItemDataChunk().
+    int m_lastItemDataTransferId = -1;
+
+    /// Global properties at script worker start (see restoreWorkerGlobals()).
+    QHash<QString, QJSValue> m_workerGlobals;
+    /// True while script worker handles an event (abort() ends only the callback).
+    bool m_runningWorkerCallback = false;
 };
 
 class NetworkReply final : public QObject {
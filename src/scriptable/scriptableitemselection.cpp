@@ -83,6 +83,8 @@ ScriptableItemSelection::~ScriptableItemSelection()
 
 QJSValue ScriptableItemSelection::length()
 {
+    if ( isReadAheadValid() )
+        return m_readAheadSize;
     return m_proxy->selectionGetSize(m_id);
 }
 
@@ -201,6 +203,21 @@ QJSValue ScriptableItemSelection::rows()
 
 QJSValue ScriptableItemSelection::itemAtIndex(int index)
 {
+    // Fetch following items only if items are read one by one.
+    const bool isNextIndex = index == m_lastIndex + 1;
+    m_lastIndex = index;
+
+    const auto hasReadAhead = [&]() {
+        const int readAheadIndex = index - m_readAheadFirstIndex;
+        return isReadAheadValid() && readAheadIndex >= 0 && readAheadIndex < m_readAheadItems.size();
+    };
+
+    if ( !hasReadAhead() && isNextIndex )
+        readAhead(index);
+
+    if ( hasReadAhead() )
+        return qjsEngine(this)->toScriptValue( m_readAheadItems[index - m_readAheadFirstIndex] );
+
     const auto item = m_proxy->selectionGetItemIndex(m_id, index);
     return qjsEngine(this)->toScriptValue(item);
 }
@@ -259,6 +276,36 @@ QJSValue ScriptableItemSelection::sort(QJSValue compareFn)
     return m_self;
 }
 
+void ScriptableItemSelection::readAhead(int index)
+{
+    m_readAheadItems.clear();
+    m_readAheadFirstIndex = index;
+
+    // Same number of items as read ahead by read() script function.
+    const int readAheadCount = 16;
+
+    ScriptableProxyBatch batch(m_proxy);
+    const int sizeIndex = m_proxy->queueSelectionGetSize(m_id);
+    QVector<int> itemIndexes;
+    for (int i = 0; i < readAheadCount; ++i)
+        itemIndexes.append( m_proxy->queueSelectionGetItemIndex(m_id, index + i) );
+    if ( !batch.finish().isEmpty() ) {
+        m_readAheadFunctionCallId = -2;
+        return;
+    }
+
+    m_readAheadSize = m_proxy->batchResult(sizeIndex).toInt();
+    for (int i = 0; i < itemIndexes.size() && index + i < m_readAheadSize; ++i)
+        m_readAheadItems.append( m_proxy->batchResult(itemIndexes[i]).toMap() );
+    m_readAheadFunctionCallId = m_proxy->lastFunctionCallId();
+}
+
+bool ScriptableItemSelection::isReadAheadValid() const
+{
+    // Any other call to server can change the selection or the items.
+    return m_readAheadFunctionCallId == m_proxy->lastFunctionCallId();
+}
+
 void ScriptableItemSelection::init(const QJSValue &self, ScriptableProxy *proxy, const QString &currentTabName)
 {
     m_self = self;
@@ -4,6 +4,8 @@
 
 #include <QJSValue>
 #include <QObject>
+#include <QVariantMap>
+#include <QVector>
 
 class ScriptableProxy;
 
@@ -58,8 +60,19 @@ public slots:
     QJSValue sort(QJSValue compareFn);
 
 private:
+    /// Fetches size and following items in a single message.
+    void readAhead(int index);
+    bool isReadAheadValid() const;
+
     int m_id = -1;
     QString m_tabName;
     ScriptableProxy *m_proxy = nullptr;
     QJSValue m_self;
+
+    /// Items fetched by readAhead(), valid until next call to server.
+    QVector<QVariantMap> m_readAheadItems;
+    int m_readAheadFirstIndex = 0;
+    int m_readAheadSize = 0;
+    int m_readAheadFunctionCallId = -2;
+    int m_lastIndex = -2;
 };
@@ -11,11 +11,13 @@
 #include "common/config.h"
 #include "common/contenttype.h"
 #include "common/display.h"
+#include "common/imagedata.h"
 #include "common/log.h"
 #include "common/mimetypes.h"
 #include "common/settings.h"
 #include "common/sleeptimer.h"
 #include "common/textdata.h"
+#include "common/trace.h"
 #include "gui/clipboardbrowser.h"
 #include "gui/filedialog.h"
 #include "gui/iconfactory.h"
@@ -92,6 +94,7 @@ void registerMetaTypes() {
     qRegisterMetaTypeStreamOperators<QVector<int>>("QVector<int>");
     qRegisterMetaTypeStreamOperators<QVector<Command>>("QVector<Command>");
     qRegisterMetaTypeStreamOperators<QVector<QVariantMap>>("QVector<QVariantMap>");
+    qRegisterMetaTypeStreamOperators<QVector<QByteArray>>("QVector<QByteArray>");
     qRegisterMetaTypeStreamOperators<Qt::KeyboardModifiers>("Qt::KeyboardModifiers");
 #else
     qRegisterMetaType<QPointer<QWidget>>("QPointer<QWidget>");
@@ -103,6 +106,7 @@ void registerMetaTypes() {
     qRegisterMetaType<QVector<int>>("QVector<int>");
     qRegisterMetaType<QVector<Command>>("QVector<Command>");
     qRegisterMetaType<QVector<QVariantMap>>("QVector<QVariantMap>");
+    qRegisterMetaType<QVector<QByteArray>>("QVector<QByteArray>");
     qRegisterMetaType<Qt::KeyboardModifiers>("Qt::KeyboardModifiers");
 #endif
 
@@ -135,11 +139,9 @@ void selectionRemoveInvalid(QList<QPersistentModelIndex> *indexes)
 
 #define STR(str) str
 
-#define INVOKE_(function, arguments, functionCallId) do { \
-    static const auto f = FunctionCallSerializer(QByteArrayLiteral(STR(#function))).withSlotArguments arguments; \
-    const auto args = f.argumentList arguments; \
-    emit sendMessage(f.serialize(functionCallId, args), CommandFunctionCall); \
-} while(false)
+#define SERIALIZE_FUNCTION_CALL(FUNCTION, ARGUMENTS, functionCallId) \
+    static const auto f = FunctionCallSerializer(QByteArrayLiteral(STR(#FUNCTION))).withSlotArguments ARGUMENTS; \
+    const QByteArray serializedFunctionCall = f.serialize(functionCallId, f.argumentList ARGUMENTS)
 
 #if QT_VERSION >= QT_VERSION_CHECK(6,0,0)
 #   define CHECK_STREAM_OPERATORS(CALL) \
@@ -161,26 +163,54 @@ void selectionRemoveInvalid(QList<QPersistentModelIndex> *indexes)
         }
 #endif
 
-#define INVOKE(FUNCTION, ARGUMENTS) do { \
+#define INVOKE_WAIT_(FUNCTION, ARGUMENTS, canBatch) do { \
     using Result = decltype(FUNCTION ARGUMENTS); \
     CHECK_STREAM_OPERATORS(STR(#FUNCTION #ARGUMENTS)); \
     if (!m_wnd) { \
         const auto functionCallId = ++m_lastFunctionCallId; \
-        INVOKE_(FUNCTION, ARGUMENTS, functionCallId); \
+        SERIALIZE_FUNCTION_CALL(FUNCTION, ARGUMENTS, functionCallId); \
+        if (canBatch && m_batchLevel > 0) { \
+            const int resultIndex = queueFunctionCall(serializedFunctionCall); \
+            flushFunctionCalls(); \
+            return m_batchResults.value(resultIndex).value<Result>(); \
+        } \
+        sendFunctionCall(serializedFunctionCall); \
         const auto result = waitForFunctionCallFinished(functionCallId); \
         return result.value<Result>(); \
     } \
 } while(false)
 
-#define INVOKE2(FUNCTION, ARGUMENTS) do { \
+/// Calls with return value are sent with queued calls in a batch (see ScriptableProxy::beginBatch()).
+#define INVOKE(FUNCTION, ARGUMENTS) INVOKE_WAIT_(FUNCTION, ARGUMENTS, true)
+
+#define INVOKE_VOID_(FUNCTION, ARGUMENTS, canQueue) do { \
     if (!m_wnd) { \
         const auto functionCallId = ++m_lastFunctionCallId; \
-        INVOKE_(FUNCTION, ARGUMENTS, functionCallId); \
+        SERIALIZE_FUNCTION_CALL(FUNCTION, ARGUMENTS, functionCallId); \
+        if (canQueue && m_batchLevel > 0 && !m_disconnected) { \
+            queueFunctionCall(serializedFunctionCall); \
+            return; \
+        } \
+        sendFunctionCall(serializedFunctionCall); \
         waitForFunctionCallFinished(functionCallId); \
         return; \
     } \
 } while(false)
 
+/// Calls without return value can be queued (see ScriptableProxy::beginBatch()).
+#define INVOKE2(FUNCTION, ARGUMENTS) INVOKE_VOID_(FUNCTION, ARGUMENTS, true)
+
+/// Queues call in a batch and returns index for ScriptableProxy::batchResult().
+#define QUEUE(FUNCTION, ARGUMENTS) do { \
+    if (!m_wnd) { \
+        Q_ASSERT(m_batchLevel > 0); \
+        SERIALIZE_FUNCTION_CALL(FUNCTION, ARGUMENTS, ++m_lastFunctionCallId); \
+        return queueFunctionCall(serializedFunctionCall); \
+    } \
+    m_batchResults.append( QVariant::fromValue(FUNCTION ARGUMENTS) ); \
+    return m_batchResults.size() - 1; \
+} while(false)
+
 Q_DECLARE_METATYPE(QFile*)
 
 QDataStream &operator<<(QDataStream &out, const NotificationButton &button)
@@ -839,11 +869,21 @@ void ScriptableProxy::callFunction(const QByteArray &serializedFunctionCall)
     if (m_shouldBeDeleted)
         return;
 
+    // Message data are valid only in this call (see ClientSocket::messageReceived()).
+    FunctionCall functionCall;
+    QString error;
+    if ( !parseFunctionCall(serializedFunctionCall, &functionCall, &error) ) {
+        log(error, LogError);
+        Q_ASSERT(false);
+        if (functionCall.id == -1)
+            return;
+    }
+
     ++m_functionCallStack;
     auto t = new QTimer(this);
     t->setSingleShot(true);
-    QObject::connect( t, &QTimer::timeout, this, [=]() {
-        const auto result = callFunctionHelper(serializedFunctionCall);
+    QObject::connect( t, &QTimer::timeout, this, [=]() mutable {
+        const auto result = callFunctionHelper(&functionCall, error);
         emit sendMessage(result, CommandFunctionCallReturnValue);
         t->deleteLater();
 
@@ -854,68 +894,89 @@ void ScriptableProxy::callFunction(const QByteArray &serializedFunctionCall)
     t->start(0);
 }
 
-QByteArray ScriptableProxy::callFunctionHelper(const QByteArray &serializedFunctionCall)
+QByteArray ScriptableProxy::callFunctionHelper(FunctionCall *functionCall, QString error)
 {
-    QVector<QVariant> arguments;
-    QByteArray slotName;
-    int functionCallId;
-    {
-        QDataStream stream(serializedFunctionCall);
-        stream.setVersion(QDataStream::Qt_5_0);
+    // Return value is empty if the call failed to parse.
+    QVariant returnValue;
+    if ( error.isEmpty() && !invokeFunctionCall(functionCall, &returnValue, &error) ) {
+        log(error, LogError);
+        Q_ASSERT(false);
+    }
 
-        quint32 magicNumber;
-        quint32 version;
-        stream >> magicNumber >> version;
+    QByteArray bytes;
+    {
+        QDataStream stream(&bytes, QIODevice::WriteOnly);
+        stream << functionCall->id << returnValue;
         if (stream.status() != QDataStream::Ok) {
-            log("Failed to read scriptable proxy slot call preamble", LogError);
+            log("Failed to write scriptable proxy slot call return value", LogError);
             Q_ASSERT(false);
-            return QByteArray();
         }
+    }
 
-        if (magicNumber != serializedFunctionCallMagicNumber) {
-            log("Unexpected scriptable proxy slot call preamble magic number", LogError);
-            Q_ASSERT(false);
-            return QByteArray();
-        }
+    return bytes;
+}
 
-        if (version != serializedFunctionCallVersion) {
-            log("Unexpected scriptable proxy slot call preamble version", LogError);
-            Q_ASSERT(false);
-            return QByteArray();
-        }
+bool ScriptableProxy::parseFunctionCall(
+        const QByteArray &serializedFunctionCall, FunctionCall *functionCall, QString *error)
+{
+    QDataStream stream(serializedFunctionCall);
+    stream.setVersion(QDataStream::Qt_5_0);
 
-        stream >> functionCallId;
-        if (stream.status() != QDataStream::Ok) {
-            log("Failed to read scriptable proxy slot call ID", LogError);
-            Q_ASSERT(false);
-            return QByteArray();
-        }
+    quint32 magicNumber;
+    quint32 version;
+    stream >> magicNumber >> version;
+    if (stream.status() != QDataStream::Ok) {
+        *error = QStringLiteral("Failed to read scriptable proxy slot call preamble");
+        return false;
+    }
 
-        stream >> slotName;
-        if (stream.status() != QDataStream::Ok) {
-            log("Failed to read scriptable proxy slot call name", LogError);
-            Q_ASSERT(false);
-            return QByteArray();
-        }
+    if (magicNumber != serializedFunctionCallMagicNumber) {
+        *error = QStringLiteral("Unexpected scriptable proxy slot call preamble magic number");
+        return false;
+    }
 
-        stream >> arguments;
-        if (stream.status() != QDataStream::Ok) {
-            log("Failed to read scriptable proxy slot call", LogError);
-            Q_ASSERT(false);
-            return QByteArray();
-        }
+    if (version != serializedFunctionCallVersion) {
+        *error = QStringLiteral("Unexpected scriptable proxy slot call preamble version");
+        return false;
+    }
+
+    stream >> functionCall->id;
+    if (stream.status() != QDataStream::Ok) {
+        functionCall->id = -1;
+        *error = QStringLiteral("Failed to read scriptable proxy slot call ID");
+        return false;
+    }
+
+    stream >> functionCall->slotName;
+    if (stream.status() != QDataStream::Ok) {
+        *error = QStringLiteral("Failed to read scriptable proxy slot call name");
+        return false;
+    }
+
+    stream >> functionCall->arguments;
+    if (stream.status() != QDataStream::Ok) {
+        *error = QStringLiteral("Failed to read scriptable proxy slot call");
+        return false;
     }
 
-    const auto slotIndex = metaObject()->indexOfSlot(slotName);
+    return true;
+}
+
+bool ScriptableProxy::invokeFunctionCall(FunctionCall *functionCall, QVariant *returnValue, QString *error)
+{
+    const auto slotIndex = metaObject()->indexOfSlot(functionCall->slotName);
     if (slotIndex == -1) {
-        log("Failed to find scriptable proxy slot: " + slotName, LogError);
-        Q_ASSERT(false);
-        return QByteArray();
+        *error = QStringLiteral("Failed to find scriptable proxy slot: %1")
+            .arg(QString::fromLatin1(functionCall->slotName));
+        return false;
     }
 
+    COPYQ_TRACE_DETAIL("proxy", "proxy call", QString::fromLatin1(functionCall->slotName));
+
     const auto metaMethod = metaObject()->method(slotIndex);
     const auto typeId = metaMethod.returnType();
 
+    auto &arguments = functionCall->arguments;
     QGenericArgument args[9];
     for (int i = 0; i < arguments.size(); ++i) {
         auto &value = arguments[i];
@@ -925,15 +986,13 @@ QByteArray ScriptableProxy::callFunctionHelper(const QByteArray &serializedFunct
         } else if ( value.userType() == argumentTypeId ) {
             args[i] = QGenericArgument( value.typeName(), static_cast<void*>(value.data()) );
         } else {
-            log( QString("Bad argument type (at index %1) for scriptable proxy slot: %2")
+            *error = QStringLiteral("Bad argument type (at index %1) for scriptable proxy slot: %2")
                  .arg(i)
-                 .arg(metaMethod.methodSignature().constData()), LogError);
-            Q_ASSERT(false);
-            return QByteArray();
+                 .arg(metaMethod.methodSignature().constData());
+            return false;
         }
     }
 
-    QVariant returnValue;
     bool called;
 
     if (typeId == QMetaType::Void) {
@@ -944,13 +1003,13 @@ QByteArray ScriptableProxy::callFunctionHelper(const QByteArray &serializedFunct
         const QMetaType metaType(typeId);
         COPYQ_LOG_VERBOSE(QStringLiteral("Script function return type: %1").arg(metaType.name()));
         Q_ASSERT(metaType.hasRegisteredDataStreamOperators());
-        returnValue = QVariant(metaType, nullptr);
+        *returnValue = QVariant(metaType, nullptr);
 #else
-        returnValue = QVariant(typeId, nullptr);
+        *returnValue = QVariant(typeId, nullptr);
 #endif
-        const auto genericReturnValue = returnValue.isValid()
-                ? QGenericReturnArgument(returnValue.typeName(), static_cast<void*>(returnValue.data()) )
-                : Q_RETURN_ARG(QVariant, returnValue);
+        const auto genericReturnValue = returnValue->isValid()
+                ? QGenericReturnArgument(returnValue->typeName(), static_cast<void*>(returnValue->data()) )
+                : Q_RETURN_ARG(QVariant, *returnValue);
 
         called = metaMethod.invoke(
                 this, genericReturnValue,
@@ -958,22 +1017,64 @@ QByteArray ScriptableProxy::callFunctionHelper(const QByteArray &serializedFunct
     }
 
     if (!called) {
-        log( QString("Bad scriptable proxy slot call: %1")
-             .arg(metaMethod.methodSignature().constData()), LogError);
-        Q_ASSERT(false);
+        *error = QStringLiteral("Bad scriptable proxy slot call: %1")
+             .arg(metaMethod.methodSignature().constData());
+        return false;
     }
 
-    QByteArray bytes;
-    {
-        QDataStream stream(&bytes, QIODevice::WriteOnly);
-        stream << functionCallId << returnValue;
-        if (stream.status() != QDataStream::Ok) {
-            log("Failed to write scriptable proxy slot call return value", LogError);
-            Q_ASSERT(false);
-        }
+    return true;
+}
+
+void ScriptableProxy::beginBatch()
+{
+    if (m_batchLevel++ == 0) {
+        m_batchResults.clear();
+        m_batchErrors.clear();
     }
+}
 
-    return bytes;
+QStringList ScriptableProxy::endBatch()
+{
+    Q_ASSERT(m_batchLevel > 0);
+    if (m_batchLevel <= 0 || --m_batchLevel > 0)
+        return QStringList();
+
+    flushFunctionCalls();
+
+    const QStringList errors = m_batchErrors;
+    m_batchErrors.clear();
+    return errors;
+}
+
+QVariant ScriptableProxy::batchResult(int resultIndex) const
+{
+    return m_batchResults.value(resultIndex);
+}
+
+int ScriptableProxy::queueBrowserItemData(const QString &tabName, int row, const QString &mime)
+{
+    QUEUE(browserItemData, (tabName, row, mime));
+}
+
+int ScriptableProxy::queueBrowserItemDataChunk(
+        const QString &tabName, int row, const QString &mime, int offset, int size)
+{
+    QUEUE(browserItemDataChunk, (tabName, row, mime, offset, size));
+}
+
+int ScriptableProxy::queueBrowserLength(const QString &tabName)
+{
+    QUEUE(browserLength, (tabName));
+}
+
+int ScriptableProxy::queueSelectionGetSize(int id)
+{
+    QUEUE(selectionGetSize, (id));
+}
+
+int ScriptableProxy::queueSelectionGetItemIndex(int id, int index)
+{
+    QUEUE(selectionGetItemIndex, (id, index));
 }
 
 void ScriptableProxy::setFunctionCallReturnValue(const QByteArray &bytes)
@@ -1225,6 +1326,40 @@ void ScriptableProxy::runInternalAction(const QVariantMap &data, const QString &
     m_wnd->runInternalAction(action);
 }
 
+void ScriptableProxy::runScriptWorkerCallback(const QVariantMap &data, const QString &callback)
+{
+    INVOKE2(runScriptWorkerCallback, (data, callback));
+
+    if ( callback == QLatin1String("onClipboardChanged") && !m_wnd->needsClipboardScript(data) ) {
+        COPYQ_LOG("No automatic command matches the clipboard, skipping script");
+        onClipboardChangedWithoutCommands(data);
+        return;
+    }
+
+    m_wnd->runScriptWorkerCallback(callback, data);
+}
+
+quint64 ScriptableProxy::addClipboardDataBeforeDelayedData(
+        const QVariantMap &data, const QStringList &delayedFormats)
+{
+    INVOKE(addClipboardDataBeforeDelayedData, (data, delayedFormats));
+
+    // Automatic commands and scripts get data with all formats.
+    if ( m_wnd->mayNeedClipboardScript(data, delayedFormats) )
+        return 0;
+
+    onClipboardChangedWithoutCommands(data);
+
+    // Hash is computed here since it is stable only within this process.
+    return hash( copyWithoutInternalData(data) );
+}
+
+QVariantMap ScriptableProxy::takeScriptWorkerEvent(int actionId)
+{
+    INVOKE(takeScriptWorkerEvent, (actionId));
+    return m_wnd->takeScriptWorkerEvent(actionId);
+}
+
 QByteArray ScriptableProxy::tryGetCommandOutput(const QString &command)
 {
     INVOKE(tryGetCommandOutput, (command));
@@ -1499,18 +1634,21 @@ bool ScriptableProxy::browserOpenEditor(const QString &tabName, const QByteArray
     return c && c->openEditor(arg1, changeClipboard);
 }
 
-QString ScriptableProxy::browserInsert(const QString &tabName, int row, const QVector<QVariantMap> &items)
+QString ScriptableProxy::browserInsert(
+        const QString &tabName, int row, const QVector<QVariantMap> &items, int transferId)
 {
-    INVOKE(browserInsert, (tabName, row, items));
+    INVOKE(browserInsert, (tabName, row, items, transferId));
+
+    const auto newItems = takeItemDataChunks(transferId, items);
 
     ClipboardBrowser *c = fetchBrowser(tabName);
     if (!c)
         return QLatin1String("Invalid tab");
 
-    if ( !c->allocateSpaceForNewItems(items.size()) )
+    if ( !c->allocateSpaceForNewItems(newItems.size()) )
         return QLatin1String("Tab is full (cannot remove any items)");
 
-    for (const auto &item : items) {
+    for (const auto &item : newItems) {
         if ( !c->add(item, row) )
             return QLatin1String("Failed to new add items");
     }
@@ -1518,16 +1656,19 @@ QString ScriptableProxy::browserInsert(const QString &tabName, int row, const QV
     return QString();
 }
 
-QString ScriptableProxy::browserChange(const QString &tabName, int row, const QVector<QVariantMap> &items)
+QString ScriptableProxy::browserChange(
+        const QString &tabName, int row, const QVector<QVariantMap> &items, int transferId)
 {
-    INVOKE(browserChange, (tabName, row, items));
+    INVOKE(browserChange, (tabName, row, items, transferId));
+
+    const auto newItems = takeItemDataChunks(transferId, items);
 
     ClipboardBrowser *c = fetchBrowser(tabName);
     if (!c)
         return QLatin1String("Invalid tab");
 
     int currentRow = row;
-    for (const auto &data : items) {
+    for (const auto &data : newItems) {
         const auto index = c->index(currentRow);
         QVariantMap itemData = c->model()->data(index, contentType::data).toMap();
         for (auto it = data.constBegin(); it != data.constEnd(); ++it) {
@@ -1555,6 +1696,100 @@ QVariantMap ScriptableProxy::browserItemData(const QString &tabName, int arg1)
     return itemData(tabName, arg1);
 }
 
+QByteArray ScriptableProxy::browserItemDataChunk(
+        const QString &tabName, int row, const QString &mime, int offset, int size)
+{
+    INVOKE(browserItemDataChunk, (tabName, row, mime, offset, size));
+
+    const QByteArray &data = chunkedItemData(tabName, row, mime, offset == 0);
+    const QByteArray chunk = data.mid(offset, size);
+    if (offset + chunk.size() >= data.size())
+        m_chunkedItemData = QByteArray();
+    return chunk;
+}
+
+int ScriptableProxy::browserItemDataSize(const QString &tabName, int row, const QString &mime)
+{
+    INVOKE(browserItemDataSize, (tabName, row, mime));
+    return chunkedItemData(tabName, row, mime, false).size();
+}
+
+void ScriptableProxy::appendItemDataChunk(
+        int transferId, int itemIndex, const QString &mime, const QByteArray &chunk)
+{
+    INVOKE2(appendItemDataChunk, (transferId, itemIndex, mime, chunk));
+    m_itemDataChunks[transferId][itemIndex][mime].append(chunk);
+}
+
+void ScriptableProxy::discardItemDataChunks(int transferId)
+{
+    INVOKE2(discardItemDataChunks, (transferId));
+    m_itemDataChunks.remove(transferId);
+}
+
+QVector<QVariantMap> ScriptableProxy::browserItemsData(
+        const QString &tabName, const QVector<int> &rows, const QStringList &formats)
+{
+    INVOKE(browserItemsData, (tabName, rows, formats));
+
+    QVector<QVariantMap> dataList;
+    auto c = fetchBrowser(tabName);
+    if (!c)
+        return dataList;
+
+    const auto copyFormats = [&](const QModelIndex &index) {
+        QVariantMap data = c->copyIndex(index);
+        if ( !formats.isEmpty() ) {
+            // Lazy image formats are converted by the caller, outside the GUI thread.
+            const QStringList keepFormats = formats + imageSourceFormats(data, formats);
+            for (auto it = data.begin(); it != data.end(); ) {
+                if ( keepFormats.contains(it.key()) )
+                    ++it;
+                else
+                    it = data.erase(it);
+            }
+        }
+        dataList.append(data);
+    };
+
+    if ( rows.isEmpty() ) {
+        dataList.reserve( c->length() );
+        for (int row = 0; row < c->length(); ++row)
+            copyFormats( c->index(row) );
+    } else {
+        dataList.reserve( rows.size() );
+        for (const int row : rows)
+            copyFormats( c->index(row) );
+    }
+
+    return dataList;
+}
+
+QVariantMap ScriptableProxy::callFunctions(const QVector<QByteArray> &serializedFunctionCalls)
+{
+    INVOKE_WAIT_(callFunctions, (serializedFunctionCalls), false);
+
+    QVariantList results;
+    QStringList errors;
+    for (const auto &serializedFunctionCall : serializedFunctionCalls) {
+        FunctionCall functionCall;
+        QVariant returnValue;
+        QString error;
+        if ( !parseFunctionCall(serializedFunctionCall, &functionCall, &error)
+             || !invokeFunctionCall(&functionCall, &returnValue, &error) )
+        {
+            log(error, LogError);
+            errors.append(error);
+        }
+        results.append(returnValue);
+    }
+
+    return QVariantMap{
+        {QStringLiteral("results"), results},
+        {QStringLiteral("errors"), errors},
+    };
+}
+
 void ScriptableProxy::setCurrentTab(const QString &tabName)
 {
     INVOKE2(setCurrentTab, (tabName));
@@ -2054,6 +2289,18 @@ void ScriptableProxy::serverLog(const QString &text)
     log(text, LogAlways);
 }
 
+void ScriptableProxy::startTracing()
+{
+    INVOKE2(startTracing, ());
+    ::startTracing();
+}
+
+bool ScriptableProxy::stopTracing(const QString &fileName)
+{
+    INVOKE(stopTracing, (fileName));
+    return ::stopTracing(fileName);
+}
+
 QString ScriptableProxy::currentWindowTitle()
 {
     INVOKE(currentWindowTitle, ());
@@ -2423,6 +2670,15 @@ void ScriptableProxy::saveData(const QString &tab, const QVariantMap &data, Clip
         c->addUnique(data, mode);
 }
 
+void ScriptableProxy::updateClipboardItem(const QString &tab, quint64 itemHash, const QVariantMap &data)
+{
+    INVOKE2(updateClipboardItem, (tab, itemHash, data));
+
+    auto c = m_wnd->tab(tab);
+    if (c)
+        c->addDelayedData(itemHash, data);
+}
+
 void ScriptableProxy::showDataNotification(const QVariantMap &data)
 {
     INVOKE2(showDataNotification, (data));
@@ -2505,6 +2761,12 @@ QVector<Command> ScriptableProxy::automaticCommands()
     return m_wnd->automaticCommands();
 }
 
+QVariantMap ScriptableProxy::automaticCommandStatistics()
+{
+    INVOKE(automaticCommandStatistics, ());
+    return m_wnd->automaticCommandStatistics();
+}
+
 QVector<Command> ScriptableProxy::displayCommands()
 {
     INVOKE(displayCommands, ());
@@ -2586,7 +2848,32 @@ ClipboardBrowser *ScriptableProxy::fetchBrowser(const QString &tabName)
             return fetchBrowser(defaultTabName);
     }
 
-    return tabName.isEmpty() ? m_wnd->browser(0) : m_wnd->tab(tabName);
+    const auto c = tabName.isEmpty() ? m_wnd->browser(0) : m_wnd->tab(tabName);
+
+    // Scripts expect all items to be available.
+    if (c)
+        c->waitForLoaded();
+
+    return c;
+}
+
+void ScriptableProxy::onClipboardChangedWithoutCommands(const QVariantMap &data)
+{
+    if ( hasNonEmptyData(data) ) {
+        const QString outputTab = getTextData(data, mimeOutputTab);
+        if ( !outputTab.isEmpty() ) {
+            const auto mode = isClipboardData(data)
+                    ? ClipboardMode::Clipboard
+                    : ClipboardMode::Selection;
+            saveData(outputTab, copyWithoutInternalData(data), mode);
+        }
+    }
+
+    if ( isClipboardData(data) ) {
+        setTitleForData(data);
+        showDataNotification(data);
+        setClipboardData(copyWithoutInternalData(data));
+    }
 }
 
 QVariantMap ScriptableProxy::itemData(const QString &tabName, int i)
@@ -2597,17 +2884,37 @@ QVariantMap ScriptableProxy::itemData(const QString &tabName, int i)
 
 QByteArray ScriptableProxy::itemData(const QString &tabName, int i, const QString &mime)
 {
-    const QVariantMap data = itemData(tabName, i);
-    if ( data.isEmpty() )
-        return QByteArray();
+    return itemDataForFormat( itemData(tabName, i), mime );
+}
 
-    if (mime == "?")
-        return QStringList(data.keys()).join("\n").toUtf8() + '\n';
+const QByteArray &ScriptableProxy::chunkedItemData(
+        const QString &tabName, int row, const QString &mime, bool refresh)
+{
+    const QString key = QStringLiteral("%1\n%2\n%3").arg(tabName).arg(row).arg(mime);
+    if (refresh || key != m_chunkedItemKey) {
+        m_chunkedItemKey = key;
+        m_chunkedItemData = itemData(tabName, row, mime);
+    }
+    return m_chunkedItemData;
+}
 
-    if (mime == mimeItems)
-        return serializeData(data);
+QVector<QVariantMap> ScriptableProxy::takeItemDataChunks(int transferId, QVector<QVariantMap> items)
+{
+    if (transferId == -1)
+        return items;
 
-    return data.value(mime).toByteArray();
+    const auto itemDataChunks = m_itemDataChunks.take(transferId);
+    for (auto it = itemDataChunks.constBegin(); it != itemDataChunks.constEnd(); ++it) {
+        if ( it.key() < 0 || it.key() >= items.size() )
+            continue;
+
+        auto &item = items[it.key()];
+        const auto &formats = it.value();
+        for (auto formatIt = formats.constBegin(); formatIt != formats.constEnd(); ++formatIt)
+            item.insert( formatIt.key(), formatIt.value() );
+    }
+
+    return items;
 }
 
 ClipboardBrowser *ScriptableProxy::currentBrowser() const
@@ -2631,6 +2938,37 @@ QList<QPersistentModelIndex> ScriptableProxy::selectedIndexes() const
             .value< QList<QPersistentModelIndex> >();
 }
 
+void ScriptableProxy::sendFunctionCall(const QByteArray &serializedFunctionCall)
+{
+    flushFunctionCalls();
+    emit sendMessage(serializedFunctionCall, CommandFunctionCall);
+}
+
+int ScriptableProxy::queueFunctionCall(const QByteArray &serializedFunctionCall)
+{
+    m_queuedFunctionCalls.append(serializedFunctionCall);
+    return m_batchResults.size() + m_queuedFunctionCalls.size() - 1;
+}
+
+void ScriptableProxy::flushFunctionCalls()
+{
+    if ( m_queuedFunctionCalls.isEmpty() )
+        return;
+
+    const QVector<QByteArray> functionCalls = m_queuedFunctionCalls;
+    m_queuedFunctionCalls.clear();
+
+    const QVariantMap reply = callFunctions(functionCalls);
+    QVariantList results = reply.value(QStringLiteral("results")).toList();
+    m_batchErrors.append( reply.value(QStringLiteral("errors")).toStringList() );
+    if ( results.size() != functionCalls.size() ) {
+        m_batchErrors.append( QStringLiteral("Failed to call %1 queued functions").arg(functionCalls.size()) );
+        while ( results.size() < functionCalls.size() )
+            results.append(QVariant());
+    }
+    m_batchResults.append(results);
+}
+
 QVariant ScriptableProxy::waitForFunctionCallFinished(int functionCallId)
 {
     if (m_disconnected)
@@ -2663,6 +3001,20 @@ KeyClicker *ScriptableProxy::keyClicker()
 }
 #endif // HAS_TESTS
 
+QByteArray itemDataForFormat(const QVariantMap &data, const QString &mime)
+{
+    if ( data.isEmpty() )
+        return QByteArray();
+
+    if (mime == "?")
+        return availableDataFormats(data).join("\n").toUtf8() + '\n';
+
+    if (mime == mimeItems)
+        return serializeData(data);
+
+    return dataForFormat(data, mime);
+}
+
 QString pluginsPath()
 {
     QDir dir;
@@ -8,6 +8,7 @@
 #include "gui/clipboardbrowser.h"
 #include "gui/notificationbutton.h"
 
+#include <QHash>
 #include <QList>
 #include <QMetaObject>
 #include <QObject>
@@ -79,6 +80,30 @@ public:
     void setFunctionCallReturnValue(const QByteArray &bytes);
     void setInputDialogResult(const QByteArray &bytes);
 
+    /**
+     * Queue calls without return value and send them to server in a single
+     * message on endBatch() or with the next call with return value.
+     *
+     * Calls with return value can be queued with queue*() functions.
+     * Their results are available with batchResult() once the calls are sent.
+     *
+     * endBatch() returns errors from all calls sent since beginBatch().
+     */
+    void beginBatch();
+    QStringList endBatch();
+
+    /// Returns result of a call queued in current or last batch.
+    QVariant batchResult(int resultIndex) const;
+
+    int queueBrowserItemData(const QString &tabName, int row, const QString &mime);
+    int queueBrowserItemDataChunk(const QString &tabName, int row, const QString &mime, int offset, int size);
+    int queueBrowserLength(const QString &tabName);
+    int queueSelectionGetSize(int id);
+    int queueSelectionGetItemIndex(int id, int index);
+
+    /// Returns ID of last call sent to server (changes with each call).
+    int lastFunctionCallId() const { return m_lastFunctionCallId; }
+
     void safeDeleteLater();
 
 public slots:
@@ -118,6 +143,13 @@ public slots:
     void action(const QVariantMap &arg1, const Command &arg2);
 
     void runInternalAction(const QVariantMap &data, const QString &command);
+    void runScriptWorkerCallback(const QVariantMap &data, const QString &callback);
+    /**
+     * Adds clipboard data without running scripts if no automatic command
+     * can match. Returns hash of the added item, or 0 if scripts need to run.
+     */
+    quint64 addClipboardDataBeforeDelayedData(const QVariantMap &data, const QStringList &delayedFormats);
+    QVariantMap takeScriptWorkerEvent(int actionId);
     QByteArray tryGetCommandOutput(const QString &command);
 
     void showMessage(const QString &title,
@@ -159,12 +191,33 @@ public slots:
     int browserLength(const QString &tabName);
     bool browserOpenEditor(const QString &tabName, const QByteArray &arg1, bool changeClipboard);
 
-    QString browserInsert(const QString &tabName, int row, const QVector<QVariantMap> &items);
-    QString browserChange(const QString &tabName, int row, const QVector<QVariantMap> &items);
+    /// Inserts items, with data from appendItemDataChunk() for @a transferId (-1 for none).
+    QString browserInsert(const QString &tabName, int row, const QVector<QVariantMap> &items, int transferId);
+    /// Changes items, with data from appendItemDataChunk() for @a transferId (-1 for none).
+    QString browserChange(const QString &tabName, int row, const QVector<QVariantMap> &items, int transferId);
 
     QByteArray browserItemData(const QString &tabName, int arg1, const QString &arg2);
     QVariantMap browserItemData(const QString &tabName, int arg1);
 
+    /// Returns part of item data so that large data are not sent in a single message.
+    QByteArray browserItemDataChunk(const QString &tabName, int row, const QString &mime, int offset, int size);
+    int browserItemDataSize(const QString &tabName, int row, const QString &mime);
+
+    /**
+     * Appends data to given format of an item for browserInsert()
+     * or browserChange() call with the same @a transferId.
+     */
+    void appendItemDataChunk(int transferId, int itemIndex, const QString &mime, const QByteArray &chunk);
+
+    /// Drops data received with appendItemDataChunk() for an aborted transfer.
+    void discardItemDataChunks(int transferId);
+
+    /// Returns data of items in rows (all if empty) with given formats (all if empty).
+    QVector<QVariantMap> browserItemsData(const QString &tabName, const QVector<int> &rows, const QStringList &formats);
+
+    /// Calls functions in order and returns "results" and "errors" (see endBatch()).
+    QVariantMap callFunctions(const QVector<QByteArray> &serializedFunctionCalls);
+
     void setCurrentTab(const QString &tabName);
 
     QString tab(const QString &tabName);
@@ -212,6 +265,9 @@ public slots:
 
     void serverLog(const QString &text);
 
+    void startTracing();
+    bool stopTracing(const QString &fileName);
+
     QString currentWindowTitle();
 
     int inputDialog(const NamedValueList &values);
@@ -250,6 +306,7 @@ public slots:
     void setTitle(const QString &title);
     void setTitleForData(const QVariantMap &data);
     void saveData(const QString &tab, const QVariantMap &data, ClipboardMode mode);
+    void updateClipboardItem(const QString &tab, quint64 itemHash, const QVariantMap &data);
     void showDataNotification(const QVariantMap &data);
 
     bool enableMenuItem(int actionId, int currentRun, int menuItemMatchCommandIndex, const QVariantMap &menuItem);
@@ -257,6 +314,7 @@ public slots:
     QVariantMap setDisplayData(int actionId, const QVariantMap &displayData);
 
     QVector<Command> automaticCommands();
+    QVariantMap automaticCommandStatistics();
     QVector<Command> displayCommands();
     QVector<Command> scriptCommands();
 
@@ -279,15 +337,39 @@ signals:
 private:
     ClipboardBrowser *fetchBrowser(const QString &tabName);
 
+    /// Same as default onClipboardChanged() script callback if no automatic command matches.
+    void onClipboardChangedWithoutCommands(const QVariantMap &data);
+
     QVariantMap itemData(const QString &tabName, int i);
     QByteArray itemData(const QString &tabName, int i, const QString &mime);
 
+    /// Returns item data for browserItemDataChunk(), kept until the last chunk is read.
+    const QByteArray &chunkedItemData(const QString &tabName, int row, const QString &mime, bool refresh);
+
+    /// Adds data received with appendItemDataChunk() to items and drops the transfer.
+    QVector<QVariantMap> takeItemDataChunks(int transferId, QVector<QVariantMap> items);
+
     ClipboardBrowser *currentBrowser() const;
     QList<QPersistentModelIndex> selectedIndexes() const;
 
+    struct FunctionCall {
+        int id = -1;
+        QByteArray slotName;
+        QVector<QVariant> arguments;
+    };
+
+    void sendFunctionCall(const QByteArray &serializedFunctionCall);
+    /// Queues call in batch and returns index of its result.
+    int queueFunctionCall(const QByteArray &serializedFunctionCall);
+    void flushFunctionCalls();
+
     QVariant waitForFunctionCallFinished(int functionId);
 
-    QByteArray callFunctionHelper(const QByteArray &serializedFunctionCall);
+    /// Invokes parsed call (unless there is a parse error) and returns serialized return value.
+    QByteArray callFunctionHelper(FunctionCall *functionCall, QString error);
+    static bool parseFunctionCall(
+            const QByteArray &serializedFunctionCall, FunctionCall *functionCall, QString *error);
+    bool invokeFunctionCall(FunctionCall *functionCall, QVariant *returnValue, QString *error);
 
 #ifdef HAS_TESTS
     KeyClicker *keyClicker();
@@ -302,14 +384,63 @@ private:
     int m_lastInputDialogId = -1;
 
     int m_functionCallStack = 0;
+    int m_batchLevel = 0;
+    QVector<QByteArray> m_queuedFunctionCalls;
+    QVariantList m_batchResults;
+    QStringList m_batchErrors;
+
     bool m_shouldBeDeleted = false;
 
+    /// Transfer ID -> item index -> format -> data (see appendItemDataChunk()).
+    QHash<int, QMap<int, QMap<QString, QByteArray>>> m_itemDataChunks;
+    QString m_chunkedItemKey;
+    /// Data read in parts (shares memory with the item data, see chunkedItemData()).
+    QByteArray m_chunkedItemData;
+
     int m_lastSelectionId = -1;
     QMap<int, ItemSelection> m_selections;
 
     bool m_disconnected = false;
 };
 
+/// Queues function calls in the scope (see ScriptableProxy::beginBatch()).
+class ScriptableProxyBatch final
+{
+public:
+    explicit ScriptableProxyBatch(ScriptableProxy *proxy)
+        : m_proxy(proxy)
+    {
+        m_proxy->beginBatch();
+    }
+
+    ~ScriptableProxyBatch()
+    {
+        finish();
+    }
+
+    /// Sends queued calls and returns errors (see ScriptableProxy::endBatch()).
+    QStringList finish()
+    {
+        if (m_finished)
+            return QStringList();
+        m_finished = true;
+        return m_proxy->endBatch();
+    }
+
+    ScriptableProxyBatch(const ScriptableProxyBatch &) = delete;
+    ScriptableProxyBatch &operator=(const ScriptableProxyBatch &) = delete;
+
+private:
+    ScriptableProxy *m_proxy;
+    bool m_finished = false;
+};
+
+/**
+ * Returns item data for format as returned by read() script function
+ * (special format "?" lists formats and mimeItems serializes the whole item).
+ */
+QByteArray itemDataForFormat(const QVariantMap &data, const QString &mime);
+
 QString pluginsPath();
 QString themesPath();
 QString translationsPath();
@@ -92,4 +92,15 @@ inline QString testTab(int i)
     return "Tab_&" + QString::number(i);
 }
 
+/**
+ * Script which sets variable to random (badly compressible) text
+ * of at least given length.
+ */
+inline QString randomTextScript(const QString &variableName, int minLength)
+{
+    return QString("var %1 = ''; while (%1.length < %2) %1 += Math.random().toString(36).slice(2);")
+            .arg(variableName)
+            .arg(minLength);
+}
+
 #endif // TEST_UTILS_H
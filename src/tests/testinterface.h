@@ -6,6 +6,7 @@
 #include "common/clipboardmode.h"
 
 #include <QStringList>
+#include <QVariantMap>
 
 #include <memory>
 
@@ -64,6 +65,10 @@ public:
             const QString &mime = QLatin1String("text/plain"),
             ClipboardMode mode = ClipboardMode::Clipboard) = 0;
 
+    /// Set clipboard with multiple formats (must contain text).
+    virtual QByteArray setClipboard(
+            const QVariantMap &data, ClipboardMode mode = ClipboardMode::Clipboard) = 0;
+
     /// Verify clipboard content.
     virtual QByteArray verifyClipboard(const QByteArray &data, const QString &mime, bool exact = true) = 0;
 
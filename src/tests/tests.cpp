@@ -6,6 +6,7 @@
 #include "common/action.h"
 #include "common/appconfig.h"
 #include "common/client_server.h"
+#include "common/clientsocket.h"
 #include "common/common.h"
 #include "common/config.h"
 #include "common/log.h"
@@ -22,12 +23,17 @@
 #include "platform/platformclipboard.h"
 #include "platform/platformnativeinterface.h"
 
+#include <QBuffer>
 #include <QDebug>
 #include <QDir>
 #include <QElapsedTimer>
 #include <QFile>
 #include <QFileInfo>
 #include <QGuiApplication>
+#include <QImage>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
 #include <QMap>
 #include <QMimeData>
 #include <QProcess>
@@ -485,6 +491,13 @@ public:
         return verifyClipboard(bytes, mime);
     }
 
+    QByteArray setClipboard(const QVariantMap &data, ClipboardMode mode) override
+    {
+        waitFor(waitMsSetClipboard);
+        clipboard()->setData(mode, data);
+        return verifyClipboard( data.value(mimeText).toByteArray(), mimeText );
+    }
+
     QByteArray verifyClipboard(const QByteArray &data, const QString &mime, bool exact = true) override
     {
         PerformanceTimer perf;
@@ -579,13 +592,18 @@ public:
         QDir settingsDir(settingsPath);
         const QStringList settingsFileFilters("copyq.test*");
         // Omit using dangerous QDir::removeRecursively().
-        for ( const auto &fileName : settingsDir.entryList(settingsFileFilters) ) {
-            const auto path = settingsDir.absoluteFilePath(fileName);
-            QFile settingsFile(path);
-            if ( settingsFile.exists() && !settingsFile.remove() ) {
-                return QString::fromLatin1("Failed to remove settings file \"%1\": %2")
-                    .arg(settingsPath, settingsFile.errorString())
-                    .toUtf8();
+        const QString blobsPath = getConfigurationFilePath("_blobs");
+        const QStringList settingsPaths{settingsPath, blobsPath, blobsPath + "/refs"};
+        for (const auto &path : settingsPaths) {
+            QDir dir(path);
+            const QStringList filters = path == settingsPath ? settingsFileFilters : QStringList();
+            for ( const auto &fileName : dir.entryList(filters, QDir::Files) ) {
+                QFile settingsFile( dir.absoluteFilePath(fileName) );
+                if ( settingsFile.exists() && !settingsFile.remove() ) {
+                    return QString::fromLatin1("Failed to remove settings file \"%1\": %2")
+                        .arg(settingsFile.fileName(), settingsFile.errorString())
+                        .toUtf8();
+                }
             }
         }
 
@@ -1107,6 +1125,33 @@ void Tests::commandsAddRead()
     RUN("read" << "3", "A");
 }
 
+void Tests::commandsWriteReadLargeData()
+{
+    const QDir sharedMemory( sharedMessageDirectory() );
+    const QStringList sharedMessageFilter{sharedMessageFileNamePattern()};
+    const auto sharedMessages = sharedMemory.entryList(sharedMessageFilter, QDir::Files);
+
+    // Large data can be passed in shared memory.
+    const auto script = R"(
+        var data = 'A'.repeat(3 * 1024 * 1024)
+        write(0, 'application/x-copyq-test-data', data)
+        var readData = read('application/x-copyq-test-data', 0)
+        print(readData.size() + ' ' + (str(readData) == data))
+        )";
+    RUN("eval" << script, QByteArray::number(3 * 1024 * 1024) + " true");
+
+    // Large data from stdin and in output are passed in multiple parts.
+    const QByteArray input(9 * 1024 * 1024 + 1, 'B');
+    RUN_WITH_INPUT("write" << COPYQ_MIME_PREFIX "test-stdin" << "-", input, "");
+    RUN("read" << COPYQ_MIME_PREFIX "test-stdin" << "0", input);
+    const QByteArray input2(9 * 1024 * 1024 + 1, 'C');
+    RUN_WITH_INPUT("change" << "0" << COPYQ_MIME_PREFIX "test-stdin" << "-", input2, "");
+    RUN("read" << COPYQ_MIME_PREFIX "test-stdin" << "0", input2);
+
+    // Messages in shared memory are removed after received or after disconnecting.
+    QCOMPARE( sharedMemory.entryList(sharedMessageFilter, QDir::Files), sharedMessages );
+}
+
 void Tests::commandsWriteRead()
 {
     const QByteArray input("\x00\x01\x02\x03\x04", 5);
@@ -1380,6 +1425,33 @@ void Tests::commandsBase64()
               "OK", data) );
 }
 
+void Tests::commandsReadConvertedImage()
+{
+    QImage image(8, 8, QImage::Format_RGB32);
+    image.fill(Qt::red);
+    QByteArray png;
+    QBuffer buffer(&png);
+    buffer.open(QIODevice::WriteOnly);
+    QVERIFY( image.save(&buffer, "PNG") );
+
+    // Only PNG is stored, BMP is converted when requested.
+    TEST( m_test->runClient(
+              Args() << "write"
+              << "image/png" << "-"
+              << COPYQ_MIME_PREFIX "image-formats" << "image/png\nimage/bmp", "",
+              png) );
+    RUN("read" << "?" << "0", "image/png\nimage/bmp\n");
+    RUN("read" << "image/png" << "0", png);
+    RUN("print(str(read('image/bmp', 0)).substring(0, 2))", "BM");
+    RUN("print(str(getItems([0], ['image/bmp'])[0]['image/bmp']).substring(0, 2))", "BM");
+
+    const auto script =
+        "setData('image/png', read('image/png', 0));"
+        "setData('" COPYQ_MIME_PREFIX "image-formats', 'image/png\\nimage/bmp');"
+        "print(dataFormats() + ':' + str(data('image/bmp')).substring(0, 2))";
+    RUN(script, "image/png,image/bmp:BM");
+}
+
 void Tests::commandsGetSetItem()
 {
     QMap<QByteArray, QByteArray> data;
@@ -1413,6 +1485,66 @@ void Tests::commandsGetSetItem()
     RUN(args << "eval" << "print(getitem(1)['text/html'])", "<b>HTML text 2</b>");
 }
 
+void Tests::commandGetItems()
+{
+    const QString tab = testTab(1);
+    const Args args = Args("tab") << tab;
+
+    RUN(args << "add" << "C" << "B" << "A", "");
+    RUN(args << "write" << "1" << "text/plain" << "X" << "text/html" << "<b>X</b>", "");
+
+    RUN(args << "eval" << "print(getItems().map(function(item) { return str(item[mimeText]) }).join(','))",
+        "A,X,B,C");
+    RUN(args << "eval" << "print(getItems([2, 0]).map(function(item) { return str(item[mimeText]) }).join(','))",
+        "B,A");
+    RUN(args << "eval" << "print(Object.keys(getItems([1], [mimeHtml])[0]))", "text/html");
+    RUN(args << "eval" << "print(getItems([]).length)", "0");
+
+    RUN(args << "separator" << "," << "read" << "0" << "2" << "3", "A,B,C");
+    RUN(args << "separator" << "," << "read" << "text/html" << "1" << "0", "<b>X</b>,");
+}
+
+void Tests::commandsReadItemsInLoop()
+{
+    const QString tab = testTab(1);
+    const Args args = Args("tab") << tab;
+
+    for (int i = 0; i < 40; ++i)
+        RUN(args << "add" << QString::number(i), "");
+
+    // Following rows are fetched at once.
+    const auto readAll = R"(
+        var texts = []
+        for (var i = 0; i < size(); ++i)
+            texts.push(str(read(i)))
+        print(texts.join(','))
+        )";
+    QByteArray expected;
+    for (int i = 39; i >= 0; --i)
+        expected.append(QByteArray::number(i) + (i > 0 ? "," : ""));
+    RUN(args << "eval" << readAll, expected);
+
+    // Changes made while reading are visible.
+    const auto readAndChange = R"(
+        var texts = []
+        for (var i = 0; i < 3; ++i) {
+            texts.push(str(read(i)))
+            write(i + 1, mimeText, 'X' + i)
+        }
+        print(texts.join(','))
+        )";
+    RUN(args << "eval" << readAndChange, "39,X0,X1");
+
+    const auto readSelection = R"(
+        var sel = ItemSelection().selectAll()
+        var texts = []
+        for (var i = 0; i < sel.length; ++i)
+            texts.push(str(sel.itemAtIndex(i)[mimeText]))
+        print(texts.slice(0, 5).join(',') + ' ' + texts.length)
+        )";
+    RUN(args << "eval" << readSelection, "39,X0,X1,X2,38 43");
+}
+
 void Tests::commandsChecksums()
 {
     RUN("md5sum" << "TEST", "033bd94b1168d7e4f0d644c3c95e35bf\n");
@@ -1909,6 +2041,100 @@ void Tests::commandUnload()
     RUN("unload" << "missing-tab", "missing-tab\n");
 }
 
+void Tests::loadManyItems()
+{
+    const auto tab = testTab(1);
+    const Args args = Args("tab") << tab;
+
+    RUN("config" << "maxitems" << "3000", "3000\n");
+    RUN(args << "eval" << "var items = []; for (var i = 0; i < 1000; ++i) items.push('item ' + i); add.apply(this, items)", "");
+    RUN("unload" << tab, tab + "\n");
+
+    // Items after the first page are loaded in background.
+    RUN(args << "size", "1000\n");
+    RUN(args << "read" << "0" << "500" << "999", "item 999\nitem 499\nitem 0");
+
+    // Save after loading keeps all items.
+    RUN(args << "add" << "new", "");
+    RUN("unload" << tab, tab + "\n");
+    RUN(args << "size", "1001\n");
+    RUN(args << "read" << "0" << "1000", "new\nitem 0");
+}
+
+void Tests::loadCompressedItems()
+{
+    const auto tab = testTab(1);
+    const Args args = Args("tab") << tab;
+
+    // Small and large (kept in file until needed) compressed data.
+    RUN(args << "eval" <<
+        randomTextScript("random", 300000) +
+        "add('x'.repeat(100000), random);"
+        "write(0, 'text/html', '<b>' + 'y'.repeat(1000) + '</b>')", "");
+    QByteArray random;
+    QByteArray stderrActual;
+    QCOMPARE( run(Args(args) << "read" << "1", &random, &stderrActual), 0 );
+    QVERIFY2( testStderr(stderrActual), stderrActual );
+    QVERIFY(random.size() >= 300000);
+
+    RUN("unload" << tab, tab + "\n");
+    RUN(args << "size", "3\n");
+    RUN(args << "eval" << "str(read(2)) == 'x'.repeat(100000)", "true\n");
+    RUN(args << "read" << "1", random);
+    RUN(args << "read" << "text/html" << "0", "<b>" + QByteArray(1000, 'y') + "</b>");
+}
+
+void Tests::shareLargeDataBetweenTabs()
+{
+    const auto tab1 = testTab(1);
+    const auto tab2 = testTab(2);
+    const Args args1 = Args("tab") << tab1;
+    const Args args2 = Args("tab") << tab2;
+
+    RUN(args1 << "eval" <<
+        randomTextScript("random", 200000) +
+        "add(random); tab('" + tab2 + "'); add(random)", "");
+    QByteArray data;
+    QByteArray stderrActual;
+    QCOMPARE( run(Args(args1) << "read" << "0", &data, &stderrActual), 0 );
+    QVERIFY2( testStderr(stderrActual), stderrActual );
+    QVERIFY(data.size() >= 200000);
+
+    RUN("unload" << tab1 << tab2, tab1 + "\n" + tab2 + "\n");
+    RUN(args1 << "read" << "0", data);
+    RUN(args2 << "read" << "0", data);
+
+    // Data used by other tab are kept after removing a tab.
+    RUN("removetab" << tab1, "");
+    waitFor(1000);
+    RUN("unload" << tab2, tab2 + "\n");
+    RUN(args2 << "read" << "0", data);
+}
+
+void Tests::removeUnusedLargeData()
+{
+    const auto tab = testTab(1);
+    const Args args = Args("tab") << tab;
+    const QDir blobs( getConfigurationFilePath("_blobs") );
+
+    RUN(args << "eval" <<
+        randomTextScript("random", 200000) +
+        "add(random); add(random + 'x')", "");
+    RUN("unload" << tab, tab + "\n");
+    QCOMPARE( blobs.entryList(QDir::Files).size(), 2 );
+
+    // Blob is removed after the last item using it is removed.
+    RUN(args << "remove" << "0", "");
+    RUN("unload" << tab, tab + "\n");
+    SleepTimer t(5000);
+    while ( blobs.entryList(QDir::Files).size() != 1 && t.sleep() ) {}
+    QCOMPARE( blobs.entryList(QDir::Files).size(), 1 );
+
+    // Data of the other item are kept.
+    RUN(args << "size", "1\n");
+    RUN(args << "eval" << "str(read(0)).length >= 200000", "true\n");
+}
+
 void Tests::commandForceUnload()
 {
     RUN("forceUnload", "");
@@ -1951,6 +2177,33 @@ void Tests::commandServerLogAndLogs()
     QVERIFY( QString::fromUtf8(stdoutActual).contains(re) );
 }
 
+void Tests::commandTrace()
+{
+    TemporaryFile tmp;
+    const auto fileName = tmp.fileName();
+
+    RUN_EXPECT_ERROR("trace" << "stop" << fileName, CommandException);
+    RUN_EXPECT_ERROR("trace" << "xxx", CommandException);
+
+    RUN("trace" << "start", "");
+    RUN("add" << "A", "");
+    RUN("trace" << "stop" << fileName, "");
+
+    QFile file(fileName);
+    QVERIFY( file.open(QIODevice::ReadOnly) );
+    const QJsonDocument document = QJsonDocument::fromJson( file.readAll() );
+    const QJsonArray events = document.object().value("traceEvents").toArray();
+    QVERIFY( !events.isEmpty() );
+
+    QStringList names;
+    for (const auto &event : events)
+        names.append( event.toObject().value("name").toString() );
+    QVERIFY2( names.contains("proxy call"), qPrintable(names.join(", ")) );
+
+    // Tracing is stopped.
+    RUN_EXPECT_ERROR("trace" << "stop" << fileName, CommandException);
+}
+
 void Tests::classByteArray()
 {
     RUN("ByteArray", "");
@@ -2584,6 +2837,33 @@ void Tests::searchAccented()
     WAIT_ON_OUTPUT("testSelected", QByteArray(clipboardTabName) + " 1 1\n");
 }
 
+void Tests::searchChangedItems()
+{
+    RUN("add" << "abc" << "XYZ" << "abcd", "");
+    RUN("filter" << "xyz", "");
+    WAIT_ON_OUTPUT("testSelected", QByteArray(clipboardTabName) + " 1 1\n");
+
+    RUN("change" << "1" << "text/plain" << "X", "");
+    RUN("change" << "2" << "text/plain" << "Wxýz", "");
+    RUN("filter" << "", "");
+    RUN("filter" << "XYZ", "");
+    WAIT_ON_OUTPUT("testSelected", QByteArray(clipboardTabName) + " 2 2\n");
+}
+
+void Tests::searchManyItems()
+{
+    RUN("config" << "maxitems" << "3000", "3000\n");
+    RUN("eval" << "var items = []; for (var i = 0; i < 2000; ++i) items.push('item ' + i); add.apply(this, items)", "");
+    RUN("size", "2000\n");
+
+    // First matching item is "item 1099".
+    RUN("filter" << "item 10", "");
+    WAIT_ON_OUTPUT("testSelected", QByteArray(clipboardTabName) + " 900 900\n");
+
+    RUN("filter" << "item 199", "");
+    WAIT_ON_OUTPUT("testSelected", QByteArray(clipboardTabName) + " 0 0\n");
+}
+
 void Tests::copyItems()
 {
     const auto tab = QString(clipboardTabName);
@@ -2730,6 +3010,122 @@ void Tests::clipboardToItem()
     WAIT_ON_OUTPUT("read" << "0", bytes);
 }
 
+void Tests::clipboardToItemScriptWorkers()
+{
+    // Restart script worker after each clipboard change.
+    RUN("config" << "script_worker_max_events" << "1", "1\n");
+    for (const auto &text : {"TEXT1", "TEXT2", "TEXT3"}) {
+        TEST( m_test->setClipboard(text) );
+        WAIT_ON_OUTPUT("read" << "0", text);
+    }
+
+    // Start new process for each clipboard change.
+    RUN("config" << "script_worker_pool_size" << "0", "0\n");
+    TEST( m_test->setClipboard("TEXT4") );
+    WAIT_ON_OUTPUT("read" << "0", "TEXT4");
+}
+
+void Tests::clipboardToItemScriptWorkerGlobals()
+{
+    // Global variables set by a callback are not visible to the next one.
+    const auto script = R"(
+        setCommands([{
+            isScript: true,
+            cmd: `
+                global.onClipboardChanged = function() {
+                    add(typeof global.leaked + ':' + str(data(mimeText)))
+                    global.leaked = 1
+                }
+            `
+        }])
+        )";
+    RUN(script, "");
+
+    TEST( m_test->setClipboard("TEXT1") );
+    WAIT_ON_OUTPUT("read" << "0", "undefined:TEXT1");
+    TEST( m_test->setClipboard("TEXT2") );
+    WAIT_ON_OUTPUT("read" << "0", "undefined:TEXT2");
+}
+
+void Tests::clipboardToItemScriptWorkerAbort()
+{
+    // Calling abort() ends only the current callback, not the worker.
+    const auto script = R"(
+        setCommands([{
+            isScript: true,
+            cmd: `
+                global.onClipboardChanged = function() {
+                    add('CALLED:' + str(data(mimeText)))
+                    abort()
+                }
+            `
+        }])
+        )";
+    RUN(script, "");
+
+    TEST( m_test->setClipboard("TEXT1") );
+    WAIT_ON_OUTPUT("read" << "0", "CALLED:TEXT1");
+    TEST( m_test->setClipboard("TEXT2") );
+    WAIT_ON_OUTPUT("read" << "0", "CALLED:TEXT2");
+    RUN("separator" << "," << "read" << "0" << "1" << "2", "CALLED:TEXT2,CALLED:TEXT1,");
+    RUN("size", "2\n");
+}
+
+void Tests::clipboardToItemDelayedFormats()
+{
+    // HTML is added to the item after the text.
+    const QVariantMap data{
+        {mimeText, QByteArray("TEXT1")},
+        {mimeHtml, QByteArray("<b>TEXT1</b>")},
+    };
+    TEST( m_test->setClipboard(data) );
+    WAIT_ON_OUTPUT("read" << "0", "TEXT1");
+    WAIT_ON_OUTPUT("read" << "text/html" << "0", "<b>TEXT1</b>");
+    RUN("size", "1\n");
+
+    // Automatic commands get all formats.
+    const auto script = R"(
+        setCommands([
+            { automatic: true, cmd: 'copyq: setData("DATA", data(mimeHtml))' },
+        ])
+        )";
+    RUN(script, "");
+    WAIT_ON_OUTPUT("commands().length", "1\n");
+
+    const QVariantMap data2{
+        {mimeText, QByteArray("TEXT2")},
+        {mimeHtml, QByteArray("<b>TEXT2</b>")},
+    };
+    TEST( m_test->setClipboard(data2) );
+    WAIT_ON_OUTPUT("read" << "0", "TEXT2");
+    RUN("read" << "DATA" << "0", "<b>TEXT2</b>");
+    RUN("read" << "text/html" << "0", "<b>TEXT2</b>");
+    RUN("size", "2\n");
+
+    // Commands with a delayed input format are not skipped.
+    const auto htmlScript = R"(
+        setCommands([
+            { automatic: true, input: 'text/html', cmd: 'copyq: setData("DATA", "HAS_HTML")' },
+        ])
+        )";
+    RUN(htmlScript, "");
+    WAIT_ON_OUTPUT("commands()[0].input", "text/html\n");
+
+    TEST( m_test->setClipboard("TEXT3") );
+    WAIT_ON_OUTPUT("read" << "0", "TEXT3");
+    RUN("read" << "DATA" << "0", "");
+
+    const QVariantMap data4{
+        {mimeText, QByteArray("TEXT4")},
+        {mimeHtml, QByteArray("<b>TEXT4</b>")},
+    };
+    TEST( m_test->setClipboard(data4) );
+    WAIT_ON_OUTPUT("read" << "0", "TEXT4");
+    RUN("read" << "DATA" << "0", "HAS_HTML");
+    RUN("read" << "text/html" << "0", "<b>TEXT4</b>");
+    RUN("size", "4\n");
+}
+
 void Tests::itemToClipboard()
 {
     RUN("add" << "TESTING2" << "TESTING1", "");
@@ -2778,6 +3174,31 @@ void Tests::tabAdd()
     RUN(args << "read" << "0" << "1" << "2", "abc def ghi");
 }
 
+void Tests::tabSaveChanges()
+{
+    const QString tab = testTab(1);
+    const Args args = Args("tab") << tab << "separator" << " ";
+
+    RUN(args << "add" << "E" << "D" << "C" << "B" << "A", "");
+
+    // Restart server to save all items first.
+    TEST( m_test->stopServer() );
+    TEST( m_test->startServer() );
+    RUN(args << "read" << "0" << "1" << "2" << "3" << "4", "A B C D E");
+
+    // Changes are appended to the tab file on save.
+    RUN(args << "remove" << "1", "");
+    RUN(args << "insert" << "2" << "X", "");
+    RUN(args << "change" << "0" << "text/plain" << "Y", "");
+    RUN(args << "ItemSelection().select(/^Y$/).move(3); read(0,1,2,3,4)", "C X Y D E");
+
+    TEST( m_test->stopServer() );
+    TEST( m_test->startServer() );
+
+    RUN(args << "size", "5\n");
+    RUN(args << "read" << "0" << "1" << "2" << "3" << "4", "C X Y D E");
+}
+
 void Tests::tabRemove()
 {
     const QString tab = testTab(1);
@@ -3792,6 +4213,33 @@ void Tests::automaticCommandIgnoreSpecialFormat()
     WAIT_ON_OUTPUT("separator" << "," << "read" << "0" << "1" << "2" << "3", "SHOULD NOT BE IGNORED,CMD2,CMD1,");
 }
 
+void Tests::automaticCommandStatistics()
+{
+    const auto script = R"(
+        setCommands([
+            { name: 'Change', automatic: true, re: '^CHANGE', cmd: 'copyq: setData("DATA", "DONE")' },
+        ])
+        )";
+    RUN(script, "");
+    WAIT_ON_OUTPUT("commands().length", "1\n");
+
+    const auto statistics = R"(
+        var s = automaticCommandStatistics()
+        print([s.checked, s.unmatched, s.commands[0].name, s.commands[0].matches].join(','))
+        )";
+
+    // Data is stored even if the script is skipped.
+    TEST( m_test->setClipboard("SKIPPED") );
+    WAIT_ON_OUTPUT("read" << "0", "SKIPPED");
+    RUN("read" << "DATA" << "0", "");
+    RUN(statistics, "1,1,Change,0");
+
+    TEST( m_test->setClipboard("CHANGE") );
+    WAIT_ON_OUTPUT("read" << "DATA" << "0", "DONE");
+    RUN("read" << "0", "CHANGE");
+    RUN(statistics, "2,1,Change,1");
+}
+
 void Tests::scriptCommandLoaded()
 {
     const auto script = R"(
@@ -57,6 +57,7 @@ private slots:
 
     void commandsAddRead();
     void commandsWriteRead();
+    void commandsWriteReadLargeData();
     void commandChange();
 
     void commandSetCurrentTab();
@@ -71,7 +72,10 @@ private slots:
 
     void commandsPackUnpack();
     void commandsBase64();
+    void commandsReadConvertedImage();
     void commandsGetSetItem();
+    void commandGetItems();
+    void commandsReadItemsInLoop();
 
     void commandsChecksums();
 
@@ -128,9 +132,14 @@ private slots:
     void commandMimeTypes();
 
     void commandUnload();
+    void loadManyItems();
+    void loadCompressedItems();
+    void shareLargeDataBetweenTabs();
+    void removeUnusedLargeData();
     void commandForceUnload();
 
     void commandServerLogAndLogs();
+    void commandTrace();
 
     void classByteArray();
     void classFile();
@@ -159,6 +168,8 @@ private slots:
     void searchItemsAndSelect();
     void searchRowNumber();
     void searchAccented();
+    void searchChangedItems();
+    void searchManyItems();
     void copyItems();
     void selectAndCopyOrder();
 
@@ -173,8 +184,13 @@ private slots:
     void toggleClipboardMonitoring();
 
     void clipboardToItem();
+    void clipboardToItemScriptWorkers();
+    void clipboardToItemScriptWorkerGlobals();
+    void clipboardToItemScriptWorkerAbort();
+    void clipboardToItemDelayedFormats();
     void itemToClipboard();
     void tabAdd();
+    void tabSaveChanges();
     void tabRemove();
     void tabIcon();
     void action();
@@ -239,6 +255,7 @@ private slots:
     void automaticCommandCopyToTab();
     void automaticCommandStoreSpecialFormat();
     void automaticCommandIgnoreSpecialFormat();
+    void automaticCommandStatistics();
 
     void scriptCommandLoaded();
     void scriptCommandAddFunction();